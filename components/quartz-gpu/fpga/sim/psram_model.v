@@ -0,0 +1,73 @@
+`timescale 1ns/1ps
+
+// Behavioural model of the badge's QSPI PSRAM, for simulation only.
+// Knows what quartz_psram sends: the switch to QPI mode (35h, in SPI mode), then QPI writes (38h)
+// and fast reads (EBh) with six wait cycles. Bursts run on linearly, page wrapping is not modelled.
+module psram_model #(
+	// Bytes modelled; higher addresses wrap around.
+	parameter size = 1 << 20
+)(
+	input  wire      sclk,
+	input  wire      ce_n,
+	inout  wire[3:0] sio
+);
+	
+	reg[7:0]  mem[0:size-1];
+	reg       qpi;
+	reg[7:0]  cmd;
+	reg[23:0] addr;
+	reg[3:0]  high;
+	// Rising clock edges since chip select fell.
+	integer   edges;
+	reg       drive;
+	reg[3:0]  out;
+	
+	assign sio = drive ? out : 4'bz;
+	
+	initial begin
+		qpi   = 0;
+		drive = 0;
+		edges = 0;
+	end
+	
+	always @(negedge ce_n) begin
+		edges = 0;
+	end
+	
+	always @(posedge ce_n) begin
+		drive = 0;
+	end
+	
+	always @(posedge sclk) if (!ce_n) begin
+		if (!qpi) begin
+			// A bit at a time on SIO0 until QPI mode is on.
+			cmd = { cmd[6:0], sio[0] };
+			if (edges == 7 && cmd == 8'h35) qpi = 1;
+		end else if (edges < 2) begin
+			cmd  = { cmd[3:0], sio };
+		end else if (edges < 8) begin
+			addr = { addr[19:0], sio };
+		end else if (cmd == 8'h38) begin
+			// High nibble first.
+			if (edges % 2 == 0) begin
+				high = sio;
+			end else begin
+				mem[addr % size] = { high, sio };
+				addr = addr + 1;
+			end
+		end
+		edges = edges + 1;
+	end
+	
+	// Read data changes on falling edges, from the one ending the last wait cycle.
+	always @(negedge sclk) if (!ce_n && qpi && cmd == 8'heb && edges >= 14) begin
+		drive = 1;
+		if (edges % 2 == 0) begin
+			out  = mem[addr % size][7:4];
+		end else begin
+			out  = mem[addr % size][3:0];
+			addr = addr + 1;
+		end
+	end
+	
+endmodule
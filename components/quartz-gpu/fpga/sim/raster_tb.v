@@ -0,0 +1,123 @@
+`timescale 1ns/1ps
+
+// Feeds the primitives recorded by host/quartz_vectors into raster.v on its own and checks that
+// it produces the same pixels as quartz_model.c, in the same order, while the pixel stream is
+// stalled at random.
+// Usage: vvp raster_tb.vvp +prims=raster_prims.hex +pixels=raster_pixels.hex
+module raster_tb;
+	
+	localparam clk_half  = 41.667;
+	// Cycles a primitive may take, enough for one covering the screen with the stream stalled half the time.
+	localparam timeout   = 4000000;
+	
+	reg        clk       = 0;
+	reg        start     = 0;
+	reg        is_line   = 0;
+	reg [15:0] prim_in[0:10];
+	wire       busy;
+	wire       pix_valid;
+	reg        pix_ready = 0;
+	wire[8:0]  pix_x;
+	wire[7:0]  pix_y;
+	wire[15:0] pix_z;
+	wire[15:0] pix_color;
+	wire[15:0] pix_mask;
+	wire       pix_max;
+	
+	always #(clk_half) clk = !clk;
+	
+	quartz_raster dut(
+		clk, start, is_line,
+		prim_in[0], prim_in[1], prim_in[2], prim_in[3], prim_in[4], prim_in[5],
+		prim_in[6], prim_in[7], prim_in[8], prim_in[9], prim_in[10],
+		busy,
+		pix_valid, pix_ready,
+		pix_x, pix_y, pix_z, pix_color, pix_mask, pix_max
+	);
+	
+	// Primitives and pixels, see host/quartz_vectors.c.
+	reg [15:0]   prims[0:(1 << 14) - 1];
+	reg [15:0]   want[0:(1 << 22) - 1];
+	// File names from the command line.
+	reg [2047:0] prims_file;
+	reg [2047:0] pixels_file;
+	
+	// Pixels accepted in total and of the current primitive.
+	integer pixel  = 0;
+	integer got    = 0;
+	integer prim   = 0;
+	integer errors = 0;
+	
+	// Stall the stream about a third of the time.
+	always @(negedge clk) pix_ready <= $urandom % 3 != 0;
+	
+	// Check every pixel as it is accepted.
+	always @(posedge clk) begin
+		if (pix_valid && pix_ready) begin
+			if ({ 7'b0, pix_x }   !== want[pixel*6]     || { 8'b0, pix_y } !== want[pixel*6 + 1]
+			 || pix_z             !== want[pixel*6 + 2] || pix_color       !== want[pixel*6 + 3]
+			 || pix_mask          !== want[pixel*6 + 4] || { 15'b0, pix_max } !== want[pixel*6 + 5]) begin
+				if (errors < 10) begin
+					$display("primitive %0d, pixel %0d: (%0d, %0d) z %04x color %04x mask %04x max %0d, not (%0d, %0d) z %04x color %04x mask %04x max %0d",
+						prim, got, pix_x, pix_y, pix_z, pix_color, pix_mask, pix_max,
+						want[pixel*6], want[pixel*6 + 1], want[pixel*6 + 2],
+						want[pixel*6 + 3], want[pixel*6 + 4], want[pixel*6 + 5]);
+				end
+				errors = errors + 1;
+			end
+			pixel = pixel + 1;
+			got   = got + 1;
+		end
+	end
+	
+	integer base;
+	integer waited;
+	integer i;
+	
+	initial begin
+		if (!$value$plusargs("prims=%s", prims_file) || !$value$plusargs("pixels=%s", pixels_file)) begin
+			$display("FAIL: usage: vvp raster_tb.vvp +prims=raster_prims.hex +pixels=raster_pixels.hex");
+			$finish;
+		end
+		$readmemh(prims_file, prims);
+		$readmemh(pixels_file, want);
+		
+		for (prim = 0; prim < prims[0]; prim = prim + 1) begin
+			base = 1 + prim * 13;
+			
+			// Start the primitive on one edge.
+			@(negedge clk);
+			is_line = prims[base];
+			for (i = 0; i < 11; i = i + 1) prim_in[i] = prims[base + 1 + i];
+			got   = 0;
+			start = 1;
+			@(negedge clk);
+			start = 0;
+			
+			// Wait for it to finish.
+			waited = 0;
+			while (busy && waited < timeout) begin
+				@(negedge clk);
+				waited = waited + 1;
+			end
+			if (busy) begin
+				$display("FAIL: primitive %0d did not finish", prim);
+				$finish;
+			end
+			if (got != prims[base + 12]) begin
+				if (errors < 10) begin
+					$display("primitive %0d: %0d pixels, not %0d", prim, got, prims[base + 12]);
+				end
+				errors = errors + 1;
+			end
+		end
+		
+		if (errors == 0) begin
+			$display("PASS: %0d primitives, %0d pixels", prim, pixel);
+		end else begin
+			$display("FAIL: %0d errors in %0d primitives", errors, prim);
+		end
+		$finish;
+	end
+	
+endmodule
@@ -0,0 +1,184 @@
+`timescale 1ns/1ps
+
+// Replays the SPI transactions of a scene recorded by host/quartz_vectors into top.v,
+// with a model of the PSRAM, and checks every frame sent to the LCD against the frames
+// quartz_model.c showed for the same transactions.
+// Usage: vvp top_tb.vvp +spi=<scene>_spi.hex +lcd=<scene>_lcd.hex
+module top_tb;
+	
+	// The 12 MHz oscillator and a 40 MHz SPI clock, as on the badge; half periods in ns.
+	localparam clk_half     = 41.667;
+	localparam spi_half     = 12.5;
+	// Cycles between tearing effect pulses, far fewer than the panel's to keep the simulation short.
+	localparam fmark_period = 20000;
+	// Cycles to wait for the interrupt, enough to send a frame to the LCD.
+	localparam irq_timeout  = 4000000;
+	localparam pixels       = 320 * 240;
+	
+	reg       clk_in    = 0;
+	wire      irq_n;
+	reg       spi_mosi  = 0;
+	wire      spi_miso;
+	reg       spi_clk   = 0;
+	reg       spi_cs_n  = 1;
+	wire[7:0] pmod;
+	wire      red_n, green_n, blue_n;
+	wire[3:0] ram_io;
+	wire      ram_clk;
+	wire      ram_cs_n;
+	wire      lcd_rs;
+	wire      lcd_wr_n;
+	wire[7:0] lcd_d;
+	reg       lcd_fmark = 0;
+	
+	always #(clk_half) clk_in = !clk_in;
+	
+	top dut(
+		.clk_in    (clk_in),
+		.irq_n     (irq_n),
+		.spi_mosi  (spi_mosi),
+		.spi_miso  (spi_miso),
+		.spi_clk   (spi_clk),
+		.spi_cs_n  (spi_cs_n),
+		.pmod      (pmod),
+		.red_n     (red_n),
+		.green_n   (green_n),
+		.blue_n    (blue_n),
+		.ram_io    (ram_io),
+		.ram_clk   (ram_clk),
+		.ram_cs_n  (ram_cs_n),
+		.lcd_rs    (lcd_rs),
+		.lcd_wr_n  (lcd_wr_n),
+		.lcd_cs_n  (1'b0),
+		.lcd_d     (lcd_d),
+		.lcd_mode  (1'b1),
+		.lcd_rst_n (1'b1),
+		.lcd_fmark (lcd_fmark)
+	);
+	
+	psram_model ram(ram_clk, ram_cs_n, ram_io);
+	
+	// Transactions and expected frames, see host/quartz_vectors.c.
+	reg [7:0]    stream[0:(1 << 22) - 1];
+	reg [15:0]   want[0:(1 << 21) - 1];
+	// File names from the command line.
+	reg [2047:0] spi_file;
+	reg [2047:0] lcd_file;
+	
+	// Tearing effect pulses.
+	integer cycle = 0;
+	always @(posedge clk_in) begin
+		cycle     <= cycle + 1;
+		lcd_fmark <= cycle % fmark_period < 10;
+	end
+	
+	// The panel: takes a byte on the rising edge of the write strobe, pixels high byte first after Memory Write.
+	reg [7:0]  lcd_cmd   = 0;
+	reg [7:0]  lcd_high;
+	reg        lcd_low   = 0;
+	integer    lcd_index = 0;
+	integer    frames    = 0;
+	integer    errors    = 0;
+	reg [15:0] lcd_want;
+	
+	always @(posedge lcd_wr_n) begin
+		if (lcd_rs === 1'b0) begin
+			lcd_cmd   = lcd_d;
+			lcd_index = 0;
+			lcd_low   = 0;
+		end else if (lcd_rs === 1'b1 && lcd_cmd == 8'h2c) begin
+			if (!lcd_low) begin
+				lcd_high = lcd_d;
+				lcd_low  = 1;
+			end else begin
+				lcd_low  = 0;
+				lcd_want = frames < want[0] ? want[1 + frames * pixels + lcd_index] : 16'hxxxx;
+				if ({ lcd_high, lcd_d } !== lcd_want) begin
+					if (errors < 10) begin
+						$display("frame %0d: pixel (%0d, %0d) is %04x, not %04x",
+							frames, lcd_index % 320, lcd_index / 320, { lcd_high, lcd_d }, lcd_want);
+					end
+					errors = errors + 1;
+				end
+				lcd_index = lcd_index + 1;
+				if (lcd_index == pixels) begin
+					frames    = frames + 1;
+					lcd_index = 0;
+				end
+			end
+		end
+	end
+	
+	// Send a byte, most significant bit first; the GPU samples on the rising edge.
+	task spi_byte(input[7:0] value);
+		integer bit_no;
+		begin
+			for (bit_no = 7; bit_no >= 0; bit_no = bit_no - 1) begin
+				spi_mosi = value[bit_no];
+				#(spi_half) spi_clk = 1;
+				#(spi_half) spi_clk = 0;
+			end
+		end
+	endtask
+	
+	// Wait for the GPU to raise its interrupt.
+	task wait_irq(input integer at);
+		integer waited;
+		begin
+			waited = 0;
+			while (irq_n !== 1'b0 && waited < irq_timeout) begin
+				@(posedge clk_in);
+				waited = waited + 1;
+			end
+			if (irq_n !== 1'b0) begin
+				$display("FAIL: no interrupt before the transaction at byte %0d", at);
+				$finish;
+			end
+		end
+	endtask
+	
+	integer ptr;
+	integer len;
+	integer i;
+	
+	initial begin
+		if (!$value$plusargs("spi=%s", spi_file) || !$value$plusargs("lcd=%s", lcd_file)) begin
+			$display("FAIL: usage: vvp top_tb.vvp +spi=<scene>_spi.hex +lcd=<scene>_lcd.hex");
+			$finish;
+		end
+		$readmemh(spi_file, stream);
+		$readmemh(lcd_file, want);
+		
+		// The PSRAM controller waits 2048 cycles before switching the RAM to QPI mode.
+		repeat (4000) @(posedge clk_in);
+		
+		ptr = 0;
+		while (stream[ptr] !== 8'hff) begin
+			len = { stream[ptr + 1], stream[ptr + 2] };
+			if (stream[ptr][0]) wait_irq(ptr);
+			ptr = ptr + 3;
+			
+			spi_cs_n = 0;
+			#(spi_half);
+			for (i = 0; i < len; i = i + 1) begin
+				spi_byte(stream[ptr + i]);
+			end
+			#(spi_half);
+			spi_cs_n = 1;
+			ptr = ptr + len;
+			
+			// The GPU sees chip select rise on its own clock.
+			repeat (4) @(posedge clk_in);
+		end
+		
+		// The last response came after the last frame was sent.
+		repeat (100) @(posedge clk_in);
+		if (errors == 0 && frames == want[0]) begin
+			$display("PASS: %0d frames", frames);
+		end else begin
+			$display("FAIL: %0d of %0d frames, %0d wrong pixels", frames, want[0], errors);
+		end
+		$finish;
+	end
+	
+endmodule
@@ -0,0 +1,342 @@
+
+// Framebuffer in the PSRAM, with a color plane and a depth plane of RGB565 / 16-bit depth pixels.
+// Pixel (x, y) is at index y*320+x and stored little endian at byte 2*index of its plane.
+// Takes one operation at a time from the command sequencer and draws rasterizer pixels while idle.
+// Besides the planes, the write and read operations can stream data to and from anywhere in the PSRAM.
+module quartz_fb(
+	input  wire       clk,
+	
+	// Operation from the command sequencer, taken when not busy.
+	input  wire       op_start,
+	input  wire[1:0]  op_kind,
+	// Byte address and length of a write or read, up to 2048 bytes.
+	input  wire[22:0] op_addr,
+	input  wire[11:0] op_bytes,
+	// Values and planes of a fill.
+	input  wire[15:0] op_color,
+	input  wire[15:0] op_depth,
+	input  wire[1:0]  op_planes,
+	output wire       busy,
+	
+	// Data to write; data_next pulses when a byte is taken, the next must follow a cycle later.
+	input  wire[7:0]  data,
+	output wire       data_next,
+	// Data read; read_valid pulses with every byte.
+	output wire[7:0]  read_data,
+	output wire       read_valid,
+	
+	// Pixels from the rasterizer.
+	input  wire       pix_valid,
+	output wire       pix_ready,
+	input  wire[8:0]  pix_x,
+	input  wire[7:0]  pix_y,
+	input  wire[15:0] pix_z,
+	input  wire[15:0] pix_color,
+	input  wire[15:0] pix_mask,
+	input  wire       pix_max,
+	
+	// Scanout to the LCD driver, started at the next tearing effect pulse.
+	input  wire       fmark_rise,
+	output reg        lcd_frame,
+	output reg        lcd_valid,
+	output reg [15:0] lcd_pix,
+	input  wire       lcd_next,
+	
+	// PSRAM pins.
+	inout  wire[3:0]  ram_io,
+	output wire       ram_clk,
+	output wire       ram_cs_n
+);
+	
+	localparam op_fill    = 0;
+	localparam op_write   = 1;
+	localparam op_present = 2;
+	localparam op_read    = 3;
+	
+	localparam pixels     = 76800;
+	localparam depth_base = 23'h040000;
+	
+	localparam f_idle      = 0;
+	localparam f_mem       = 1;
+	localparam f_fill      = 2;
+	localparam f_write     = 3;
+	localparam f_vsync     = 4;
+	localparam f_present   = 5;
+	localparam f_px_depth  = 6;
+	localparam f_px_merge  = 7;
+	localparam f_px_wdepth = 8;
+	localparam f_px_max    = 9;
+	localparam f_read      = 10;
+	
+	reg[3:0]   state;
+	// State to return to after a PSRAM transaction.
+	reg[3:0]   ret;
+	
+	assign busy      = state != f_idle;
+	assign pix_ready = state == f_idle && !op_start;
+	
+	// PSRAM transaction.
+	reg        mem_req;
+	reg        mem_write;
+	reg[22:0]  mem_addr;
+	reg[5:0]   mem_len;
+	wire       mem_ready;
+	wire       mem_wnext;
+	wire[7:0]  mem_rdata;
+	wire       mem_rvalid;
+	// Written data is streamed in or repeats `wval`, low byte first.
+	// Transactions on `wval` and `rword` are whole pixels, so `wb` and `rb` are back to 0 after each one.
+	reg        src_data;
+	reg[15:0]  wval;
+	reg        wb;
+	wire[7:0]  mem_wdata = src_data ? data : wb ? wval[15:8] : wval[7:0];
+	assign     data_next = src_data && mem_wnext;
+	// Read data goes to the scanout FIFO, out of read_data or to `rword`.
+	reg        dst_fifo;
+	reg        dst_read;
+	assign     read_data  = mem_rdata;
+	assign     read_valid = dst_read && mem_rvalid;
+	reg        rb;
+	reg[7:0]   rlo;
+	reg[15:0]  rword;
+	
+	quartz_psram psram(
+		clk,
+		mem_req,
+		mem_write,
+		mem_addr,
+		mem_len,
+		mem_ready,
+		mem_wdata,
+		mem_wnext,
+		mem_rdata,
+		mem_rvalid,
+		ram_io,
+		ram_clk,
+		ram_cs_n
+	);
+	
+	// Pixel being drawn.
+	reg[16:0]  px_index;
+	reg[15:0]  px_z;
+	reg[15:0]  px_color;
+	reg[15:0]  px_mask;
+	wire[16:0] pix_index = { pix_y, 8'b0 } + { pix_y, 6'b0 } + pix_x;
+	
+	// Per-channel maximum of two RGB565 colors.
+	wire[4:0]  max_r = rword[15:11] > px_color[15:11] ? rword[15:11] : px_color[15:11];
+	wire[5:0]  max_g = rword[10:5]  > px_color[10:5]  ? rword[10:5]  : px_color[10:5];
+	wire[4:0]  max_b = rword[4:0]   > px_color[4:0]   ? rword[4:0]   : px_color[4:0];
+	
+	// Fill and span progress.
+	reg[22:0]  addr;
+	reg[17:0]  left;
+	wire[5:0]  page_room = 32 - addr[4:0];
+	reg        fill_depth;
+	reg[1:0]   planes;
+	reg[15:0]  fill_depth_val;
+	
+	// Scanout FIFO.
+	reg[15:0]  fifo[31:0];
+	reg[4:0]   fifo_wp;
+	reg[4:0]   fifo_rp;
+	reg[5:0]   fifo_count;
+	reg[16:0]  scan_left;
+	wire       fifo_push = dst_fifo && mem_rvalid && rb;
+	wire       fifo_pop  = fifo_count != 0 && (!lcd_valid || lcd_next);
+	
+	initial begin
+		state      = f_idle;
+		mem_req    = 0;
+		wb         = 0;
+		rb         = 0;
+		src_data   = 0;
+		dst_fifo   = 0;
+		dst_read   = 0;
+		lcd_frame  = 0;
+		lcd_valid  = 0;
+		fifo_wp    = 0;
+		fifo_rp    = 0;
+		fifo_count = 0;
+		scan_left  = 0;
+	end
+	
+	// Start a PSRAM transaction, continuing in `next` when it is done.
+	task mem_start(input write, input[22:0] start_addr, input[5:0] len, input[3:0] next);
+		begin
+			mem_req   <= 1;
+			mem_write <= write;
+			mem_addr  <= start_addr;
+			mem_len   <= len;
+			ret       <= next;
+			state     <= f_mem;
+		end
+	endtask
+	
+	// Byte streams.
+	always @(posedge clk) begin
+		if (mem_wnext && !src_data) wb <= !wb;
+		if (mem_rvalid && !dst_read) begin
+			rb  <= !rb;
+			rlo <= mem_rdata;
+			if (rb && !dst_fifo) rword <= { mem_rdata, rlo };
+		end
+		if (fifo_push) begin
+			fifo[fifo_wp] <= { mem_rdata, rlo };
+			fifo_wp       <= fifo_wp + 1;
+		end
+		
+		// Hand pixels to the LCD driver.
+		if (fifo_pop) begin
+			lcd_pix   <= fifo[fifo_rp];
+			lcd_valid <= 1;
+			fifo_rp   <= fifo_rp + 1;
+		end else if (lcd_next) begin
+			lcd_valid <= 0;
+		end
+		fifo_count <= fifo_count + fifo_push - fifo_pop;
+		if (lcd_frame) begin
+			scan_left <= pixels;
+		end else if (lcd_next) begin
+			scan_left <= scan_left - 1;
+		end
+	end
+	
+	always @(posedge clk) begin
+		lcd_frame <= 0;
+		
+		case (state)
+			f_idle: if (op_start) begin
+				if (op_kind == op_fill) begin
+					planes         <= op_planes;
+					wval           <= op_color;
+					fill_depth_val <= op_depth;
+					fill_depth     <= !op_planes[0];
+					addr           <= op_planes[0] ? 0 : depth_base;
+					left           <= pixels * 2;
+					state          <= op_planes ? f_fill : f_idle;
+				end else if (op_kind == op_write) begin
+					addr           <= op_addr;
+					left           <= op_bytes;
+					src_data       <= 1;
+					state          <= f_write;
+				end else if (op_kind == op_read) begin
+					addr           <= op_addr;
+					left           <= op_bytes;
+					dst_read       <= 1;
+					state          <= f_read;
+				end else begin
+					state          <= f_vsync;
+				end
+				
+			end else if (pix_valid) begin
+				px_index <= pix_index;
+				px_z     <= pix_z;
+				px_color <= pix_color;
+				px_mask  <= pix_mask;
+				if (pix_max) begin
+					mem_start(0, { pix_index, 1'b0 }, 2, f_px_max);
+				end else begin
+					mem_start(0, depth_base + { pix_index, 1'b0 }, 2, f_px_depth);
+				end
+			end
+			
+			// Wait for the PSRAM to take the request, then to finish it.
+			f_mem: begin
+				if (mem_req && mem_ready) begin
+					mem_req <= 0;
+				end else if (!mem_req && mem_ready) begin
+					state   <= ret;
+				end
+			end
+			
+			// Write the planes in 32-byte bursts.
+			f_fill: begin
+				if (left != 0) begin
+					mem_start(1, addr, 32, f_fill);
+					addr <= addr + 32;
+					left <= left - 32;
+				end else if (!fill_depth && planes[1]) begin
+					wval       <= fill_depth_val;
+					fill_depth <= 1;
+					addr       <= depth_base;
+					left       <= pixels * 2;
+				end else begin
+					state      <= f_idle;
+				end
+			end
+			
+			// Store streamed data, in bursts that end on 32 byte boundaries so they stay within a RAM page.
+			f_write: begin
+				if (left != 0) begin
+					mem_start(1, addr, left > page_room ? page_room : left, f_write);
+					addr <= addr + page_room;
+					left <= left > page_room ? left - page_room : 0;
+				end else begin
+					src_data   <= 0;
+					state      <= f_idle;
+				end
+			end
+			
+			// Stream data out, in bursts that stay within a RAM page as well.
+			f_read: begin
+				if (left != 0) begin
+					mem_start(0, addr, left > page_room ? page_room : left, f_read);
+					addr <= addr + page_room;
+					left <= left > page_room ? left - page_room : 0;
+				end else begin
+					dst_read   <= 0;
+					state      <= f_idle;
+				end
+			end
+			
+			// Start the scanout when the panel starts blanking.
+			f_vsync: if (fmark_rise) begin
+				lcd_frame  <= 1;
+				dst_fifo   <= 1;
+				addr       <= 0;
+				left       <= pixels;
+				state      <= f_present;
+			end
+			
+			// Keep the FIFO filled until every pixel went to the LCD.
+			f_present: if (!lcd_frame) begin
+				if (left != 0 && fifo_count <= 16) begin
+					mem_start(0, addr, 32, f_present);
+					addr <= addr + 32;
+					left <= left - 16;
+				end else if (left == 0 && scan_left == 0) begin
+					dst_fifo <= 0;
+					state    <= f_idle;
+				end
+			end
+			
+			// Depth test, then write the pixel, merging with the stored color outside the mask.
+			f_px_depth: begin
+				if (px_z <= rword) begin
+					state <= f_idle;
+				end else if (px_mask == 16'hffff) begin
+					wval  <= px_color;
+					mem_start(1, { px_index, 1'b0 }, 2, f_px_wdepth);
+				end else begin
+					mem_start(0, { px_index, 1'b0 }, 2, f_px_merge);
+				end
+			end
+			f_px_merge: begin
+				wval  <= (px_color & px_mask) | (rword & ~px_mask);
+				mem_start(1, { px_index, 1'b0 }, 2, f_px_wdepth);
+			end
+			f_px_wdepth: begin
+				wval  <= px_z;
+				mem_start(1, depth_base + { px_index, 1'b0 }, 2, f_idle);
+			end
+			
+			// Blend with the per-channel maximum.
+			f_px_max: begin
+				wval  <= { max_r, max_g, max_b };
+				mem_start(1, { px_index, 1'b0 }, 2, f_idle);
+			end
+		endcase
+	end
+	
+endmodule
@@ -0,0 +1,385 @@
+
+// Geometry unit for resident meshes, meant to draw the same pixels as quartz_model.c;
+// the meshes scene of sim/top_tb.v compares the two.
+// Reads the triangles of a mesh from the PSRAM through the framebuffer, one at a time,
+// transforms, projects, culls and lights them, and hands the visible ones to the rasterizer.
+module quartz_geom(
+	input  wire        clk,
+
+	// Define mesh `mesh_handle`.
+	input  wire        mesh_we,
+	input  wire[5:0]   mesh_handle,
+	input  wire[22:0]  mesh_vtx_addr,
+	input  wire[15:0]  mesh_num_vertex,
+	input  wire[22:0]  mesh_tri_addr,
+	input  wire[15:0]  mesh_num_tri,
+
+	// Parameter bytes in the order they are sent, shifted into the projection
+	// or into the color and placement of the next draw.
+	input  wire        view_shift,
+	input  wire        draw_shift,
+	input  wire[7:0]   par_data,
+
+	// Draw mesh `handle` with the current parameters, ignored while busy.
+	input  wire        start,
+	input  wire[5:0]   handle,
+	output wire        busy,
+
+	// Reads from the PSRAM, done by the framebuffer; every byte comes with a pulse on rd_valid.
+	output wire        rd_start,
+	output reg [22:0]  rd_addr,
+	output reg [11:0]  rd_bytes,
+	input  wire        fb_busy,
+	input  wire[7:0]   rd_data,
+	input  wire        rd_valid,
+
+	// Triangles for the rasterizer, laid out like those of QUARTZ_CMD_TRIS.
+	output wire        tri_start,
+	input  wire        raster_busy,
+	output wire[159:0] tri
+);
+
+	localparam g_idle       = 0;
+	localparam g_wait       = 1;
+	localparam g_mesh       = 2;
+	localparam g_tri        = 3;
+	localparam g_fetch      = 4;
+	localparam g_fetch_wait = 5;
+	localparam g_index      = 6;
+	localparam g_rot        = 7;
+	localparam g_rot_acc    = 8;
+	localparam g_proj       = 9;
+	localparam g_x0         = 10;
+	localparam g_x1         = 11;
+	localparam g_y0         = 12;
+	localparam g_y1         = 13;
+	localparam g_z          = 14;
+	localparam g_area0      = 15;
+	localparam g_area1      = 16;
+	localparam g_area2      = 17;
+	localparam g_light0     = 18;
+	localparam g_light1     = 19;
+	localparam g_shade      = 20;
+	localparam g_raster     = 21;
+	localparam g_next       = 22;
+
+	reg[4:0]  state;
+	// State to continue in once a read, the multiplier or the divider is done.
+	reg[4:0]  ret;
+
+	assign busy      = state != g_idle;
+	assign rd_start  = state == g_fetch && !fb_busy;
+	assign tri_start = state == g_raster && !raster_busy;
+
+	// Mesh table: u23 vertex address, u16 vertex count, u23 triangle address, u16 triangle count.
+	reg [77:0] mesh_table[63:0];
+	reg [77:0] mesh_entry;
+	integer    i;
+
+	initial begin
+		for (i = 0; i < 64; i = i + 1) mesh_table[i] = 0;
+	end
+
+	always @(posedge clk) begin
+		if (mesh_we) mesh_table[mesh_handle] <= { mesh_num_tri, mesh_tri_addr, mesh_num_vertex, mesh_vtx_addr };
+		mesh_entry <= mesh_table[handle];
+	end
+
+	// Projection: i32 focal, i16 scale, i16 cx, i16 cy, i32 depth_a, i32 depth_b.
+	reg [143:0] view;
+	wire signed[31:0] focal   = view[31:0];
+	wire signed[15:0] scale   = view[47:32];
+	wire signed[15:0] view_cx = view[63:48];
+	wire signed[15:0] view_cy = view[79:64];
+	wire signed[31:0] depth_a = view[111:80];
+	wire signed[31:0] depth_b = view[143:112];
+
+	// Draw: u16 color, i16 rot[3][3], u8 shift, i32 pos[3], i16 light[3].
+	reg [311:0] draw_par;
+	wire[15:0]  color = draw_par[15:0];
+	wire[4:0]   shift = draw_par[164:160];
+
+	// Mesh being drawn.
+	reg [22:0]  vtx_addr;
+	reg [15:0]  num_vertex;
+	reg [22:0]  tri_ptr;
+	reg [15:0]  tri_left;
+
+	// Triangle being drawn: u16 indices[3], i8 normal[3], u8 unused; and vertex: i16 x, y, z.
+	reg         fetch_tri;
+	reg [79:0]  tri_raw;
+	reg [47:0]  vtx_raw;
+	reg [1:0]   k;
+	wire[15:0]  index = k == 0 ? tri_raw[15:0] : k == 1 ? tri_raw[31:16] : tri_raw[47:32];
+
+	// Transform, row by row.
+	reg [1:0]   row;
+	reg [1:0]   col;
+	reg signed[33:0] acc;
+	reg signed[31:0] p0, p1, p2;
+	reg signed[32:0] w;
+	wire signed[15:0] rot_sel  = draw_par[16 + 16 * (row * 3 + col) +: 16];
+	wire signed[15:0] vtx_sel  = col == 0 ? vtx_raw[15:0] : col == 1 ? vtx_raw[31:16] : vtx_raw[47:32];
+	wire signed[31:0] pos_sel  = draw_par[168 + 32 * row +: 32];
+	wire signed[33:0] rot_sum  = acc + mul_p;
+	wire signed[33:0] rot_shr  = rot_sum >>> shift;
+	wire signed[31:0] p_next   = rot_shr[31:0] + pos_sel;
+	wire signed[32:0] w_next   = focal + p2;
+
+	// Projected vertices, clamped like quartz_model.c does.
+	reg signed[15:0] x0, y0, x1, y1, x2, y2;
+	reg       [15:0] z0, z1, z2;
+	wire signed[32:0] sum_x = view_cx + div_q;
+	wire signed[32:0] sum_y = view_cy - div_q;
+	wire signed[32:0] sum_z = div_q + depth_b;
+	wire       [15:0] clamp_x = sum_x < -32768 ? 16'h8000 : sum_x > 32767 ? 16'h7fff : sum_x[15:0];
+	wire       [15:0] clamp_y = sum_y < -32768 ? 16'h8000 : sum_y > 32767 ? 16'h7fff : sum_y[15:0];
+	wire       [15:0] clamp_z = sum_z < 1      ? 16'h0001 : sum_z > 65535 ? 16'hffff : sum_z[15:0];
+
+	// Flat shading: shade = 155 - floor(100 * dot(light, normal) / 2^22).
+	reg [1:0]   li;
+	reg signed[25:0] dot;
+	reg [15:0]  tri_color;
+	wire signed[15:0] light_sel  = draw_par[264 + 16 * li +: 16];
+	wire signed[7:0]  normal_sel = li == 0 ? tri_raw[55:48] : li == 1 ? tri_raw[63:56] : tri_raw[71:64];
+	wire signed[33:0] dot100     = (dot <<< 6) + (dot <<< 5) + (dot <<< 2);
+	wire signed[33:0] shade_raw  = 155 - (dot100 >>> 22);
+	wire       [8:0]  shade_mul  = (shade_raw < 0 ? 0 : shade_raw > 255 ? 255 : shade_raw[7:0]) + 1;
+	wire       [13:0] shade_r    = color[15:11] * shade_mul;
+	wire       [14:0] shade_g    = color[10:5]  * shade_mul;
+	wire       [13:0] shade_b    = color[4:0]   * shade_mul;
+
+	assign tri = { tri_color, z2, y2, x2, z1, y1, x1, z0, y0, x0 };
+
+	// Shared arithmetic.
+	reg               mul_start;
+	reg  signed[32:0] mul_a;
+	reg  signed[21:0] mul_b;
+	wire              mul_done;
+	wire signed[54:0] mul_p;
+	quartz_mul mul(clk, mul_start, mul_a, mul_b, mul_done, mul_p);
+
+	reg               div_start;
+	reg  signed[55:0] div_num;
+	wire              div_done;
+	wire signed[31:0] div_q;
+	quartz_div div(clk, div_start, div_num, { 3'b0, w }, div_done, div_q);
+
+	reg signed[54:0]  tmp;
+
+	initial begin
+		state     = g_idle;
+		mul_start = 0;
+		div_start = 0;
+	end
+
+	// Start a read of `len` bytes, continuing in `next` when it is done.
+	task read_start(input to_tri, input[22:0] addr, input[3:0] len, input[4:0] next);
+		begin
+			fetch_tri <= to_tri;
+			rd_addr   <= addr;
+			rd_bytes  <= len;
+			ret       <= next;
+			state     <= g_fetch;
+		end
+	endtask
+
+	always @(posedge clk) begin
+		mul_start <= 0;
+		div_start <= 0;
+
+		if (view_shift) view     <= { par_data, view[143:8] };
+		if (draw_shift) draw_par <= { par_data, draw_par[311:8] };
+		if (rd_valid && fetch_tri) tri_raw <= { rd_data, tri_raw[79:8] };
+		if (rd_valid && !fetch_tri) vtx_raw <= { rd_data, vtx_raw[47:8] };
+
+		case (state)
+			g_idle: if (start) begin
+				state <= g_mesh;
+			end
+
+			g_wait: if (mul_done || div_done) begin
+				state <= ret;
+			end
+
+			// The mesh table is read a cycle after the handle is given.
+			g_mesh: begin
+				vtx_addr   <= mesh_entry[22:0];
+				num_vertex <= mesh_entry[38:23];
+				tri_ptr    <= mesh_entry[61:39];
+				tri_left   <= mesh_entry[77:62];
+				state      <= g_tri;
+			end
+
+			// Fetch the next triangle.
+			g_tri: begin
+				k <= 0;
+				if (tri_left == 0) begin
+					state <= g_idle;
+				end else begin
+					read_start(1, tri_ptr, 10, g_index);
+				end
+			end
+
+			// Wait for the framebuffer to take the read, then to finish it.
+			g_fetch: if (!fb_busy) begin
+				state <= g_fetch_wait;
+			end
+			g_fetch_wait: if (!fb_busy) begin
+				state <= ret;
+			end
+
+			// Fetch the next vertex; triangles with a bad index are skipped.
+			g_index: begin
+				row <= 0;
+				col <= 0;
+				acc <= 0;
+				if (index >= num_vertex) begin
+					state <= g_next;
+				end else begin
+					read_start(0, vtx_addr + { index, 2'b0 } + { index, 1'b0 }, 6, g_rot);
+				end
+			end
+
+			// p = floor(rot * v / 2^shift) + pos, wrapping to 32 bits.
+			g_rot: begin
+				mul_a     <= rot_sel;
+				mul_b     <= vtx_sel;
+				mul_start <= 1;
+				ret       <= g_rot_acc;
+				state     <= g_wait;
+			end
+			g_rot_acc: begin
+				if (col == 2) begin
+					case (row)
+						0: p0 <= p_next;
+						1: p1 <= p_next;
+						2: p2 <= p_next;
+					endcase
+					acc   <= 0;
+					col   <= 0;
+					row   <= row + 1;
+					state <= row == 2 ? g_proj : g_rot;
+				end else begin
+					acc   <= rot_sum;
+					col   <= col + 1;
+					state <= g_rot;
+				end
+			end
+
+			// Triangles with a corner behind the eye are skipped.
+			g_proj: begin
+				w <= w_next;
+				if (p2 < 0 || w_next <= 0) begin
+					state     <= g_next;
+				end else begin
+					mul_a     <= p0;
+					mul_b     <= scale;
+					mul_start <= 1;
+					ret       <= g_x0;
+					state     <= g_wait;
+				end
+			end
+			g_x0: begin
+				div_num   <= mul_p;
+				div_start <= 1;
+				ret       <= g_x1;
+				state     <= g_wait;
+			end
+			g_x1: begin
+				case (k)
+					0: x0 <= clamp_x;
+					1: x1 <= clamp_x;
+					2: x2 <= clamp_x;
+				endcase
+				mul_a     <= p1;
+				mul_b     <= scale;
+				mul_start <= 1;
+				ret       <= g_y0;
+				state     <= g_wait;
+			end
+			g_y0: begin
+				div_num   <= mul_p;
+				div_start <= 1;
+				ret       <= g_y1;
+				state     <= g_wait;
+			end
+			g_y1: begin
+				case (k)
+					0: y0 <= clamp_y;
+					1: y1 <= clamp_y;
+					2: y2 <= clamp_y;
+				endcase
+				div_num   <= depth_a <<< 8;
+				div_start <= 1;
+				ret       <= g_z;
+				state     <= g_wait;
+			end
+			g_z: begin
+				case (k)
+					0: z0 <= clamp_z;
+					1: z1 <= clamp_z;
+					2: z2 <= clamp_z;
+				endcase
+				k     <= k + 1;
+				state <= k == 2 ? g_area0 : g_index;
+			end
+
+			// Back faces wind the other way around on the screen.
+			g_area0: begin
+				mul_a     <= x1 - x0;
+				mul_b     <= y2 - y0;
+				mul_start <= 1;
+				ret       <= g_area1;
+				state     <= g_wait;
+			end
+			g_area1: begin
+				tmp       <= mul_p;
+				mul_a     <= y1 - y0;
+				mul_b     <= x2 - x0;
+				mul_start <= 1;
+				ret       <= g_area2;
+				state     <= g_wait;
+			end
+			g_area2: begin
+				li  <= 0;
+				dot <= 0;
+				if (tmp <= mul_p) begin
+					state <= g_next;
+				end else begin
+					state <= g_light0;
+				end
+			end
+
+			// Flat shading from the stored normal.
+			g_light0: begin
+				mul_a     <= light_sel;
+				mul_b     <= normal_sel;
+				mul_start <= 1;
+				ret       <= g_light1;
+				state     <= g_wait;
+			end
+			g_light1: begin
+				dot   <= dot + mul_p;
+				li    <= li + 1;
+				state <= li == 2 ? g_shade : g_light0;
+			end
+			g_shade: begin
+				tri_color <= { shade_r[12:8], shade_g[13:8], shade_b[12:8] };
+				state     <= g_raster;
+			end
+
+			// Wait for the rasterizer to take the triangle; the next one is worked on while it draws.
+			g_raster: if (!raster_busy) begin
+				state <= g_next;
+			end
+
+			g_next: begin
+				tri_ptr  <= tri_ptr + 10;
+				tri_left <= tri_left - 1;
+				state    <= g_tri;
+			end
+		endcase
+	end
+
+endmodule
@@ -7,6 +7,10 @@ module ili9341(
 	output wire       lcd_we_n,
 	output wire       lcd_rs,
 	input  wire       lcd_fmark,
+	// Pulse to start writing a frame from the top left.
+	input  wire       frame_start,
+	// Pixel to write; pix_clk pulses when it has been sent.
+	input  wire       pix_valid,
 	output wire       pix_clk,
 	input  wire[15:0] pix_data
 );
@@ -21,7 +25,11 @@ module ili9341(
 	reg      lcd_rs_reg;
 	reg      lcd_we_reg;
 	reg[7:0] lcd_data_reg;
+	// Whether the low byte of the pixel is next.
+	reg      pix_low;
+	reg      pix_clk_reg;
 	
+	assign pix_clk  = pix_clk_reg;
 	assign lcd_we_n = !(clk & lcd_we_reg);
 	assign lcd_rs   = lcd_rs_reg;
 	assign lcd_data = lcd_data_reg;
@@ -31,7 +39,10 @@ module ili9341(
 	reg[8:0]   init_sequence[0:100];
 	
 	initial begin
+		state        = state_rst;
 		init_counter = 0;
+		pix_low      = 0;
+		pix_clk_reg  = 0;
 		
 		init_sequence[7'h00] = 9'h0ef;
 		init_sequence[7'h01] = 9'h103;
@@ -120,26 +131,28 @@ module ili9341(
 		init_sequence[7'h54] = 9'h011; // Sleep Out
 		init_sequence[7'h55] = 9'h029; // Display ON
 		init_sequence[7'h56] = 9'h036; // Memory Access Control
-		init_sequence[7'h57] = 9'h108; //   Select BGR color filter
+		init_sequence[7'h57] = 9'h128; //   Row/column exchange (320x240 landscape), select BGR color filter
 		init_sequence[7'h58] = 9'h02a; // Column Address Set
 		init_sequence[7'h59] = 9'h100; //   Start column [15:8]
 		init_sequence[7'h5a] = 9'h100; //   Start column [7:0]
-		init_sequence[7'h5b] = 9'h100; //   End column [15:8]
-		init_sequence[7'h5c] = 9'h1ef; //   End column [7:0]
+		init_sequence[7'h5b] = 9'h101; //   End column [15:8]
+		init_sequence[7'h5c] = 9'h13f; //   End column [7:0]
 		init_sequence[7'h5d] = 9'h02b; // Page Address Set
 		init_sequence[7'h5e] = 9'h100; //   Start position [15:8]
 		init_sequence[7'h5f] = 9'h100; //   Start position [7:0]
-		init_sequence[7'h60] = 9'h101; //   End position   [15:8]
-		init_sequence[7'h61] = 9'h13f; //   End position   [7:0]
+		init_sequence[7'h60] = 9'h100; //   End position   [15:8]
+		init_sequence[7'h61] = 9'h1ef; //   End position   [7:0]
 		init_sequence[7'h62] = 9'h035; // Tearing Effect Line ON
-		init_sequence[7'h63] = 9'h000; //   V-Blanking information only (set to 01h for both V-Blanking and H-Blanking information
+		init_sequence[7'h63] = 9'h100; //   V-Blanking information only (set to 01h for both V-Blanking and H-Blanking information
 		init_sequence[7'h64] = 9'h02c; // Memory Write
 	end
 	
 	always @(negedge clk) begin
 		if (rst) begin
-			// The screen driver reset edition.
+			// The screen driver reset edition; initialise the panel again afterwards.
 			lcd_we_reg   <= 0;
+			pix_clk_reg  <= 0;
+			state        <= state_rst;
 			
 		end else if (state == state_rst) begin
 			// Prepare init sequence things.
@@ -158,17 +171,38 @@ module ili9341(
 			
 			// Check length.
 			if (init_counter == init_len) begin
-				state    <= state_write;
+				state    <= state_idle;
 			end
 			
+		end else if (frame_start) begin
+			// Memory Write, which starts at the top left.
+			lcd_we_reg   <= 1;
+			lcd_rs_reg   <= 0;
+			lcd_data_reg <= 8'h2c;
+			pix_low      <= 0;
+			pix_clk_reg  <= 0;
+			state        <= state_write;
+			
 		end else if (state == state_idle) begin
 			// Nothing happens.
 			lcd_we_reg   <= 0;
 			
 		end else if (state == state_write) begin
-			// WRITING NOW!
-			lcd_we_reg   <= 1;
-			lcd_rs_reg   <= 0;
+			// WRITING NOW! High byte first.
+			pix_clk_reg  <= 0;
+			lcd_rs_reg   <= 1;
+			if (pix_low) begin
+				lcd_we_reg   <= 1;
+				lcd_data_reg <= pix_data[7:0];
+				pix_low      <= 0;
+				pix_clk_reg  <= 1;
+			end else if (pix_valid) begin
+				lcd_we_reg   <= 1;
+				lcd_data_reg <= pix_data[15:8];
+				pix_low      <= 1;
+			end else begin
+				lcd_we_reg   <= 0;
+			end
 			
 		end
 	end
@@ -0,0 +1,186 @@
+
+// Controller for the QSPI PSRAM, used in QPI mode.
+// Transactions are bursts of 1 to 32 bytes, short enough for the RAM's 8us chip select limit.
+// Data changes on the rising edge of clk; ram_clk rises halfway, so the RAM samples stable data.
+module quartz_psram(
+	input  wire       clk,
+	
+	// Start a transaction, taken while ready.
+	input  wire       req,
+	input  wire       req_write,
+	input  wire[22:0] req_addr,
+	input  wire[5:0]  req_len,
+	output wire       ready,
+	
+	// Write data; wdata_next pulses when a byte is taken, the next one must follow a cycle later.
+	input  wire[7:0]  wdata,
+	output reg        wdata_next,
+	// Read data, valid while rdata_valid pulses.
+	output reg [7:0]  rdata,
+	output reg        rdata_valid,
+	
+	// RAM pins.
+	inout  wire[3:0]  ram_io,
+	output wire       ram_clk,
+	output reg        ram_cs_n
+);
+	
+	localparam cmd_qpi   = 8'h35;
+	localparam cmd_write = 8'h38;
+	localparam cmd_read  = 8'heb;
+	
+	localparam s_boot  = 0;
+	localparam s_qpi   = 1;
+	localparam s_idle  = 2;
+	localparam s_hdr   = 3;
+	localparam s_wait  = 4;
+	localparam s_write = 5;
+	localparam s_read  = 6;
+	localparam s_end   = 7;
+	
+	reg[2:0]  state;
+	reg[11:0] cnt;
+	reg       write;
+	reg[5:0]  len;
+	// Command and address, shifted out a nibble at a time.
+	reg[31:0] hdr;
+	// Nibble held back for the next cycle.
+	reg[3:0]  nibble;
+	reg       lo_phase;
+	
+	reg[3:0]  io_out;
+	reg[3:0]  io_oe;
+	reg[3:0]  io_in;
+	reg       clk_en;
+	
+	assign ready   = state == s_idle;
+	assign ram_clk = clk_en & !clk;
+	assign ram_io[0] = io_oe[0] ? io_out[0] : 'bz;
+	assign ram_io[1] = io_oe[1] ? io_out[1] : 'bz;
+	assign ram_io[2] = io_oe[2] ? io_out[2] : 'bz;
+	assign ram_io[3] = io_oe[3] ? io_out[3] : 'bz;
+	
+	initial begin
+		state       = s_boot;
+		cnt         = 0;
+		ram_cs_n    = 1;
+		clk_en      = 0;
+		io_oe       = 0;
+		wdata_next  = 0;
+		rdata_valid = 0;
+	end
+	
+	// The RAM changes read data as ram_clk falls, so sample halfway.
+	always @(negedge clk) begin
+		io_in <= ram_io;
+	end
+	
+	always @(posedge clk) begin
+		wdata_next  <= 0;
+		rdata_valid <= 0;
+		
+		case (state)
+			// The RAM needs 150us after power up.
+			s_boot: begin
+				cnt <= cnt + 1;
+				if (cnt == 2047) begin
+					cnt      <= 0;
+					hdr      <= { cmd_qpi, 24'h0 };
+					ram_cs_n <= 0;
+					state    <= s_qpi;
+				end
+			end
+			
+			// Switch to QPI mode, sent in SPI mode on io[0]; io[1] is the RAM's output.
+			s_qpi: begin
+				cnt <= cnt + 1;
+				if (cnt == 8) begin
+					clk_en   <= 0;
+					io_oe    <= 0;
+					ram_cs_n <= 1;
+					state    <= s_idle;
+				end else begin
+					clk_en   <= 1;
+					io_oe    <= 4'b1101;
+					io_out   <= { 3'b110, hdr[31] };
+					hdr      <= hdr << 1;
+				end
+			end
+			
+			s_idle: if (req) begin
+				ram_cs_n <= 0;
+				clk_en   <= 1;
+				io_oe    <= 4'b1111;
+				io_out   <= req_write ? cmd_write[7:4] : cmd_read[7:4];
+				hdr      <= { req_write ? cmd_write[3:0] : cmd_read[3:0], 1'b0, req_addr, 4'h0 };
+				write    <= req_write;
+				len      <= req_len;
+				lo_phase <= 0;
+				cnt      <= 1;
+				state    <= s_hdr;
+			end
+			
+			// Rest of the command and the 24-bit address.
+			s_hdr: begin
+				io_out <= hdr[31:28];
+				hdr    <= hdr << 4;
+				cnt    <= cnt + 1;
+				if (cnt == 7) begin
+					cnt   <= 0;
+					state <= write ? s_write : s_wait;
+				end
+			end
+			
+			// Six wait cycles before read data.
+			s_wait: begin
+				io_oe <= 0;
+				cnt   <= cnt + 1;
+				if (cnt == 5) begin
+					cnt   <= 0;
+					state <= s_read;
+				end
+			end
+			
+			// Two nibbles per byte, high first.
+			s_write: begin
+				if (!lo_phase) begin
+					io_out     <= wdata[7:4];
+					nibble     <= wdata[3:0];
+					wdata_next <= 1;
+					lo_phase   <= 1;
+				end else begin
+					io_out     <= nibble;
+					lo_phase   <= 0;
+					len        <= len - 1;
+					if (len == 1) state <= s_end;
+				end
+			end
+			
+			// Nibble n is sampled halfway through cycle n of this state, high nibble first.
+			s_read: begin
+				cnt <= cnt + 1;
+				if (cnt != 0) begin
+					if (cnt[0]) begin
+						nibble <= io_in;
+					end else begin
+						rdata       <= { nibble, io_in };
+						rdata_valid <= 1;
+					end
+				end
+				if (cnt == len * 2) begin
+					clk_en   <= 0;
+					ram_cs_n <= 1;
+					state    <= s_idle;
+				end
+			end
+			
+			s_end: begin
+				clk_en   <= 0;
+				io_oe    <= 0;
+				ram_cs_n <= 1;
+				state    <= s_idle;
+			end
+		endcase
+	end
+	
+endmodule
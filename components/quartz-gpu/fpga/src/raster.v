@@ -0,0 +1,508 @@
+
+
+// Sequential signed multiplier: p = a * b, done 22 cycles after start.
+module quartz_mul(
+	input  wire              clk,
+	input  wire              start,
+	input  wire signed[32:0] a,
+	input  wire signed[21:0] b,
+	output reg               done,
+	output reg  signed[54:0] p
+);
+
+	reg       busy;
+	reg[4:0]  count;
+	reg       neg;
+	reg[54:0] sh_a;
+	reg[21:0] mag_b;
+	reg[54:0] acc;
+
+	wire[54:0] acc_next = acc + (mag_b[0] ? sh_a : 55'd0);
+
+	initial begin
+		busy = 0;
+		done = 0;
+	end
+
+	always @(posedge clk) begin
+		done <= 0;
+		if (start) begin
+			// Multiply magnitudes, fix the sign at the end.
+			sh_a  <= a[32] ? -a : a;
+			mag_b <= b[21] ? -b : b;
+			neg   <= a[32] ^ b[21];
+			acc   <= 0;
+			count <= 0;
+			busy  <= 1;
+
+		end else if (busy) begin
+			acc   <= acc_next;
+			sh_a  <= sh_a << 1;
+			mag_b <= mag_b >> 1;
+			count <= count + 1;
+			if (count == 21) begin
+				busy  <= 0;
+				done  <= 1;
+				p     <= neg ? -$signed(acc_next) : $signed(acc_next);
+			end
+		end
+	end
+
+endmodule
+
+
+
+// Sequential signed divider: q = num / den, truncated towards zero and saturated to 32 bits.
+// The denominator must be positive. Done 56 cycles after start.
+module quartz_div(
+	input  wire              clk,
+	input  wire              start,
+	input  wire signed[55:0] num,
+	input  wire      [35:0] den,
+	output reg               done,
+	output reg  signed[31:0] q
+);
+
+	reg       busy;
+	reg[5:0]  count;
+	reg       neg;
+	reg[55:0] quo;
+	reg[36:0] rem;
+	reg[35:0] div;
+
+	// Restoring division, one quotient bit per cycle.
+	wire[36:0] rem_shift = { rem[35:0], quo[55] };
+	wire       rem_fits  = rem_shift >= { 1'b0, div };
+	wire[55:0] quo_next  = { quo[54:0], rem_fits };
+
+	initial begin
+		busy = 0;
+		done = 0;
+	end
+
+	always @(posedge clk) begin
+		done <= 0;
+		if (start) begin
+			quo   <= num[55] ? -num : num;
+			neg   <= num[55];
+			div   <= den;
+			rem   <= 0;
+			count <= 0;
+			busy  <= 1;
+
+		end else if (busy) begin
+			rem   <= rem_fits ? rem_shift - { 1'b0, div } : rem_shift;
+			quo   <= quo_next;
+			count <= count + 1;
+			if (count == 55) begin
+				busy <= 0;
+				done <= 1;
+				if (!neg && quo_next > 56'h7fffffff) begin
+					q <= 32'h7fffffff;
+				end else if (neg && quo_next > 56'h80000000) begin
+					q <= 32'h80000000;
+				end else begin
+					q <= neg ? -quo_next[31:0] : quo_next[31:0];
+				end
+			end
+		end
+	end
+
+endmodule
+
+
+
+// Triangle and line rasterizer, meant to produce the same pixels in the same order as quartz_model.c;
+// sim/raster_tb.v compares the two.
+// Coordinates are 12.4 fixed-point pixels, pixel (X, Y) has its center at (16X+8, 16Y+8).
+module quartz_raster(
+	input  wire       clk,
+
+	// Start rasterizing a primitive, ignored while busy.
+	input  wire       start,
+	input  wire       is_line,
+	input  wire[15:0] in_x0,
+	input  wire[15:0] in_y0,
+	input  wire[15:0] in_z0,
+	input  wire[15:0] in_x1,
+	input  wire[15:0] in_y1,
+	input  wire[15:0] in_z1,
+	input  wire[15:0] in_x2,
+	input  wire[15:0] in_y2,
+	input  wire[15:0] in_z2,
+	input  wire[15:0] in_color,
+	input  wire[15:0] in_mask,
+	output wire       busy,
+
+	// Pixel stream, held until accepted.
+	output reg        pix_valid,
+	input  wire       pix_ready,
+	output reg [8:0]  pix_x,
+	output reg [7:0]  pix_y,
+	output reg [15:0] pix_z,
+	output reg [15:0] pix_color,
+	output reg [15:0] pix_mask,
+	// Blend with the per-channel maximum instead of depth testing.
+	output reg        pix_max
+);
+
+	localparam width  = 320;
+	localparam height = 240;
+
+	localparam s_idle   = 0;
+	localparam s_wait   = 1;
+	localparam s_area0  = 2;
+	localparam s_area1  = 3;
+	localparam s_area2  = 4;
+	localparam s_bbox   = 5;
+	localparam s_edge0  = 6;
+	localparam s_edge1  = 7;
+	localparam s_edge2  = 8;
+	localparam s_grad0  = 9;
+	localparam s_grad1  = 10;
+	localparam s_grad2  = 11;
+	localparam s_grad3  = 12;
+	localparam s_grad4  = 13;
+	localparam s_grad5  = 14;
+	localparam s_grad6  = 15;
+	localparam s_zrow0  = 16;
+	localparam s_zrow1  = 17;
+	localparam s_scan   = 18;
+	localparam s_line0  = 19;
+	localparam s_line1  = 20;
+	localparam s_line2  = 21;
+
+	reg[4:0] state;
+	// State to continue in once the multiplier or divider is done.
+	reg[4:0] ret;
+	assign   busy = state != s_idle || pix_valid;
+
+	// Primitive.
+	reg signed[17:0] x0, y0, x1, y1, x2, y2;
+	reg signed[17:0] z0, z1, z2;
+	reg       [15:0] color;
+	reg       [15:0] mask;
+
+	// Triangle setup.
+	reg signed[55:0] tmp;
+	reg signed[36:0] area;
+	reg signed[13:0] bx0, bx1, by0, by1;
+	reg signed[17:0] px, py;
+	reg       [1:0]  ei;
+	reg signed[39:0] edge0, edge1, edge2;
+	reg signed[21:0] step_x0, step_x1, step_x2;
+	reg signed[21:0] step_y0, step_y1, step_y2;
+	reg signed[31:0] dzdx, dzdy;
+	reg signed[63:0] z_row;
+
+	// Triangle scan.
+	reg signed[39:0] e0, e1, e2;
+	reg signed[63:0] zc;
+	reg       [8:0]  cx;
+	reg       [7:0]  cy;
+
+	// Line.
+	reg signed[13:0] lx, ly, lx1, ly1;
+	reg signed[15:0] ldx, ldy, lerr;
+	reg              lsx, lsy;
+
+	// Shared arithmetic.
+	reg               mul_start;
+	reg  signed[32:0] mul_a;
+	reg  signed[21:0] mul_b;
+	wire              mul_done;
+	wire signed[54:0] mul_p;
+	quartz_mul mul(clk, mul_start, mul_a, mul_b, mul_done, mul_p);
+
+	reg               div_start;
+	reg  signed[55:0] div_num;
+	wire              div_done;
+	wire signed[31:0] div_q;
+	quartz_div div(clk, div_start, div_num, area[35:0], div_done, div_q);
+
+	// Bounding box of the pixel centers: ceil((min - 8) / 16) to floor((max - 8) / 16).
+	wire signed[17:0] min_x = (x0 < x1) ? ((x0 < x2) ? x0 : x2) : ((x1 < x2) ? x1 : x2);
+	wire signed[17:0] max_x = (x0 > x1) ? ((x0 > x2) ? x0 : x2) : ((x1 > x2) ? x1 : x2);
+	wire signed[17:0] min_y = (y0 < y1) ? ((y0 < y2) ? y0 : y2) : ((y1 < y2) ? y1 : y2);
+	wire signed[17:0] max_y = (y0 > y1) ? ((y0 > y2) ? y0 : y2) : ((y1 > y2) ? y1 : y2);
+	wire signed[17:0] ceil_x  = -((18'sd8 - min_x) >>> 4);
+	wire signed[17:0] floor_x =  (max_x - 18'sd8) >>> 4;
+	wire signed[17:0] ceil_y  = -((18'sd8 - min_y) >>> 4);
+	wire signed[17:0] floor_y =  (max_y - 18'sd8) >>> 4;
+
+	// Edge ei lies opposite vertex ei, from vertex a to vertex b.
+	wire signed[17:0] ea_x = (ei == 0) ? x1 : (ei == 1) ? x2 : x0;
+	wire signed[17:0] ea_y = (ei == 0) ? y1 : (ei == 1) ? y2 : y0;
+	wire signed[17:0] eb_x = (ei == 0) ? x2 : (ei == 1) ? x0 : x1;
+	wire signed[17:0] eb_y = (ei == 0) ? y2 : (ei == 1) ? y0 : y1;
+	wire signed[17:0] e_dx = eb_x - ea_x;
+	wire signed[17:0] e_dy = eb_y - ea_y;
+	// Top-left rule: centers exactly on any other edge belong to the neighbour.
+	wire              e_tl = e_dy < 0 || (e_dy == 0 && e_dx > 0);
+	wire signed[1:0]  e_bias = e_tl ? 2'sd0 : 2'sd1;
+
+	// Current depth, clamped.
+	wire signed[47:0] zc_int = zc >>> 16;
+	wire       [15:0] zc_clamp = zc_int < 0 ? 16'h0000 : zc_int > 65535 ? 16'hffff : zc_int[15:0];
+
+	// Line stepping.
+	wire signed[16:0] l_e2    = { lerr, 1'b0 };
+	wire              l_inside = lx >= 0 && lx < width && ly >= 0 && ly < height;
+
+	initial begin
+		state     = s_idle;
+		pix_valid = 0;
+		mul_start = 0;
+		div_start = 0;
+	end
+
+	always @(posedge clk) begin
+		mul_start <= 0;
+		div_start <= 0;
+		if (pix_ready) pix_valid <= 0;
+
+		case (state)
+			s_idle: if (start) begin
+				x0    <= $signed(in_x0);
+				y0    <= $signed(in_y0);
+				z0    <= $signed({ 2'b0, in_z0 });
+				x1    <= $signed(in_x1);
+				y1    <= $signed(in_y1);
+				z1    <= $signed({ 2'b0, in_z1 });
+				x2    <= $signed(in_x2);
+				y2    <= $signed(in_y2);
+				z2    <= $signed({ 2'b0, in_z2 });
+				color <= in_color;
+				mask  <= in_mask;
+				state <= is_line ? s_line0 : s_area0;
+			end
+
+			s_wait: if (mul_done || div_done) begin
+				state <= ret;
+			end
+
+			// Twice the signed area.
+			s_area0: begin
+				mul_a     <= x1 - x0;
+				mul_b     <= y2 - y0;
+				mul_start <= 1;
+				ret       <= s_area1;
+				state     <= s_wait;
+			end
+			s_area1: begin
+				tmp       <= mul_p;
+				mul_a     <= y1 - y0;
+				mul_b     <= x2 - x0;
+				mul_start <= 1;
+				ret       <= s_area2;
+				state     <= s_wait;
+			end
+			s_area2: begin
+				if (tmp == mul_p) begin
+					// Degenerate.
+					state <= s_idle;
+				end else if (tmp < mul_p) begin
+					// Make the winding positive.
+					area  <= mul_p - tmp;
+					x1    <= x2; x2 <= x1;
+					y1    <= y2; y2 <= y1;
+					z1    <= z2; z2 <= z1;
+					state <= s_bbox;
+				end else begin
+					area  <= tmp - mul_p;
+					state <= s_bbox;
+				end
+			end
+
+			s_bbox: begin
+				bx0 <= ceil_x  < 0          ? 0          : ceil_x;
+				bx1 <= floor_x > width  - 1 ? width  - 1 : floor_x;
+				by0 <= ceil_y  < 0          ? 0          : ceil_y;
+				by1 <= floor_y > height - 1 ? height - 1 : floor_y;
+				px  <= (ceil_x < 0 ? 0 : ceil_x) * 16 + 8;
+				py  <= (ceil_y < 0 ? 0 : ceil_y) * 16 + 8;
+				ei  <= 0;
+				if (ceil_x > floor_x || ceil_y > floor_y || ceil_x > width - 1 || ceil_y > height - 1
+						|| floor_x < 0 || floor_y < 0) begin
+					state <= s_idle;
+				end else begin
+					state <= s_edge0;
+				end
+			end
+
+			// Edge functions at the first pixel center: dx * (py - ay) - dy * (px - ax).
+			s_edge0: begin
+				mul_a     <= e_dx;
+				mul_b     <= py - ea_y;
+				mul_start <= 1;
+				ret       <= s_edge1;
+				state     <= s_wait;
+			end
+			s_edge1: begin
+				tmp       <= mul_p;
+				mul_a     <= e_dy;
+				mul_b     <= px - ea_x;
+				mul_start <= 1;
+				ret       <= s_edge2;
+				state     <= s_wait;
+			end
+			s_edge2: begin
+				case (ei)
+					0: begin edge0 <= tmp - mul_p - e_bias; step_x0 <= -e_dy * 16; step_y0 <= e_dx * 16; end
+					1: begin edge1 <= tmp - mul_p - e_bias; step_x1 <= -e_dy * 16; step_y1 <= e_dx * 16; end
+					2: begin edge2 <= tmp - mul_p - e_bias; step_x2 <= -e_dy * 16; step_y2 <= e_dx * 16; end
+				endcase
+				ei    <= ei + 1;
+				state <= ei == 2 ? s_grad0 : s_edge0;
+			end
+
+			// Depth gradients in 16.16 per pixel, from the weights of vertex 1 and 2.
+			s_grad0: begin
+				mul_a     <= z1 - z0;
+				mul_b     <= step_x1;
+				mul_start <= 1;
+				ret       <= s_grad1;
+				state     <= s_wait;
+			end
+			s_grad1: begin
+				tmp       <= mul_p;
+				mul_a     <= z2 - z0;
+				mul_b     <= step_x2;
+				mul_start <= 1;
+				ret       <= s_grad2;
+				state     <= s_wait;
+			end
+			s_grad2: begin
+				div_num   <= (tmp + mul_p) <<< 16;
+				div_start <= 1;
+				ret       <= s_grad3;
+				state     <= s_wait;
+			end
+			s_grad3: begin
+				dzdx      <= div_q;
+				mul_a     <= z1 - z0;
+				mul_b     <= step_y1;
+				mul_start <= 1;
+				ret       <= s_grad4;
+				state     <= s_wait;
+			end
+			s_grad4: begin
+				tmp       <= mul_p;
+				mul_a     <= z2 - z0;
+				mul_b     <= step_y2;
+				mul_start <= 1;
+				ret       <= s_grad5;
+				state     <= s_wait;
+			end
+			s_grad5: begin
+				div_num   <= (tmp + mul_p) <<< 16;
+				div_start <= 1;
+				ret       <= s_grad6;
+				state     <= s_wait;
+			end
+			s_grad6: begin
+				dzdy      <= div_q;
+				mul_a     <= dzdx;
+				mul_b     <= px - x0;
+				mul_start <= 1;
+				ret       <= s_zrow0;
+				state     <= s_wait;
+			end
+
+			// Depth at the first pixel center.
+			s_zrow0: begin
+				tmp       <= mul_p;
+				mul_a     <= dzdy;
+				mul_b     <= py - y0;
+				mul_start <= 1;
+				ret       <= s_zrow1;
+				state     <= s_wait;
+			end
+			s_zrow1: begin
+				z_row <= (z0 <<< 16) + ((tmp + mul_p) >>> 4);
+				zc    <= (z0 <<< 16) + ((tmp + mul_p) >>> 4);
+				e0    <= edge0;
+				e1    <= edge1;
+				e2    <= edge2;
+				cx    <= bx0;
+				cy    <= by0;
+				state <= s_scan;
+			end
+
+			// One pixel center per cycle.
+			s_scan: if (!pix_valid || pix_ready) begin
+				pix_valid <= e0 >= 0 && e1 >= 0 && e2 >= 0;
+				pix_x     <= cx;
+				pix_y     <= cy;
+				pix_z     <= zc_clamp;
+				pix_color <= color;
+				pix_mask  <= mask;
+				pix_max   <= 0;
+
+				if (cx != bx1) begin
+					e0 <= e0 + step_x0;
+					e1 <= e1 + step_x1;
+					e2 <= e2 + step_x2;
+					zc <= zc + dzdx;
+					cx <= cx + 1;
+				end else if (cy != by1) begin
+					edge0 <= edge0 + step_y0;
+					edge1 <= edge1 + step_y1;
+					edge2 <= edge2 + step_y2;
+					z_row <= z_row + dzdy;
+					e0    <= edge0 + step_y0;
+					e1    <= edge1 + step_y1;
+					e2    <= edge2 + step_y2;
+					zc    <= z_row + dzdy;
+					cx    <= bx0;
+					cy    <= cy + 1;
+				end else begin
+					state <= s_idle;
+				end
+			end
+
+			// Line endpoints are the pixels they fall in.
+			s_line0: begin
+				lx    <= x0 >>> 4;
+				ly    <= y0 >>> 4;
+				lx1   <= x1 >>> 4;
+				ly1   <= y1 >>> 4;
+				state <= s_line1;
+			end
+			s_line1: begin
+				ldx   <=   lx1 > lx ? lx1 - lx : lx - lx1;
+				ldy   <= -(ly1 > ly ? ly1 - ly : ly - ly1);
+				lerr  <=  (lx1 > lx ? lx1 - lx : lx - lx1) - (ly1 > ly ? ly1 - ly : ly - ly1);
+				lsx   <= lx < lx1;
+				lsy   <= ly < ly1;
+				state <= s_line2;
+			end
+
+			// Bresenham, one pixel per cycle.
+			s_line2: if (!pix_valid || pix_ready) begin
+				pix_valid <= l_inside;
+				pix_x     <= lx;
+				pix_y     <= ly;
+				pix_z     <= 0;
+				pix_color <= color;
+				pix_mask  <= 16'hffff;
+				pix_max   <= 1;
+
+				if (lx == lx1 && ly == ly1) begin
+					state <= s_idle;
+				end else begin
+					if (l_e2 >= ldy && l_e2 <= ldx) begin
+						lerr <= lerr + ldy + ldx;
+					end else if (l_e2 >= ldy) begin
+						lerr <= lerr + ldy;
+					end else if (l_e2 <= ldx) begin
+						lerr <= lerr + ldx;
+					end
+					if (l_e2 >= ldy) lx <= lsx ? lx + 1 : lx - 1;
+					if (l_e2 <= ldx) ly <= lsy ? ly + 1 : ly - 1;
+				end
+			end
+		endcase
+	end
+
+endmodule
@@ -1,5 +1,9 @@
 `timescale 1ns/1ps
 `include "ili.v"
+`include "raster.v"
+`include "psram.v"
+`include "fb.v"
+`include "geom.v"
 
 module top (
 	input  wire      clk_in,
@@ -31,22 +35,38 @@ module top (
 	wire [7:0] lcd_d_tmp;
 	assign     lcd_d = lcd_mode ? lcd_d_tmp : 'bz;
 	
-	wire pix_clk;
+	// Scanout from the framebuffer.
+	wire       lcd_frame;
+	wire       lcd_valid;
+	wire[15:0] lcd_pix;
+	wire       pix_clk;
 	
 	ili9341 ili_driver(
 		clk_in,
-		!cld_rst_n,
+		!lcd_rst_n,
 		lcd_d_tmp,
 		lcd_wr_n,
 		lcd_rs,
 		lcd_fmark,
+		lcd_frame,
+		lcd_valid,
 		pix_clk,
-		0
+		lcd_pix
 	);
 	
 	// Commands.
-	localparam cmd_status = 'h01;
-	localparam cmd_rgbled = 'h02;
+	localparam cmd_status  = 'h01;
+	localparam cmd_rgbled  = 'h02;
+	localparam cmd_fmark   = 'h03;
+	localparam cmd_tris    = 'h04;
+	localparam cmd_lines   = 'h05;
+	localparam cmd_clear   = 'h06;
+	localparam cmd_spans   = 'h07;
+	localparam cmd_present = 'h08;
+	localparam cmd_bulk    = 'h09;
+	localparam cmd_mesh    = 'h0a;
+	localparam cmd_view    = 'h0b;
+	localparam cmd_draw    = 'h0c;
 	
 	reg[7:0] spi_recv_data;
 	reg[7:0] spi_tx_data;
@@ -61,7 +81,8 @@ module top (
 	assign pmod[1]   = spi_clk;
 	assign pmod[2]   = spi_mosi;
 	assign pmod[3]   = spi_tx_data[7];
-	assign pmod[4:7] = 0;
+	assign pmod[4]   = pix_valid;
+	assign pmod[7:5] = 0;
 	
 	// Sample buffer.
 	reg[7:0]   sample_buf[15:0];
@@ -70,6 +91,7 @@ module top (
 	initial begin
 		spi_bit       = 0;
 		spi_byte_idx  = 0;
+		spi_rx_idx    = 0;
 		spi_tx_sum    = 'hcc;
 		clkdiv        = 1;
 		spi_cs_n_last = 1;
@@ -82,6 +104,12 @@ module top (
 		hello_reg     = 0;
 		// Receive error flag.
 		status_err_rx = 0;
+		// Bulk chunk flag.
+		status_chunk_ok = 0;
+		
+		// Tearing effect.
+		fmark_sync    = 0;
+		fmark_wait    = 0;
 	end
 	
 	// Hello status flag.
@@ -90,6 +118,18 @@ module top (
 	
 	// Receive error flag.
 	reg       status_err_rx;
+	// Whether the last command was a bulk chunk that arrived intact.
+	reg       status_chunk_ok;
+	
+	// Tearing effect signal, synchronised to clk_in.
+	reg [2:0] fmark_sync;
+	wire      fmark_rise = fmark_sync[1] && !fmark_sync[2];
+	// Whether a response is held back until the next tearing effect pulse.
+	reg       fmark_wait;
+	
+	always @(posedge clk_in) begin
+		fmark_sync <= { fmark_sync[1:0], lcd_fmark };
+	end
 	
 	// Architecture ID.
 	assign spi_tx_buf[0] = 1;
@@ -102,11 +142,404 @@ module top (
 	assign spi_tx_buf[4] = 'h00;
 	assign spi_tx_buf[5] = 'h00;
 	// Status flags.
-	assign spi_tx_buf[6] = { 4'b0, status_hello, 3'b0 };
+	assign spi_tx_buf[6] = { 2'b0, status_chunk_ok, fmark_sync[1], status_hello, 2'b0, draw_busy };
 	assign spi_tx_buf[7] = { 7'b0, status_err_rx };
 	
+	// Rasterizer.
+	wire       raster_start;
+	wire       raster_busy;
+	wire       pix_valid;
+	wire       pix_ready;
+	wire[8:0]  pix_x;
+	wire[7:0]  pix_y;
+	wire[15:0] pix_z;
+	wire[15:0] pix_color;
+	wire[15:0] pix_mask;
+	wire       pix_max;
+	
+	// Framebuffer.
+	localparam fb_fill    = 0;
+	localparam fb_write   = 1;
+	localparam fb_present = 2;
+	localparam fb_read    = 3;
+	
+	wire       fb_start;
+	reg [1:0]  fb_kind;
+	reg [22:0] fb_addr;
+	reg [11:0] fb_bytes;
+	wire       fb_busy;
+	wire       fb_data_next;
+	wire[7:0]  fb_read_data;
+	wire       fb_read_valid;
+	
+	// Geometry unit, which reads resident meshes through the framebuffer while it draws.
+	wire       geom_start;
+	wire       geom_busy;
+	wire       geom_read;
+	wire[22:0] geom_addr;
+	wire[11:0] geom_bytes;
+	wire       geom_tri_start;
+	wire[159:0] geom_tri;
+	
+	// Bulk chunks are received into two banks, so one can arrive while the other is copied to RAM.
+	reg [7:0]  bulk_buf[4095:0];
+	// Bank the next chunk is received into and bank to copy next.
+	reg        bulk_bank;
+	reg        bulk_copy;
+	// Banks holding a chunk that is not copied yet, with its address and length.
+	reg [1:0]  bulk_full;
+	reg [22:0] bulk_dest[1:0];
+	reg [11:0] bulk_size[1:0];
+	// Whether the response to a chunk waits for a bank to become free.
+	reg        bulk_wait;
+	reg [10:0] bulk_ptr;
+	reg [7:0]  bulk_rdata;
+	wire[10:0] bulk_raddr = draw_state == draw_fb_wait && fb_data_next ? bulk_ptr + 1 : bulk_ptr;
+	
+	initial begin
+		bulk_bank = 0;
+		bulk_copy = 0;
+		bulk_full = 0;
+		bulk_wait = 0;
+	end
+	
+	// Draw sequencer: feeds the primitives of a TRIS or LINES command to the rasterizer,
+	// the CLEAR, SPANS and PRESENT commands and bulk chunks to the framebuffer,
+	// and the MESH, VIEW and DRAW commands to the geometry unit.
+	localparam draw_idle      = 0;
+	localparam draw_next      = 1;
+	localparam draw_read      = 2;
+	localparam draw_shift     = 3;
+	localparam draw_mask      = 4;
+	localparam draw_start     = 5;
+	localparam draw_finish    = 6;
+	localparam draw_span      = 7;
+	localparam draw_fb_start  = 8;
+	localparam draw_fb_wait   = 9;
+	localparam draw_mesh      = 10;
+	localparam draw_view      = 11;
+	localparam draw_handle    = 12;
+	localparam draw_geom      = 13;
+	localparam draw_geom_wait = 14;
+	
+	reg [3:0]   draw_state;
+	// State to continue in once draw_need bytes have been read.
+	reg [3:0]   draw_then;
+	reg [7:0]   draw_op;
+	wire        draw_lines = draw_op == cmd_lines;
+	// Read position in spi_rx_buf and end of the payload.
+	reg [7:0]   draw_ptr;
+	reg [7:0]   draw_end;
+	// Bytes left to read for the current field.
+	reg [5:0]   draw_need;
+	reg [7:0]   draw_rdata;
+	// The primitive being read, shifted in from the top.
+	reg [159:0] draw_prim;
+	reg [15:0]  draw_mask_reg;
+	// Pulses when the command is complete.
+	reg         draw_done;
+	// Whether a command was received but not started; bulk chunks that arrived before it go first.
+	reg         draw_pending;
+	wire        draw_busy = draw_state != draw_idle || raster_busy || fb_busy || bulk_full != 0;
+	wire[7:0]   draw_left = draw_end - draw_ptr;
+	wire[4:0]   draw_size = draw_lines ? 10 : 20;
+	// Mesh definition: u8 handle, u24 vertex address, u16 vertex count, u24 triangle address, u16 triangle count.
+	wire[7:0]   mesh_handle = draw_prim[79:72];
+	// Handle of a draw, followed by the u16 color and placement that go to the geometry unit.
+	wire[7:0]   draw_handle_byte = draw_prim[159:152];
+	reg [5:0]   draw_handle_reg;
+	// Span header: u16 x, u16 y, u16 length.
+	wire[15:0]  span_x    = draw_prim[127:112];
+	wire[15:0]  span_y    = draw_prim[143:128];
+	wire[15:0]  span_len  = draw_prim[159:144];
+	// Span data is read ahead, so the next byte is ready the cycle after one is taken.
+	wire[7:0]   draw_raddr = draw_state == draw_fb_wait && fb_data_next ? draw_ptr + 1 : draw_ptr;
+	
+	assign raster_start = draw_state == draw_start && !raster_busy || geom_tri_start;
+	assign fb_start     = draw_state == draw_fb_start && !fb_busy || geom_read;
+	assign geom_start   = draw_state == draw_geom;
+	
+	// Triangles come from the geometry unit while a DRAW command runs.
+	wire[159:0] raster_prim = draw_op == cmd_draw ? geom_tri : draw_prim;
+	
+	initial begin
+		draw_state   = draw_idle;
+		draw_done    = 0;
+		draw_pending = 0;
+	end
+	
+	quartz_raster raster(
+		clk_in,
+		raster_start,
+		draw_lines,
+		// Triangles use all 20 bytes, lines only the top 10.
+		draw_lines ? raster_prim[95:80]   : raster_prim[15:0],
+		draw_lines ? raster_prim[111:96]  : raster_prim[31:16],
+		raster_prim[47:32],
+		draw_lines ? raster_prim[127:112] : raster_prim[63:48],
+		draw_lines ? raster_prim[143:128] : raster_prim[79:64],
+		raster_prim[95:80],
+		raster_prim[111:96],
+		raster_prim[127:112],
+		raster_prim[143:128],
+		raster_prim[159:144],
+		draw_mask_reg,
+		raster_busy,
+		pix_valid,
+		pix_ready,
+		pix_x,
+		pix_y,
+		pix_z,
+		pix_color,
+		pix_mask,
+		pix_max
+	);
+	
+	quartz_fb fb(
+		clk_in,
+		fb_start,
+		geom_busy ? fb_read    : fb_kind,
+		geom_busy ? geom_addr  : fb_addr,
+		geom_busy ? geom_bytes : fb_bytes,
+		// CLEAR: u16 color, u16 depth, u8 planes.
+		draw_prim[135:120],
+		draw_prim[151:136],
+		draw_prim[153:152],
+		fb_busy,
+		draw_op == cmd_bulk ? bulk_rdata : draw_rdata,
+		fb_data_next,
+		fb_read_data,
+		fb_read_valid,
+		pix_valid,
+		pix_ready,
+		pix_x,
+		pix_y,
+		pix_z,
+		pix_color,
+		pix_mask,
+		pix_max,
+		fmark_rise,
+		lcd_frame,
+		lcd_valid,
+		lcd_pix,
+		pix_clk,
+		ram_io,
+		ram_clk,
+		ram_cs_n
+	);
+	
+	quartz_geom geom(
+		clk_in,
+		draw_state == draw_mesh && mesh_handle < 64,
+		mesh_handle[5:0],
+		draw_prim[102:80],
+		draw_prim[119:104],
+		draw_prim[142:120],
+		draw_prim[159:144],
+		// Parameter bytes are handed over as they are read.
+		draw_state == draw_shift && draw_then == draw_view,
+		draw_state == draw_shift && draw_then == draw_geom,
+		draw_rdata,
+		geom_start,
+		draw_handle_reg,
+		geom_busy,
+		geom_read,
+		geom_addr,
+		geom_bytes,
+		fb_busy,
+		fb_read_data,
+		fb_read_valid,
+		geom_tri_start,
+		raster_busy,
+		geom_tri
+	);
+	
 	always @(posedge clk_in) begin
-		// TODO
+		draw_rdata <= spi_rx_buf[draw_raddr];
+		bulk_rdata <= bulk_buf[{ bulk_copy, bulk_raddr }];
+	end
+	
+	always @(posedge clk_in) begin
+		draw_done <= 0;
+		case (draw_state)
+			draw_idle: if (bulk_full[bulk_copy]) begin
+				// Copy a received chunk to RAM.
+				draw_op      <= cmd_bulk;
+				fb_kind      <= fb_write;
+				fb_addr      <= bulk_dest[bulk_copy];
+				fb_bytes     <= bulk_size[bulk_copy];
+				bulk_ptr     <= 0;
+				draw_state   <= draw_fb_start;
+			end else if (draw_pending) begin
+				draw_pending <= 0;
+				draw_op    <= spi_rx_op;
+				draw_ptr   <= 3;
+				draw_end   <= 3 + spi_rx_len;
+				if (spi_rx_idx < 3 + spi_rx_len
+						|| (spi_rx_op == cmd_tris || spi_rx_op == cmd_lines || spi_rx_op == cmd_draw) && spi_rx_len < 2
+						|| spi_rx_op == cmd_clear && spi_rx_len < 5
+						|| spi_rx_op == cmd_mesh && spi_rx_len != 11
+						|| spi_rx_op == cmd_view && spi_rx_len != 18) begin
+					// Not enough data was received.
+					status_err_rx <= 1;
+					draw_done     <= 1;
+				end else if (spi_rx_op == cmd_tris || spi_rx_op == cmd_lines || spi_rx_op == cmd_draw) begin
+					draw_need     <= 2;
+					draw_then     <= draw_mask;
+					draw_state    <= draw_read;
+				end else if (spi_rx_op == cmd_clear) begin
+					fb_kind       <= fb_fill;
+					draw_need     <= 5;
+					draw_then     <= draw_fb_start;
+					draw_state    <= draw_read;
+				end else if (spi_rx_op == cmd_spans) begin
+					fb_kind       <= fb_write;
+					draw_state    <= draw_next;
+				end else if (spi_rx_op == cmd_mesh) begin
+					draw_need     <= 11;
+					draw_then     <= draw_mesh;
+					draw_state    <= draw_read;
+				end else if (spi_rx_op == cmd_view) begin
+					draw_need     <= 18;
+					draw_then     <= draw_view;
+					draw_state    <= draw_read;
+				end else begin
+					fb_kind       <= fb_present;
+					draw_state    <= draw_fb_start;
+				end
+			end
+			
+			// Start the next primitive or span, if there is a whole one left.
+			draw_next: begin
+				if (draw_op == cmd_bulk) begin
+					// The bank is free for another chunk.
+					bulk_full[bulk_copy] <= 0;
+					bulk_copy     <= !bulk_copy;
+					draw_state    <= draw_idle;
+				end else if (draw_left == 0) begin
+					draw_state    <= draw_finish;
+				end else if (draw_op == cmd_spans && draw_left >= 6) begin
+					draw_need     <= 6;
+					draw_then     <= draw_span;
+					draw_state    <= draw_read;
+				end else if ((draw_op == cmd_tris || draw_op == cmd_lines) && draw_left >= draw_size) begin
+					draw_need     <= draw_size;
+					draw_then     <= draw_start;
+					draw_state    <= draw_read;
+				end else if (draw_op == cmd_draw && draw_left >= 40) begin
+					draw_need     <= 1;
+					draw_then     <= draw_handle;
+					draw_state    <= draw_read;
+				end else begin
+					status_err_rx <= 1;
+					draw_state    <= draw_finish;
+				end
+			end
+			
+			// Read a byte, the buffer is synchronous.
+			draw_read: begin
+				draw_ptr   <= draw_ptr + 1;
+				draw_need  <= draw_need - 1;
+				draw_state <= draw_shift;
+			end
+			draw_shift: begin
+				draw_prim  <= { draw_rdata, draw_prim[159:8] };
+				draw_state <= draw_need != 0 ? draw_read : draw_then;
+			end
+			draw_mask: begin
+				draw_mask_reg <= draw_prim[159:144];
+				draw_state    <= draw_next;
+			end
+			
+			// Wait for the rasterizer to take the primitive; the next one is read while it works.
+			draw_start: if (!raster_busy) begin
+				draw_state <= draw_next;
+			end
+			
+			// Check that the span fits on the screen and in the command.
+			draw_span: begin
+				if (span_len == 0 || span_len > draw_left[7:1] || span_y >= 240 || span_x + span_len > 320) begin
+					status_err_rx <= 1;
+					draw_state    <= draw_finish;
+				end else begin
+					fb_addr       <= { { span_y[7:0], 8'b0 } + { span_y[7:0], 6'b0 } + span_x[8:0], 1'b0 };
+					fb_bytes      <= { span_len[7:0], 1'b0 };
+					draw_state    <= draw_fb_start;
+				end
+			end
+			
+			// Wait for the framebuffer to take the operation, then to finish it.
+			// Span and chunk data is taken from the receive buffers as it goes.
+			draw_fb_start: if (!fb_busy) begin
+				draw_state <= draw_fb_wait;
+			end
+			draw_fb_wait: begin
+				if (fb_data_next && draw_op == cmd_bulk) begin
+					bulk_ptr   <= bulk_ptr + 1;
+				end else if (fb_data_next) begin
+					draw_ptr   <= draw_ptr + 1;
+				end
+				if (!fb_busy) begin
+					draw_state <= draw_next;
+				end
+			end
+			
+			// Define a resident mesh; the geometry unit takes it from draw_prim.
+			draw_mesh: begin
+				if (mesh_handle >= 64) begin
+					status_err_rx <= 1;
+				end
+				draw_state <= draw_finish;
+			end
+			
+			// The projection was shifted into the geometry unit as it was read.
+			draw_view: begin
+				draw_state <= draw_finish;
+			end
+			
+			// Read the color and placement of a draw, skipping draws of bad handles.
+			draw_handle: begin
+				if (draw_handle_byte >= 64) begin
+					status_err_rx   <= 1;
+					draw_ptr        <= draw_ptr + 39;
+					draw_state      <= draw_next;
+				end else begin
+					draw_handle_reg <= draw_handle_byte[5:0];
+					draw_need       <= 39;
+					draw_then       <= draw_geom;
+					draw_state      <= draw_read;
+				end
+			end
+			
+			// Start the geometry unit and wait for it; it hands triangles to the rasterizer itself.
+			draw_geom: begin
+				draw_state <= draw_geom_wait;
+			end
+			draw_geom_wait: if (!geom_busy) begin
+				draw_state <= draw_next;
+			end
+			
+			// Wait for the last primitive to be drawn.
+			draw_finish: if (!raster_busy && !fb_busy && !geom_busy) begin
+				draw_done  <= 1;
+				draw_state <= draw_idle;
+			end
+		endcase
+		
+		// Take received commands and chunks.
+		if (spi_cs_rise && spi_rx_op != 0) begin
+			status_chunk_ok <= 0;
+		end
+		if (spi_cs_rise && spi_rx_draw) begin
+			draw_pending <= 1;
+		end
+		if (spi_cs_rise && bulk_ok) begin
+			status_chunk_ok      <= 1;
+			bulk_full[bulk_bank] <= 1;
+			bulk_dest[bulk_bank] <= bulk_addr[22:0];
+			bulk_size[bulk_bank] <= bulk_len[11:0];
+			bulk_bank            <= !bulk_bank;
+		end
 	end
 	
 	// SPI Send.
@@ -120,8 +553,27 @@ module top (
 	// SPI Recv.
 	reg [7:0]  spi_rx_sum;
 	reg [7:0]  spi_rx_avl;
-	reg [7:0]  spi_rx_buf[31:0];
+	reg [7:0]  spi_rx_buf[255:0];
+	// Received byte count, opcode and send length of the current transaction.
+	reg [11:0] spi_rx_idx;
+	reg [7:0]  spi_rx_op;
+	reg [7:0]  spi_rx_len;
 	reg        spi_rx_trigger;
+	// Whether the command goes to the draw sequencer.
+	wire       spi_rx_draw = spi_rx_op >= cmd_tris && spi_rx_op <= cmd_draw && spi_rx_op != cmd_bulk;
+	wire[7:0]  spi_rx_byte = { spi_recv_data[6:0], spi_mosi };
+	
+	// Bulk chunk: u16 length, u24 address, data, u16 CRC-16/CCITT of everything after the opcode.
+	reg [15:0] bulk_len;
+	reg [23:0] bulk_addr;
+	reg [15:0] bulk_crc;
+	reg [15:0] bulk_crc_rx;
+	// Offset of the received byte in the chunk's data.
+	wire[11:0] bulk_pos   = spi_rx_idx - 6;
+	wire       bulk_data  = spi_rx_op == cmd_bulk && spi_rx_idx >= 6 && bulk_pos < bulk_len && !bulk_pos[11];
+	wire       bulk_ok    = spi_rx_op == cmd_bulk && bulk_len != 0 && bulk_len <= 2048
+	                     && spi_rx_idx == 8 + bulk_len && bulk_crc == bulk_crc_rx
+	                     && { 1'b0, bulk_addr } + bulk_len <= 'h800000;
 	
 	always @(posedge spi_clk, posedge spi_cs_n) begin
 		if (spi_cs_n) begin
@@ -130,6 +582,8 @@ module top (
 			spi_tx_data  <= spi_tx_avl;
 			spi_tx_sum   <= 'hcc ^ spi_tx_avl;
 			spi_byte_idx <= -1;
+			spi_rx_idx   <= 0;
+			bulk_crc     <= 'hffff;
 			
 		end else begin
 			
@@ -163,8 +617,26 @@ module top (
 			// Record received bits.
 			if (spi_bit == 7) begin
 				spi_rx_avl  <= spi_rx_avl + 1;
-				spi_rx_sum  <= spi_rx_sum ^ { spi_recv_data[6:0], spi_mosi };
-				spi_rx_buf[spi_byte_idx] <= { spi_recv_data[6:0], spi_mosi };
+				spi_rx_sum  <= spi_rx_sum ^ spi_rx_byte;
+				if (spi_rx_idx < 256) spi_rx_buf[spi_rx_idx] <= spi_rx_byte;
+				if (spi_rx_idx != 'hfff) spi_rx_idx <= spi_rx_idx + 1;
+				if (spi_rx_idx == 0) spi_rx_op  <= spi_rx_byte;
+				if (spi_rx_idx == 1) spi_rx_len <= spi_rx_byte;
+				
+				// Bulk chunk fields; the bank is free, or the host would not have been answered.
+				if (spi_rx_idx == 1) bulk_len[7:0]    <= spi_rx_byte;
+				if (spi_rx_idx == 2) bulk_len[15:8]   <= spi_rx_byte;
+				if (spi_rx_idx == 3) bulk_addr[7:0]   <= spi_rx_byte;
+				if (spi_rx_idx == 4) bulk_addr[15:8]  <= spi_rx_byte;
+				if (spi_rx_idx == 5) bulk_addr[23:16] <= spi_rx_byte;
+				if (bulk_data) bulk_buf[{ bulk_bank, bulk_pos[10:0] }] <= spi_rx_byte;
+				if (spi_rx_idx == 6 + bulk_len) bulk_crc_rx[7:0]  <= spi_rx_byte;
+				if (spi_rx_idx == 7 + bulk_len) bulk_crc_rx[15:8] <= spi_rx_byte;
+			end
+			
+			// The CRC is computed a bit at a time, most significant bit first.
+			if (spi_rx_idx != 0 && (spi_rx_idx < 6 || bulk_pos < bulk_len)) begin
+				bulk_crc <= { bulk_crc[14:0], 1'b0 } ^ (bulk_crc[15] ^ spi_mosi ? 'h1021 : 0);
 			end
 			spi_recv_data <= { spi_recv_data[6:0], spi_mosi };
 			
@@ -187,23 +659,42 @@ module top (
 		end
 	end
 	
-	reg spi_cs_n_last;
+	reg  spi_cs_n_last;
+	wire spi_cs_rise = spi_cs_n && !spi_cs_n_last;
 	always @(posedge clk_in) begin
 		if (spi_rx_trigger) begin
 			spi_rx_trigger <= 0;
-		end else if (spi_cs_n && !spi_cs_n_last) begin
-			spi_rx_trigger <= 1;
+		end else if (spi_cs_rise) begin
+			if (spi_rx_op == cmd_fmark) begin
+				// Respond at the next tearing effect pulse instead.
+				fmark_wait     <= 1;
+			end else if (spi_rx_draw) begin
+				// Respond once drawing is complete.
+			end else if (spi_rx_op == cmd_bulk) begin
+				// Respond once the next chunk can be received.
+				bulk_wait      <= 1;
+			end else begin
+				spi_rx_trigger <= 1;
+			end
 			
 			// Hello logic.
-			if (spi_rx_buf[0] == cmd_status) begin
+			if (spi_rx_op == cmd_status) begin
 				if (hello_reg != 2) begin
 					hello_reg <= hello_reg + 1;
 				end
 			end
+		end else if (fmark_wait && fmark_rise) begin
+			// The panel started blanking.
+			fmark_wait     <= 0;
+			spi_rx_trigger <= 1;
+		end else if (draw_done) begin
+			spi_rx_trigger <= 1;
+		end else if (bulk_wait && !bulk_full[bulk_bank]) begin
+			bulk_wait      <= 0;
+			spi_rx_trigger <= 1;
 		end
 		
 		spi_cs_n_last <= spi_cs_n;
-		resp_rdy_init <= 1;
 	end
 	
 endmodule
@@ -0,0 +1,199 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz_emu.h"
+#include "quartz_proto.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Measures the command protocol against the emulator:
+// how fast the host side runs, and what the SPI bus would allow.
+// Usage: quartz_bench [commands per test] [SPI clock in Hz] [gap between transactions in us]
+// Wire figures are modelled, not measured: the emulator charges the SPI clock for every byte and an assumed gap
+// per transaction, which stands in for chip select, the interrupt and the SPI driver that it does not run.
+// Measure on the badge with quartz_trace to check them.
+
+// Default gap between transactions in microseconds; an estimate for interrupt driven ESP-IDF SPI transactions
+// plus waking the task on the GPU's interrupt, not a measurement.
+#define BENCH_GAP_US 30
+
+// A payload to send repeatedly.
+typedef struct {
+	// Shown in the report.
+	const char  *name;
+	quartz_cmd_t opcode;
+	// Amount of triangles, lines or pixels.
+	int          count;
+} bench_load_t;
+
+static const bench_load_t loads[] = {
+	{ "status",   QUARTZ_CMD_STATUS, 0 },
+	{ "1 line",   QUARTZ_CMD_LINES,  1 },
+	{ "25 lines", QUARTZ_CMD_LINES,  QUARTZ_LINE_BATCH },
+	{ "1 tri",    QUARTZ_CMD_TRIS,   1 },
+	{ "4 tris",   QUARTZ_CMD_TRIS,   4 },
+	{ "12 tris",  QUARTZ_CMD_TRIS,   QUARTZ_TRI_BATCH },
+	{ "123 px",   QUARTZ_CMD_SPANS,  QUARTZ_SPAN_BATCH },
+};
+
+// Chance per byte of a flipped bit, also used as the chance per command of a lost interrupt.
+static const double fault_rates[] = { 0, 1e-5, 1e-4, 1e-3 };
+
+// Build the payload for a load; small primitives so rasterizing does not dominate.
+static uint8_t bench_payload(const bench_load_t *load, uint8_t *out) {
+	if (load->opcode == QUARTZ_CMD_STATUS) return 0;
+	
+	if (load->opcode == QUARTZ_CMD_SPANS) {
+		// One span, as framebuffer uploads send them.
+		quartz_put16(out + 0, 0);
+		quartz_put16(out + 2, 0);
+		quartz_put16(out + 4, load->count);
+		for (int i = 0; i < load->count; i++) {
+			quartz_put16(out + QUARTZ_SPAN_HEADER + i * 2, i * 0x0841);
+		}
+		return QUARTZ_SPAN_HEADER + load->count * 2;
+	}
+	
+	quartz_put16(out, 0xffff);
+	size_t len = 2;
+	for (int i = 0; i < load->count; i++) {
+		int16_t x = (i % 16) * 320, y = (i / 16) * 320;
+		if (load->opcode == QUARTZ_CMD_TRIS) {
+			quartz_tri_t tri = {
+				.v     = { { x, y, 1000 }, { x + 48, y, 1000 }, { x, y + 48, 1000 } },
+				.color = 0xffff,
+			};
+			quartz_encode_tri(out + len, &tri);
+			len += QUARTZ_TRI_SIZE;
+		} else {
+			quartz_line_t line = { x, y, x + 48, y + 32, 0xffff };
+			quartz_encode_line(out + len, &line);
+			len += QUARTZ_LINE_SIZE;
+		}
+	}
+	return len;
+}
+
+// Measure bulk transfers of 64 KB blocks, checking every block that arrived.
+static void bench_bulk(long commands, uint32_t spi_hz, double gap_us) {
+	static uint8_t block[65536];
+	static uint8_t ram[sizeof(block)];
+	long blocks = commands / 32 > 0 ? commands / 32 : 1;
+	
+	static quartz_emu_t emu;
+	quartz_transport_t  transport = quartz_emu_transport(&emu);
+	
+	printf("\n%ld blocks of %zu bytes per test, %d byte chunks\n", blocks, sizeof(block), QUARTZ_BULK_CHUNK);
+	printf("model columns are modelled, not measured, assuming %.1f us between transactions\n", gap_us);
+	printf("%-9s %8s %9s %10s %7s %8s %7s %7s\n",
+		"load", "faults", "host MB/s", "model KB/s", "model %", "chunks", "failed", "corrupt");
+	
+	for (size_t f = 0; f < sizeof(fault_rates) / sizeof(*fault_rates); f++) {
+		quartz_emu_init(&emu, 100 + f);
+		emu.model.ram      = ram;
+		emu.model.ram_size = sizeof(ram);
+		emu.spi_hz         = spi_hz;
+		emu.gap_ns         = gap_us * 1000;
+		emu.mosi_error     = fault_rates[f];
+		emu.miso_error     = fault_rates[f];
+		emu.irq_loss       = fault_rates[f];
+		
+		long    failed  = 0;
+		long    corrupt = 0;
+		int64_t start   = quartz_time_us();
+		for (long i = 0; i < blocks; i++) {
+			for (size_t j = 0; j < sizeof(block); j++) block[j] = i + j * 7;
+			memset(ram, 0, sizeof(ram));
+			if (!quartz_proto_bulk(&transport, QUARTZ_RAM_FREE, block, sizeof(block))) {
+				failed ++;
+			} else if (memcmp(ram, block, sizeof(block))) {
+				corrupt ++;
+			}
+		}
+		double host_s = (quartz_time_us() - start) / 1e6;
+		double wire_s = emu.wire_ns / 1e9;
+		// Only blocks that arrived count.
+		double bytes  = (double) (blocks - failed) * sizeof(block);
+		
+		printf("%-9s %8g %9.2f %10.1f %6.1f%% %8ld %7ld %7ld\n",
+			"64K bulk", fault_rates[f],
+			bytes / host_s / 1e6, bytes / wire_s / 1e3,
+			100.0 * bytes / wire_s / (spi_hz / 8.0),
+			(long) (emu.transactions / 2), failed, corrupt
+		);
+	}
+}
+
+int main(int argc, char **argv) {
+	long     commands = argc > 1 ? atol(argv[1]) : 20000;
+	uint32_t spi_hz   = argc > 2 ? atol(argv[2]) : 40000000;
+	double   gap_us   = argc > 3 ? atof(argv[3]) : BENCH_GAP_US;
+	if (commands < 1 || spi_hz < 1 || gap_us < 0) {
+		fprintf(stderr, "Usage: %s [commands per test] [SPI clock in Hz] [gap between transactions in us]\n", argv[0]);
+		return 1;
+	}
+	
+	static quartz_emu_t emu;
+	quartz_transport_t  transport = quartz_emu_transport(&emu);
+	
+	printf("%ld commands per test, SPI clock %.1f MHz\n", commands, spi_hz / 1e6);
+	printf("model columns are modelled, not measured, assuming %.1f us between transactions\n", gap_us);
+	printf("%-9s %7s %8s %10s %9s %11s %10s %7s\n",
+		"load", "payload", "faults", "host cmd/s", "host MB/s", "model cmd/s", "model KB/s", "failed");
+	
+	for (size_t f = 0; f < sizeof(fault_rates) / sizeof(*fault_rates); f++) {
+		for (size_t l = 0; l < sizeof(loads) / sizeof(*loads); l++) {
+			uint8_t payload[QUARTZ_MAX_SEND];
+			uint8_t len = bench_payload(&loads[l], payload);
+			
+			quartz_emu_init(&emu, 1 + l);
+			emu.spi_hz     = spi_hz;
+			emu.gap_ns     = gap_us * 1000;
+			emu.mosi_error = fault_rates[f];
+			emu.miso_error = fault_rates[f];
+			emu.irq_loss   = fault_rates[f];
+			
+			long    failed = 0;
+			int64_t start  = quartz_time_us();
+			for (long i = 0; i < commands; i++) {
+				uint8_t resp[8];
+				if (!quartz_proto_cmd(&transport, loads[l].opcode, len, payload, sizeof(resp), resp)) failed ++;
+			}
+			double host_s = (quartz_time_us() - start) / 1e6;
+			double wire_s = emu.wire_ns / 1e9;
+			
+			printf("%-9s %7u %8g %10.0f %9.2f %11.0f %10.1f %6.2f%%\n",
+				loads[l].name, len, fault_rates[f],
+				commands / host_s, commands * len / host_s / 1e6,
+				commands / wire_s, commands * len / wire_s / 1e3,
+				100.0 * failed / commands
+			);
+		}
+	}
+	
+	bench_bulk(commands, spi_hz, gap_us);
+	
+	return 0;
+}
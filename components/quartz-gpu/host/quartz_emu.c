@@ -0,0 +1,114 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz_emu.h"
+#include <string.h>
+
+// Get a uniformly distributed number in [0, 1).
+static double quartz_emu_random(quartz_emu_t *emu) {
+	// xorshift64*
+	emu->rng ^= emu->rng >> 12;
+	emu->rng ^= emu->rng << 25;
+	emu->rng ^= emu->rng >> 27;
+	return (emu->rng * 0x2545f4914f6cdd1dULL >> 11) * (1.0 / (1ULL << 53));
+}
+
+// Flip a random bit in some of the bytes.
+static void quartz_emu_corrupt(quartz_emu_t *emu, uint8_t *data, size_t length, double chance) {
+	if (chance <= 0) return;
+	for (size_t i = 0; i < length; i++) {
+		if (quartz_emu_random(emu) < chance) {
+			data[i] ^= 1 << (int) (quartz_emu_random(emu) * 8);
+			emu->flips ++;
+		}
+	}
+}
+
+// Do one SPI transaction with the emulated GPU.
+static bool quartz_emu_transfer(void *args, const void *tx, void *rx, size_t length) {
+	quartz_emu_t *emu = args;
+	uint8_t      *out = rx;
+	
+	// Chip select clears the interrupt.
+	emu->irq = false;
+	emu->transactions ++;
+	emu->bytes   += length;
+	emu->wire_ns += length * 8 * 1000000000ULL / emu->spi_hz + emu->gap_ns;
+	
+	// The GPU always streams out its status: available length, the status and a checksum.
+	uint8_t resp[QUARTZ_EMU_RESP_LEN];
+	resp[0] = 8;
+	quartz_model_status(&emu->model, &resp[1]);
+	uint8_t sum = 0xcc;
+	for (int i = 0; i < 9; i++) sum ^= resp[i];
+	resp[9] = sum;
+	
+	for (size_t i = 0; i < length; i++) {
+		out[i] = i < QUARTZ_EMU_RESP_LEN ? resp[i] : 0;
+	}
+	quartz_emu_corrupt(emu, out, length, emu->miso_error);
+	
+	// Whatever was received is run as a command once chip select is released.
+	static uint8_t cmd[QUARTZ_BULK_HEADER + QUARTZ_BULK_CHUNK + 2];
+	if (length > sizeof(cmd)) length = sizeof(cmd);
+	memcpy(cmd, tx, length);
+	quartz_emu_corrupt(emu, cmd, length, emu->mosi_error);
+	uint8_t dummy[8];
+	quartz_model_command(&emu->model, cmd, length, dummy, sizeof(dummy));
+	
+	if (emu->irq_loss > 0 && quartz_emu_random(emu) < emu->irq_loss) {
+		emu->lost_irqs ++;
+	} else {
+		emu->irq = true;
+	}
+	return true;
+}
+
+// Wait for the emulated interrupt line.
+static bool quartz_emu_await(void *args, uint64_t wait_time) {
+	quartz_emu_t *emu = args;
+	// Commands complete as soon as they are sent, so a missing interrupt will never come
+	// and the host sits out the whole wait.
+	if (!emu->irq) emu->wire_ns += wait_time * 1000000;
+	return emu->irq;
+}
+
+
+
+// Initialise the emulator without faults, with a 40 MHz SPI clock.
+void quartz_emu_init(quartz_emu_t *emu, uint64_t seed) {
+	memset(emu, 0, sizeof(*emu));
+	quartz_model_init(&emu->model);
+	emu->rng    = seed ? seed : 1;
+	emu->spi_hz = 40000000;
+}
+
+// Get a transport that talks to the emulator.
+quartz_transport_t quartz_emu_transport(quartz_emu_t *emu) {
+	return (quartz_transport_t) {
+		.transfer = quartz_emu_transfer,
+		.await    = quartz_emu_await,
+		.args     = emu,
+	};
+}
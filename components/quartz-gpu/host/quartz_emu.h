@@ -0,0 +1,82 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#ifndef QUARTZ_EMU_H
+#define QUARTZ_EMU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "quartz_port.h"
+#include "quartz_model.h"
+
+// In-process stand-in for the FPGA, for testing the protocol on Linux.
+// Follows the RTL: every transaction is a command, the response to it streams out
+// during the next transaction and the interrupt line is raised in between.
+
+// Longest response the emulator streams out: available length, 8 status bytes, checksum.
+#define QUARTZ_EMU_RESP_LEN 10
+
+typedef struct {
+	// The emulated GPU.
+	quartz_model_t model;
+	// Whether the interrupt line is active.
+	bool           irq;
+	
+	// Chance per byte of one flipped bit from host to GPU.
+	double         mosi_error;
+	// Chance per byte of one flipped bit from GPU to host.
+	double         miso_error;
+	// Chance per command that the interrupt is never raised.
+	double         irq_loss;
+	// State of the fault injection random number generator.
+	uint64_t       rng;
+	
+	// SPI clock used to estimate time on the wire, in Hz.
+	uint32_t       spi_hz;
+	// Time added per transaction for chip select, interrupt latency and the driver, in nanoseconds.
+	uint32_t       gap_ns;
+	// Time the transactions would have taken on the wire, including waits for lost interrupts, in nanoseconds.
+	uint64_t       wire_ns;
+	// Amount of transactions.
+	uint64_t       transactions;
+	// Amount of bytes transferred, counting each direction once.
+	uint64_t       bytes;
+	// Amount of bits flipped by fault injection.
+	uint64_t       flips;
+	// Amount of interrupts dropped by fault injection.
+	uint64_t       lost_irqs;
+} quartz_emu_t;
+
+// Initialise the emulator without faults, with a 40 MHz SPI clock.
+void               quartz_emu_init     (quartz_emu_t *emu, uint64_t seed);
+// Get a transport that talks to the emulator.
+quartz_transport_t quartz_emu_transport(quartz_emu_t *emu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUARTZ_EMU_H
@@ -0,0 +1,69 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz.h"
+
+// What quartz.c does on the badge, for running the portable driver on Linux.
+// Commands go straight to the transport; there is no command task, so batches send synchronously.
+
+// Transport used by quartz_cmd_raw, set with quartz_set_transport.
+static const quartz_transport_t *quartz_transport;
+
+// Replace the transport used to reach the GPU; NULL leaves none, and commands fail.
+void quartz_set_transport(const quartz_transport_t *transport) {
+	quartz_transport = transport;
+}
+
+// Send a raw quartz command.
+// Returns whether the message was successfully received.
+bool quartz_cmd_raw(quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf) {
+	return quartz_transport && quartz_proto_cmd(quartz_transport, opcode, send, send_buf, recv, recv_buf);
+}
+
+// Write any amount of data to the GPU's RAM, in checksummed chunks that are retried when damaged.
+// Returns whether all of it arrived.
+bool quartz_bulk_write(uint32_t addr, const void *data, size_t len) {
+	return quartz_transport && quartz_proto_bulk(quartz_transport, addr, data, len);
+}
+
+// Prepare a command for the asynchronous command queue.
+void quartz_job_init(quartz_job_t *job, quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf) {
+	*job = (quartz_job_t) {
+		.opcode   = opcode,
+		.send     = send,
+		.send_buf = send_buf,
+		.recv     = recv,
+		.recv_buf = recv_buf,
+	};
+}
+
+// There is no command queue; callers send the command themselves.
+bool quartz_submit(quartz_job_t *job, uint64_t wait_time) {
+	return false;
+}
+
+// Nothing is ever queued, so there is nothing to wait for.
+bool quartz_job_wait(quartz_job_t *job, uint64_t wait_time) {
+	return job->done;
+}
@@ -0,0 +1,176 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz.h"
+#include "quartz_emu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Checks quartz_delta_upload against the emulator: after every upload the model's framebuffer
+// must hold the frame, only tiles that changed may be sent, and a failed upload must be healed by the next.
+// Usage: quartz_test_delta [frames per pass] [seed]
+
+// Report a failed check and carry on.
+#define CHECK(cond, ...) do { \
+		if (!(cond)) { \
+			failures ++; \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+static int          failures;
+static quartz_emu_t emu;
+static uint64_t     rng;
+
+// The frame as it should appear, as sent and as sent the time before.
+static uint16_t want[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+static uint16_t sent[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+static uint16_t last[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+
+// Get a random number below `limit`.
+static uint32_t test_random(uint32_t limit) {
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return (rng * 0x2545f4914f6cdd1dULL >> 32) % limit;
+}
+
+// Fill a rectangle with noise or a flat color.
+static void test_rect(int x, int y, int w, int h) {
+	bool     noise = test_random(2);
+	uint16_t color = test_random(0x10000);
+	for (int py = y; py < y + h; py++) {
+		for (int px = x; px < x + w; px++) {
+			want[py * QUARTZ_WIDTH + px] = noise ? test_random(0x10000) : color;
+		}
+	}
+}
+
+// Change the frame the way a renderer might: not at all, in a few places, in whole bands or entirely.
+static void test_next_frame(int index) {
+	int kind = index ? test_random(8) : 7;
+	if (kind == 0) {
+		// Unchanged.
+	} else if (kind < 5) {
+		for (int i = test_random(4); i >= 0; i--) {
+			int w = 1 + test_random(QUARTZ_WIDTH / 2);
+			int h = 1 + test_random(QUARTZ_HEIGHT / 2);
+			test_rect(test_random(QUARTZ_WIDTH - w + 1), test_random(QUARTZ_HEIGHT - h + 1), w, h);
+		}
+	} else if (kind < 7) {
+		int h = 1 + test_random(QUARTZ_HEIGHT / 2);
+		test_rect(0, test_random(QUARTZ_HEIGHT - h + 1), QUARTZ_WIDTH, h);
+	} else {
+		test_rect(0, 0, QUARTZ_WIDTH, QUARTZ_HEIGHT);
+	}
+}
+
+// Count the tiles that differ between two frames.
+static int test_changed_tiles(const uint16_t *a, const uint16_t *b) {
+	int count = 0;
+	for (int ty = 0; ty < QUARTZ_TILES_Y; ty++) {
+		for (int tx = 0; tx < QUARTZ_TILES_X; tx++) {
+			bool same = true;
+			for (int y = ty * QUARTZ_TILE_SIZE; y < (ty + 1) * QUARTZ_TILE_SIZE && same; y++) {
+				const uint16_t *ra = a + y * QUARTZ_WIDTH + tx * QUARTZ_TILE_SIZE;
+				const uint16_t *rb = b + y * QUARTZ_WIDTH + tx * QUARTZ_TILE_SIZE;
+				same = !memcmp(ra, rb, QUARTZ_TILE_SIZE * sizeof(uint16_t));
+			}
+			count += !same;
+		}
+	}
+	return count;
+}
+
+// Compare a plane of the model with the frame, reporting the first difference.
+static bool test_compare(const uint16_t *plane, const char *name, int frame) {
+	for (int i = 0; i < QUARTZ_WIDTH * QUARTZ_HEIGHT; i++) {
+		if (plane[i] != want[i]) {
+			CHECK(false, "frame %d: %s (%d, %d) is %04x, not %04x", frame, name,
+				i % QUARTZ_WIDTH, i / QUARTZ_WIDTH, plane[i], want[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Upload `frames` frames, with faults injected if `faulty`; returns the amount of failed uploads.
+static int test_pass(int frames, bool swapped, bool faulty) {
+	quartz_delta_t delta;
+	quartz_batch_t batch;
+	quartz_delta_init(&delta);
+	quartz_batch_init(&batch);
+	quartz_emu_init(&emu, rng);
+	emu.miso_error = faulty ? 1e-3 : 0;
+	emu.irq_loss   = faulty ? 1e-3 : 0;
+	int retries    = 0;
+	
+	for (int i = 0; i < frames; i++) {
+		test_next_frame(i);
+		memcpy(last, sent, sizeof(sent));
+		for (int j = 0; j < QUARTZ_WIDTH * QUARTZ_HEIGHT; j++) {
+			sent[j] = swapped ? (want[j] >> 8) | (want[j] << 8) : want[j];
+		}
+		
+		if (!faulty) {
+			int tiles = i ? test_changed_tiles(sent, last) : QUARTZ_TILES_X * QUARTZ_TILES_Y;
+			CHECK(quartz_delta_upload(&delta, &batch, sent, swapped), "frame %d: upload failed without faults", i);
+			CHECK(delta.tiles == tiles, "frame %d: sent %u tiles, %d changed", i, delta.tiles, tiles);
+			CHECK(delta.pixels == (uint32_t) tiles * QUARTZ_TILE_SIZE * QUARTZ_TILE_SIZE, "frame %d: sent %u pixels for %d tiles", i, delta.pixels, tiles);
+		} else {
+			// Faults make uploads fail, after which the next one sends everything.
+			int tries = 0;
+			while (!quartz_delta_upload(&delta, &batch, sent, swapped) && tries < 10) tries ++;
+			CHECK(tries < 10, "frame %d: upload did not recover", i);
+			retries += tries;
+		}
+		if (!test_compare(emu.model.color, "color", i)) break;
+		
+		if (!faulty) {
+			CHECK(quartz_cmd_present().rx_valid, "frame %d: present failed", i);
+			if (!test_compare(emu.model.lcd, "LCD", i)) break;
+		}
+	}
+	return retries;
+}
+
+int main(int argc, char **argv) {
+	int frames = argc > 1 ? atoi(argv[1]) : 50;
+	rng        = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+	
+	quartz_transport_t transport = quartz_emu_transport(&emu);
+	quartz_set_transport(&transport);
+	
+	test_pass(frames, false, false);
+	test_pass(frames, true,  false);
+	int retries = test_pass(frames, false, true);
+	CHECK(retries > 0, "no upload failed with faults injected, the recovery was not tested");
+	
+	printf("quartz_test_delta: %d frames per pass, %d failed uploads healed: %s\n",
+		frames, retries, failures ? "FAIL" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,426 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz.h"
+#include "quartz_emu.h"
+#include "wf3d.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Checks quartz_meshes against the emulator: resident meshes stay inside their region and never
+// overlap, the least recently drawn ones are evicted to make room, a key reused for another mesh
+// is not mistaken for the old one, and meshes drawn by the GPU look like wf3d drawing them itself.
+// Usage: quartz_test_meshes [acquires] [seed]
+
+// Report a failed check and carry on.
+#define CHECK(cond, ...) do { \
+		if (!(cond)) { \
+			failures ++; \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+// Amount of different meshes acquired, more than there are handles.
+#define TEST_KEYS         96
+// Size of the region they share, far too small for all of them.
+#define TEST_REGION       0x8000
+// Most vertices and triangles per mesh.
+#define TEST_MAX_VERTEX   300
+#define TEST_MAX_TRI      500
+// Most a color channel may differ by inside triangles, as the GPU shades the RGB565 color itself.
+#define TEST_SHADE_MARGIN 2
+// Most pixels that may differ on edges, in parts per thousand of the pixels either drew.
+#define TEST_MAX_DIFF_PERMILLE 30
+
+static int             failures;
+static quartz_emu_t    emu;
+static quartz_batch_t  batch;
+static quartz_meshes_t meshes;
+static uint64_t        rng;
+// The GPU's RAM after the framebuffer.
+static uint8_t         ram[QUARTZ_RAM_SIZE - QUARTZ_RAM_FREE];
+
+// A mesh to acquire, and a hash of how it was stored when it was uploaded.
+typedef struct {
+	float             vertices[TEST_MAX_VERTEX * 3];
+	size_t            tris[TEST_MAX_TRI * 3];
+	quartz_mesh_src_t src;
+	uint32_t          hash;
+} test_mesh_t;
+
+static test_mesh_t keys[TEST_KEYS];
+
+// Get a random number below `limit`.
+static uint32_t test_random(uint32_t limit) {
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return (rng * 0x2545f4914f6cdd1dULL >> 32) % limit;
+}
+
+// Make a random mesh of the given size.
+static void test_make(test_mesh_t *mesh, size_t num_vertex, size_t num_tri, uint32_t serial) {
+	for (size_t i = 0; i < num_vertex * 3; i++) {
+		mesh->vertices[i] = test_random(2001) / 1000.0f - 1;
+	}
+	for (size_t i = 0; i < num_tri * 3; i++) {
+		mesh->tris[i] = test_random(num_vertex);
+	}
+	mesh->src = (quartz_mesh_src_t) {
+		num_vertex, mesh->vertices,
+		num_tri,    mesh->tris,
+		serial,
+	};
+}
+
+// FNV-1a of the GPU's RAM, to tell whether a mesh was overwritten.
+static uint32_t test_hash(uint32_t addr, uint32_t size) {
+	uint32_t hash = 2166136261u;
+	for (uint32_t i = 0; i < size; i++) {
+		hash = (hash ^ ram[addr - QUARTZ_RAM_FREE + i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Acquire a mesh, remembering how it was stored if it was uploaded.
+static int test_acquire(test_mesh_t *key) {
+	uint32_t uploads = meshes.uploads;
+	int      handle  = quartz_meshes_acquire(&meshes, &batch, key, &key->src);
+	if (handle >= 0 && meshes.uploads != uploads) {
+		key->hash = test_hash(meshes.mesh[handle].addr, meshes.mesh[handle].size);
+	}
+	return handle;
+}
+
+// Check where the resident meshes are, what the GPU was told about them and that they are intact.
+static void test_check_layout(const char *test, int step) {
+	for (int i = 0; i < QUARTZ_MESH_SLOTS; i++) {
+		const quartz_mesh_t *mesh = &meshes.mesh[i];
+		if (!mesh->key) continue;
+		CHECK(mesh->addr >= meshes.base && mesh->addr + mesh->size <= meshes.base + meshes.size,
+			"%s %d: mesh %d at %06x-%06x is outside %06x-%06x", test, step, i,
+			mesh->addr, mesh->addr + mesh->size, meshes.base, meshes.base + meshes.size);
+		CHECK(mesh->addr >= QUARTZ_RAM_FREE && mesh->addr + mesh->size <= QUARTZ_RAM_SIZE,
+			"%s %d: mesh %d at %06x is not in free RAM", test, step, i, mesh->addr);
+		for (int j = i + 1; j < QUARTZ_MESH_SLOTS; j++) {
+			const quartz_mesh_t *other = &meshes.mesh[j];
+			if (!other->key) continue;
+			CHECK(other->key != mesh->key, "%s %d: a mesh is resident as %d and %d", test, step, i, j);
+			CHECK(other->addr >= mesh->addr + mesh->size || other->addr + other->size <= mesh->addr,
+				"%s %d: meshes %d and %d overlap", test, step, i, j);
+		}
+		
+		const test_mesh_t       *key = mesh->key;
+		const quartz_mesh_def_t *def = &emu.model.meshes[i];
+		CHECK(def->vtx_addr == mesh->addr && def->num_vertex == key->src.num_vertex && def->num_tri == key->src.num_tri
+			&& def->tri_addr == mesh->addr + key->src.num_vertex * QUARTZ_MESH_VTX_SIZE,
+			"%s %d: the GPU has another mesh as %d", test, step, i);
+		CHECK(test_hash(mesh->addr, mesh->size) == key->hash, "%s %d: mesh %d was overwritten", test, step, i);
+	}
+}
+
+// Acquire random meshes; every eviction must take the least recently drawn ones.
+static void test_lru(int steps) {
+	quartz_meshes_init(&meshes, QUARTZ_RAM_FREE, TEST_REGION);
+	for (int i = 0; i < TEST_KEYS; i++) {
+		// Mostly small, so that they run out of handles as well as room.
+		bool large = test_random(3) == 0;
+		test_make(&keys[i],
+			3 + test_random(large ? TEST_MAX_VERTEX - 3 : 30),
+			1 + test_random(large ? TEST_MAX_TRI - 1 : 40), 1);
+	}
+	
+	for (int step = 0; step < steps; step++) {
+		// Some meshes are drawn far more often than others.
+		test_mesh_t    *key    = &keys[test_random(test_random(2) ? 8 : TEST_KEYS)];
+		quartz_meshes_t before = meshes;
+		int             handle = test_acquire(key);
+		CHECK(handle >= 0, "lru %d: a mesh of %zu bytes did not fit", step,
+			key->src.num_vertex * QUARTZ_MESH_VTX_SIZE + key->src.num_tri * QUARTZ_MESH_TRI_SIZE);
+		if (handle < 0) continue;
+		CHECK(meshes.uploads != before.uploads || before.mesh[handle].key == key, "lru %d: drawn as another mesh", step);
+		
+		// Every mesh evicted must have been drawn longer ago than every one kept.
+		uint32_t evicted_min = UINT32_MAX, kept_max = 0;
+		uint32_t evicted     = 0;
+		for (int i = 0; i < QUARTZ_MESH_SLOTS; i++) {
+			if (!before.mesh[i].key || before.mesh[i].key == key) continue;
+			uint32_t age = before.clock - before.mesh[i].last_use;
+			if (meshes.mesh[i].key == before.mesh[i].key) {
+				if (age > kept_max) kept_max = age;
+			} else {
+				evicted ++;
+				if (age < evicted_min) evicted_min = age;
+			}
+		}
+		CHECK(evicted == meshes.evictions - before.evictions, "lru %d: %u meshes gone, %u evicted",
+			step, evicted, meshes.evictions - before.evictions);
+		CHECK(!evicted || evicted_min > kept_max, "lru %d: evicted a mesh drawn %u ago, kept one drawn %u ago",
+			step, evicted_min, kept_max);
+		test_check_layout("lru", step);
+	}
+	CHECK(meshes.evictions > 0, "nothing was evicted, so eviction was not tested");
+	printf("quartz_test_meshes: %d acquires, %u uploads, %u evictions\n", steps, meshes.uploads, meshes.evictions);
+}
+
+// Meshes that fill the region exactly, do not fit or are not meshes.
+static void test_bounds() {
+	quartz_meshes_init(&meshes, QUARTZ_RAM_FREE + 0x100, 0x1000);
+	
+	// Exactly the size of the region.
+	test_make(&keys[0], 256, 256, 1);
+	int handle = test_acquire(&keys[0]);
+	CHECK(handle >= 0 && meshes.mesh[handle].addr == meshes.base, "bounds: a mesh the size of the region was not put at its start");
+	test_check_layout("bounds", 0);
+	
+	// One vertex too many must fail without evicting anything.
+	test_make(&keys[1], 257, 256, 1);
+	CHECK(test_acquire(&keys[1]) < 0, "bounds: a mesh larger than the region was made resident");
+	CHECK(meshes.evictions == 0, "bounds: a mesh that can never fit evicted another");
+	
+	// Too many vertices or no triangles at all.
+	quartz_mesh_src_t huge  = { UINT16_MAX + 1, keys[1].vertices, 1, keys[1].tris, 1 };
+	quartz_mesh_src_t empty = { 3, keys[1].vertices, 0, keys[1].tris, 1 };
+	CHECK(quartz_meshes_acquire(&meshes, &batch, &huge,  &huge)  < 0, "bounds: a mesh with too many vertices was made resident");
+	CHECK(quartz_meshes_acquire(&meshes, &batch, &empty, &empty) < 0, "bounds: a mesh without triangles was made resident");
+	test_check_layout("bounds", 1);
+}
+
+// A key reused for another mesh, as when a shape is freed and another made at its address.
+static void test_reuse() {
+	quartz_meshes_init(&meshes, QUARTZ_RAM_FREE, TEST_REGION);
+	test_mesh_t *key = &keys[0];
+	test_make(key, 10, 8, 1);
+	int old = test_acquire(key);
+	CHECK(old >= 0, "reuse: the first mesh was not made resident");
+	
+	test_make(key, 20, 30, 2);
+	uint32_t uploads = meshes.uploads;
+	int      handle  = test_acquire(key);
+	CHECK(handle >= 0 && meshes.uploads == uploads + 1, "reuse: a new mesh with an old key was drawn as the old one");
+	test_check_layout("reuse", 0);
+	
+	// Drawing it again is a hit, forgetting it uploads it again.
+	uploads = meshes.uploads;
+	CHECK(test_acquire(key) == handle && meshes.uploads == uploads, "reuse: a resident mesh was uploaded again");
+	quartz_meshes_forget(&meshes, key);
+	CHECK(test_acquire(key) >= 0 && meshes.uploads == uploads + 1, "reuse: a forgotten mesh was not uploaded again");
+	test_check_layout("reuse", 1);
+	
+	// Shapes made by wf3d tell themselves apart, even where the heap gives out the same address again.
+	wf3d_shape_t *shape  = s3d_uv_sphere((vec3f_t) {0, 0, 0}, 1, 4, 4);
+	uint32_t      serial = shape->serial;
+	s3d_free(shape);
+	shape = s3d_uv_sphere((vec3f_t) {0, 0, 0}, 1, 4, 4);
+	CHECK(serial && shape->serial && shape->serial != serial, "reuse: two shapes have serial %u", serial);
+	s3d_free(shape);
+}
+
+
+
+// Converts a position in pixels to the GPU's 12.4 fixed-point, like main.c.
+static int16_t test_fixed(float value) {
+	float fixed = value * 16;
+	if (fixed < INT16_MIN) return INT16_MIN;
+	if (fixed > INT16_MAX) return INT16_MAX;
+	return lrintf(fixed);
+}
+
+// Sends a triangle from wf3d to the GPU.
+static void test_tri(void *args, const vec3f_t screen[3], uint16_t color565, uint16_t mask565) {
+	quartz_tri_t tri = { .color = color565 };
+	for (int i = 0; i < 3; i++) {
+		tri.v[i] = (quartz_vtx_t) { test_fixed(screen[i].x), test_fixed(screen[i].y), screen[i].z };
+	}
+	quartz_batch_tri(args, &tri, mask565);
+}
+
+// Sends a line from wf3d to the GPU.
+static void test_line(void *args, const vec3f_t screen[2], uint16_t color565) {
+	quartz_line_t line = {
+		test_fixed(screen[0].x), test_fixed(screen[0].y),
+		test_fixed(screen[1].x), test_fixed(screen[1].y),
+		color565,
+	};
+	quartz_batch_line(args, &line);
+}
+
+// Clears the GPU's depth buffer before a pass.
+static void test_clear(void *args) {
+	quartz_batch_flush(args);
+	quartz_cmd_clear(0, 0, QUARTZ_CLEAR_DEPTH);
+}
+
+// Keeps every mesh with triangles on the GPU.
+static bool test_keeps(void *args, wf3d_shape_t *shape) {
+	return shape->num_tri && shape->num_tri <= UINT16_MAX && shape->num_vertex <= UINT16_MAX;
+}
+
+// Projection last sent to the GPU.
+static quartz_view_t test_view;
+
+// Draws a mesh kept on the GPU, like main.c.
+static void test_mesh(void *args, wf3d_shape_t *shape, matrix_3d_t mtx, const wf3d_proj_t *proj, uint16_t color565, uint16_t mask565) {
+	quartz_mesh_src_t src = {
+		shape->num_vertex, (const float *) shape->vertices,
+		shape->num_tri,    shape->tri_indices,
+		shape->serial,
+	};
+	int handle = quartz_meshes_acquire(&meshes, args, shape, &src);
+	CHECK(handle >= 0, "render: a mesh of %zu triangles was not made resident", shape->num_tri);
+	if (handle < 0) return;
+	
+	quartz_view_t view = quartz_make_view(proj->focal, proj->scale, proj->cx, proj->cy, proj->depth_near, proj->depth_far);
+	if (memcmp(&view, &test_view, sizeof(view))) {
+		quartz_batch_flush(args);
+		quartz_cmd_view(&view);
+		test_view = view;
+	}
+	float light[3] = { proj->light.x, proj->light.y, proj->light.z };
+	quartz_xform_t xform = quartz_meshes_xform(&meshes, handle, mtx.arr, light);
+	quartz_batch_draw(args, handle, color565, mask565, &xform);
+}
+
+static const wf3d_sink_t test_sink = {
+	.tri   = test_tri,
+	.line  = test_line,
+	.clear = test_clear,
+	.keeps = test_keeps,
+	.mesh  = test_mesh,
+	.args  = &batch,
+};
+
+// Whether a pixel has a 4-neighbour of another color, so that it lies on an edge.
+static bool test_on_edge(const uint16_t *plane, int x, int y) {
+	uint16_t pixel = plane[x + y * QUARTZ_WIDTH];
+	return (x > 0                 && plane[x - 1 + y * QUARTZ_WIDTH] != pixel)
+		|| (x < QUARTZ_WIDTH - 1  && plane[x + 1 + y * QUARTZ_WIDTH] != pixel)
+		|| (y > 0                 && plane[x + (y - 1) * QUARTZ_WIDTH] != pixel)
+		|| (y < QUARTZ_HEIGHT - 1 && plane[x + (y + 1) * QUARTZ_WIDTH] != pixel);
+}
+
+// Whether two RGB565 colors are within the shading margin of each other.
+static bool test_shade_close(uint16_t a, uint16_t b) {
+	return abs((a >> 11) - (b >> 11)) <= TEST_SHADE_MARGIN
+		&& abs(((a >> 5) & 63) - ((b >> 5) & 63)) <= TEST_SHADE_MARGIN * 2
+		&& abs((a & 31) - (b & 31)) <= TEST_SHADE_MARGIN;
+}
+
+// Add the scene: two spheres, one partly in front of the other.
+static void test_scene(wf3d_ctx_t *ctx, wf3d_shape_t *sphere, wf3d_shape_t *ball) {
+	wf3d_clear(ctx);
+	wf3d_mesh(ctx, sphere);
+	wf3d_mesh_mtx(ctx, matrix_3d_translate(0.6f, 0.3f, -0.7f), ball);
+	wf3d_force_redraw(ctx);
+}
+
+// Draw spheres through resident meshes and through wf3d_raster565; they may only differ on edges
+// and by the rounding of the GPU's shading.
+static void test_render(int frames) {
+	quartz_meshes_init(&meshes, QUARTZ_RAM_FREE, QUARTZ_RAM_SIZE - QUARTZ_RAM_FREE);
+	memset(&test_view, 0, sizeof(test_view));
+	
+	// Set up like main.c does for the GPU.
+	pax_buf_t buf;
+	pax_buf_init(&buf, NULL, QUARTZ_WIDTH, QUARTZ_HEIGHT, PAX_BUF_16_565RGB);
+	wf3d_ctx_t ctx;
+	wf3d_init(&ctx);
+	ctx.depth      = malloc(sizeof(depth_t) * QUARTZ_WIDTH * QUARTZ_HEIGHT);
+	ctx.depth_mode = WF3D_DEPTH_RECIPROCAL;
+	ctx.depth_near = 0.5;
+	ctx.depth_far  = 20;
+	ctx.tri_order  = WF3D_ORDER_FRONT_TO_BACK;
+	wf3d_shape_t *sphere = s3d_uv_sphere((vec3f_t) {0, 0, 0}, 1, 8, 16);
+	wf3d_shape_t *ball   = s3d_uv_sphere((vec3f_t) {0, 0, 0}, 0.4f, 6, 10);
+	
+	int edge_diffs = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		float       angle = frame * 0.37f;
+		matrix_3d_t cam   = matrix_3d_translate(0.1f * sinf(angle), 0, 2.5f);
+		cam = matrix_3d_multiply(cam, matrix_3d_rotate_y(angle));
+		cam = matrix_3d_multiply(cam, matrix_3d_rotate_x(angle * 0.6f));
+		
+		memset(buf.buf, 0, sizeof(uint16_t) * QUARTZ_WIDTH * QUARTZ_HEIGHT);
+		ctx.sink = NULL;
+		test_scene(&ctx, sphere, ball);
+		wf3d_render(&buf, 0xffff8020, &ctx, cam);
+		
+		quartz_cmd_clear(0, 0, QUARTZ_CLEAR_COLOR | QUARTZ_CLEAR_DEPTH);
+		ctx.sink = &test_sink;
+		test_scene(&ctx, sphere, ball);
+		wf3d_render(&buf, 0xffff8020, &ctx, cam);
+		CHECK(quartz_batch_flush(&batch), "render %d: batch failed", frame);
+		
+		const uint16_t *cpu  = buf.buf;
+		const uint16_t *gpu  = emu.model.color;
+		int             diff = 0, drawn = 0;
+		for (int y = 0; y < QUARTZ_HEIGHT; y++) {
+			for (int x = 0; x < QUARTZ_WIDTH; x++) {
+				int i = x + y * QUARTZ_WIDTH;
+				drawn += cpu[i] || gpu[i];
+				if (test_on_edge(cpu, x, y) || test_on_edge(gpu, x, y)) {
+					diff += !test_shade_close(cpu[i], gpu[i]);
+				} else {
+					CHECK(test_shade_close(cpu[i], gpu[i]), "render %d: (%d, %d) is %04x, not %04x, away from any edge",
+						frame, x, y, gpu[i], cpu[i]);
+				}
+			}
+		}
+		CHECK(drawn > 0, "render %d: nothing was drawn", frame);
+		CHECK(diff * 1000 <= drawn * TEST_MAX_DIFF_PERMILLE, "render %d: %d of %d pixels differ", frame, diff, drawn);
+		edge_diffs += diff;
+	}
+	CHECK(meshes.uploads == 2, "render: %u uploads for 2 meshes", meshes.uploads);
+	printf("quartz_test_meshes: %d frames, %.1f edge pixels differ per frame\n", frames, edge_diffs / (double) frames);
+	
+	s3d_free(sphere);
+	s3d_free(ball);
+	free(ctx.depth);
+	wf3d_destroy(&ctx);
+	pax_buf_destroy(&buf);
+}
+
+int main(int argc, char **argv) {
+	int steps = argc > 1 ? atoi(argv[1]) : 2000;
+	rng       = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+	
+	quartz_emu_init(&emu, rng);
+	emu.model.ram      = ram;
+	emu.model.ram_size = sizeof(ram);
+	quartz_transport_t transport = quartz_emu_transport(&emu);
+	quartz_set_transport(&transport);
+	quartz_batch_init(&batch);
+	
+	test_lru(steps);
+	test_bounds();
+	test_reuse();
+	test_render(20);
+	
+	printf("quartz_test_meshes: %s\n", failures ? "FAIL" : "OK");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz.h"
+#include "quartz_emu.h"
+#include "wf3d.h"
+#include "raster565.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Renders the same scenes through wf3d's own RGB565 rasterizer and through the model, the way
+// main.c sends them to the GPU, and compares the two. Triangles may only differ on edges, where
+// the float and 12.4 fixed-point rasterizers round differently. Lines are stepped differently
+// (DDA against Bresenham), so they only have to take the same path.
+// Usage: quartz_test_raster [frames per scene]
+
+// Report a failed check and carry on.
+#define CHECK(cond, ...) do { \
+		if (!(cond)) { \
+			failures ++; \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+// Most pixels of triangles that may differ, in parts per thousand of the pixels either drew.
+#define TEST_MAX_DIFF_PERMILLE 30
+
+static int            failures;
+static quartz_emu_t   emu;
+static quartz_batch_t batch;
+
+// Converts a position in pixels to the GPU's 12.4 fixed-point, like main.c.
+static int16_t test_fixed(float value) {
+	float fixed = value * 16;
+	if (fixed < INT16_MIN) return INT16_MIN;
+	if (fixed > INT16_MAX) return INT16_MAX;
+	return lrintf(fixed);
+}
+
+// Sends a triangle from wf3d to the GPU.
+static void test_tri(void *args, const vec3f_t screen[3], uint16_t color565, uint16_t mask565) {
+	quartz_tri_t tri = { .color = color565 };
+	for (int i = 0; i < 3; i++) {
+		tri.v[i] = (quartz_vtx_t) { test_fixed(screen[i].x), test_fixed(screen[i].y), screen[i].z };
+	}
+	quartz_batch_tri(args, &tri, mask565);
+}
+
+// Sends a line from wf3d to the GPU.
+static void test_line(void *args, const vec3f_t screen[2], uint16_t color565) {
+	quartz_line_t line = {
+		test_fixed(screen[0].x), test_fixed(screen[0].y),
+		test_fixed(screen[1].x), test_fixed(screen[1].y),
+		color565,
+	};
+	quartz_batch_line(args, &line);
+}
+
+// Clears the GPU's depth buffer before a pass.
+static void test_clear(void *args) {
+	quartz_batch_flush(args);
+	quartz_cmd_clear(0, 0, QUARTZ_CLEAR_DEPTH);
+}
+
+static const wf3d_sink_t test_sink = {
+	.tri   = test_tri,
+	.line  = test_line,
+	.clear = test_clear,
+	.args  = &batch,
+};
+
+// A scene to render both ways.
+typedef struct {
+	const char      *name;
+	wf3d_draw_mode_t draw_mode;
+	pax_col_t        color;
+	// Whether only lines are drawn.
+	bool             lines;
+} test_scene_t;
+
+static const test_scene_t scenes[] = {
+	{ "sphere",    WF3D_DRAW_FILL,      0xffff8020, false },
+	{ "wireframe", WF3D_DRAW_WIREFRAME, 0xff20c0ff, true  },
+};
+
+// Whether a pixel has a 4-neighbour of another color, so that it lies on an edge.
+static bool test_on_edge(const uint16_t *plane, int x, int y) {
+	uint16_t pixel = plane[x + y * QUARTZ_WIDTH];
+	return (x > 0                 && plane[x - 1 + y * QUARTZ_WIDTH] != pixel)
+		|| (x < QUARTZ_WIDTH - 1  && plane[x + 1 + y * QUARTZ_WIDTH] != pixel)
+		|| (y > 0                 && plane[x + (y - 1) * QUARTZ_WIDTH] != pixel)
+		|| (y < QUARTZ_HEIGHT - 1 && plane[x + (y + 1) * QUARTZ_WIDTH] != pixel);
+}
+
+// Whether anything was drawn at or next to a pixel.
+static bool test_near_drawn(const uint16_t *plane, int x, int y) {
+	for (int ny = y - 1; ny <= y + 1; ny++) {
+		for (int nx = x - 1; nx <= x + 1; nx++) {
+			if (nx >= 0 && nx < QUARTZ_WIDTH && ny >= 0 && ny < QUARTZ_HEIGHT && plane[nx + ny * QUARTZ_WIDTH]) return true;
+		}
+	}
+	return false;
+}
+
+// Render one frame of a scene both ways and compare; returns the amount of differing pixels.
+static int test_frame(wf3d_ctx_t *ctx, pax_buf_t *buf, wf3d_shape_t *shape, const test_scene_t *scene, int frame) {
+	float       angle = frame * 0.37f;
+	matrix_3d_t cam   = matrix_3d_translate(0.1f * sinf(angle), 0, 2.5f);
+	cam = matrix_3d_multiply(cam, matrix_3d_rotate_y(angle));
+	cam = matrix_3d_multiply(cam, matrix_3d_rotate_x(angle * 0.6f));
+	
+	// Through wf3d_raster565.
+	memset(buf->buf, 0, sizeof(uint16_t) * QUARTZ_WIDTH * QUARTZ_HEIGHT);
+	wf3d_clear(ctx);
+	ctx->sink      = NULL;
+	ctx->draw_mode = scene->draw_mode;
+	wf3d_mesh(ctx, shape);
+	wf3d_force_redraw(ctx);
+	wf3d_render(buf, scene->color, ctx, cam);
+	
+	// Through the model.
+	quartz_cmd_clear(0, 0, QUARTZ_CLEAR_COLOR | QUARTZ_CLEAR_DEPTH);
+	wf3d_clear(ctx);
+	ctx->sink = &test_sink;
+	wf3d_mesh(ctx, shape);
+	wf3d_force_redraw(ctx);
+	wf3d_render(buf, scene->color, ctx, cam);
+	CHECK(quartz_batch_flush(&batch), "%s %d: batch failed", scene->name, frame);
+	
+	// Differences away from edges mean the two disagree on more than rounding.
+	const uint16_t *cpu  = buf->buf;
+	const uint16_t *gpu  = emu.model.color;
+	int             diff = 0, drawn = 0;
+	for (int y = 0; y < QUARTZ_HEIGHT; y++) {
+		for (int x = 0; x < QUARTZ_WIDTH; x++) {
+			int i = x + y * QUARTZ_WIDTH;
+			drawn += cpu[i] || gpu[i];
+			if (cpu[i] == gpu[i]) continue;
+			diff ++;
+			if (scene->lines) {
+				CHECK(test_near_drawn(gpu, x, y) && test_near_drawn(cpu, x, y),
+					"%s %d: (%d, %d) is %04x, not %04x, away from any line", scene->name, frame, x, y, gpu[i], cpu[i]);
+			} else {
+				CHECK(test_on_edge(cpu, x, y) || test_on_edge(gpu, x, y),
+					"%s %d: (%d, %d) is %04x, not %04x, away from any edge", scene->name, frame, x, y, gpu[i], cpu[i]);
+			}
+		}
+	}
+	CHECK(drawn > 0, "%s %d: nothing was drawn", scene->name, frame);
+	CHECK(scene->lines || diff * 1000 <= drawn * TEST_MAX_DIFF_PERMILLE, "%s %d: %d of %d pixels differ", scene->name, frame, diff, drawn);
+	return diff;
+}
+
+int main(int argc, char **argv) {
+	int frames = argc > 1 ? atoi(argv[1]) : 20;
+	
+	quartz_emu_init(&emu, 1);
+	quartz_transport_t transport = quartz_emu_transport(&emu);
+	quartz_set_transport(&transport);
+	quartz_batch_init(&batch);
+	
+	// Set up like main.c does for the GPU.
+	pax_buf_t buf;
+	pax_buf_init(&buf, NULL, QUARTZ_WIDTH, QUARTZ_HEIGHT, PAX_BUF_16_565RGB);
+	wf3d_ctx_t ctx;
+	wf3d_init(&ctx);
+	ctx.depth      = malloc(sizeof(depth_t) * QUARTZ_WIDTH * QUARTZ_HEIGHT);
+	ctx.depth_mode = WF3D_DEPTH_RECIPROCAL;
+	ctx.depth_near = 0.5;
+	ctx.depth_far  = 20;
+	ctx.tri_order  = WF3D_ORDER_FRONT_TO_BACK;
+	wf3d_shape_t *shape = s3d_uv_sphere((vec3f_t) {0, 0, 0}, 1, 8, 16);
+	
+	for (size_t i = 0; i < sizeof(scenes) / sizeof(*scenes); i++) {
+		int diff = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			diff += test_frame(&ctx, &buf, shape, &scenes[i], frame);
+		}
+		printf("quartz_test_raster: %s: %d frames, %.1f pixels differ per frame\n", scenes[i].name, frames, diff / (double) frames);
+	}
+	
+	s3d_free(shape);
+	free(ctx.depth);
+	wf3d_destroy(&ctx);
+	pax_buf_destroy(&buf);
+	printf("quartz_test_raster: %s\n", failures ? "FAIL" : "OK");
+	return failures ? 1 : 0;
+}
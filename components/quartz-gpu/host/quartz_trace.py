@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+# Decodes Quartz command traces from a serial log.
+# Usage: quartz_trace.py [log file], reads stdin by default.
+# Picks up every dump printed by quartz_trace_dump, ignoring other output.
+
+import struct
+import sys
+
+OPCODES = {
+	0x00: "NOP",
+	0x01: "STATUS",
+	0x02: "RGBLED",
+	0x03: "FMARK",
+	0x04: "TRIS",
+	0x05: "LINES",
+	0x06: "CLEAR",
+	0x07: "SPANS",
+	0x08: "PRESENT",
+	0x09: "BULK",
+	0x0a: "MESH",
+	0x0b: "VIEW",
+	0x0c: "DRAW",
+}
+
+RESULTS = ["ok", "send error", "timeout", "recv error", "checksum error", "chunk rejected"]
+
+# Matches QUARTZ_TRACE_VERSION and the encoding of quartz_trace_t.
+VERSION = 1
+ENTRY   = struct.Struct("<IIBBBBHBB")
+
+def decode(lines):
+	"""Yield (header, entries) for every dump in the lines."""
+	header, entries = None, None
+	for line in lines:
+		pos = line.find("QTRACE:")
+		if pos < 0:
+			continue
+		body = line[pos + 7:].strip()
+		if body.startswith("begin"):
+			version, size, count, total = map(int, body.split()[1:5])
+			if version != VERSION or size != ENTRY.size:
+				raise ValueError(f"unsupported trace version {version} with {size} byte entries")
+			header, entries = (count, total), []
+		elif body == "end":
+			if header is not None:
+				yield header, entries
+			header, entries = None, None
+		elif header is not None:
+			entries.append(ENTRY.unpack(bytes.fromhex(body)))
+
+def show(header, entries):
+	count, total = header
+	print(f"{count} of {total} commands:")
+	print(f"{'time':>12} {'latency':>9}  {'opcode':<8} {'send':>4} {'recv':>4}  {'status':>6}  result")
+	last = None
+	for time, latency, opcode, send, recv, result, status, sum_host, sum_gpu in entries:
+		name = OPCODES.get(opcode, f"0x{opcode:02x}")
+		text = RESULTS[result] if result < len(RESULTS) else f"result {result}"
+		if result == 4:
+			text += f" (host {sum_host:02x}, GPU {sum_gpu:02x})"
+		# Times wrap every 71 minutes; show the gap to the previous command as well.
+		gap = "" if last is None else f" +{(time - last) % (1 << 32)} us"
+		last = time
+		print(f"{time:>12} {latency:>6} us  {name:<8} {send:>4} {recv:>4}  {status:>6x}  {text}{gap}")
+	
+	ok = [e for e in entries if e[5] == 0]
+	if ok:
+		lat = sorted(e[1] for e in ok)
+		print(f"{len(ok)} ok, {len(entries) - len(ok)} failed, latency min {lat[0]} us, "
+			f"median {lat[len(lat) // 2]} us, max {lat[-1]} us")
+	print()
+
+def main():
+	source = open(sys.argv[1], errors="replace") if len(sys.argv) > 1 else sys.stdin
+	found = False
+	for header, entries in decode(source):
+		show(header, entries)
+		found = True
+	if not found:
+		print("No trace dumps found.", file=sys.stderr)
+		return 1
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())
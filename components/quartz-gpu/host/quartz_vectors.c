@@ -0,0 +1,375 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz.h"
+#include "quartz_emu.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Records what the driver sends in a few scenes, for replaying into the RTL with fpga/sim,
+// along with the frames the model showed on the LCD.
+// Usage: quartz_vectors <output directory>
+// Writes <scene>_spi.hex, the transactions, and <scene>_lcd.hex, the frames, for $readmemh.
+// A transaction is a flags byte, 1 if the host waited for the interrupt first, a big endian
+// 16-bit length and the bytes sent; a flags byte of ff ends the scene.
+// The frame file holds the amount of frames at address 0, then every pixel of every frame.
+//
+// Also writes raster_prims.hex and raster_pixels.hex, to check the rasterizer on its own.
+// The primitive file holds the amount of primitives at address 0, then 13 words per primitive:
+// is_line, x0, y0, z0, x1, y1, z1, x2, y2, z2, color, mask and the amount of pixels it produces.
+// The pixel file holds 6 words per pixel, in the order the model produces them: x, y, z, color, mask
+// and 1 if it is blended with the maximum.
+
+// Bytes of RAM after the framebuffer given to resident meshes, well within the simulated PSRAM.
+#define VEC_MESH_RAM 0x10000
+
+// A scene: commands to run against the GPU.
+typedef struct {
+	// Prefix of the files written.
+	const char *name;
+	// Sends the commands.
+	void      (*run)();
+} vec_scene_t;
+
+static quartz_emu_t       emu;
+// The GPU's RAM after the framebuffer, for resident meshes.
+static uint8_t            ram[VEC_MESH_RAM];
+static quartz_transport_t emu_transport;
+// Transactions of the scene being recorded.
+static FILE              *spi_out;
+// Frames of the scene being recorded.
+static FILE              *lcd_out;
+static int                lcd_frames;
+// Whether the host waited for the interrupt since the last transaction.
+static bool               awaited;
+
+// Record a transaction, then let the emulator run it.
+static bool vec_transfer(void *args, const void *tx, void *rx, size_t length) {
+	const uint8_t *data = tx;
+	fprintf(spi_out, "%02x\n%02x\n%02x\n", awaited, (unsigned) (length >> 8), (unsigned) (length & 0xff));
+	for (size_t i = 0; i < length; i++) {
+		fprintf(spi_out, "%02x\n", data[i]);
+	}
+	awaited = false;
+	return emu_transport.transfer(emu_transport.args, tx, rx, length);
+}
+
+// Record a wait for the interrupt.
+static bool vec_await(void *args, uint64_t wait_time) {
+	awaited = true;
+	return emu_transport.await(emu_transport.args, wait_time);
+}
+
+// Show the framebuffer on the LCD and record what it shows.
+static void vec_present() {
+	if (!quartz_cmd_present().rx_valid) {
+		fprintf(stderr, "Present failed\n");
+		exit(1);
+	}
+	fprintf(lcd_out, "@%x\n", 1 + lcd_frames * QUARTZ_WIDTH * QUARTZ_HEIGHT);
+	for (int i = 0; i < QUARTZ_WIDTH * QUARTZ_HEIGHT; i++) {
+		fprintf(lcd_out, "%04x\n", emu.model.lcd[i]);
+	}
+	lcd_frames ++;
+}
+
+
+
+// Clears, a full frame, changes in part of a row of tiles and in whole rows: the CLEAR, SPANS, BULK and PRESENT paths.
+static void vec_scene_delta() {
+	static uint16_t frame[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+	quartz_delta_t  delta;
+	quartz_batch_t  batch;
+	quartz_delta_init(&delta);
+	quartz_batch_init(&batch);
+	
+	quartz_cmd_clear(0x1234, 0x5678, QUARTZ_CLEAR_COLOR | QUARTZ_CLEAR_DEPTH);
+	vec_present();
+	
+	// Every pixel different, so misplaced bytes show.
+	for (int i = 0; i < QUARTZ_WIDTH * QUARTZ_HEIGHT; i++) {
+		frame[i] = i * 0x9e37 ^ (i >> 5);
+	}
+	quartz_delta_upload(&delta, &batch, frame, false);
+	vec_present();
+	
+	// A rectangle that does not line up with the tiles, sent as spans.
+	for (int y = 21; y < 75; y++) {
+		for (int x = 50; x < 123; x++) {
+			frame[y * QUARTZ_WIDTH + x] = x * 0x0841 + y;
+		}
+	}
+	quartz_delta_upload(&delta, &batch, frame, false);
+	vec_present();
+	
+	// A whole row of tiles, sent as bulk data, and a single pixel in the last tile.
+	for (int i = 160 * QUARTZ_WIDTH; i < 176 * QUARTZ_WIDTH; i++) {
+		frame[i] = ~frame[i];
+	}
+	frame[QUARTZ_WIDTH * QUARTZ_HEIGHT - 1] = 0xf81f;
+	quartz_delta_upload(&delta, &batch, frame, false);
+	vec_present();
+	
+	// Clearing only the color plane.
+	quartz_cmd_clear(0x07e0, 0, QUARTZ_CLEAR_COLOR);
+	vec_present();
+}
+
+// Amount of primitives in the raster vectors.
+#define VEC_RASTER_PRIMS 600
+
+// Model for the raster vectors, which only produces pixels.
+static quartz_model_t raster_model;
+static FILE          *pixel_out;
+static uint64_t       rng = 1;
+
+// Get a random number below `limit`.
+static uint32_t vec_random(uint32_t limit) {
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return (rng * 0x2545f4914f6cdd1dULL >> 32) % limit;
+}
+
+// Get a random 12.4 fixed-point position, mostly on the screen but up to `margin` pixels past it.
+static int16_t vec_random_pos(int size, int margin) {
+	return (int) vec_random((size + 2 * margin) * 16) - margin * 16;
+}
+
+// Record a pixel produced by the model.
+static void vec_pixel(void *args, const quartz_pixel_t *pixel) {
+	fprintf(pixel_out, "%04x\n%04x\n%04x\n%04x\n%04x\n%04x\n",
+		pixel->x, pixel->y, pixel->z, pixel->color, pixel->mask, pixel->op == QUARTZ_PIX_MAX);
+}
+
+// Make the next primitive: triangles large, small, thin, sharing edges with the previous one,
+// degenerate or off the screen, with depth gradients steep enough to clamp, and lines in every direction.
+static void vec_raster_prim(int index, bool *is_line, quartz_tri_t *tri, quartz_line_t *line, uint16_t *mask) {
+	static quartz_tri_t last;
+	int kind = vec_random(10);
+	*is_line = kind >= 7;
+	*mask    = vec_random(4) ? 0xffff : vec_random(0x10000);
+	
+	if (*is_line) {
+		int margin = kind == 9 ? 200 : 10;
+		*line = (quartz_line_t) {
+			vec_random_pos(QUARTZ_WIDTH, margin), vec_random_pos(QUARTZ_HEIGHT, margin),
+			vec_random_pos(QUARTZ_WIDTH, margin), vec_random_pos(QUARTZ_HEIGHT, margin),
+			vec_random(0x10000),
+		};
+		// Short lines, down to a single point.
+		if (kind == 8) {
+			line->x1 = line->x0 + (int) vec_random(97) - 48;
+			line->y1 = line->y0 + (int) vec_random(97) - 48;
+		}
+		return;
+	}
+	
+	tri->color = vec_random(0x10000);
+	for (int i = 0; i < 3; i++) {
+		tri->v[i].z = vec_random(0x10000);
+	}
+	// Few large ones, as they cover much of the screen.
+	if (kind == 6 && vec_random(4)) kind = 3;
+	if (kind == 0 && index) {
+		// The other side of the last one's first edge, to check that no pixel is drawn twice or skipped.
+		tri->v[0]   = last.v[1];
+		tri->v[1]   = last.v[0];
+		tri->v[2].x = last.v[1].x + last.v[0].x - last.v[2].x;
+		tri->v[2].y = last.v[1].y + last.v[0].y - last.v[2].y;
+	} else if (kind < 5) {
+		// Small or medium, around a point on the screen.
+		int16_t x    = vec_random_pos(QUARTZ_WIDTH, 0);
+		int16_t y    = vec_random_pos(QUARTZ_HEIGHT, 0);
+		int     size = kind < 3 ? 16 : 48;
+		for (int i = 0; i < 3; i++) {
+			tri->v[i].x = x + (int) vec_random((2 * size + 1) * 16) - size * 16;
+			tri->v[i].y = y + (int) vec_random((2 * size + 1) * 16) - size * 16;
+		}
+	} else if (kind == 5) {
+		// Thin, or with all vertices on a line.
+		tri->v[0].x = vec_random_pos(QUARTZ_WIDTH, 0);
+		tri->v[0].y = vec_random_pos(QUARTZ_HEIGHT, 0);
+		tri->v[1].x = vec_random_pos(QUARTZ_WIDTH, 0);
+		tri->v[1].y = vec_random_pos(QUARTZ_HEIGHT, 0);
+		int off = vec_random(3);
+		tri->v[2].x = (tri->v[0].x + tri->v[1].x) / 2 + off;
+		tri->v[2].y = (tri->v[0].y + tri->v[1].y) / 2 - off;
+	} else {
+		// Anywhere, up to far off the screen.
+		int margin = vec_random(2) ? 1500 : 40;
+		for (int i = 0; i < 3; i++) {
+			tri->v[i].x = vec_random_pos(QUARTZ_WIDTH, margin);
+			tri->v[i].y = vec_random_pos(QUARTZ_HEIGHT, margin);
+		}
+	}
+	last = *tri;
+}
+
+// Rasterize primitives on the model alone and record what it produces.
+static bool vec_raster(const char *dir) {
+	char  path[512];
+	snprintf(path, sizeof(path), "%s/raster_prims.hex", dir);
+	FILE *prim_out = fopen(path, "w");
+	snprintf(path, sizeof(path), "%s/raster_pixels.hex", dir);
+	pixel_out = fopen(path, "w");
+	if (!prim_out || !pixel_out) {
+		fprintf(stderr, "Cannot write %s\n", path);
+		return false;
+	}
+	
+	quartz_model_init(&raster_model);
+	raster_model.pixel_cb = vec_pixel;
+	fprintf(prim_out, "@1\n");
+	for (int i = 0; i < VEC_RASTER_PRIMS; i++) {
+		bool          is_line;
+		quartz_tri_t  tri  = {0};
+		quartz_line_t line = {0};
+		uint16_t      mask;
+		vec_raster_prim(i, &is_line, &tri, &line, &mask);
+		
+		uint32_t before = raster_model.pixels;
+		if (is_line) {
+			quartz_model_line(&raster_model, &line);
+			tri = (quartz_tri_t) {
+				.v     = { { line.x0, line.y0, 0 }, { line.x1, line.y1, 0 } },
+				.color = line.color,
+			};
+		} else {
+			quartz_model_tri(&raster_model, mask, &tri);
+		}
+		fprintf(prim_out, "%04x\n", is_line);
+		for (int j = 0; j < 3; j++) {
+			fprintf(prim_out, "%04x\n%04x\n%04x\n", (uint16_t) tri.v[j].x, (uint16_t) tri.v[j].y, tri.v[j].z);
+		}
+		fprintf(prim_out, "%04x\n%04x\n%04x\n", tri.color, mask, (unsigned) (raster_model.pixels - before));
+	}
+	fprintf(prim_out, "@0\n%04x\n", VEC_RASTER_PRIMS);
+	fclose(prim_out);
+	fclose(pixel_out);
+	printf("raster: %d primitives, %u pixels\n", VEC_RASTER_PRIMS, (unsigned) raster_model.pixels);
+	return true;
+}
+
+// Resident meshes turning in front of the eye, one partly behind the other: the MESH, VIEW and DRAW paths.
+static void vec_scene_meshes() {
+	// An octahedron, and a cube with one triangle that has a bad index.
+	static const float  octa_vtx[] = { 1, 0, 0,  -1, 0, 0,  0, 1, 0,  0, -1, 0,  0, 0, 1,  0, 0, -1 };
+	static const size_t octa_tri[] = {
+		0, 2, 4,  2, 1, 4,  1, 3, 4,  3, 0, 4,
+		2, 0, 5,  1, 2, 5,  3, 1, 5,  0, 3, 5,
+	};
+	static const float  cube_vtx[] = {
+		-1, -1, -1,   1, -1, -1,  -1,  1, -1,   1,  1, -1,
+		-1, -1,  1,   1, -1,  1,  -1,  1,  1,   1,  1,  1,
+	};
+	static const size_t cube_tri[] = {
+		0, 2, 1,  1, 2, 3,  4, 5, 6,  5, 7, 6,
+		0, 1, 4,  1, 5, 4,  2, 6, 3,  3, 6, 7,
+		0, 4, 2,  2, 4, 6,  1, 3, 5,  3, 7, 5,
+		0, 1, 99,
+	};
+	const quartz_mesh_src_t octa = { 6, octa_vtx, 8,  octa_tri, 1 };
+	const quartz_mesh_src_t cube = { 8, cube_vtx, 13, cube_tri, 1 };
+	
+	quartz_meshes_t meshes;
+	quartz_batch_t  batch;
+	quartz_meshes_init(&meshes, QUARTZ_RAM_FREE, VEC_MESH_RAM);
+	quartz_batch_init(&batch);
+	quartz_view_t view = quartz_make_view(1.5f, 120, 160, 120, 0.5f, 20);
+	quartz_cmd_view(&view);
+	const float light[3] = { 0, -0.7071f, -0.7071f };
+	
+	for (int frame = 0; frame < 4; frame++) {
+		quartz_cmd_clear(0x0000, 0, QUARTZ_CLEAR_COLOR | QUARTZ_CLEAR_DEPTH);
+		for (int i = 0; i < 2; i++) {
+			// Turned about y, the cube smaller and further away.
+			float angle = frame * 0.4f + i * 0.9f;
+			float size  = i ? 0.5f : 0.8f;
+			float c     = cosf(angle) * size, s = sinf(angle) * size;
+			float mtx[12] = {
+				 c, 0, s, i ? 0.6f : -0.3f,
+				 0, size, 0, i ? 0.2f : 0,
+				-s, 0, c, i ? 3.0f : 2.5f,
+			};
+			int handle = quartz_meshes_acquire(&meshes, &batch, i ? (const void *) &cube : &octa, i ? &cube : &octa);
+			if (handle < 0) {
+				fprintf(stderr, "Mesh upload failed\n");
+				exit(1);
+			}
+			quartz_xform_t xform = quartz_meshes_xform(&meshes, handle, mtx, light);
+			quartz_batch_draw(&batch, handle, i ? 0x07ff : 0xfd20, 0xffff, &xform);
+		}
+		quartz_batch_flush(&batch);
+		vec_present();
+	}
+}
+
+static const vec_scene_t scenes[] = {
+	{ "delta",  vec_scene_delta },
+	{ "meshes", vec_scene_meshes },
+};
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <output directory>\n", argv[0]);
+		return 1;
+	}
+	
+	emu_transport = quartz_emu_transport(&emu);
+	quartz_transport_t transport = {
+		.transfer = vec_transfer,
+		.await    = vec_await,
+	};
+	quartz_set_transport(&transport);
+	
+	for (size_t i = 0; i < sizeof(scenes) / sizeof(*scenes); i++) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/%s_spi.hex", argv[1], scenes[i].name);
+		spi_out = fopen(path, "w");
+		snprintf(path, sizeof(path), "%s/%s_lcd.hex", argv[1], scenes[i].name);
+		lcd_out = fopen(path, "w");
+		if (!spi_out || !lcd_out) {
+			fprintf(stderr, "Cannot write %s\n", path);
+			return 1;
+		}
+		
+		quartz_emu_init(&emu, 1);
+		memset(ram, 0, sizeof(ram));
+		emu.model.ram      = ram;
+		emu.model.ram_size = sizeof(ram);
+		lcd_frames = 0;
+		awaited    = false;
+		scenes[i].run();
+		
+		fprintf(spi_out, "ff\n");
+		fprintf(lcd_out, "@0\n%04x\n", lcd_frames);
+		fclose(spi_out);
+		fclose(lcd_out);
+		printf("%s: %d frames\n", scenes[i].name, lcd_frames);
+	}
+	return vec_raster(argv[1]) ? 0 : 1;
+}
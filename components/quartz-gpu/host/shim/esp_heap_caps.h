@@ -0,0 +1,17 @@
+// ESP-IDF's heap for the host tests, see pax_gfx.h: one heap, which counts as internal RAM.
+// Allocations that ask for PSRAM alone fail, like on a badge without it.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+void  *heap_caps_malloc                (size_t size, uint32_t caps);
+void  *heap_caps_realloc               (void *ptr, size_t size, uint32_t caps);
+void   heap_caps_free                  (void *ptr);
+size_t heap_caps_get_allocated_size    (void *ptr);
+size_t heap_caps_get_free_size         (uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
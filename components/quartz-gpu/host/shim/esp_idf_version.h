@@ -0,0 +1,5 @@
+// Claims the ESP-IDF version whose headers this directory stands in for, see pax_gfx.h.
+#pragma once
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION                          ESP_IDF_VERSION_VAL(4, 4, 0)
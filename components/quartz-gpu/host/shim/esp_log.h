@@ -0,0 +1,12 @@
+// ESP-IDF logging for the host tests, see pax_gfx.h; only warnings and errors are shown.
+#pragma once
+
+#include <stdio.h>
+
+// Takes the arguments of a log message that is not shown.
+static inline void esp_log_discard(const char *tag, const char *fmt, ...) {}
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) esp_log_discard(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) esp_log_discard(tag, fmt, ##__VA_ARGS__)
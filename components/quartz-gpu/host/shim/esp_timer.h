@@ -0,0 +1,6 @@
+// ESP-IDF's microsecond clock for the host tests, see pax_gfx.h.
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time();
@@ -0,0 +1,6 @@
+// The little of FreeRTOS that wf3d uses, for the host tests, see pax_gfx.h; everything runs on core 0.
+#pragma once
+
+typedef int BaseType_t;
+
+BaseType_t xPortGetCoreID();
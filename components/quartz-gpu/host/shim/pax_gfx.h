@@ -0,0 +1,80 @@
+// Just enough of PAX to build wf3d on Linux for the host tests, see shim.c.
+// Only RGB565 buffers are drawn to, by wf3d's own rasterizer; the PAX drawing functions do nothing.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef uint32_t pax_col_t;
+
+typedef enum {
+	PAX_BUF_16_565RGB = 1,
+	PAX_BUF_32_8888ARGB,
+} pax_buf_type_t;
+
+#define PAX_GET_BPP(type) ((type) == PAX_BUF_16_565RGB ? 16 : 32)
+#define PAX_RENDERER_ID_SWR 1
+
+typedef struct {
+	float x0, y0, x1, y1, x2, y2;
+} pax_tri_t;
+
+typedef struct {
+	float x, y;
+} pax_vec1_t;
+
+typedef struct {
+	float a0, a1, a2, b0, b1, b2;
+} matrix_2d_t;
+
+typedef struct pax_font pax_font_t;
+extern const pax_font_t *pax_font_sky_mono;
+
+typedef struct {
+	pax_buf_type_t type;
+	union {
+		void     *buf;
+		uint16_t *buf_16bpp;
+	};
+	int  width, height;
+	bool reverse_endianness;
+	// Whether `buf` was allocated by pax_buf_init.
+	bool do_free;
+} pax_buf_t;
+
+typedef pax_col_t (*pax_shader_func_v1_t)(pax_col_t tint, pax_col_t existing, int x, int y, float u, float v, void *args);
+
+typedef struct {
+	uint8_t              schema_version;
+	uint8_t              schema_complement;
+	int                  renderer_id;
+	void                *promise_callback;
+	pax_shader_func_v1_t callback;
+	void                *callback_args;
+	bool                 alpha_promise_0;
+	bool                 alpha_promise_255;
+} pax_shader_t;
+
+matrix_2d_t matrix_2d_translate(float x, float y);
+matrix_2d_t matrix_2d_scale    (float x, float y);
+
+void      pax_buf_init   (pax_buf_t *buf, void *mem, int width, int height, pax_buf_type_t type);
+void      pax_buf_destroy(pax_buf_t *buf);
+void      pax_mark_dirty0(pax_buf_t *buf);
+void      pax_join       ();
+
+void      pax_push_2d    (pax_buf_t *buf);
+void      pax_pop_2d     (pax_buf_t *buf);
+void      pax_apply_2d   (pax_buf_t *buf, matrix_2d_t mtx);
+
+pax_col_t pax_col_rgb    (uint8_t r, uint8_t g, uint8_t b);
+pax_col_t pax_col_lerp   (uint8_t part, pax_col_t from, pax_col_t to);
+
+void      pax_shade_tri  (pax_buf_t *buf, pax_col_t color, const pax_shader_t *shader, const pax_tri_t *uvs,
+                          float x0, float y0, float x1, float y1, float x2, float y2);
+void      pax_shade_line (pax_buf_t *buf, pax_col_t color, const pax_shader_t *shader, float x0, float y0, float x1, float y1);
+void      pax_draw_rect  (pax_buf_t *buf, pax_col_t color, float x, float y, float width, float height);
+void      pax_draw_text  (pax_buf_t *buf, pax_col_t color, const pax_font_t *font, float size, float x, float y, const char *text);
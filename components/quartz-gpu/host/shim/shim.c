@@ -0,0 +1,109 @@
+#include "pax_gfx.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <malloc.h>
+#include <time.h>
+
+// The functions behind the headers in this directory, see pax_gfx.h.
+
+const pax_font_t *pax_font_sky_mono = NULL;
+
+// Make a matrix that moves.
+matrix_2d_t matrix_2d_translate(float x, float y) {
+	return (matrix_2d_t) { 1, 0, x, 0, 1, y };
+}
+
+// Make a matrix that scales.
+matrix_2d_t matrix_2d_scale(float x, float y) {
+	return (matrix_2d_t) { x, 0, 0, 0, y, 0 };
+}
+
+// Set up a buffer, allocating the pixels if `mem` is NULL.
+void pax_buf_init(pax_buf_t *buf, void *mem, int width, int height, pax_buf_type_t type) {
+	size_t size = (size_t) width * height * PAX_GET_BPP(type) / 8;
+	*buf = (pax_buf_t) {
+		.type    = type,
+		.buf     = mem ? mem : calloc(1, size),
+		.width   = width,
+		.height  = height,
+		.do_free = !mem,
+	};
+}
+
+// Free what pax_buf_init allocated.
+void pax_buf_destroy(pax_buf_t *buf) {
+	if (buf->do_free) free(buf->buf);
+	buf->buf = NULL;
+}
+
+// Nothing keeps track of changed areas.
+void pax_mark_dirty0(pax_buf_t *buf) {}
+
+// Nothing draws in the background.
+void pax_join() {}
+
+// Transforms only matter to PAX's own drawing, which does nothing.
+void pax_push_2d(pax_buf_t *buf) {}
+void pax_pop_2d(pax_buf_t *buf) {}
+void pax_apply_2d(pax_buf_t *buf, matrix_2d_t mtx) {}
+
+// Make an opaque color.
+pax_col_t pax_col_rgb(uint8_t r, uint8_t g, uint8_t b) {
+	return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+// Mix two colors per channel, 0 is `from` and 255 is `to`.
+pax_col_t pax_col_lerp(uint8_t part, pax_col_t from, pax_col_t to) {
+	pax_col_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		int a = (from >> shift) & 255;
+		int b = (to   >> shift) & 255;
+		out |= (pax_col_t) (a + ((b - a) * (part + (part >> 7)) >> 8)) << shift;
+	}
+	return out;
+}
+
+// Only RGB565 buffers are tested, which wf3d fills itself.
+void pax_shade_tri(pax_buf_t *buf, pax_col_t color, const pax_shader_t *shader, const pax_tri_t *uvs,
+		float x0, float y0, float x1, float y1, float x2, float y2) {}
+void pax_shade_line(pax_buf_t *buf, pax_col_t color, const pax_shader_t *shader, float x0, float y0, float x1, float y1) {}
+void pax_draw_rect(pax_buf_t *buf, pax_col_t color, float x, float y, float width, float height) {}
+void pax_draw_text(pax_buf_t *buf, pax_col_t color, const pax_font_t *font, float size, float x, float y, const char *text) {}
+
+// Allocate from the one heap, which counts as internal RAM.
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+	return caps & MALLOC_CAP_INTERNAL ? malloc(size) : NULL;
+}
+
+// Resize within the one heap.
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+	return caps & MALLOC_CAP_INTERNAL ? realloc(ptr, size) : NULL;
+}
+
+void heap_caps_free(void *ptr) {
+	free(ptr);
+}
+
+size_t heap_caps_get_allocated_size(void *ptr) {
+	return malloc_usable_size(ptr);
+}
+
+// The host's heap is not what is being measured.
+size_t heap_caps_get_free_size(uint32_t caps) {
+	return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+	return 0;
+}
+
+int64_t esp_timer_get_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+BaseType_t xPortGetCoreID() {
+	return 0;
+}
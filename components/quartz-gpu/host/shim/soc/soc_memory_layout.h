@@ -0,0 +1,8 @@
+// The host has no PSRAM, see pax_gfx.h.
+#pragma once
+
+#include <stdbool.h>
+
+static inline bool esp_ptr_external_ram(const void *ptr) {
+	return false;
+}
@@ -0,0 +1,146 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "bvh.h"
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures building, refitting and culling BVHs of 10 to 10k boxes scattered in front of a camera,
+// against testing every box on its own.
+// Usage: wf3d_bench_bvh
+// Times are for the host CPU; they show how the BVH scales, not what it costs on the badge.
+
+// Repeat every measurement until about this many objects were handled, so small BVHs get a readable time.
+#define BENCH_WORK 1000000
+
+static const size_t sizes[] = { 10, 100, 1000, 10000 };
+
+// Counts a found object.
+static void bench_cb(void *args, size_t obj) {
+	(*(size_t *) args) ++;
+}
+
+// Simple pseudo-random number generator, so every run scatters the same boxes.
+static float bench_rand(uint32_t *state) {
+	*state = *state * 1664525 + 1013904223;
+	return (*state >> 8) / (float) (1 << 24);
+}
+
+// Benchmarks one amount of objects; returns false if out of memory.
+static bool bench_size(size_t num, const wf3d_frustum_t *frustum) {
+	wf3d_aabb_t *boxes  = malloc(sizeof(wf3d_aabb_t) * num);
+	wf3d_bvh_t   bvh    = {0};
+	uint32_t     seed   = 1;
+	size_t       rounds = (BENCH_WORK + num - 1) / num;
+	if (!boxes) return false;
+	
+	// Scatter some boxes.
+	for (size_t i = 0; i < num; i++) {
+		vec3f_t pos  = { bench_rand(&seed) * 200 - 100, bench_rand(&seed) * 200 - 100, bench_rand(&seed) * 200 - 100 };
+		float   size = bench_rand(&seed) * 2 + 0.5;
+		boxes[i] = (wf3d_aabb_t) { { pos.x, pos.y, pos.z }, { pos.x + size, pos.y + size, pos.z + size } };
+	}
+	
+	// Build.
+	int64_t start = esp_timer_get_time();
+	for (size_t r = 0; r < rounds; r++) {
+		if (!wf3d_bvh_build(&bvh, num, boxes)) {
+			free(boxes);
+			return false;
+		}
+	}
+	double build_us = (esp_timer_get_time() - start) / (double) rounds;
+	
+	// Move a hundredth of the objects, refitting incrementally.
+	start = esp_timer_get_time();
+	for (size_t r = 0; r < rounds; r++) {
+		float delta = r & 1 ? -1 : 1;
+		for (size_t i = 0; i < num; i += 100) {
+			wf3d_aabb_t box = bvh.obj_bounds[i];
+			box.min.x += delta; box.max.x += delta;
+			wf3d_bvh_update(&bvh, i, box);
+		}
+	}
+	double update_us = (esp_timer_get_time() - start) / (double) rounds;
+	
+	// Move all objects, refitting at once.
+	start = esp_timer_get_time();
+	for (size_t r = 0; r < rounds; r++) {
+		float delta = r & 1 ? -1 : 1;
+		for (size_t i = 0; i < num; i++) {
+			wf3d_aabb_t box = bvh.obj_bounds[i];
+			box.min.y += delta; box.max.y += delta;
+			wf3d_bvh_move(&bvh, i, box);
+		}
+		wf3d_bvh_refit(&bvh);
+	}
+	double refit_us = (esp_timer_get_time() - start) / (double) rounds;
+	
+	// Cull using the BVH.
+	size_t visible = 0;
+	start = esp_timer_get_time();
+	for (size_t r = 0; r < rounds; r++) {
+		visible = 0;
+		wf3d_bvh_cull(&bvh, frustum, bench_cb, &visible);
+	}
+	double cull_us = (esp_timer_get_time() - start) / (double) rounds;
+	
+	// Test every object on its own, for comparison.
+	size_t brute_visible = 0;
+	start = esp_timer_get_time();
+	for (size_t r = 0; r < rounds; r++) {
+		brute_visible = 0;
+		for (size_t i = 0; i < num; i++) {
+			if (wf3d_frustum_test(frustum, bvh.obj_bounds[i]) != WF3D_CULL_OUTSIDE) brute_visible ++;
+		}
+	}
+	double brute_us = (esp_timer_get_time() - start) / (double) rounds;
+	
+	printf("%6zu  %10.2f  %10.2f  %10.2f  %10.2f  %8zu  %10.2f  %8zu\n",
+		num, build_us, update_us, refit_us, cull_us, visible, brute_us, brute_visible);
+	
+	wf3d_bvh_destroy(&bvh);
+	free(boxes);
+	return true;
+}
+
+int main(int argc, char **argv) {
+	// A 60 degree field of view camera looking into the field of boxes.
+	wf3d_frustum_t frustum = wf3d_make_frustum(
+		0.5 / tanf(60 / 360.0 * M_PI), 0.5, 0.5 * 240 / 320, matrix_3d_translate(0, 0, 50)
+	);
+	
+	printf("Times in us, averaged over at least %d objects handled\n", BENCH_WORK);
+	printf("%6s  %10s  %10s  %10s  %10s  %8s  %10s  %8s\n",
+		"objs", "build", "update 1%", "refit", "cull", "visible", "brute", "visible");
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+		if (!bench_size(sizes[i], &frustum)) {
+			fprintf(stderr, "Out of memory for %zu objects\n", sizes[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,187 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "anim.h"
+#include "mem.h"
+#include "obj.h"
+#include "wf3d_anim_test.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Plays the clip that the Makefile has wf3d_anim.py make from the keyframes in anim/, compiled like any
+// user of the tool would: poses must match blending the keyframes themselves, within quantisation,
+// and a DRAWING QUEUE that cannot grow must be left as it was.
+// Usage: wf3d_test_anim
+
+// Report a failed check and carry on.
+#define CHECK(cond, ...) do { \
+		if (!(cond)) { \
+			failures ++; \
+			printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+// Keyframes per second and the keyframes, as given to wf3d_anim.py by the Makefile.
+#define TEST_RATE   4
+#define TEST_FRAMES 2
+static const char *const frame_paths[TEST_FRAMES] = {
+	"anim/cube_squash.obj",
+	"anim/cube_twist.obj",
+};
+// Vertices queued before the clip, so it has to grow the DRAWING QUEUE.
+#define TEST_FILL   (WF3D_INITIAL_VERTEX_CAP - 4)
+
+static int           failures;
+static wf3d_shape_t *base;
+static wf3d_shape_t *frames[TEST_FRAMES];
+
+// Loads an .obj from the test's directory.
+static wf3d_shape_t *test_load(const char *path) {
+	FILE *fd = fopen(path, "r");
+	if (!fd) {
+		printf("FAIL: cannot open %s, run from components/quartz-gpu/host\n", path);
+		exit(1);
+	}
+	wf3d_shape_t *shape = s3d_decode_obj(fd);
+	fclose(fd);
+	return shape;
+}
+
+// Checks the vertices queued from `first` against blending the keyframes at `time` seconds under `mtx`.
+static void test_pose(wf3d_ctx_t *ctx, size_t first, float time, matrix_3d_t mtx) {
+	// Where the clip is, looping.
+	float  pos    = fmodf(time * TEST_RATE, TEST_FRAMES);
+	if (pos < 0) pos += TEST_FRAMES;
+	size_t frame0 = (size_t) pos % TEST_FRAMES;
+	size_t frame1 = (frame0 + 1) % TEST_FRAMES;
+	float  weight = pos - (size_t) pos;
+	
+	// Half a step of either keyframe, scaled by the matrix.
+	float scale   = fmaxf(wf3d_anim_test.scales[0], wf3d_anim_test.scales[1]);
+	float stretch = 0;
+	for (int i = 0; i < 12; i++) {
+		// Leave out the translation.
+		if (i % 4 != 3) stretch = fmaxf(stretch, fabsf(mtx.arr[i]));
+	}
+	float margin  = 3 * stretch * scale / 2 + 1e-4;
+	
+	float worst = 0;
+	for (size_t i = 0; i < base->num_vertex; i++) {
+		vec3f_t a = frames[frame0]->vertices[i];
+		vec3f_t b = frames[frame1]->vertices[i];
+		vec3f_t want = {
+			a.x + (b.x - a.x) * weight,
+			a.y + (b.y - a.y) * weight,
+			a.z + (b.z - a.z) * weight,
+		};
+		matrix_3d_transform(mtx, &want.x, &want.y, &want.z);
+		vec3f_t got = ctx->vertices[first + i];
+		worst = fmaxf(worst, fmaxf(fabsf(got.x - want.x), fmaxf(fabsf(got.y - want.y), fabsf(got.z - want.z))));
+	}
+	CHECK(worst <= margin, "at %.3f s, a vertex is %g off, more than %g", time, worst, margin);
+}
+
+// Plays the clip at times across loop wraps, on either side of zero and under a MATRIX.
+static void test_play() {
+	CHECK(wf3d_anim_test.num_vertex == base->num_vertex, "clip has %zu vertices, the base %zu",
+		wf3d_anim_test.num_vertex, base->num_vertex);
+	CHECK(wf3d_anim_test.num_frame == TEST_FRAMES, "clip has %zu keyframes", wf3d_anim_test.num_frame);
+	CHECK(fabsf(wf3d_anim_length(&wf3d_anim_test) - (float) TEST_FRAMES / TEST_RATE) < 1e-6,
+		"clip lasts %g s", wf3d_anim_length(&wf3d_anim_test));
+	
+	const float times[] = { 0, 0.1, 0.25, 0.3, 0.49, 0.5, 0.61, 1.3, -0.1, -0.75 };
+	matrix_3d_t mtx = matrix_3d_multiply(matrix_3d_translate(1, -2, 3), matrix_3d_rotate_y(0.7));
+	mtx = matrix_3d_multiply(mtx, matrix_3d_scale(2, 2, 2));
+	
+	wf3d_ctx_t ctx;
+	wf3d_init(&ctx);
+	for (size_t i = 0; i < sizeof(times) / sizeof(*times); i++) {
+		size_t first = ctx.num_vertex;
+		wf3d_anim_mesh(&ctx, base, &wf3d_anim_test, times[i]);
+		test_pose(&ctx, first, times[i], matrix_3d_identity());
+		
+		first = ctx.num_vertex;
+		wf3d_anim_mesh_mtx(&ctx, mtx, base, &wf3d_anim_test, times[i]);
+		test_pose(&ctx, first, times[i], mtx);
+	}
+	wf3d_destroy(&ctx);
+}
+
+// Plays the clip into a DRAWING QUEUE that runs out of memory while growing.
+static void test_oom() {
+	static wf3d_mem_t mem;
+	mem = wf3d_mem_default;
+	memset(mem.usage, 0, sizeof(mem.usage));
+	wf3d_ctx_t ctx;
+	wf3d_init_mem(&ctx, &mem);
+	
+	// Nearly fill the vertices, and mark the ones still free.
+	static vec3f_t fill[TEST_FILL];
+	wf3d_tris(&ctx, TEST_FILL, fill, 0, NULL);
+	vec3f_t mark = { 12345, 23456, 34567 };
+	for (size_t i = ctx.num_vertex; i < ctx.cap_vertex; i++) ctx.vertices[i] = mark;
+	
+	// The host's heap has no PSRAM, so this makes every queue allocation fail.
+	uint32_t caps[WF3D_MEM_TRIES];
+	memcpy(caps, mem.caps[WF3D_MEM_QUEUE], sizeof(caps));
+	mem.caps[WF3D_MEM_QUEUE][0] = MALLOC_CAP_SPIRAM;
+	mem.caps[WF3D_MEM_QUEUE][1] = 0;
+	
+	size_t cap = ctx.cap_vertex;
+	wf3d_anim_mesh(&ctx, base, &wf3d_anim_test, 0.3);
+	CHECK(mem.usage[WF3D_MEM_QUEUE].failures > 0, "the DRAWING QUEUE did not need to grow");
+	CHECK(ctx.num_vertex == TEST_FILL, "%zu vertices queued without memory for them", ctx.num_vertex - TEST_FILL);
+	CHECK(ctx.cap_vertex == cap, "capacity changed from %zu to %zu", cap, ctx.cap_vertex);
+	for (size_t i = TEST_FILL; i < cap; i++) {
+		CHECK(!memcmp(&ctx.vertices[i], &mark, sizeof(mark)), "free vertex %zu was written", i);
+	}
+	
+	// With memory again, it plays as usual.
+	memcpy(mem.caps[WF3D_MEM_QUEUE], caps, sizeof(caps));
+	wf3d_anim_mesh(&ctx, base, &wf3d_anim_test, 0.3);
+	CHECK(ctx.num_vertex == TEST_FILL + base->num_vertex, "%zu vertices queued", ctx.num_vertex);
+	test_pose(&ctx, TEST_FILL, 0.3, matrix_3d_identity());
+	wf3d_destroy(&ctx);
+}
+
+int main(int argc, char **argv) {
+	base = test_load("anim/cube.obj");
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		frames[i] = test_load(frame_paths[i]);
+	}
+	
+	test_play();
+	test_oom();
+	
+	s3d_free(base);
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		s3d_free(frames[i]);
+	}
+	printf("wf3d_test_anim: %s\n", failures ? "FAIL" : "OK");
+	return failures ? 1 : 0;
+}
@@ -23,6 +23,7 @@
 */
 
 #include "quartz.h"
+#include "quartz_trace.h"
 #include <mch2022_badge.h>
 #include <hardware.h>
 #include <pax_internal.h>
@@ -31,21 +32,23 @@
 
 static const char *TAG = "quartz";
 
+// Serialises access to the FPGA.
+static SemaphoreHandle_t quartz_lock;
+// Whether the interrupt handler is installed.
+static bool              quartz_irq_ready;
+// Task to notify when the FPGA raises its interrupt, if any.
+static TaskHandle_t      quartz_irq_task;
+// Commands waiting to be sent by the command task.
+static QueueHandle_t     quartz_queue;
+
 extern const uint8_t quartz_bin_start[] asm("_binary_quartz_bin_start");
 extern const uint8_t quartz_bin_end[]   asm("_binary_quartz_bin_end");
 
-// Dump some raw bytes.
-void dump_bytes(const void *raw, size_t size) {
-	const uint8_t *data = raw;
-	for (size_t i = 0; i < size; i++) {
-		printf("%02x ", data[i]);
-	}
-}
-
 // For debugging purposes.
 void quartz_debug() {
     ESP_LOGI(TAG, "Press A to restart FPGA,");
-    ESP_LOGI(TAG, "Press B to get status.");
+    ESP_LOGI(TAG, "Press B to get status,");
+    ESP_LOGI(TAG, "Press SELECT to dump the command trace.");
 	
 	while (true) {
 		quartz_init();
@@ -69,6 +72,9 @@ void quartz_debug() {
 					ESP_LOGI(TAG, "Status:   %04x",      status.status_flags);
 				}
 				
+			} else if (msg.input == RP2040_INPUT_BUTTON_SELECT && msg.state) {
+				quartz_trace_dump();
+				
 			} else if (msg.input == RP2040_INPUT_BUTTON_HOME && msg.state) {
 				return;
 			}
@@ -78,8 +84,61 @@ void quartz_debug() {
 
 
 
+// Wakes the task waiting for the FPGA.
+static void IRAM_ATTR quartz_isr(void *args) {
+	BaseType_t   woken = pdFALSE;
+	TaskHandle_t task  = quartz_irq_task;
+	if (task) vTaskNotifyGiveFromISR(task, &woken);
+	if (woken) portYIELD_FROM_ISR();
+}
+
+// Sends queued commands.
+static void quartz_task(void *args) {
+	while (true) {
+		quartz_job_t *job;
+		if (!xQueueReceive(quartz_queue, &job, portMAX_DELAY)) continue;
+		
+		job->success = quartz_cmd_raw(job->opcode, job->send, job->send_buf, job->recv, job->recv_buf);
+		job->done    = true;
+		
+		// The job may be reused as soon as it is signalled, so touch it last.
+		if (job->callback) {
+			job->callback(job, job->args);
+		} else {
+			xSemaphoreGive(job->sem);
+		}
+	}
+}
+
+// Sets up the interrupt and command task, once.
+static void quartz_init_async() {
+	if (quartz_lock) return;
+	quartz_lock = xSemaphoreCreateMutex();
+	
+	// The ISR service may already be installed by other drivers.
+	esp_err_t res = gpio_install_isr_service(0);
+	if (res && res != ESP_ERR_INVALID_STATE) {
+		ESP_LOGE(TAG, "Cannot install ISR service: %s", esp_err_to_name(res));
+	} else {
+		// The FPGA pulls the line low when it has a response.
+		gpio_set_direction(GPIO_INT_FPGA, GPIO_MODE_INPUT);
+		gpio_set_intr_type(GPIO_INT_FPGA, GPIO_INTR_NEGEDGE);
+		res = gpio_isr_handler_add(GPIO_INT_FPGA, quartz_isr, NULL);
+		if (res) {
+			ESP_LOGE(TAG, "Cannot add ISR: %s", esp_err_to_name(res));
+		} else {
+			quartz_irq_ready = true;
+		}
+	}
+	
+	quartz_queue = xQueueCreate(QUARTZ_QUEUE_LEN, sizeof(quartz_job_t *));
+	xTaskCreate(quartz_task, "quartz", 3072, NULL, QUARTZ_TASK_PRIO, NULL);
+}
+
 // Initialise the FPGA GPU system.
 void quartz_init() {
+	quartz_init_async();
+	
 	if (get_ice40() == NULL) {
 		esp_err_t res = bsp_ice40_init();
 		if (res) {
@@ -152,7 +211,25 @@ void quartz_select(bool select_fpga_output) {
 bool quartz_await(uint64_t wait_time) {
 	if (!gpio_get_level(GPIO_INT_FPGA)) return true;
 	
-	if (wait_time) {
+	if (wait_time && quartz_irq_ready) {
+		// Sleep until the interrupt instead of polling every tick.
+		int64_t limit = esp_timer_get_time() + wait_time * 1000;
+		quartz_irq_task = xTaskGetCurrentTaskHandle();
+		ulTaskNotifyTake(pdTRUE, 0);
+		
+		// The edge may have come before this task was registered.
+		bool ready = !gpio_get_level(GPIO_INT_FPGA);
+		while (!ready) {
+			int64_t left = limit - esp_timer_get_time();
+			if (left <= 0) break;
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(left / 1000) + 1);
+			ready = !gpio_get_level(GPIO_INT_FPGA);
+		}
+		
+		quartz_irq_task = NULL;
+		return ready;
+		
+	} else if (wait_time) {
 		uint64_t limit = esp_timer_get_time() + wait_time * 1000;
 		while (esp_timer_get_time() < limit) {
 			vTaskDelay(1);
@@ -163,16 +240,6 @@ bool quartz_await(uint64_t wait_time) {
 	return false;
 }
 
-// Compute the quartz checksum over a number of bytes.
-uint8_t quartz_checksum(const void *mem, size_t length) {
-	const uint8_t *arr = mem;
-	uint8_t current = 0xcc;
-	for (size_t i = 0; i < length; i++) {
-		current = current ^ arr[i];
-	}
-	return current;
-}
-
 // Send a raw quartz command.
 // Returns whether the message was successfully received.
 bool quartz_cmd_raw1(quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf) {
@@ -194,7 +261,6 @@ bool quartz_cmd_raw1(quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t
 		ESP_LOGE(TAG, "Comms error: %s", esp_err_to_name(res));
 		return false;
 	}
-	dump_bytes(rx_buf, 4+send+recv);
 	
 	// Calculate checksum over received.
 	uint8_t real_sum = quartz_checksum(&rx_buf[3+send], recv);
@@ -212,85 +278,79 @@ bool quartz_cmd_raw1(quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t
 	}
 }
 
-// Send a raw quartz command.
-// Returns whether the message was successfully received.
-bool quartz_cmd_raw(quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf) {
-	// Some temporary buffers for sending and receiving.
-	static uint8_t tx_buf[260];
-	static uint8_t rx_buf[260];
-	
-	// Prepare send headers.
-	tx_buf[0] = opcode;
-	tx_buf[1] = send;
-	tx_buf[2] = recv;
-	// Insert send data.
-	memcpy(&tx_buf[3], send_buf, send);
-	
-	// Send stuff to the FPGA.
-	esp_err_t res = ice40_transaction(get_ice40(), tx_buf, 3+send, rx_buf, 3+send);
-	if (res) {
-		ESP_LOGE(TAG, "Comms error: %s", esp_err_to_name(res));
-		return false;
-	}
-	printf("\033[32m");
-	dump_bytes(tx_buf, 3+send);
-	printf("-> ");
-	
-	// Await receivement time.
-	if (!quartz_await(100)) {
-		printf("\033[31m<timeout>\033[0m\n");
-		ESP_LOGE(TAG, "Comms error: Timeout waiting for response.");
-		return false;
-	}
-	
-	// Clear out send data.
-	memset(tx_buf, 0, recv+2);
-	res = ice40_transaction(get_ice40(), tx_buf, recv+2, rx_buf, recv+2);
+// Do one SPI transaction with the FPGA.
+static bool quartz_ice40_transfer(void *args, const void *tx, void *rx, size_t length) {
+	esp_err_t res = ice40_transaction(get_ice40(), (uint8_t *) tx, length, rx, length);
 	if (res) {
-		printf("\033[31m<SPI error>\033[0m\n");
 		ESP_LOGE(TAG, "Comms error: %s", esp_err_to_name(res));
 		return false;
 	}
-	
-	// Calculate checksum over received.
-	uint8_t real_sum = quartz_checksum(rx_buf, 1+recv);
-	if (real_sum != rx_buf[1+recv]) {
-		printf("\033[31m");
-	}
-	dump_bytes(rx_buf, 2+recv);
-	if (real_sum != rx_buf[1+recv]) {
-		printf("(checksum error)");
-	}
-	printf("\033[0m\n");
-	
-	// Confirm checksum.
-	if (real_sum != rx_buf[1+recv]) {
-		// Checksum mismatch.
-		ESP_LOGE(TAG, "Comms error: Checksum mismatch (host's sum: %02x, GPU's sum: %02x)", real_sum, rx_buf[1+recv]);
-		return false;
-		
-	} else {
-		// Successfull communication.
-		memcpy(recv_buf, &rx_buf[1], recv);
-		return true;
-	}
+	return true;
 }
 
+// Wait for the FPGA's interrupt line.
+static bool quartz_ice40_await(void *args, uint64_t wait_time) {
+	return quartz_await(wait_time);
+}
 
-// Send a status request.
-quartz_status_t quartz_cmd_status() {
-	uint8_t rx[8];
-	if (!quartz_cmd_raw(QUARTZ_CMD_STATUS, 0, NULL, sizeof(rx), rx)) {
-		return (quartz_status_t) {false};
-	} else {
-		return (quartz_status_t) {
-			.rx_valid     = true,
-			
-			.arch_no      = rx[0],
-			.rev_no       = rx[1],
-			.task_cap     = rx[2] | (rx[3] << 8),
-			.task_num     = rx[4] | (rx[5] << 8),
-			.status_flags = rx[6] | (rx[7] << 8),
-		};
-	}
+// The FPGA on the badge.
+static const quartz_transport_t quartz_ice40_transport = {
+	.transfer = quartz_ice40_transfer,
+	.await    = quartz_ice40_await,
+	.args     = NULL,
+};
+
+// Transport used by quartz_cmd_raw.
+static const quartz_transport_t *quartz_transport = &quartz_ice40_transport;
+
+// Replace the transport used to reach the GPU; NULL selects the FPGA on the badge.
+void quartz_set_transport(const quartz_transport_t *transport) {
+	if (quartz_lock) xSemaphoreTake(quartz_lock, portMAX_DELAY);
+	quartz_transport = transport ? transport : &quartz_ice40_transport;
+	if (quartz_lock) xSemaphoreGive(quartz_lock);
+}
+
+// Send a raw quartz command.
+// Returns whether the message was successfully received.
+bool quartz_cmd_raw(quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf) {
+	if (quartz_lock) xSemaphoreTake(quartz_lock, portMAX_DELAY);
+	bool res = quartz_proto_cmd(quartz_transport, opcode, send, send_buf, recv, recv_buf);
+	if (quartz_lock) xSemaphoreGive(quartz_lock);
+	return res;
+}
+
+// Write any amount of data to the GPU's RAM, in checksummed chunks that are retried when damaged.
+// Returns whether all of it arrived.
+bool quartz_bulk_write(uint32_t addr, const void *data, size_t len) {
+	if (quartz_lock) xSemaphoreTake(quartz_lock, portMAX_DELAY);
+	bool res = quartz_proto_bulk(quartz_transport, addr, data, len);
+	if (quartz_lock) xSemaphoreGive(quartz_lock);
+	return res;
+}
+
+// Prepare a command for the asynchronous command queue.
+void quartz_job_init(quartz_job_t *job, quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf) {
+	*job = (quartz_job_t) {
+		.opcode   = opcode,
+		.send     = send,
+		.send_buf = send_buf,
+		.recv     = recv,
+		.recv_buf = recv_buf,
+	};
+	job->sem = xSemaphoreCreateBinaryStatic(&job->sem_buf);
+}
+
+// Queue a command to be sent by the command task.
+// Wait time in milliseconds, returns false if the queue stayed full.
+bool quartz_submit(quartz_job_t *job, uint64_t wait_time) {
+	if (!quartz_queue) return false;
+	job->done    = false;
+	job->success = false;
+	return xQueueSend(quartz_queue, &job, pdMS_TO_TICKS(wait_time));
+}
+
+// Wait for a queued command without a callback to complete; a wait time of 0 polls.
+// Wait time in milliseconds, returns whether it completed; see `success` for the result.
+bool quartz_job_wait(quartz_job_t *job, uint64_t wait_time) {
+	return xSemaphoreTake(job->sem, pdMS_TO_TICKS(wait_time));
 }
@@ -30,10 +30,172 @@ extern "C" {
 #endif
 
 #include "quartz_types.h"
+#include "quartz_proto.h"
 
+#ifdef ESP_PLATFORM
 #include <pax_gfx.h>
 #include <ice40.h>
 #include <ili9341.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#endif
+
+// Amount of commands that can wait in the asynchronous command queue.
+#ifndef QUARTZ_QUEUE_LEN
+#define QUARTZ_QUEUE_LEN  16
+#endif
+// Priority of the task that runs queued commands.
+#ifndef QUARTZ_TASK_PRIO
+#define QUARTZ_TASK_PRIO  10
+#endif
+// Whether fpga/build-tmp/quartz.bin was built from fpga/src, instead of using the placeholder without the GPU.
+// Set by CMakeLists.txt.
+#ifndef QUARTZ_BITSTREAM_BUILT
+#define QUARTZ_BITSTREAM_BUILT 0
+#endif
+// Whether the delta scene of fpga/sim passed, running the framebuffer, PSRAM and LCD RTL.
+// Set by CMakeLists.txt.
+#ifndef QUARTZ_SIM_DELTA
+#define QUARTZ_SIM_DELTA  0
+#endif
+// Whether raster_tb of fpga/sim passed, checking raster.v against quartz_model.c.
+// Set by CMakeLists.txt.
+#ifndef QUARTZ_SIM_RASTER
+#define QUARTZ_SIM_RASTER 0
+#endif
+// Whether the meshes scene of fpga/sim passed, running geom.v on meshes kept by the FPGA.
+// Set by CMakeLists.txt.
+#ifndef QUARTZ_SIM_MESHES
+#define QUARTZ_SIM_MESHES 0
+#endif
+
+// Width and height of the tiles compared by quartz_delta_upload.
+#define QUARTZ_TILE_SIZE  16
+#define QUARTZ_TILES_X    (QUARTZ_WIDTH  / QUARTZ_TILE_SIZE)
+#define QUARTZ_TILES_Y    (QUARTZ_HEIGHT / QUARTZ_TILE_SIZE)
+
+typedef struct quartz_job quartz_job_t;
+
+// Called from the command task when a queued command completes.
+typedef void (*quartz_job_cb_t)(quartz_job_t *job, void *args);
+
+// A command for the asynchronous command queue.
+// It, and its buffers, must stay valid until it is complete.
+struct quartz_job {
+	// The command to send.
+	quartz_cmd_t      opcode;
+	// Amount of bytes to send.
+	uint8_t           send;
+	// Data to send.
+	void             *send_buf;
+	// Amount of bytes to receive.
+	uint8_t           recv;
+	// Where to store received data.
+	void             *recv_buf;
+	
+	// Called on completion instead of signalling waiters, may be NULL.
+	quartz_job_cb_t   callback;
+	// Passed to the callback.
+	void             *args;
+	
+	// Whether the command has completed; use quartz_job_wait before reusing the job.
+	volatile bool     done;
+	// Whether the response was received correctly, valid once done.
+	bool              success;
+#ifdef ESP_PLATFORM
+	// Given on completion if there is no callback.
+	SemaphoreHandle_t sem;
+	// Storage for the semaphore.
+	StaticSemaphore_t sem_buf;
+#endif
+};
+
+// Draw commands collected into as few transactions as possible.
+// One command is filled while the previous one is being sent.
+typedef struct {
+	// Opcode of the command being filled, QUARTZ_CMD_NOP if there is none.
+	quartz_cmd_t opcode;
+	// Write mask of the command being filled.
+	uint16_t     mask;
+	// Which command buffer is being filled.
+	uint8_t      cur;
+	// Bytes in each command buffer.
+	uint8_t      len[2];
+	// Command payloads.
+	uint8_t      buf[2][QUARTZ_MAX_SEND];
+	// Status responses.
+	uint8_t      resp[2][8];
+	// Jobs sending the command buffers.
+	quartz_job_t job[2];
+	// Whether each job is in the command queue.
+	bool         queued[2];
+	// Whether a command was not received correctly since the last flush.
+	bool         error;
+	// Amount of commands sent.
+	uint32_t     commands;
+} quartz_batch_t;
+
+// Keeps the GPU's framebuffer in sync with a frame in memory by sending only the tiles that changed.
+typedef struct {
+	// Hash of every tile as last sent.
+	uint32_t hash[QUARTZ_TILES_Y][QUARTZ_TILES_X];
+	// Whether the hashes match what the GPU has.
+	bool     valid;
+	// Amount of tiles sent by the last upload.
+	uint16_t tiles;
+	// Amount of pixels sent by the last upload.
+	uint32_t pixels;
+} quartz_delta_t;
+
+// Where the vertices and triangles of a resident mesh come from.
+typedef struct {
+	// Amount of vertices, at most 65535.
+	size_t        num_vertex;
+	// Positions, x, y and z for every vertex.
+	const float  *vertices;
+	// Amount of triangles, at most 65535.
+	size_t        num_tri;
+	// Vertex indices, three per triangle.
+	const size_t *tri_indices;
+	// Changes when the key is reused for another mesh, such as when one is freed and another made at its address.
+	uint32_t      serial;
+} quartz_mesh_src_t;
+
+// A mesh kept in the GPU's RAM.
+typedef struct {
+	// What the mesh was made from, NULL if the handle is free.
+	const void *key;
+	// Serial of the mesh it was made from, see quartz_mesh_src_t.
+	uint32_t    serial;
+	// Where the mesh is in RAM.
+	uint32_t    addr;
+	// Size of the mesh in RAM.
+	uint32_t    size;
+	// Use counter value of the last time it was drawn.
+	uint32_t    last_use;
+	// Position units per step of the stored vertex coordinates.
+	float       scale;
+} quartz_mesh_t;
+
+// Keeps meshes in a region of the GPU's RAM, evicting the least recently drawn ones to make room.
+// Not thread-safe; use it from the task that fills the batch it is given.
+typedef struct {
+	// Meshes by handle.
+	quartz_mesh_t mesh[QUARTZ_MESH_SLOTS];
+	// Start of the region of RAM.
+	uint32_t      base;
+	// Size of the region of RAM.
+	uint32_t      size;
+	// Counts uses, to find the least recently drawn mesh.
+	uint32_t      clock;
+	// Amount of meshes uploaded.
+	uint32_t      uploads;
+	// Amount of meshes evicted to make room.
+	uint32_t      evictions;
+	// Amount of bytes uploaded.
+	uint32_t      upload_bytes;
+} quartz_meshes_t;
 
 // For debugging purposes.
 void quartz_debug();
@@ -46,14 +208,72 @@ void quartz_select(bool select_fpga_output);
 // Wait for the FPGA DEVICE to have INCOMING DATA.
 // Wait time in milliseconds.
 bool    quartz_await   (uint64_t wait_time);
-// Compute the quartz checksum over a number of bytes.
-uint8_t quartz_checksum(const void *mem, size_t length);
+// Replace the transport used to reach the GPU; NULL selects the FPGA on the badge.
+void    quartz_set_transport(const quartz_transport_t *transport);
 // Send a raw quartz command.
 // Returns whether the message was successfully received.
 bool    quartz_cmd_raw (quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf);
+// Write any amount of data to the GPU's RAM, in checksummed chunks that are retried when damaged.
+// Returns whether all of it arrived.
+bool    quartz_bulk_write(uint32_t addr, const void *data, size_t len);
+
+// Prepare a command for the asynchronous command queue.
+void    quartz_job_init(quartz_job_t *job, quartz_cmd_t opcode, uint8_t send, void *send_buf, uint8_t recv, void *recv_buf);
+// Queue a command to be sent by the command task.
+// Wait time in milliseconds, returns false if the queue stayed full.
+bool    quartz_submit  (quartz_job_t *job, uint64_t wait_time);
+// Wait for a queued command without a callback to complete; a wait time of 0 polls.
+// Wait time in milliseconds, returns whether it completed; see `success` for the result.
+bool    quartz_job_wait(quartz_job_t *job, uint64_t wait_time);
+
+// Prepare an empty batch of draw commands.
+void quartz_batch_init (quartz_batch_t *batch);
+// Add a depth tested triangle, writing only the channels in `mask`.
+void quartz_batch_tri  (quartz_batch_t *batch, const quartz_tri_t *tri, uint16_t mask);
+// Add a line, blended with the per-channel maximum.
+void quartz_batch_line (quartz_batch_t *batch, const quartz_line_t *line);
+// Add a horizontal run of RGB565 pixels for the framebuffer, split over commands as needed.
+// Set `swapped` if the pixels are stored byte-swapped, as in PAX buffers for the LCD.
+void quartz_batch_span (quartz_batch_t *batch, uint16_t x, uint16_t y, uint16_t len, const uint16_t *pixels, bool swapped);
+// Add a draw of a resident mesh, writing only the channels in `mask`.
+void quartz_batch_draw (quartz_batch_t *batch, uint8_t handle, uint16_t color, uint16_t mask, const quartz_xform_t *xform);
+// Send everything in the batch and wait for it to be drawn.
+// Returns whether all commands since the last flush were received correctly.
+bool quartz_batch_flush(quartz_batch_t *batch);
+
+// Forget what the GPU's framebuffer holds, so that the next upload sends everything.
+void quartz_delta_init  (quartz_delta_t *delta);
+// Send the tiles of a QUARTZ_WIDTH by QUARTZ_HEIGHT RGB565 frame that changed since the last upload.
+// Returns whether everything was received correctly; if not, the next upload sends everything.
+bool quartz_delta_upload(quartz_delta_t *delta, quartz_batch_t *batch, const uint16_t *pixels, bool swapped);
+
+// Manage meshes in `size` bytes of the GPU's RAM from `base`, which must not overlap the framebuffer.
+void quartz_meshes_init   (quartz_meshes_t *meshes, uint32_t base, uint32_t size);
+// Get the handle of a mesh, uploading it if it is not resident; `key` and the source's serial identify it,
+// e.g. the shape it is made from and the shape's serial.
+// The batch is flushed before anything is evicted or uploaded. Returns -1 if the mesh cannot be made resident.
+int  quartz_meshes_acquire(quartz_meshes_t *meshes, quartz_batch_t *batch, const void *key, const quartz_mesh_src_t *src);
+// Forget a mesh, so that it is uploaded again the next time, e.g. because it changed.
+void quartz_meshes_forget (quartz_meshes_t *meshes, const void *key);
+// Make the placement of a resident mesh from a 3 by 4 matrix, the rows of which give the eye's x, y and z.
+// `light` is the unit light direction in the eye's space, see quartz_xform_t.
+quartz_xform_t quartz_meshes_xform(const quartz_meshes_t *meshes, int handle, const float mtx[12], const float light[3]);
+// Make the projection of resident meshes, see quartz_view_t; positions in pixels.
+// Reciprocal depth goes from 65535 at distance `near` down to 1 at distance `far`.
+quartz_view_t  quartz_make_view   (float focal, float scale, float cx, float cy, float near, float far);
 
 // Send a status request.
 quartz_status_t quartz_cmd_status();
+// Wait for the start of the LCD's next tearing effect pulse, then get status.
+quartz_status_t quartz_cmd_fmark();
+// Fill planes of the framebuffer, a mask of QUARTZ_CLEAR_COLOR and QUARTZ_CLEAR_DEPTH.
+quartz_status_t quartz_cmd_clear(uint16_t color, uint16_t depth, uint8_t planes);
+// Define resident mesh `handle` from vertices and triangles already in RAM.
+quartz_status_t quartz_cmd_mesh(uint8_t handle, uint32_t vtx_addr, uint16_t num_vertex, uint32_t tri_addr, uint16_t num_tri);
+// Set the projection of resident meshes; flush batches with draws first.
+quartz_status_t quartz_cmd_view(const quartz_view_t *view);
+// Send the framebuffer to the LCD at the next tearing effect pulse, and wait for it.
+quartz_status_t quartz_cmd_present();
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,541 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+// The portable parts of the driver: batches of draw commands, framebuffer uploads,
+// resident meshes and the command wrappers. Everything that needs the badge is in quartz.c,
+// so that these build on Linux against the emulator, see host/.
+
+#include "quartz.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "quartz";
+
+// Wait for a command buffer of a batch to be sent.
+static void quartz_batch_join(quartz_batch_t *batch, int index) {
+	if (!batch->queued[index]) return;
+	// Every command times out on its own, so this does not wait forever.
+	while (!quartz_job_wait(&batch->job[index], 1000));
+	batch->queued[index] = false;
+	if (!batch->job[index].success) batch->error = true;
+}
+
+// Send the command being filled, if any, and start on the other buffer.
+static void quartz_batch_send(quartz_batch_t *batch) {
+	if (batch->opcode == QUARTZ_CMD_NOP) return;
+	
+	int           cur = batch->cur;
+	quartz_job_t *job = &batch->job[cur];
+	job->opcode = batch->opcode;
+	job->send   = batch->len[cur];
+	if (quartz_submit(job, 1000)) {
+		batch->queued[cur] = true;
+	} else if (!quartz_cmd_raw(job->opcode, job->send, job->send_buf, job->recv, job->recv_buf)) {
+		// The command task is not running, so it was sent right away.
+		batch->error = true;
+	}
+	batch->commands ++;
+	
+	// The other buffer may still be in flight.
+	batch->cur    = !cur;
+	batch->opcode = QUARTZ_CMD_NOP;
+	quartz_batch_join(batch, batch->cur);
+}
+
+// Make room for an item of `size` bytes in a command with the given opcode and mask.
+static uint8_t *quartz_batch_reserve(quartz_batch_t *batch, quartz_cmd_t opcode, uint16_t mask, size_t size) {
+	if (batch->opcode != opcode || batch->mask != mask || batch->len[batch->cur] + size > QUARTZ_MAX_SEND) {
+		quartz_batch_send(batch);
+	}
+	
+	uint8_t *buf = batch->buf[batch->cur];
+	if (batch->opcode == QUARTZ_CMD_NOP) {
+		// Every draw command starts with the write mask, spans have no header.
+		batch->opcode = opcode;
+		batch->mask   = mask;
+		if (opcode == QUARTZ_CMD_SPANS) {
+			batch->len[batch->cur] = 0;
+		} else {
+			quartz_put16(buf, mask);
+			batch->len[batch->cur] = 2;
+		}
+	}
+	
+	uint8_t *out = buf + batch->len[batch->cur];
+	batch->len[batch->cur] += size;
+	return out;
+}
+
+// Prepare an empty batch of draw commands.
+void quartz_batch_init(quartz_batch_t *batch) {
+	*batch = (quartz_batch_t) {
+		.opcode = QUARTZ_CMD_NOP,
+	};
+	for (int i = 0; i < 2; i++) {
+		quartz_job_init(&batch->job[i], QUARTZ_CMD_NOP, 0, batch->buf[i], sizeof(batch->resp[i]), batch->resp[i]);
+	}
+}
+
+// Add a depth tested triangle, writing only the channels in `mask`.
+void quartz_batch_tri(quartz_batch_t *batch, const quartz_tri_t *tri, uint16_t mask) {
+	quartz_encode_tri(quartz_batch_reserve(batch, QUARTZ_CMD_TRIS, mask, QUARTZ_TRI_SIZE), tri);
+}
+
+// Add a line, blended with the per-channel maximum.
+void quartz_batch_line(quartz_batch_t *batch, const quartz_line_t *line) {
+	quartz_encode_line(quartz_batch_reserve(batch, QUARTZ_CMD_LINES, 0, QUARTZ_LINE_SIZE), line);
+}
+
+// Add a horizontal run of RGB565 pixels for the framebuffer, split over commands as needed.
+// Set `swapped` if the pixels are stored byte-swapped, as in PAX buffers for the LCD.
+void quartz_batch_span(quartz_batch_t *batch, uint16_t x, uint16_t y, uint16_t len, const uint16_t *pixels, bool swapped) {
+	while (len) {
+		// Fill up the command being built before starting the next one.
+		size_t room = QUARTZ_MAX_SEND;
+		if (batch->opcode == QUARTZ_CMD_SPANS && batch->len[batch->cur] + QUARTZ_SPAN_HEADER + 2 <= QUARTZ_MAX_SEND) {
+			room -= batch->len[batch->cur];
+		}
+		uint16_t part = (room - QUARTZ_SPAN_HEADER) / 2;
+		if (part > len) part = len;
+		
+		uint8_t *out = quartz_batch_reserve(batch, QUARTZ_CMD_SPANS, 0, QUARTZ_SPAN_HEADER + part * 2);
+		quartz_put16(out + 0, x);
+		quartz_put16(out + 2, y);
+		quartz_put16(out + 4, part);
+		out += QUARTZ_SPAN_HEADER;
+		for (size_t i = 0; i < part; i++) {
+			uint16_t value = swapped ? (pixels[i] >> 8) | (pixels[i] << 8) : pixels[i];
+			quartz_put16(out + i * 2, value);
+		}
+		
+		x      += part;
+		pixels += part;
+		len    -= part;
+	}
+}
+
+// Add a draw of a resident mesh, writing only the channels in `mask`.
+void quartz_batch_draw(quartz_batch_t *batch, uint8_t handle, uint16_t color, uint16_t mask, const quartz_xform_t *xform) {
+	uint8_t *out = quartz_batch_reserve(batch, QUARTZ_CMD_DRAW, mask, QUARTZ_DRAW_SIZE);
+	out[0] = handle;
+	quartz_put16(out + 1, color);
+	quartz_encode_xform(out + 3, xform);
+}
+
+// Send everything in the batch and wait for it to be drawn.
+// Returns whether all commands since the last flush were received correctly.
+bool quartz_batch_flush(quartz_batch_t *batch) {
+	quartz_batch_send(batch);
+	quartz_batch_join(batch, 0);
+	quartz_batch_join(batch, 1);
+	
+	bool success = !batch->error;
+	batch->error = false;
+	return success;
+}
+
+
+// Hash a tile of a frame, FNV-1a over its pixels.
+static uint32_t quartz_tile_hash(const uint16_t *pixels, int tx, int ty) {
+	uint32_t hash = 2166136261u;
+	const uint16_t *row = pixels + ty * QUARTZ_TILE_SIZE * QUARTZ_WIDTH + tx * QUARTZ_TILE_SIZE;
+	for (int y = 0; y < QUARTZ_TILE_SIZE; y++, row += QUARTZ_WIDTH) {
+		for (int x = 0; x < QUARTZ_TILE_SIZE; x++) {
+			hash = (hash ^ row[x]) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+// Write pixels to the framebuffer's color plane as bulk data, converted to little endian.
+static bool quartz_bulk_pixels(size_t index, const uint16_t *pixels, size_t count, bool swapped) {
+	static uint8_t stage[QUARTZ_BULK_CHUNK];
+	while (count) {
+		size_t part = count > sizeof(stage) / 2 ? sizeof(stage) / 2 : count;
+		for (size_t i = 0; i < part; i++) {
+			uint16_t value = swapped ? (pixels[i] >> 8) | (pixels[i] << 8) : pixels[i];
+			quartz_put16(stage + i * 2, value);
+		}
+		if (!quartz_bulk_write(QUARTZ_RAM_COLOR + index * 2, stage, part * 2)) return false;
+		index  += part;
+		pixels += part;
+		count  -= part;
+	}
+	return true;
+}
+
+// Forget what the GPU's framebuffer holds, so that the next upload sends everything.
+void quartz_delta_init(quartz_delta_t *delta) {
+	*delta = (quartz_delta_t) {
+		.valid = false,
+	};
+}
+
+// Send the tiles of a QUARTZ_WIDTH by QUARTZ_HEIGHT RGB565 frame that changed since the last upload.
+// Returns whether everything was received correctly; if not, the next upload sends everything.
+bool quartz_delta_upload(quartz_delta_t *delta, quartz_batch_t *batch, const uint16_t *pixels, bool swapped) {
+	delta->tiles  = 0;
+	delta->pixels = 0;
+	bool bulk_ok  = true;
+	
+	for (int ty = 0; ty < QUARTZ_TILES_Y; ty++) {
+		// Find the changed tiles in this row.
+		bool dirty[QUARTZ_TILES_X];
+		bool any = false;
+		for (int tx = 0; tx < QUARTZ_TILES_X; tx++) {
+			uint32_t hash = quartz_tile_hash(pixels, tx, ty);
+			dirty[tx] = !delta->valid || hash != delta->hash[ty][tx];
+			delta->hash[ty][tx] = hash;
+			if (dirty[tx]) {
+				delta->tiles ++;
+				any = true;
+			}
+		}
+		if (!any) continue;
+		
+		// A whole row of tiles is one stretch of RAM, so it goes as bulk data.
+		bool all = true;
+		for (int tx = 0; tx < QUARTZ_TILES_X; tx++) all &= dirty[tx];
+		if (all) {
+			size_t first = ty * QUARTZ_TILE_SIZE * QUARTZ_WIDTH;
+			bulk_ok &= quartz_bulk_pixels(first, pixels + first, QUARTZ_TILE_SIZE * QUARTZ_WIDTH, swapped);
+			delta->pixels += QUARTZ_TILE_SIZE * QUARTZ_WIDTH;
+			continue;
+		}
+		
+		// Send neighbouring changed tiles as one span per line.
+		for (int tx = 0; tx < QUARTZ_TILES_X;) {
+			if (!dirty[tx]) {
+				tx ++;
+				continue;
+			}
+			int end = tx;
+			while (end < QUARTZ_TILES_X && dirty[end]) end ++;
+			
+			uint16_t x   = tx * QUARTZ_TILE_SIZE;
+			uint16_t len = (end - tx) * QUARTZ_TILE_SIZE;
+			for (int y = ty * QUARTZ_TILE_SIZE; y < (ty + 1) * QUARTZ_TILE_SIZE; y++) {
+				quartz_batch_span(batch, x, y, len, pixels + y * QUARTZ_WIDTH + x, swapped);
+			}
+			delta->pixels += len * QUARTZ_TILE_SIZE;
+			tx = end;
+		}
+	}
+	
+	delta->valid = quartz_batch_flush(batch) && bulk_ok;
+	return delta->valid;
+}
+
+
+// Round to a 16-bit signed value.
+static inline int16_t quartz_round16(float value) {
+	if (value <= INT16_MIN) return INT16_MIN;
+	if (value >= INT16_MAX) return INT16_MAX;
+	return lrintf(value);
+}
+
+// Round to a 32-bit signed value.
+static inline int32_t quartz_round32(float value) {
+	if (value <= (float) INT32_MIN) return INT32_MIN;
+	if (value >= (float) INT32_MAX) return INT32_MAX;
+	return lrintf(value);
+}
+
+// Manage meshes in `size` bytes of the GPU's RAM from `base`, which must not overlap the framebuffer.
+void quartz_meshes_init(quartz_meshes_t *meshes, uint32_t base, uint32_t size) {
+	*meshes = (quartz_meshes_t) {
+		.base = base,
+		.size = size,
+	};
+}
+
+// Find the lowest place where `size` bytes fit between the resident meshes.
+static bool quartz_meshes_place(const quartz_meshes_t *meshes, uint32_t size, uint32_t *addr) {
+	// Free space starts at the start of the region or right after a mesh.
+	uint32_t best = UINT32_MAX;
+	for (int i = -1; i < QUARTZ_MESH_SLOTS; i++) {
+		if (i >= 0 && !meshes->mesh[i].key) continue;
+		uint32_t at = i < 0 ? meshes->base : meshes->mesh[i].addr + meshes->mesh[i].size;
+		if (at >= best || at + size > meshes->base + meshes->size) continue;
+		
+		bool free = true;
+		for (int j = 0; j < QUARTZ_MESH_SLOTS && free; j++) {
+			const quartz_mesh_t *mesh = &meshes->mesh[j];
+			free = !mesh->key || mesh->addr >= at + size || mesh->addr + mesh->size <= at;
+		}
+		if (free) best = at;
+	}
+	*addr = best;
+	return best != UINT32_MAX;
+}
+
+// Evict the least recently drawn mesh; returns false if none are resident.
+static bool quartz_meshes_evict(quartz_meshes_t *meshes) {
+	int lru = -1;
+	for (int i = 0; i < QUARTZ_MESH_SLOTS; i++) {
+		if (!meshes->mesh[i].key) continue;
+		if (lru < 0 || (int32_t) (meshes->mesh[i].last_use - meshes->mesh[lru].last_use) < 0) lru = i;
+	}
+	if (lru < 0) return false;
+	// The GPU still has the handle, but nothing draws it before it is defined again.
+	meshes->mesh[lru].key = NULL;
+	meshes->evictions ++;
+	return true;
+}
+
+// Encode a mesh and write it to RAM, a chunk at a time.
+static bool quartz_meshes_upload(uint32_t addr, const quartz_mesh_src_t *src, float scale) {
+	static uint8_t stage[QUARTZ_BULK_CHUNK];
+	size_t fill = 0;
+	
+	for (size_t i = 0; i < src->num_vertex + src->num_tri; i++) {
+		uint8_t item[QUARTZ_MESH_TRI_SIZE] = {0};
+		size_t  len;
+		if (i < src->num_vertex) {
+			// Coordinates in steps of `scale`.
+			const float *vtx = &src->vertices[i * 3];
+			for (int j = 0; j < 3; j++) {
+				quartz_put16(&item[j * 2], quartz_round16(vtx[j] / scale));
+			}
+			len = QUARTZ_MESH_VTX_SIZE;
+		} else {
+			// Indices and the unit normal; the GPU skips triangles with bad indices.
+			const size_t *tri = &src->tri_indices[(i - src->num_vertex) * 3];
+			bool valid = tri[0] < src->num_vertex && tri[1] < src->num_vertex && tri[2] < src->num_vertex;
+			for (int j = 0; j < 3; j++) {
+				quartz_put16(&item[j * 2], valid ? tri[j] : UINT16_MAX);
+			}
+			if (valid) {
+				const float *p0 = &src->vertices[tri[0] * 3];
+				const float *p1 = &src->vertices[tri[1] * 3];
+				const float *p2 = &src->vertices[tri[2] * 3];
+				float a[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float b[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+				float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int j = 0; j < 3 && length > 0; j++) {
+					item[6 + j] = (int8_t) lrintf(n[j] / length * 127);
+				}
+			}
+			len = QUARTZ_MESH_TRI_SIZE;
+		}
+		
+		if (fill + len > sizeof(stage)) {
+			if (!quartz_bulk_write(addr, stage, fill)) return false;
+			addr += fill;
+			fill  = 0;
+		}
+		memcpy(&stage[fill], item, len);
+		fill += len;
+	}
+	return !fill || quartz_bulk_write(addr, stage, fill);
+}
+
+// Get the handle of a mesh, uploading it if it is not resident.
+int quartz_meshes_acquire(quartz_meshes_t *meshes, quartz_batch_t *batch, const void *key, const quartz_mesh_src_t *src) {
+	meshes->clock ++;
+	for (int i = 0; i < QUARTZ_MESH_SLOTS; i++) {
+		if (!key || meshes->mesh[i].key != key) continue;
+		if (meshes->mesh[i].serial == src->serial) {
+			meshes->mesh[i].last_use = meshes->clock;
+			return i;
+		}
+		// A mesh made where a freed one was; the old one can never be drawn again.
+		meshes->mesh[i].key = NULL;
+	}
+	
+	if (!key || src->num_vertex > UINT16_MAX || src->num_tri > UINT16_MAX || !src->num_tri) return -1;
+	uint32_t size = src->num_vertex * QUARTZ_MESH_VTX_SIZE + src->num_tri * QUARTZ_MESH_TRI_SIZE;
+	if (size > meshes->size) return -1;
+	
+	// Queued draws may use the handle or the RAM that gets reused.
+	quartz_batch_flush(batch);
+	
+	// Evict until there is a free handle and enough room in one piece.
+	int      handle;
+	uint32_t addr;
+	while (true) {
+		for (handle = 0; handle < QUARTZ_MESH_SLOTS && meshes->mesh[handle].key; handle++);
+		if (handle < QUARTZ_MESH_SLOTS && quartz_meshes_place(meshes, size, &addr)) break;
+		if (!quartz_meshes_evict(meshes)) return -1;
+	}
+	
+	// Scale the coordinates to use the full range of the stored vertices.
+	float max = 0;
+	for (size_t i = 0; i < src->num_vertex * 3; i++) {
+		max = fmaxf(max, fabsf(src->vertices[i]));
+	}
+	float    scale    = max > 0 ? max / INT16_MAX : 1;
+	uint32_t tri_addr = addr + src->num_vertex * QUARTZ_MESH_VTX_SIZE;
+	if (!quartz_meshes_upload(addr, src, scale)
+			|| !quartz_cmd_mesh(handle, addr, src->num_vertex, tri_addr, src->num_tri).rx_valid) {
+		QUARTZ_LOGW(TAG, "Mesh upload failed");
+		return -1;
+	}
+	
+	meshes->mesh[handle] = (quartz_mesh_t) {
+		.key      = key,
+		.serial   = src->serial,
+		.addr     = addr,
+		.size     = size,
+		.last_use = meshes->clock,
+		.scale    = scale,
+	};
+	meshes->uploads ++;
+	meshes->upload_bytes += size;
+	return handle;
+}
+
+// Forget a mesh, so that it is uploaded again the next time.
+void quartz_meshes_forget(quartz_meshes_t *meshes, const void *key) {
+	for (int i = 0; i < QUARTZ_MESH_SLOTS; i++) {
+		if (meshes->mesh[i].key == key) meshes->mesh[i].key = NULL;
+	}
+}
+
+// Make the placement of a resident mesh from a 3 by 4 matrix, the rows of which give the eye's x, y and z.
+quartz_xform_t quartz_meshes_xform(const quartz_meshes_t *meshes, int handle, const float mtx[12], const float light[3]) {
+	quartz_xform_t xform = {0};
+	
+	// The linear part, from stored coordinates to 16.16, with as many bits as fit.
+	float lin[3][3];
+	float max = 0;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			lin[i][j] = mtx[i * 4 + j] * meshes->mesh[handle].scale * 65536;
+			max = fmaxf(max, fabsf(lin[i][j]));
+		}
+	}
+	while (xform.shift < 31 && ldexpf(max, xform.shift + 1) <= INT16_MAX) xform.shift ++;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			xform.rot[i][j] = quartz_round16(ldexpf(lin[i][j], xform.shift));
+		}
+		xform.pos[i] = quartz_round32(mtx[i * 4 + 3] * 65536);
+	}
+	
+	// The light in the mesh's space; exact for rotations and uniform scaling.
+	float dir[3], length = 0;
+	for (int j = 0; j < 3; j++) {
+		dir[j]  = mtx[j] * light[0] + mtx[4 + j] * light[1] + mtx[8 + j] * light[2];
+		length += dir[j] * dir[j];
+	}
+	length = sqrtf(length);
+	for (int j = 0; j < 3 && length > 0; j++) {
+		xform.light[j] = quartz_round16(dir[j] / length * INT16_MAX);
+	}
+	return xform;
+}
+
+// Make the projection of resident meshes; positions in pixels.
+quartz_view_t quartz_make_view(float focal, float scale, float cx, float cy, float near, float far) {
+	// Reversed 1 / distance, the same as wf3d's reciprocal depth.
+	float depth_a = (UINT16_MAX - 1) / (1 / near - 1 / far);
+	float depth_b = 1 - depth_a / far;
+	return (quartz_view_t) {
+		.focal   = quartz_round32(focal * 65536),
+		.scale   = quartz_round16(focal * scale * 16),
+		.cx      = quartz_round16(cx * 16),
+		.cy      = quartz_round16(cy * 16),
+		.depth_a = quartz_round32(depth_a * 256),
+		.depth_b = quartz_round32(depth_b),
+	};
+}
+
+
+// Send a status request.
+quartz_status_t quartz_cmd_status() {
+	uint8_t rx[8];
+	if (!quartz_cmd_raw(QUARTZ_CMD_STATUS, 0, NULL, sizeof(rx), rx)) {
+		return (quartz_status_t) {false};
+	} else {
+		return quartz_decode_status(rx);
+	}
+}
+
+// Wait for the start of the LCD's next tearing effect pulse, then get status.
+quartz_status_t quartz_cmd_fmark() {
+	uint8_t rx[8];
+	if (!quartz_cmd_raw(QUARTZ_CMD_FMARK, 0, NULL, sizeof(rx), rx)) {
+		return (quartz_status_t) {false};
+	} else {
+		return quartz_decode_status(rx);
+	}
+}
+
+// Fill planes of the framebuffer, a mask of QUARTZ_CLEAR_COLOR and QUARTZ_CLEAR_DEPTH.
+quartz_status_t quartz_cmd_clear(uint16_t color, uint16_t depth, uint8_t planes) {
+	uint8_t tx[5];
+	uint8_t rx[8];
+	quartz_put16(&tx[0], color);
+	quartz_put16(&tx[2], depth);
+	tx[4] = planes;
+	if (!quartz_cmd_raw(QUARTZ_CMD_CLEAR, sizeof(tx), tx, sizeof(rx), rx)) {
+		return (quartz_status_t) {false};
+	} else {
+		return quartz_decode_status(rx);
+	}
+}
+
+// Define resident mesh `handle` from vertices and triangles already in RAM.
+quartz_status_t quartz_cmd_mesh(uint8_t handle, uint32_t vtx_addr, uint16_t num_vertex, uint32_t tri_addr, uint16_t num_tri) {
+	uint8_t tx[QUARTZ_MESH_SIZE];
+	uint8_t rx[8];
+	tx[0] = handle;
+	tx[1] = vtx_addr;
+	tx[2] = vtx_addr >> 8;
+	tx[3] = vtx_addr >> 16;
+	quartz_put16(&tx[4], num_vertex);
+	tx[6] = tri_addr;
+	tx[7] = tri_addr >> 8;
+	tx[8] = tri_addr >> 16;
+	quartz_put16(&tx[9], num_tri);
+	if (!quartz_cmd_raw(QUARTZ_CMD_MESH, sizeof(tx), tx, sizeof(rx), rx)) {
+		return (quartz_status_t) {false};
+	} else {
+		return quartz_decode_status(rx);
+	}
+}
+
+// Set the projection of resident meshes.
+quartz_status_t quartz_cmd_view(const quartz_view_t *view) {
+	uint8_t tx[QUARTZ_VIEW_SIZE];
+	uint8_t rx[8];
+	quartz_encode_view(tx, view);
+	if (!quartz_cmd_raw(QUARTZ_CMD_VIEW, sizeof(tx), tx, sizeof(rx), rx)) {
+		return (quartz_status_t) {false};
+	} else {
+		return quartz_decode_status(rx);
+	}
+}
+
+// Send the framebuffer to the LCD at the next tearing effect pulse, and wait for it.
+quartz_status_t quartz_cmd_present() {
+	uint8_t rx[8];
+	if (!quartz_cmd_raw(QUARTZ_CMD_PRESENT, 0, NULL, sizeof(rx), rx)) {
+		return (quartz_status_t) {false};
+	} else {
+		return quartz_decode_status(rx);
+	}
+}
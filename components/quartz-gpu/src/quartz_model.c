@@ -0,0 +1,504 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz_model.h"
+#include <string.h>
+#include <stdlib.h>
+
+// The hardware's integer rules, spelled out so that the model does not depend on
+// how the compiler shifts negative numbers:
+// - coordinates are 12.4 fixed-point, pixel centers sit at 16n+8;
+// - divisions truncate towards zero and saturate to 32 bits;
+// - conversions back to whole units round towards negative infinity.
+
+// Divide by 2^shift, rounding towards negative infinity.
+static inline int64_t quartz_floor_shr(int64_t value, int shift) {
+	int64_t div = (int64_t) 1 << shift;
+	return value >= 0 ? value / div : -((-value + div - 1) / div);
+}
+
+// Divide, rounding towards zero and saturating to 32 bits.
+static inline int64_t quartz_div_sat(int64_t num, int64_t den) {
+	int64_t q = num / den;
+	if (q > INT32_MAX) return INT32_MAX;
+	if (q < INT32_MIN) return INT32_MIN;
+	return q;
+}
+
+// Per-channel maximum of two RGB565 colors.
+static inline uint16_t quartz_max565(uint16_t a, uint16_t b) {
+	uint16_t r = (a & 0xf800) > (b & 0xf800) ? (a & 0xf800) : (b & 0xf800);
+	uint16_t g = (a & 0x07e0) > (b & 0x07e0) ? (a & 0x07e0) : (b & 0x07e0);
+	uint16_t l = (a & 0x001f) > (b & 0x001f) ? (a & 0x001f) : (b & 0x001f);
+	return r | g | l;
+}
+
+// Hand a rasterized pixel to the pixel callback and the buffers.
+static inline void quartz_model_emit(quartz_model_t *model, const quartz_pixel_t *pixel) {
+	model->pixels ++;
+	if (model->pixel_cb) model->pixel_cb(model->pixel_args, pixel);
+	quartz_model_pixel(model, pixel);
+}
+
+
+
+// Initialise the model as if the GPU just started.
+void quartz_model_init(quartz_model_t *model) {
+	memset(model, 0, sizeof(*model));
+}
+
+// Fill the color and depth buffers.
+void quartz_model_clear(quartz_model_t *model, uint16_t color, uint16_t depth) {
+	for (size_t i = 0; i < QUARTZ_WIDTH * QUARTZ_HEIGHT; i++) {
+		model->color[i] = color;
+		model->depth[i] = depth;
+	}
+}
+
+// Write a horizontal run of pixels to the color buffer; returns false if it is not on the screen.
+bool quartz_model_span(quartz_model_t *model, uint16_t x, uint16_t y, uint16_t len, const uint8_t *data) {
+	if (len == 0 || y >= QUARTZ_HEIGHT || x + len > QUARTZ_WIDTH) return false;
+	uint16_t *out = &model->color[x + y * QUARTZ_WIDTH];
+	for (size_t i = 0; i < len; i++) {
+		out[i] = quartz_get16(&data[i * 2]);
+	}
+	return true;
+}
+
+// Write one byte to a plane of little endian pixels.
+static inline void quartz_plane_write(uint16_t *plane, uint32_t offset, uint8_t value) {
+	uint16_t *px = &plane[offset / 2];
+	if (offset & 1) {
+		*px = (*px & 0x00ff) | (value << 8);
+	} else {
+		*px = (*px & 0xff00) | value;
+	}
+}
+
+// Write bytes to the GPU's RAM, which includes the color and depth planes.
+void quartz_model_write(quartz_model_t *model, uint32_t addr, const uint8_t *data, size_t len) {
+	const uint32_t plane_size = QUARTZ_WIDTH * QUARTZ_HEIGHT * 2;
+	for (size_t i = 0; i < len; i++, addr++) {
+		// The color plane starts at address 0.
+		if (addr < QUARTZ_RAM_COLOR + plane_size) {
+			quartz_plane_write(model->color, addr - QUARTZ_RAM_COLOR, data[i]);
+		} else if (addr >= QUARTZ_RAM_DEPTH && addr < QUARTZ_RAM_DEPTH + plane_size) {
+			quartz_plane_write(model->depth, addr - QUARTZ_RAM_DEPTH, data[i]);
+		} else if (model->ram && addr >= QUARTZ_RAM_FREE && addr - QUARTZ_RAM_FREE < model->ram_size) {
+			model->ram[addr - QUARTZ_RAM_FREE] = data[i];
+		}
+	}
+}
+
+// Read bytes from the GPU's RAM; what is not modelled reads as 0.
+void quartz_model_read(quartz_model_t *model, uint32_t addr, uint8_t *data, size_t len) {
+	const uint32_t plane_size = QUARTZ_WIDTH * QUARTZ_HEIGHT * 2;
+	for (size_t i = 0; i < len; i++, addr++) {
+		// The color plane starts at address 0.
+		if (addr < QUARTZ_RAM_COLOR + plane_size) {
+			data[i] = model->color[(addr - QUARTZ_RAM_COLOR) / 2] >> (addr & 1) * 8;
+		} else if (addr >= QUARTZ_RAM_DEPTH && addr < QUARTZ_RAM_DEPTH + plane_size) {
+			data[i] = model->depth[(addr - QUARTZ_RAM_DEPTH) / 2] >> (addr & 1) * 8;
+		} else if (model->ram && addr >= QUARTZ_RAM_FREE && addr - QUARTZ_RAM_FREE < model->ram_size) {
+			data[i] = model->ram[addr - QUARTZ_RAM_FREE];
+		} else {
+			data[i] = 0;
+		}
+	}
+}
+
+// Check a QUARTZ_CMD_BULK chunk and write it to RAM; returns whether it was intact.
+static bool quartz_model_bulk(quartz_model_t *model, const uint8_t *cmd, size_t cmd_len) {
+	if (cmd_len < QUARTZ_BULK_HEADER + 2) return false;
+	uint16_t len  = quartz_get16(&cmd[1]);
+	uint32_t addr = cmd[3] | (cmd[4] << 8) | (cmd[5] << 16);
+	if (len == 0 || len > QUARTZ_BULK_CHUNK || cmd_len != (size_t) QUARTZ_BULK_HEADER + len + 2) return false;
+	if (addr + len > QUARTZ_RAM_SIZE) return false;
+	
+	// The checksum covers everything after the opcode.
+	uint16_t sum = quartz_crc16(0xffff, &cmd[1], QUARTZ_BULK_HEADER - 1 + len);
+	if (sum != quartz_get16(&cmd[QUARTZ_BULK_HEADER + len])) return false;
+	
+	quartz_model_write(model, addr, &cmd[QUARTZ_BULK_HEADER], len);
+	return true;
+}
+
+// Get the status response.
+void quartz_model_status(quartz_model_t *model, uint8_t resp[8]) {
+	uint16_t flags = 0;
+	if (model->hello == 1) flags |= QUARTZ_STATUS_HELLO;
+	if (model->fmark)      flags |= QUARTZ_STATUS_FMARK;
+	if (model->chunk_ok)   flags |= QUARTZ_STATUS_CHUNK_OK;
+	if (model->err_rx)     flags |= QUARTZ_STATUS_ERR_RX;
+	
+	// Architecture 1 revision 1, capacity for 10 tasks, none in use.
+	resp[0] = 1;
+	resp[1] = 1;
+	quartz_put16(&resp[2], 10);
+	quartz_put16(&resp[4], 0);
+	quartz_put16(&resp[6], flags);
+}
+
+// Run one command as received by the GPU: opcode, send length, receive length, then data.
+// Writes the response data and returns its length, 0 if there is none.
+size_t quartz_model_command(quartz_model_t *model, const uint8_t *cmd, size_t cmd_len, uint8_t *resp, size_t resp_cap) {
+	if (cmd_len < 1 || cmd[0] == QUARTZ_CMD_NOP) return 0;
+	
+	// Bulk chunks have their own framing, and a bad one is reported in its response only.
+	model->chunk_ok = cmd[0] == QUARTZ_CMD_BULK && quartz_model_bulk(model, cmd, cmd_len);
+	if (cmd[0] == QUARTZ_CMD_BULK) {
+		if (resp_cap < 8) return 0;
+		quartz_model_status(model, resp);
+		return 8;
+	}
+	
+	const uint8_t *data = &cmd[3];
+	size_t         len  = cmd_len >= 3 ? cmd[1] : 0;
+	if (cmd_len < 3 || cmd_len != 3 + len) {
+		model->err_rx = true;
+		len = 0;
+	}
+	
+	switch (cmd[0]) {
+		case QUARTZ_CMD_STATUS:
+			if (model->hello != 2) model->hello ++;
+			break;
+			
+		case QUARTZ_CMD_RGBLED:
+			if (len == 3) {
+				memcpy(model->led, data, 3);
+			} else {
+				model->err_rx = true;
+			}
+			break;
+			
+		case QUARTZ_CMD_FMARK:
+			// Timing is up to whoever drives the model.
+			break;
+			
+		case QUARTZ_CMD_TRIS:
+			if (len < 2 || (len - 2) % QUARTZ_TRI_SIZE) {
+				model->err_rx = true;
+				break;
+			}
+			for (size_t i = 2; i < len; i += QUARTZ_TRI_SIZE) {
+				quartz_tri_t tri = quartz_decode_tri(&data[i]);
+				quartz_model_tri(model, quartz_get16(data), &tri);
+			}
+			break;
+			
+		case QUARTZ_CMD_LINES:
+			if (len < 2 || (len - 2) % QUARTZ_LINE_SIZE) {
+				model->err_rx = true;
+				break;
+			}
+			for (size_t i = 2; i < len; i += QUARTZ_LINE_SIZE) {
+				quartz_line_t line = quartz_decode_line(&data[i]);
+				quartz_model_line(model, &line);
+			}
+			break;
+			
+		case QUARTZ_CMD_CLEAR:
+			if (len < 5) {
+				model->err_rx = true;
+				break;
+			}
+			// Like the hardware, extra data is an error but does not prevent the clear.
+			if (len > 5) model->err_rx = true;
+			for (size_t i = 0; i < QUARTZ_WIDTH * QUARTZ_HEIGHT; i++) {
+				if (data[4] & QUARTZ_CLEAR_COLOR) model->color[i] = quartz_get16(&data[0]);
+				if (data[4] & QUARTZ_CLEAR_DEPTH) model->depth[i] = quartz_get16(&data[2]);
+			}
+			break;
+			
+		case QUARTZ_CMD_SPANS:
+			// Spans are written in order; the first bad one ends the command.
+			for (size_t i = 0; i < len;) {
+				uint16_t count = len - i >= QUARTZ_SPAN_HEADER ? quartz_get16(&data[i + 4]) : 0;
+				if (len - i < (size_t) QUARTZ_SPAN_HEADER + count * 2
+						|| !quartz_model_span(model, quartz_get16(&data[i]), quartz_get16(&data[i + 2]), count, &data[i + QUARTZ_SPAN_HEADER])) {
+					model->err_rx = true;
+					break;
+				}
+				i += QUARTZ_SPAN_HEADER + count * 2;
+			}
+			break;
+			
+		case QUARTZ_CMD_MESH:
+			if (len != QUARTZ_MESH_SIZE || data[0] >= QUARTZ_MESH_SLOTS) {
+				model->err_rx = true;
+				break;
+			}
+			model->meshes[data[0]] = (quartz_mesh_def_t) {
+				.vtx_addr   = data[1] | (data[2] << 8) | (data[3] << 16),
+				.num_vertex = quartz_get16(&data[4]),
+				.tri_addr   = data[6] | (data[7] << 8) | (data[8] << 16),
+				.num_tri    = quartz_get16(&data[9]),
+			};
+			break;
+			
+		case QUARTZ_CMD_VIEW:
+			if (len != QUARTZ_VIEW_SIZE) {
+				model->err_rx = true;
+				break;
+			}
+			model->view = quartz_decode_view(data);
+			break;
+			
+		case QUARTZ_CMD_DRAW:
+			if (len < 2 || (len - 2) % QUARTZ_DRAW_SIZE) {
+				model->err_rx = true;
+				break;
+			}
+			for (size_t i = 2; i < len; i += QUARTZ_DRAW_SIZE) {
+				if (data[i] >= QUARTZ_MESH_SLOTS) {
+					model->err_rx = true;
+					continue;
+				}
+				quartz_xform_t xform = quartz_decode_xform(&data[i + 3]);
+				quartz_model_draw(model, quartz_get16(data), data[i], quartz_get16(&data[i + 1]), &xform);
+			}
+			break;
+			
+		case QUARTZ_CMD_PRESENT:
+			// Timing is up to whoever drives the model.
+			memcpy(model->lcd, model->color, sizeof(model->lcd));
+			model->presents ++;
+			if (len) model->err_rx = true;
+			break;
+			
+		default:
+			model->err_rx = true;
+			break;
+	}
+	
+	if (resp_cap < 8) return 0;
+	quartz_model_status(model, resp);
+	return 8;
+}
+
+
+
+// Clamp to a 16-bit signed value.
+static inline int16_t quartz_clamp16(int64_t value) {
+	return value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : value;
+}
+
+// Scale the channels of an RGB565 color by (shade + 1) / 256.
+static inline uint16_t quartz_shade565(uint16_t color, uint8_t shade) {
+	uint16_t r = ((color >> 11) & 31) * (shade + 1) >> 8;
+	uint16_t g = ((color >>  5) & 63) * (shade + 1) >> 8;
+	uint16_t b = ( color        & 31) * (shade + 1) >> 8;
+	return (r << 11) | (g << 5) | b;
+}
+
+// Project a vertex of a resident mesh; returns false if it is behind the plane z = 0.
+static bool quartz_model_vertex(const quartz_view_t *view, const quartz_xform_t *xform, const uint8_t raw[QUARTZ_MESH_VTX_SIZE], quartz_vtx_t *out) {
+	int16_t v[3] = { quartz_get16(&raw[0]), quartz_get16(&raw[2]), quartz_get16(&raw[4]) };
+	int32_t p[3];
+	for (int i = 0; i < 3; i++) {
+		int64_t sum = 0;
+		for (int j = 0; j < 3; j++) {
+			sum += (int32_t) xform->rot[i][j] * v[j];
+		}
+		// Like the hardware, the position wraps to 32 bits.
+		p[i] = (uint32_t) quartz_floor_shr(sum, xform->shift & 31) + (uint32_t) xform->pos[i];
+	}
+	
+	int64_t w = (int64_t) view->focal + p[2];
+	if (p[2] < 0 || w <= 0) return false;
+	int64_t z = quartz_div_sat((int64_t) view->depth_a * 256, w) + view->depth_b;
+	out->x = quartz_clamp16(view->cx + quartz_div_sat((int64_t) p[0] * view->scale, w));
+	out->y = quartz_clamp16(view->cy - quartz_div_sat((int64_t) p[1] * view->scale, w));
+	out->z = z < 1 ? 1 : z > UINT16_MAX ? UINT16_MAX : z;
+	return true;
+}
+
+// Draw a resident mesh.
+void quartz_model_draw(quartz_model_t *model, uint16_t mask, uint8_t handle, uint16_t color, const quartz_xform_t *xform) {
+	if (handle >= QUARTZ_MESH_SLOTS) return;
+	const quartz_mesh_def_t *mesh = &model->meshes[handle];
+	
+	for (uint32_t i = 0; i < mesh->num_tri; i++) {
+		uint8_t raw[QUARTZ_MESH_TRI_SIZE];
+		quartz_model_read(model, mesh->tri_addr + i * QUARTZ_MESH_TRI_SIZE, raw, sizeof(raw));
+		
+		// Triangles with a bad index or a corner behind the eye are skipped.
+		quartz_tri_t tri;
+		bool visible = true;
+		for (int j = 0; j < 3 && visible; j++) {
+			uint16_t index = quartz_get16(&raw[j * 2]);
+			uint8_t  vtx[QUARTZ_MESH_VTX_SIZE];
+			quartz_model_read(model, mesh->vtx_addr + index * QUARTZ_MESH_VTX_SIZE, vtx, sizeof(vtx));
+			visible = index < mesh->num_vertex && quartz_model_vertex(&model->view, xform, vtx, &tri.v[j]);
+		}
+		if (!visible) continue;
+		
+		// Back faces wind the other way around on the screen.
+		int64_t area = (int64_t) (tri.v[1].x - tri.v[0].x) * (tri.v[2].y - tri.v[0].y)
+		             - (int64_t) (tri.v[1].y - tri.v[0].y) * (tri.v[2].x - tri.v[0].x);
+		if (area <= 0) continue;
+		
+		// Flat shading from the stored normal.
+		int64_t dot = 0;
+		for (int j = 0; j < 3; j++) {
+			dot += xform->light[j] * (int8_t) raw[6 + j];
+		}
+		int64_t shade = 155 - quartz_floor_shr(dot * 100, 22);
+		tri.color = quartz_shade565(color, shade < 0 ? 0 : shade > 255 ? 255 : shade);
+		quartz_model_tri(model, mask, &tri);
+	}
+}
+
+// Rasterize a triangle.
+void quartz_model_tri(quartz_model_t *model, uint16_t mask, const quartz_tri_t *tri) {
+	int32_t x[3], y[3], z[3];
+	for (int i = 0; i < 3; i++) {
+		x[i] = tri->v[i].x;
+		y[i] = tri->v[i].y;
+		z[i] = tri->v[i].z;
+	}
+	
+	// Make the winding positive so the inside is where all edges are positive.
+	int64_t area = (int64_t) (x[1] - x[0]) * (y[2] - y[0]) - (int64_t) (y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0) return;
+	if (area < 0) {
+		int32_t tmp;
+		tmp = x[1]; x[1] = x[2]; x[2] = tmp;
+		tmp = y[1]; y[1] = y[2]; y[2] = tmp;
+		tmp = z[1]; z[1] = z[2]; z[2] = tmp;
+		area = -area;
+	}
+	
+	// Pixels whose centers may be covered.
+	int32_t min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+	for (int i = 1; i < 3; i++) {
+		if (x[i] < min_x) min_x = x[i];
+		if (x[i] > max_x) max_x = x[i];
+		if (y[i] < min_y) min_y = y[i];
+		if (y[i] > max_y) max_y = y[i];
+	}
+	int32_t x0 = -quartz_floor_shr(8 - min_x, 4);
+	int32_t x1 =  quartz_floor_shr(max_x - 8, 4);
+	int32_t y0 = -quartz_floor_shr(8 - min_y, 4);
+	int32_t y1 =  quartz_floor_shr(max_y - 8, 4);
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > QUARTZ_WIDTH  - 1) x1 = QUARTZ_WIDTH  - 1;
+	if (y1 > QUARTZ_HEIGHT - 1) y1 = QUARTZ_HEIGHT - 1;
+	if (x0 > x1 || y0 > y1) return;
+	int32_t px = x0 * 16 + 8;
+	int32_t py = y0 * 16 + 8;
+	
+	// Edge i lies opposite vertex i; it equals `area` at vertex i and 0 on the edge.
+	int64_t edge[3], step_x[3], step_y[3];
+	for (int i = 0; i < 3; i++) {
+		int a = (i + 1) % 3, b = (i + 2) % 3;
+		int32_t dx = x[b] - x[a];
+		int32_t dy = y[b] - y[a];
+		// Top-left rule: centers exactly on any other edge belong to the neighbour.
+		bool top_left = dy < 0 || (dy == 0 && dx > 0);
+		edge[i]   = (int64_t) dx * (py - y[a]) - (int64_t) dy * (px - x[a]) - !top_left;
+		step_x[i] = -16 * (int64_t) dy;
+		step_y[i] =  16 * (int64_t) dx;
+	}
+	
+	// Depth gradients in 16.16 per pixel, from the weights of vertex 1 and 2.
+	int64_t dz1   = z[1] - z[0];
+	int64_t dz2   = z[2] - z[0];
+	int64_t dzdx  = quartz_div_sat((dz1 * step_x[1] + dz2 * step_x[2]) * 65536, area);
+	int64_t dzdy  = quartz_div_sat((dz1 * step_y[1] + dz2 * step_y[2]) * 65536, area);
+	int64_t z_row = (int64_t) z[0] * 65536 + quartz_floor_shr(dzdx * (px - x[0]) + dzdy * (py - y[0]), 4);
+	
+	quartz_pixel_t pixel = {
+		.color = tri->color,
+		.mask  = mask,
+		.op    = QUARTZ_PIX_DEPTH,
+	};
+	for (int32_t cy = y0; cy <= y1; cy++) {
+		int64_t e0 = edge[0], e1 = edge[1], e2 = edge[2];
+		int64_t zc = z_row;
+		for (int32_t cx = x0; cx <= x1; cx++) {
+			if (e0 >= 0 && e1 >= 0 && e2 >= 0) {
+				int64_t depth = quartz_floor_shr(zc, 16);
+				pixel.x = cx;
+				pixel.y = cy;
+				pixel.z = depth < 0 ? 0 : depth > UINT16_MAX ? UINT16_MAX : depth;
+				quartz_model_emit(model, &pixel);
+			}
+			e0 += step_x[0];
+			e1 += step_x[1];
+			e2 += step_x[2];
+			zc += dzdx;
+		}
+		edge[0] += step_y[0];
+		edge[1] += step_y[1];
+		edge[2] += step_y[2];
+		z_row   += dzdy;
+	}
+}
+
+// Rasterize a line.
+void quartz_model_line(quartz_model_t *model, const quartz_line_t *line) {
+	// Endpoints are the pixels they fall in.
+	int32_t x0 = quartz_floor_shr(line->x0, 4);
+	int32_t y0 = quartz_floor_shr(line->y0, 4);
+	int32_t x1 = quartz_floor_shr(line->x1, 4);
+	int32_t y1 = quartz_floor_shr(line->y1, 4);
+	
+	// Bresenham over all octants.
+	int32_t dx  =  abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+	int32_t dy  = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+	int32_t err = dx + dy;
+	
+	quartz_pixel_t pixel = {
+		.color = line->color,
+		.mask  = 0xffff,
+		.op    = QUARTZ_PIX_MAX,
+	};
+	while (true) {
+		if (x0 >= 0 && x0 < QUARTZ_WIDTH && y0 >= 0 && y0 < QUARTZ_HEIGHT) {
+			pixel.x = x0;
+			pixel.y = y0;
+			quartz_model_emit(model, &pixel);
+		}
+		if (x0 == x1 && y0 == y1) break;
+		int32_t e2 = 2 * err;
+		if (e2 >= dy) { err += dy; x0 += sx; }
+		if (e2 <= dx) { err += dx; y0 += sy; }
+	}
+}
+
+// Write a pixel to the color and depth buffers.
+void quartz_model_pixel(quartz_model_t *model, const quartz_pixel_t *pixel) {
+	if (pixel->x >= QUARTZ_WIDTH || pixel->y >= QUARTZ_HEIGHT) return;
+	size_t i = pixel->x + pixel->y * QUARTZ_WIDTH;
+	
+	if (pixel->op == QUARTZ_PIX_MAX) {
+		model->color[i] = quartz_max565(model->color[i], pixel->color);
+	} else if (pixel->z > model->depth[i]) {
+		model->depth[i] = pixel->z;
+		model->color[i] = (pixel->color & pixel->mask) | (model->color[i] & ~pixel->mask);
+	}
+}
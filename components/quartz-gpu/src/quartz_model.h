@@ -0,0 +1,118 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#ifndef QUARTZ_MODEL_H
+#define QUARTZ_MODEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "quartz_types.h"
+
+// Software model of the Quartz command processor, the reference the RTL is written to match.
+// Portable C, so it builds on Linux to check rendering without hardware; fpga/sim checks the RTL against it.
+
+// A resident mesh, as defined by QUARTZ_CMD_MESH.
+typedef struct {
+	// Address of the vertices in RAM.
+	uint32_t vtx_addr;
+	// Amount of vertices; triangles using others are not drawn.
+	uint16_t num_vertex;
+	// Address of the triangles in RAM.
+	uint32_t tri_addr;
+	// Amount of triangles, 0 if the handle is not in use.
+	uint16_t num_tri;
+} quartz_mesh_def_t;
+
+// State of the emulated GPU.
+typedef struct {
+	// Color of every pixel, RGB565.
+	uint16_t color[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+	// Reciprocal depth of every pixel, larger is closer.
+	uint16_t depth[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+	// What the LCD shows, as of the last QUARTZ_CMD_PRESENT.
+	uint16_t lcd[QUARTZ_WIDTH * QUARTZ_HEIGHT];
+	
+	// RGB LED color.
+	uint8_t  led[3];
+	// Hello handshake counter.
+	uint8_t  hello;
+	// Whether the tearing effect line is active.
+	bool     fmark;
+	// Receive error flag.
+	bool     err_rx;
+	// Whether the last command was an intact QUARTZ_CMD_BULK chunk.
+	bool     chunk_ok;
+	
+	// RAM from QUARTZ_RAM_FREE on, may be NULL; writes past it are dropped.
+	uint8_t *ram;
+	// Size of `ram` in bytes.
+	size_t   ram_size;
+	
+	// Resident meshes by handle.
+	quartz_mesh_def_t meshes[QUARTZ_MESH_SLOTS];
+	// Projection of resident meshes.
+	quartz_view_t     view;
+	
+	// Called for every pixel the rasterizers produce, before it is written; may be NULL.
+	void   (*pixel_cb)(void *args, const quartz_pixel_t *pixel);
+	// Passed to the pixel callback.
+	void    *pixel_args;
+	// Amount of pixels produced.
+	uint32_t pixels;
+	// Amount of frames sent to the LCD.
+	uint32_t presents;
+} quartz_model_t;
+
+// Initialise the model as if the GPU just started.
+void   quartz_model_init   (quartz_model_t *model);
+// Fill the color and depth buffers.
+void   quartz_model_clear  (quartz_model_t *model, uint16_t color, uint16_t depth);
+// Write a horizontal run of pixels to the color buffer; returns false if it is not on the screen.
+bool   quartz_model_span   (quartz_model_t *model, uint16_t x, uint16_t y, uint16_t len, const uint8_t *data);
+// Run one command as received by the GPU: opcode, send length, receive length, then data.
+// Writes the response data and returns its length, 0 if there is none.
+size_t quartz_model_command(quartz_model_t *model, const uint8_t *cmd, size_t cmd_len, uint8_t *resp, size_t resp_cap);
+// Write bytes to the GPU's RAM, which includes the color and depth planes.
+void   quartz_model_write  (quartz_model_t *model, uint32_t addr, const uint8_t *data, size_t len);
+// Read bytes from the GPU's RAM; what is not modelled reads as 0.
+void   quartz_model_read   (quartz_model_t *model, uint32_t addr, uint8_t *data, size_t len);
+// Get the status response.
+void   quartz_model_status (quartz_model_t *model, uint8_t resp[8]);
+
+// Rasterize a triangle.
+void   quartz_model_tri    (quartz_model_t *model, uint16_t mask, const quartz_tri_t *tri);
+// Rasterize a line.
+void   quartz_model_line   (quartz_model_t *model, const quartz_line_t *line);
+// Draw a resident mesh.
+void   quartz_model_draw   (quartz_model_t *model, uint16_t mask, uint8_t handle, uint16_t color, const quartz_xform_t *xform);
+// Write a pixel to the color and depth buffers.
+void   quartz_model_pixel  (quartz_model_t *model, const quartz_pixel_t *pixel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUARTZ_MODEL_H
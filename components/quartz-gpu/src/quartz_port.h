@@ -0,0 +1,96 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#ifndef QUARTZ_PORT_H
+#define QUARTZ_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// What the portable parts of quartz need from the platform: logging, time and a transport.
+
+#ifdef ESP_PLATFORM
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define QUARTZ_LOGE(tag, ...) ESP_LOGE(tag, __VA_ARGS__)
+#define QUARTZ_LOGW(tag, ...) ESP_LOGW(tag, __VA_ARGS__)
+#define QUARTZ_LOGI(tag, ...) ESP_LOGI(tag, __VA_ARGS__)
+
+// Get the time in microseconds.
+static inline int64_t quartz_time_us() {
+	return esp_timer_get_time();
+}
+
+#else
+
+#include <stdio.h>
+#include <time.h>
+
+// Whether to print log messages on the host.
+#ifndef QUARTZ_HOST_LOG
+#define QUARTZ_HOST_LOG 1
+#endif
+
+#define QUARTZ_LOG(level, tag, fmt, ...) do { \
+		if (QUARTZ_HOST_LOG) fprintf(stderr, level " (%s) " fmt "\n", tag, ##__VA_ARGS__); \
+	} while (0)
+#define QUARTZ_LOGE(tag, fmt, ...) QUARTZ_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define QUARTZ_LOGW(tag, fmt, ...) QUARTZ_LOG("W", tag, fmt, ##__VA_ARGS__)
+#define QUARTZ_LOGI(tag, fmt, ...) QUARTZ_LOG("I", tag, fmt, ##__VA_ARGS__)
+
+// Get the time in microseconds.
+static inline int64_t quartz_time_us() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+#endif
+
+
+
+// The link to the GPU: an SPI bus and the GPU's interrupt line.
+typedef struct {
+	// Do one full-duplex transaction, with chip select held throughout.
+	// Returns false if the bus failed.
+	bool (*transfer)(void *args, const void *tx, void *rx, size_t length);
+	// Wait for the GPU to signal it has a response.
+	// Wait time in milliseconds, returns false on timeout.
+	bool (*await)   (void *args, uint64_t wait_time);
+	// Passed to the callbacks.
+	void  *args;
+} quartz_transport_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUARTZ_PORT_H
@@ -0,0 +1,180 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz_proto.h"
+#include "quartz_trace.h"
+#include <string.h>
+
+static const char *TAG = "quartz";
+
+// Some temporary buffers for sending and receiving, large enough for a bulk chunk.
+static uint8_t tx_buf[QUARTZ_BULK_HEADER + QUARTZ_BULK_CHUNK + 2];
+static uint8_t rx_buf[QUARTZ_BULK_HEADER + QUARTZ_BULK_CHUNK + 2];
+
+// Compute the quartz checksum over a number of bytes.
+uint8_t quartz_checksum(const void *mem, size_t length) {
+	const uint8_t *arr = mem;
+	uint8_t current = 0xcc;
+	for (size_t i = 0; i < length; i++) {
+		current = current ^ arr[i];
+	}
+	return current;
+}
+
+// Finish the trace entry of a command, dumping the trace ring if it failed.
+static inline bool quartz_proto_end(quartz_trace_t *trace, quartz_trace_result_t result) {
+#if QUARTZ_TRACE
+	trace->result     = result;
+	trace->latency_us = quartz_time_us() - trace->time_us;
+	quartz_trace_add(trace);
+	if (QUARTZ_TRACE_ON_ERROR && result != QUARTZ_TRACE_OK) quartz_trace_dump();
+#endif
+	return result == QUARTZ_TRACE_OK;
+}
+
+// Send the command in tx_buf, then wait for the response and check it.
+static quartz_trace_result_t quartz_proto_exchange(const quartz_transport_t *transport, quartz_trace_t *trace, size_t send, uint8_t recv, void *recv_buf) {
+	// Send stuff to the FPGA.
+	if (!transport->transfer(transport->args, tx_buf, rx_buf, send)) {
+		return QUARTZ_TRACE_ERR_SEND;
+	}
+	
+	// Await receivement time.
+	if (!transport->await(transport->args, 100)) {
+		QUARTZ_LOGE(TAG, "Comms error: Timeout waiting for response.");
+		return QUARTZ_TRACE_ERR_TIMEOUT;
+	}
+	
+	// Clear out send data.
+	memset(tx_buf, 0, recv+2);
+	if (!transport->transfer(transport->args, tx_buf, rx_buf, recv+2)) {
+		return QUARTZ_TRACE_ERR_RECV;
+	}
+	
+	// Calculate checksum over received.
+	uint8_t real_sum = quartz_checksum(rx_buf, 1+recv);
+	trace->sum_host = real_sum;
+	trace->sum_gpu  = rx_buf[1+recv];
+	if (recv >= 8) trace->status = quartz_get16(&rx_buf[7]);
+	
+	// Confirm checksum.
+	if (real_sum != rx_buf[1+recv]) {
+		// Checksum mismatch.
+		QUARTZ_LOGE(TAG, "Comms error: Checksum mismatch (host's sum: %02x, GPU's sum: %02x)", real_sum, rx_buf[1+recv]);
+		return QUARTZ_TRACE_ERR_CHECKSUM;
+		
+	} else {
+		// Successfull communication.
+		memcpy(recv_buf, &rx_buf[1], recv);
+		return QUARTZ_TRACE_OK;
+	}
+}
+
+// Send a raw quartz command over a transport; not thread safe.
+// Returns whether the message was successfully received.
+bool quartz_proto_cmd(const quartz_transport_t *transport, quartz_cmd_t opcode, uint8_t send, const void *send_buf, uint8_t recv, void *recv_buf) {
+	quartz_trace_t trace = {
+		.opcode = opcode,
+		.send   = send,
+		.recv   = recv,
+	};
+	if (QUARTZ_TRACE) trace.time_us = quartz_time_us();
+	
+	// Prepare send headers.
+	tx_buf[0] = opcode;
+	tx_buf[1] = send;
+	tx_buf[2] = recv;
+	// Insert send data.
+	memcpy(&tx_buf[3], send_buf, send);
+	
+	return quartz_proto_end(&trace, quartz_proto_exchange(transport, &trace, 3+send, recv, recv_buf));
+}
+
+// Send one QUARTZ_CMD_BULK chunk; returns whether the GPU took it.
+static bool quartz_proto_chunk(const quartz_transport_t *transport, uint32_t addr, const uint8_t *data, uint16_t len) {
+	quartz_trace_t trace = {
+		.opcode = QUARTZ_CMD_BULK,
+		.send   = len > UINT8_MAX ? UINT8_MAX : len,
+		.recv   = 8,
+	};
+	if (QUARTZ_TRACE) trace.time_us = quartz_time_us();
+	
+	// Header, data and a checksum over everything after the opcode.
+	tx_buf[0] = QUARTZ_CMD_BULK;
+	quartz_put16(&tx_buf[1], len);
+	tx_buf[3] = addr;
+	tx_buf[4] = addr >> 8;
+	tx_buf[5] = addr >> 16;
+	memcpy(&tx_buf[QUARTZ_BULK_HEADER], data, len);
+	quartz_put16(&tx_buf[QUARTZ_BULK_HEADER + len], quartz_crc16(0xffff, &tx_buf[1], QUARTZ_BULK_HEADER - 1 + len));
+	
+	uint8_t resp[8];
+	quartz_trace_result_t result = quartz_proto_exchange(transport, &trace, QUARTZ_BULK_HEADER + len + 2, sizeof(resp), resp);
+	if (result == QUARTZ_TRACE_OK && !(quartz_get16(&resp[6]) & QUARTZ_STATUS_CHUNK_OK)) {
+		QUARTZ_LOGW(TAG, "Comms error: Bulk chunk at %06x rejected", (unsigned) addr);
+		result = QUARTZ_TRACE_ERR_CHUNK;
+	}
+	return quartz_proto_end(&trace, result);
+}
+
+// Write any amount of data to the GPU's RAM in QUARTZ_CMD_BULK chunks; not thread safe.
+// A damaged chunk is sent again, up to QUARTZ_BULK_RETRIES times, and in halves to better its odds;
+// the chunks grow again after 8 arrive intact in a row. Returns whether all of it arrived.
+bool quartz_proto_bulk(const quartz_transport_t *transport, uint32_t addr, const void *data, size_t len) {
+	const uint8_t *ptr     = data;
+	uint16_t       max_len = QUARTZ_BULK_CHUNK;
+	int            tries   = 0;
+	int            streak  = 0;
+	while (len) {
+		uint16_t chunk = len > max_len ? max_len : len;
+		if (!quartz_proto_chunk(transport, addr, ptr, chunk)) {
+			if (++tries > QUARTZ_BULK_RETRIES) return false;
+			if (max_len > QUARTZ_BULK_CHUNK / 16) max_len /= 2;
+			streak = 0;
+			continue;
+		}
+		tries = 0;
+		if (++streak >= 8 && max_len < QUARTZ_BULK_CHUNK) {
+			max_len *= 2;
+			streak   = 0;
+		}
+		addr += chunk;
+		ptr  += chunk;
+		len  -= chunk;
+	}
+	return true;
+}
+
+// Decode a status response.
+quartz_status_t quartz_decode_status(const uint8_t *rx) {
+	return (quartz_status_t) {
+		.rx_valid     = true,
+		
+		.arch_no      = rx[0],
+		.rev_no       = rx[1],
+		.task_cap     = rx[2] | (rx[3] << 8),
+		.task_num     = rx[4] | (rx[5] << 8),
+		.status_flags = rx[6] | (rx[7] << 8),
+	};
+}
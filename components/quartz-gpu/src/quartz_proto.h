@@ -0,0 +1,61 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#ifndef QUARTZ_PROTO_H
+#define QUARTZ_PROTO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "quartz_types.h"
+#include "quartz_port.h"
+
+// The host side of the command protocol, independent of the transport.
+// A command is two transactions:
+// - opcode, send length, receive length and the data, after which the GPU raises its interrupt;
+// - the response: available length, the data and a checksum.
+// QUARTZ_CMD_BULK replaces the first with its own framing, see quartz_types.h.
+
+// How many times a bulk chunk is sent again before giving up.
+#ifndef QUARTZ_BULK_RETRIES
+#define QUARTZ_BULK_RETRIES 3
+#endif
+
+// Compute the quartz checksum over a number of bytes.
+uint8_t         quartz_checksum     (const void *mem, size_t length);
+// Send a raw quartz command over a transport; not thread safe.
+// Returns whether the message was successfully received.
+bool            quartz_proto_cmd    (const quartz_transport_t *transport, quartz_cmd_t opcode, uint8_t send, const void *send_buf, uint8_t recv, void *recv_buf);
+// Write any amount of data to the GPU's RAM in QUARTZ_CMD_BULK chunks; not thread safe.
+// Damaged chunks are sent again in halves, up to QUARTZ_BULK_RETRIES times; returns whether all of it arrived.
+bool            quartz_proto_bulk   (const quartz_transport_t *transport, uint32_t addr, const void *data, size_t len);
+// Decode a status response.
+quartz_status_t quartz_decode_status(const uint8_t *rx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUARTZ_PROTO_H
@@ -0,0 +1,79 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "quartz_trace.h"
+
+#if QUARTZ_TRACE
+
+#include <stdio.h>
+
+// The last QUARTZ_TRACE_LEN commands.
+static quartz_trace_t quartz_trace_ring[QUARTZ_TRACE_LEN];
+// Amount of commands ever recorded; the next one goes at this index modulo the length.
+static uint32_t       quartz_trace_count;
+
+// Record a command in the trace ring.
+void quartz_trace_add(const quartz_trace_t *entry) {
+	quartz_trace_ring[quartz_trace_count % QUARTZ_TRACE_LEN] = *entry;
+	quartz_trace_count ++;
+}
+
+// Print the trace ring as hex, oldest first, on lines starting with "QTRACE:".
+// Decode the output with host/quartz_trace.py.
+void quartz_trace_dump() {
+	// Copy it out first, in case commands are being sent while printing.
+	static quartz_trace_t copy[QUARTZ_TRACE_LEN];
+	uint32_t count = quartz_trace_count;
+	uint32_t first = count > QUARTZ_TRACE_LEN ? count - QUARTZ_TRACE_LEN : 0;
+	for (uint32_t i = first; i < count; i++) {
+		copy[i - first] = quartz_trace_ring[i % QUARTZ_TRACE_LEN];
+	}
+	
+	// Header: format version, entry size, amount of entries and commands recorded in total.
+	printf("QTRACE:begin %d %d %u %u\n", QUARTZ_TRACE_VERSION, QUARTZ_TRACE_SIZE, (unsigned) (count - first), (unsigned) count);
+	for (uint32_t i = 0; i < count - first; i++) {
+		const quartz_trace_t *entry = &copy[i];
+		uint8_t raw[QUARTZ_TRACE_SIZE];
+		quartz_put16(&raw[0],  entry->time_us);
+		quartz_put16(&raw[2],  entry->time_us >> 16);
+		quartz_put16(&raw[4],  entry->latency_us);
+		quartz_put16(&raw[6],  entry->latency_us >> 16);
+		raw[8]  = entry->opcode;
+		raw[9]  = entry->send;
+		raw[10] = entry->recv;
+		raw[11] = entry->result;
+		quartz_put16(&raw[12], entry->status);
+		raw[14] = entry->sum_host;
+		raw[15] = entry->sum_gpu;
+		
+		char hex[QUARTZ_TRACE_SIZE * 2 + 1];
+		for (int x = 0; x < QUARTZ_TRACE_SIZE; x++) {
+			snprintf(&hex[x * 2], 3, "%02x", raw[x]);
+		}
+		printf("QTRACE:%s\n", hex);
+	}
+	printf("QTRACE:end\n");
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#ifndef QUARTZ_TRACE_H
+#define QUARTZ_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "quartz_types.h"
+#include "quartz_port.h"
+
+// Whether commands are recorded in the trace ring; without it, tracing compiles to nothing.
+#ifndef QUARTZ_TRACE
+#define QUARTZ_TRACE            1
+#endif
+// Amount of commands the trace ring remembers.
+#ifndef QUARTZ_TRACE_LEN
+#define QUARTZ_TRACE_LEN        64
+#endif
+// Whether the trace ring is dumped when a command fails.
+#ifndef QUARTZ_TRACE_ON_ERROR
+#define QUARTZ_TRACE_ON_ERROR   1
+#endif
+
+// Version of the dump format, see quartz_trace_dump.
+#define QUARTZ_TRACE_VERSION    1
+// Size of an encoded quartz_trace_t.
+#define QUARTZ_TRACE_SIZE       16
+
+// How a command ended.
+typedef enum {
+	// The response was received correctly.
+	QUARTZ_TRACE_OK,
+	// The transport failed while sending the command.
+	QUARTZ_TRACE_ERR_SEND,
+	// The GPU did not raise its interrupt in time.
+	QUARTZ_TRACE_ERR_TIMEOUT,
+	// The transport failed while receiving the response.
+	QUARTZ_TRACE_ERR_RECV,
+	// The response checksum did not match.
+	QUARTZ_TRACE_ERR_CHECKSUM,
+	// The GPU did not receive a bulk chunk intact.
+	QUARTZ_TRACE_ERR_CHUNK,
+} quartz_trace_result_t;
+
+// One command in the trace ring.
+// Encoded as u32 time, u32 latency, u8 opcode, u8 send, u8 recv, u8 result,
+// u16 status flags, u8 host's checksum, u8 GPU's checksum, all little endian.
+typedef struct {
+	// When the command started, in microseconds, wrapping.
+	uint32_t time_us;
+	// How long the command took, in microseconds.
+	uint32_t latency_us;
+	// The command sent.
+	uint8_t  opcode;
+	// Amount of bytes sent and asked for; bulk chunks show at most 255.
+	uint8_t  send, recv;
+	// How the command ended, a quartz_trace_result_t.
+	uint8_t  result;
+	// Status flags from the response, if it had at least 8 bytes.
+	uint16_t status;
+	// Checksum computed by the host and sent by the GPU, if a response arrived.
+	uint8_t  sum_host, sum_gpu;
+} quartz_trace_t;
+
+#if QUARTZ_TRACE
+
+// Record a command in the trace ring.
+void quartz_trace_add (const quartz_trace_t *entry);
+// Print the trace ring as hex, oldest first, on lines starting with "QTRACE:".
+// Decode the output with host/quartz_trace.py.
+void quartz_trace_dump();
+
+#else
+
+#define quartz_trace_add(entry) ((void) 0)
+#define quartz_trace_dump()     ((void) 0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUARTZ_TRACE_H
@@ -29,7 +29,9 @@
 extern "C" {
 #endif
 
-#include <pax_gfx.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 
 
@@ -41,6 +43,10 @@ extern "C" {
 #define QUARTZ_STATUS_ACCEPTING	0x0004
 // This is the first status request since GPU startup.
 #define QUARTZ_STATUS_HELLO     0x0008
+// The LCD's tearing effect line is active (the panel is in vertical blanking).
+#define QUARTZ_STATUS_FMARK     0x0010
+// The command this responds to was a QUARTZ_CMD_BULK chunk that arrived intact.
+#define QUARTZ_STATUS_CHUNK_OK  0x0020
 
 // A previous command was received incorrectly (invalid checksum or length, etc).
 #define QUARTZ_STATUS_ERR_RX	0x0100
@@ -48,6 +54,60 @@ extern "C" {
 // A mask of all error status flags.
 #define QUARTZ_ERROR_MASK       0xff00
 
+// Size of the screen the GPU draws to.
+#define QUARTZ_WIDTH            320
+#define QUARTZ_HEIGHT           240
+
+// Most data a single command can send.
+#define QUARTZ_MAX_SEND         252
+// Size of an encoded quartz_tri_t.
+#define QUARTZ_TRI_SIZE         20
+// Size of an encoded quartz_line_t.
+#define QUARTZ_LINE_SIZE        10
+// Most triangles a single QUARTZ_CMD_TRIS can send.
+#define QUARTZ_TRI_BATCH        ((QUARTZ_MAX_SEND - 2) / QUARTZ_TRI_SIZE)
+// Most lines a single QUARTZ_CMD_LINES can send.
+#define QUARTZ_LINE_BATCH       ((QUARTZ_MAX_SEND - 2) / QUARTZ_LINE_SIZE)
+// Size of the header of a span in QUARTZ_CMD_SPANS.
+#define QUARTZ_SPAN_HEADER      6
+// Most pixels a single QUARTZ_CMD_SPANS can send.
+#define QUARTZ_SPAN_BATCH       ((QUARTZ_MAX_SEND - QUARTZ_SPAN_HEADER) / 2)
+
+// Size of the header of a QUARTZ_CMD_BULK chunk, opcode included.
+#define QUARTZ_BULK_HEADER      6
+// Most data a single QUARTZ_CMD_BULK chunk can send.
+#define QUARTZ_BULK_CHUNK       2048
+
+// Size of the GPU's RAM.
+#define QUARTZ_RAM_SIZE         0x800000
+// Where the framebuffer's color and depth planes are in RAM, pixel (x, y) at 2*(y*QUARTZ_WIDTH+x).
+#define QUARTZ_RAM_COLOR        0x000000
+#define QUARTZ_RAM_DEPTH        0x040000
+// Start of the RAM that is free for other data.
+#define QUARTZ_RAM_FREE         0x080000
+
+// Amount of resident meshes the GPU can keep track of.
+#define QUARTZ_MESH_SLOTS       64
+// Size of an encoded vertex of a resident mesh: i16 x, y, z.
+#define QUARTZ_MESH_VTX_SIZE    6
+// Size of an encoded triangle of a resident mesh: u16 vertex indices[3], i8 normal[3], u8 unused.
+// The normal is a 1.7 fixed-point unit vector, used for lighting.
+#define QUARTZ_MESH_TRI_SIZE    10
+// Size of an encoded QUARTZ_CMD_MESH.
+#define QUARTZ_MESH_SIZE        11
+// Size of an encoded quartz_view_t.
+#define QUARTZ_VIEW_SIZE        18
+// Size of an encoded quartz_xform_t.
+#define QUARTZ_XFORM_SIZE       37
+// Size of a single draw in QUARTZ_CMD_DRAW: u8 handle, u16 color, quartz_xform_t.
+#define QUARTZ_DRAW_SIZE        (3 + QUARTZ_XFORM_SIZE)
+// Most draws a single QUARTZ_CMD_DRAW can send.
+#define QUARTZ_DRAW_BATCH       ((QUARTZ_MAX_SEND - 2) / QUARTZ_DRAW_SIZE)
+
+// Planes written by QUARTZ_CMD_CLEAR.
+#define QUARTZ_CLEAR_COLOR      0x01
+#define QUARTZ_CLEAR_DEPTH      0x02
+
 
 
 // A command that can be issued.
@@ -60,6 +120,37 @@ typedef enum {
 	// Set the color of the RGB LED.
 	// u8 r, u8 g, u8 b -> quartz_status_t
 	QUARTZ_CMD_RGBLED = 0x02,
+	// Wait for the start of the LCD's next tearing effect pulse, then get status.
+	// none -> quartz_status_t
+	QUARTZ_CMD_FMARK  = 0x03,
+	// Draw depth tested triangles, keeping the existing color outside of the write mask.
+	// u16 mask, quartz_tri_t[] -> quartz_status_t
+	QUARTZ_CMD_TRIS   = 0x04,
+	// Draw lines, blending with the per-channel maximum.
+	// u16 unused, quartz_line_t[] -> quartz_status_t
+	QUARTZ_CMD_LINES  = 0x05,
+	// Fill planes of the framebuffer.
+	// u16 color, u16 depth, u8 planes -> quartz_status_t
+	QUARTZ_CMD_CLEAR  = 0x06,
+	// Write horizontal runs of pixels to the framebuffer's color plane.
+	// (u16 x, u16 y, u16 length, u16 color[length])[] -> quartz_status_t
+	QUARTZ_CMD_SPANS  = 0x07,
+	// Send the framebuffer to the LCD, starting at the next tearing effect pulse.
+	// none -> quartz_status_t, once the whole frame is sent
+	QUARTZ_CMD_PRESENT = 0x08,
+	// Write a chunk of data to the GPU's RAM, with its own framing and a quartz_crc16:
+	// u8 opcode, u16 length, u24 address, u8 data[length], u16 crc -> quartz_status_t
+	// The response comes once the GPU can take the next chunk; check QUARTZ_STATUS_CHUNK_OK.
+	QUARTZ_CMD_BULK   = 0x09,
+	// Define a resident mesh from vertices and triangles in RAM; a triangle count of 0 forgets it.
+	// u8 handle, u24 vertex address, u16 vertex count, u24 triangle address, u16 triangle count -> quartz_status_t
+	QUARTZ_CMD_MESH   = 0x0a,
+	// Set the projection used by QUARTZ_CMD_DRAW.
+	// quartz_view_t -> quartz_status_t
+	QUARTZ_CMD_VIEW   = 0x0b,
+	// Draw resident meshes with depth tested, lit and back-face culled triangles.
+	// u16 mask, (u8 handle, u16 color, quartz_xform_t)[] -> quartz_status_t
+	QUARTZ_CMD_DRAW   = 0x0c,
 } quartz_cmd_t;
 
 
@@ -81,6 +172,215 @@ typedef struct {
 	uint16_t status_flags;
 } quartz_status_t;
 
+// A vertex of a triangle, as sent to the GPU.
+// Coordinates are 12.4 fixed-point pixels; pixel (X, Y) has its center at (16X+8, 16Y+8).
+typedef struct {
+	// Screen position.
+	int16_t  x, y;
+	// Reciprocal depth, larger is closer.
+	uint16_t z;
+} quartz_vtx_t;
+
+// A triangle, as sent to the GPU.
+// Encoded as 3 x (i16 x, i16 y, u16 z), u16 color, all little endian.
+typedef struct {
+	// The corners.
+	quartz_vtx_t v[3];
+	// RGB565 color.
+	uint16_t     color;
+} quartz_tri_t;
+
+// A line, as sent to the GPU.
+// Encoded as i16 x0, i16 y0, i16 x1, i16 y1, u16 color, all little endian.
+typedef struct {
+	// Start and end in 12.4 fixed-point pixels.
+	int16_t  x0, y0, x1, y1;
+	// RGB565 color.
+	uint16_t color;
+} quartz_line_t;
+
+// Projection of QUARTZ_CMD_DRAW, from the eye's space to the screen.
+// A point (x, y, z) is at distance w = focal + z, points with negative z are not drawn.
+// It goes to (cx + x * scale / w, cy - y * scale / w) with reciprocal depth depth_a / w + depth_b.
+// Positions are 16.16 fixed-point, divisions truncate towards zero.
+// Encoded as i32 focal, i16 scale, i16 cx, i16 cy, i32 depth_a, i32 depth_b, all little endian.
+typedef struct {
+	// Distance from the eye to the plane z = 0, 16.16 fixed-point.
+	int32_t focal;
+	// Screen size of a unit at the focal distance, in 12.4 fixed-point pixels.
+	int16_t scale;
+	// Screen position of the view's center, in 12.4 fixed-point pixels.
+	int16_t cx, cy;
+	// Reciprocal depth parameters, depth_a in 24.8 fixed-point.
+	int32_t depth_a, depth_b;
+} quartz_view_t;
+
+// Placement of a resident mesh, from the mesh's space to the eye's space.
+// Vertex v goes to rot * v / 2^shift + pos, in 16.16 fixed-point, rounding towards negative infinity.
+// Encoded as i16 rot[3][3] row by row, u8 shift, i32 pos[3], i16 light[3], all little endian.
+typedef struct {
+	// Linear part.
+	int16_t rot[3][3];
+	// Amount of bits to shift the linear part right by, at most 31.
+	uint8_t shift;
+	// Translation, 16.16 fixed-point.
+	int32_t pos[3];
+	// Light direction in the mesh's space as a 1.15 fixed-point unit vector.
+	// A triangle's color is scaled by (shade + 1) / 256, with shade = 155 - 100 * dot(light, normal).
+	int16_t light[3];
+} quartz_xform_t;
+
+// How a pixel from the rasterizers is written.
+typedef enum {
+	// Write if closer than the stored depth, within the write mask.
+	QUARTZ_PIX_DEPTH,
+	// Blend with the per-channel maximum, ignoring depth.
+	QUARTZ_PIX_MAX,
+} quartz_pix_op_t;
+
+// A pixel produced by the rasterizers.
+typedef struct {
+	// Position on the screen.
+	uint16_t        x, y;
+	// Reciprocal depth, larger is closer.
+	uint16_t        z;
+	// RGB565 color.
+	uint16_t        color;
+	// Channels to write for QUARTZ_PIX_DEPTH.
+	uint16_t        mask;
+	// How to write the pixel.
+	quartz_pix_op_t op;
+} quartz_pixel_t;
+
+
+
+// Store a little endian 16-bit value.
+static inline void quartz_put16(uint8_t *out, uint16_t value) {
+	out[0] = value;
+	out[1] = value >> 8;
+}
+
+// Load a little endian 16-bit value.
+static inline uint16_t quartz_get16(const uint8_t *in) {
+	return in[0] | (in[1] << 8);
+}
+
+// Store a little endian 32-bit value.
+static inline void quartz_put32(uint8_t *out, uint32_t value) {
+	quartz_put16(out,     value);
+	quartz_put16(out + 2, value >> 16);
+}
+
+// Load a little endian 32-bit value.
+static inline uint32_t quartz_get32(const uint8_t *in) {
+	return quartz_get16(in) | ((uint32_t) quartz_get16(in + 2) << 16);
+}
+
+// Continue a QUARTZ_CMD_BULK checksum: CRC-16/CCITT, polynomial 0x1021, starting at 0xffff.
+static inline uint16_t quartz_crc16(uint16_t crc, const void *mem, size_t length) {
+	const uint8_t *arr = mem;
+	for (size_t i = 0; i < length; i++) {
+		// A byte at a time, without a table.
+		crc  = (crc >> 8) | (crc << 8);
+		crc ^= arr[i];
+		crc ^= (crc & 0xff) >> 4;
+		crc ^= crc << 12;
+		crc ^= (crc & 0xff) << 5;
+	}
+	return crc;
+}
+
+// Encode a triangle into QUARTZ_TRI_SIZE bytes.
+static inline void quartz_encode_tri(uint8_t *out, const quartz_tri_t *tri) {
+	for (int i = 0; i < 3; i++) {
+		quartz_put16(out + i*6 + 0, tri->v[i].x);
+		quartz_put16(out + i*6 + 2, tri->v[i].y);
+		quartz_put16(out + i*6 + 4, tri->v[i].z);
+	}
+	quartz_put16(out + 18, tri->color);
+}
+
+// Decode a triangle from QUARTZ_TRI_SIZE bytes.
+static inline quartz_tri_t quartz_decode_tri(const uint8_t *in) {
+	quartz_tri_t tri;
+	for (int i = 0; i < 3; i++) {
+		tri.v[i].x = quartz_get16(in + i*6 + 0);
+		tri.v[i].y = quartz_get16(in + i*6 + 2);
+		tri.v[i].z = quartz_get16(in + i*6 + 4);
+	}
+	tri.color = quartz_get16(in + 18);
+	return tri;
+}
+
+// Encode a line into QUARTZ_LINE_SIZE bytes.
+static inline void quartz_encode_line(uint8_t *out, const quartz_line_t *line) {
+	quartz_put16(out + 0, line->x0);
+	quartz_put16(out + 2, line->y0);
+	quartz_put16(out + 4, line->x1);
+	quartz_put16(out + 6, line->y1);
+	quartz_put16(out + 8, line->color);
+}
+
+// Decode a line from QUARTZ_LINE_SIZE bytes.
+static inline quartz_line_t quartz_decode_line(const uint8_t *in) {
+	return (quartz_line_t) {
+		.x0    = quartz_get16(in + 0),
+		.y0    = quartz_get16(in + 2),
+		.x1    = quartz_get16(in + 4),
+		.y1    = quartz_get16(in + 6),
+		.color = quartz_get16(in + 8),
+	};
+}
+
+
+// Encode a projection into QUARTZ_VIEW_SIZE bytes.
+static inline void quartz_encode_view(uint8_t *out, const quartz_view_t *view) {
+	quartz_put32(out +  0, view->focal);
+	quartz_put16(out +  4, view->scale);
+	quartz_put16(out +  6, view->cx);
+	quartz_put16(out +  8, view->cy);
+	quartz_put32(out + 10, view->depth_a);
+	quartz_put32(out + 14, view->depth_b);
+}
+
+// Decode a projection from QUARTZ_VIEW_SIZE bytes.
+static inline quartz_view_t quartz_decode_view(const uint8_t *in) {
+	return (quartz_view_t) {
+		.focal   = quartz_get32(in +  0),
+		.scale   = quartz_get16(in +  4),
+		.cx      = quartz_get16(in +  6),
+		.cy      = quartz_get16(in +  8),
+		.depth_a = quartz_get32(in + 10),
+		.depth_b = quartz_get32(in + 14),
+	};
+}
+
+// Encode a placement into QUARTZ_XFORM_SIZE bytes.
+static inline void quartz_encode_xform(uint8_t *out, const quartz_xform_t *xform) {
+	for (int i = 0; i < 9; i++) {
+		quartz_put16(out + i*2, xform->rot[i / 3][i % 3]);
+	}
+	out[18] = xform->shift;
+	for (int i = 0; i < 3; i++) {
+		quartz_put32(out + 19 + i*4, xform->pos[i]);
+		quartz_put16(out + 31 + i*2, xform->light[i]);
+	}
+}
+
+// Decode a placement from QUARTZ_XFORM_SIZE bytes.
+static inline quartz_xform_t quartz_decode_xform(const uint8_t *in) {
+	quartz_xform_t xform;
+	for (int i = 0; i < 9; i++) {
+		xform.rot[i / 3][i % 3] = quartz_get16(in + i*2);
+	}
+	xform.shift = in[18];
+	for (int i = 0; i < 3; i++) {
+		xform.pos[i]   = quartz_get32(in + 19 + i*4);
+		xform.light[i] = quartz_get16(in + 31 + i*2);
+	}
+	return xform;
+}
+
 
 
 #ifdef __cplusplus
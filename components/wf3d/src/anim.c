@@ -0,0 +1,104 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "anim.h"
+#include <math.h>
+
+
+
+// Picks the two keyframes around `time` and how far along from the first to the second.
+static void wf3d_anim_frames(const wf3d_anim_t *anim, float time, size_t *frame0, size_t *frame1, float *weight) {
+	float pos = time * anim->rate;
+	if (anim->loop) {
+		pos = fmodf(pos, anim->num_frame);
+		if (pos < 0) pos += anim->num_frame;
+	} else if (pos < 0) {
+		pos = 0;
+	} else if (pos > anim->num_frame - 1) {
+		pos = anim->num_frame - 1;
+	}
+	
+	*frame0 = pos;
+	// Rounding may put it on the end.
+	if (*frame0 >= anim->num_frame) *frame0 = anim->num_frame - 1;
+	*frame1 = *frame0 + 1;
+	if (*frame1 >= anim->num_frame) *frame1 = anim->loop ? 0 : *frame0;
+	*weight = pos - *frame0;
+	if (*weight < 0) *weight = 0;
+}
+
+// Adds a SHAPE to the DRAWING QUEUE as deformed by a VERTEX ANIMATION at `time` seconds.
+void wf3d_anim_mesh(wf3d_ctx_t *ctx, wf3d_shape_t *base, const wf3d_anim_t *anim, float time) {
+	// The base SHAPE is copied and transformed the usual way, then moved by the offsets.
+	size_t first = wf3d_mesh_direct(ctx, base);
+	if (first == SIZE_MAX) return;
+	if (!anim->num_frame || anim->num_vertex != base->num_vertex) return;
+	
+	size_t frame0, frame1;
+	float  weight;
+	wf3d_anim_frames(anim, time, &frame0, &frame1, &weight);
+	
+	// The base SHAPE is signed by pointer, so sign the pose as well.
+	wf3d_sig_mix(ctx, &anim,   sizeof(anim));
+	wf3d_sig_mix(ctx, &frame0, sizeof(frame0));
+	wf3d_sig_mix(ctx, &frame1, sizeof(frame1));
+	wf3d_sig_mix(ctx, &weight, sizeof(weight));
+	
+	// Offsets are moved like directions: rotated and scaled, but not translated.
+	matrix_3d_t   mtx    = ctx->stack.value;
+	float         scale0 = anim->scales[frame0] * (1 - weight);
+	float         scale1 = anim->scales[frame1] * weight;
+	const int8_t *delta0 = anim->deltas + 3 * anim->num_vertex * frame0;
+	const int8_t *delta1 = anim->deltas + 3 * anim->num_vertex * frame1;
+	if (weight == 0) {
+		// Exactly on a keyframe; don't read the next one.
+		delta1 = delta0;
+		scale1 = 0;
+	}
+	
+	for (size_t i = 0; i < anim->num_vertex; i++) {
+		float dx = delta0[i*3]   * scale0 + delta1[i*3]   * scale1;
+		float dy = delta0[i*3+1] * scale0 + delta1[i*3+1] * scale1;
+		float dz = delta0[i*3+2] * scale0 + delta1[i*3+2] * scale1;
+		
+		vec3f_t *ptr = &ctx->vertices[first + i];
+		ptr->x += dx * mtx.xx + dy * mtx.yx + dz * mtx.zx;
+		ptr->y += dx * mtx.xy + dy * mtx.yy + dz * mtx.zy;
+		ptr->z += dx * mtx.xz + dy * mtx.yz + dz * mtx.zz;
+	}
+}
+
+// Adds a SHAPE to the DRAWING QUEUE as deformed by a VERTEX ANIMATION at `time` seconds, under an extra MATRIX.
+void wf3d_anim_mesh_mtx(wf3d_ctx_t *ctx, matrix_3d_t mtx, wf3d_shape_t *base, const wf3d_anim_t *anim, float time) {
+	matrix_3d_t saved = ctx->stack.value;
+	ctx->stack.value  = matrix_3d_multiply(saved, mtx);
+	wf3d_anim_mesh(ctx, base, anim, time);
+	ctx->stack.value  = saved;
+}
+
+// Length of a VERTEX ANIMATION in seconds, including the blend back to the first keyframe if it loops.
+float wf3d_anim_length(const wf3d_anim_t *anim) {
+	if (!anim->num_frame) return 0;
+	return (anim->loop ? anim->num_frame : anim->num_frame - 1) / anim->rate;
+}
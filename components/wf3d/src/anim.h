@@ -0,0 +1,70 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef ANIM_H
+#define ANIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+
+
+
+// A VERTEX ANIMATION: keyframes stored as quantised offsets from the vertices of a base SHAPE.
+// Meant to live in flash; playing it only reads the two keyframes around the current time,
+// so the RAM it takes does not depend on the length of the clip. See tools/wf3d_anim.py.
+typedef struct {
+	// Amount of vertices per keyframe, which must match the base SHAPE.
+	size_t         num_vertex;
+	// Amount of keyframes.
+	size_t         num_frame;
+	// Keyframes per second.
+	float          rate;
+	// Whether the last keyframe blends back into the first instead of holding.
+	bool           loop;
+	// Per keyframe: the distance of one step in `deltas`.
+	const float   *scales;
+	// Per keyframe, per vertex: the X, Y and Z offset from the base SHAPE in steps.
+	const int8_t  *deltas;
+} wf3d_anim_t;
+
+
+
+// Adds a SHAPE to the DRAWING QUEUE as deformed by a VERTEX ANIMATION at `time` seconds.
+// Always goes into the DRAWING QUEUE itself, as DISPLAY LISTs and the PRIMITIVE SINK only hold still SHAPEs.
+// Leaves the DRAWING QUEUE as it was if out of memory.
+void wf3d_anim_mesh    (wf3d_ctx_t *ctx, wf3d_shape_t *base, const wf3d_anim_t *anim, float time);
+// Adds a SHAPE to the DRAWING QUEUE as deformed by a VERTEX ANIMATION at `time` seconds, under an extra MATRIX.
+void wf3d_anim_mesh_mtx(wf3d_ctx_t *ctx, matrix_3d_t mtx, wf3d_shape_t *base, const wf3d_anim_t *anim, float time);
+// Length of a VERTEX ANIMATION in seconds, including the blend back to the first keyframe if it loops.
+float wf3d_anim_length (const wf3d_anim_t *anim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ANIM_H
@@ -0,0 +1,416 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "bvh.h"
+#include <string.h>
+
+
+
+// Gets one axis of a vector.
+static inline float vec3f_axis(vec3f_t vec, int axis) {
+	return axis == 0 ? vec.x : axis == 1 ? vec.y : vec.z;
+}
+
+// Gets one axis of the center of a bounding box, times two.
+// Empty boxes, which span from infinity to minus infinity, count as centered on the origin instead of NaN.
+static inline float aabb_center2(wf3d_aabb_t box, int axis) {
+	if (wf3d_aabb_is_empty(box)) return 0;
+	return vec3f_axis(box.min, axis) + vec3f_axis(box.max, axis);
+}
+
+// Makes a bounding box containing both boxes.
+wf3d_aabb_t wf3d_aabb_union(wf3d_aabb_t a, wf3d_aabb_t b) {
+	return (wf3d_aabb_t) {
+		{ fminf(a.min.x, b.min.x), fminf(a.min.y, b.min.y), fminf(a.min.z, b.min.z) },
+		{ fmaxf(a.max.x, b.max.x), fmaxf(a.max.y, b.max.y), fmaxf(a.max.z, b.max.z) },
+	};
+}
+
+// Transforms a bounding box, returning a box around the result.
+wf3d_aabb_t wf3d_aabb_xform(matrix_3d_t mtx, wf3d_aabb_t box) {
+	if (wf3d_aabb_is_empty(box)) return box;
+	
+	// Transform the center, then grow by the absolute matrix times the extents.
+	vec3f_t center = { (box.min.x + box.max.x) / 2, (box.min.y + box.max.y) / 2, (box.min.z + box.max.z) / 2 };
+	vec3f_t extent = { (box.max.x - box.min.x) / 2, (box.max.y - box.min.y) / 2, (box.max.z - box.min.z) / 2 };
+	center = matrix_3d_transform_inline(mtx, center);
+	vec3f_t radius = {
+		fabsf(mtx.xx) * extent.x + fabsf(mtx.yx) * extent.y + fabsf(mtx.zx) * extent.z,
+		fabsf(mtx.xy) * extent.x + fabsf(mtx.yy) * extent.y + fabsf(mtx.zy) * extent.z,
+		fabsf(mtx.xz) * extent.x + fabsf(mtx.yz) * extent.y + fabsf(mtx.zz) * extent.z,
+	};
+	
+	return (wf3d_aabb_t) {
+		{ center.x - radius.x, center.y - radius.y, center.z - radius.z },
+		{ center.x + radius.x, center.y + radius.y, center.z + radius.z },
+	};
+}
+
+// Computes the bounding box of a shape.
+wf3d_aabb_t wf3d_shape_bounds(const wf3d_shape_t *shape) {
+	wf3d_aabb_t box = wf3d_aabb_empty();
+	for (size_t i = 0; i < shape->num_vertex; i++) {
+		vec3f_t vtx = shape->vertices[i];
+		box.min.x = fminf(box.min.x, vtx.x);
+		box.min.y = fminf(box.min.y, vtx.y);
+		box.min.z = fminf(box.min.z, vtx.z);
+		box.max.x = fmaxf(box.max.x, vtx.x);
+		box.max.y = fmaxf(box.max.y, vtx.y);
+		box.max.z = fmaxf(box.max.z, vtx.z);
+	}
+	return box;
+}
+
+
+// Intersects a ray with a bounding box.
+float wf3d_ray_aabb(wf3d_ray_t ray, wf3d_aabb_t box) {
+	if (wf3d_aabb_is_empty(box)) return INFINITY;
+	float t_min = ray.t_min, t_max = ray.t_max;
+	for (int axis = 0; axis < 3; axis++) {
+		float origin = vec3f_axis(ray.origin, axis);
+		float dir    = vec3f_axis(ray.dir,    axis);
+		float lo     = vec3f_axis(box.min,    axis);
+		float hi     = vec3f_axis(box.max,    axis);
+		if (dir == 0) {
+			// Parallel to this slab.
+			if (origin < lo || origin > hi) return INFINITY;
+			continue;
+		}
+		float t0 = (lo - origin) / dir;
+		float t1 = (hi - origin) / dir;
+		if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+		if (t0 > t_min) t_min = t0;
+		if (t1 < t_max) t_max = t1;
+		if (t_min > t_max) return INFINITY;
+	}
+	return t_min;
+}
+
+// Transforms a ray. Distances along the ray stay the same.
+wf3d_ray_t wf3d_ray_xform(matrix_3d_t mtx, wf3d_ray_t ray) {
+	matrix_3d_t linear = mtx;
+	linear.dx = linear.dy = linear.dz = 0;
+	return (wf3d_ray_t) {
+		.origin = matrix_3d_transform_inline(mtx,    ray.origin),
+		.dir    = matrix_3d_transform_inline(linear, ray.dir),
+		.t_min  = ray.t_min,
+		.t_max  = ray.t_max,
+	};
+}
+
+
+
+// Transforms a plane from camera space into the space the matrix transforms from.
+static wf3d_plane_t plane_xform(matrix_3d_t mtx, vec3f_t normal, float dist) {
+	return (wf3d_plane_t) {
+		.normal = {
+			mtx.xx * normal.x + mtx.xy * normal.y + mtx.xz * normal.z,
+			mtx.yx * normal.x + mtx.yy * normal.y + mtx.yz * normal.z,
+			mtx.zx * normal.x + mtx.zy * normal.y + mtx.zz * normal.z,
+		},
+		.dist = mtx.dx * normal.x + mtx.dy * normal.y + mtx.dz * normal.z + dist,
+	};
+}
+
+// Determines the frustum of a camera with the given focal depth and half screen size in projected units.
+wf3d_frustum_t wf3d_make_frustum(float focal, float half_width, float half_height, matrix_3d_t mtx) {
+	// Projection is x * focal / (focal + z), and everything with z < 0 is dropped.
+	return (wf3d_frustum_t) { .planes = {
+		plane_xform(mtx, (vec3f_t) {  0,      0,     -1           }, 0),
+		plane_xform(mtx, (vec3f_t) { -focal,  0,     -half_width  }, -half_width  * focal),
+		plane_xform(mtx, (vec3f_t) {  focal,  0,     -half_width  }, -half_width  * focal),
+		plane_xform(mtx, (vec3f_t) {  0,     -focal, -half_height }, -half_height * focal),
+		plane_xform(mtx, (vec3f_t) {  0,      focal, -half_height }, -half_height * focal),
+	}};
+}
+
+// Determines the frustum visible to the camera, in the space of the current MATRIX.
+wf3d_frustum_t wf3d_get_frustum(pax_buf_t *buf, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix) {
+	float scale = fminf(buf->width, buf->height);
+	return wf3d_make_frustum(
+		wf3d_get_foc(buf, ctx),
+		buf->width  / scale,
+		buf->height / scale,
+		matrix_3d_multiply(cam_matrix, ctx->stack.value)
+	);
+}
+
+// Tests a bounding box against a frustum.
+wf3d_cull_t wf3d_frustum_test(const wf3d_frustum_t *frustum, wf3d_aabb_t box) {
+	if (wf3d_aabb_is_empty(box)) return WF3D_CULL_OUTSIDE;
+	
+	vec3f_t center = { (box.min.x + box.max.x) / 2, (box.min.y + box.max.y) / 2, (box.min.z + box.max.z) / 2 };
+	vec3f_t extent = { (box.max.x - box.min.x) / 2, (box.max.y - box.min.y) / 2, (box.max.z - box.min.z) / 2 };
+	wf3d_cull_t res = WF3D_CULL_INSIDE;
+	for (int i = 0; i < 5; i++) {
+		const wf3d_plane_t *plane = &frustum->planes[i];
+		float dist   = plane->normal.x * center.x + plane->normal.y * center.y + plane->normal.z * center.z + plane->dist;
+		float radius = fabsf(plane->normal.x) * extent.x + fabsf(plane->normal.y) * extent.y + fabsf(plane->normal.z) * extent.z;
+		if (dist - radius > 0) return WF3D_CULL_OUTSIDE;
+		if (dist + radius > 0) res = WF3D_CULL_INTERSECT;
+	}
+	return res;
+}
+
+
+
+// Computes the bounds of a range of objects.
+static wf3d_aabb_t bvh_range_bounds(const wf3d_bvh_t *bvh, size_t first, size_t count) {
+	wf3d_aabb_t box = wf3d_aabb_empty();
+	for (size_t i = first; i < first + count; i++) {
+		box = wf3d_aabb_union(box, bvh->obj_bounds[bvh->order[i]]);
+	}
+	return box;
+}
+
+// Computes the bounds of a node from its objects or children.
+static wf3d_aabb_t bvh_node_bounds(const wf3d_bvh_t *bvh, const wf3d_bvh_node_t *node) {
+	if (node->left) {
+		return wf3d_aabb_union(bvh->nodes[node->left].bounds, bvh->nodes[node->left + 1].bounds);
+	} else {
+		return bvh_range_bounds(bvh, node->first, node->count);
+	}
+}
+
+// Partially sorts a range of objects along an axis, such that the nth is in its sorted position.
+static void bvh_select(const wf3d_bvh_t *bvh, uint32_t *order, size_t count, size_t nth, int axis) {
+	size_t lo = 0, hi = count - 1;
+	while (lo < hi) {
+		float    pivot = aabb_center2(bvh->obj_bounds[order[(lo + hi) / 2]], axis);
+		size_t   i = lo, j = hi;
+		while (i <= j) {
+			while (aabb_center2(bvh->obj_bounds[order[i]], axis) < pivot) i++;
+			while (aabb_center2(bvh->obj_bounds[order[j]], axis) > pivot) j--;
+			if (i <= j) {
+				uint32_t tmp = order[i];
+				order[i] = order[j];
+				order[j] = tmp;
+				i++;
+				if (j == 0) break;
+				j--;
+			}
+		}
+		if (nth <= j) hi = j;
+		else if (nth >= i) lo = i;
+		else break;
+	}
+}
+
+// Recursively builds a node by splitting its objects at the median of the widest axis.
+static void bvh_build_node(wf3d_bvh_t *bvh, uint32_t idx) {
+	wf3d_bvh_node_t *node = &bvh->nodes[idx];
+	node->bounds = bvh_range_bounds(bvh, node->first, node->count);
+	node->left   = 0;
+	
+	if (node->count <= WF3D_BVH_LEAF_SIZE) {
+		// Small enough for a leaf.
+		for (size_t i = node->first; i < node->first + node->count; i++) {
+			bvh->obj_leaf[bvh->order[i]] = idx;
+		}
+		return;
+	}
+	
+	// Find the widest axis of the object centers.
+	float lo[3] = { INFINITY,  INFINITY,  INFINITY};
+	float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+	for (size_t i = node->first; i < node->first + node->count; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			float center = aabb_center2(bvh->obj_bounds[bvh->order[i]], axis);
+			if (center < lo[axis]) lo[axis] = center;
+			if (center > hi[axis]) hi[axis] = center;
+		}
+	}
+	int axis = 0;
+	if (hi[1] - lo[1] > hi[axis] - lo[axis]) axis = 1;
+	if (hi[2] - lo[2] > hi[axis] - lo[axis]) axis = 2;
+	
+	// Split at the median.
+	size_t half = node->count / 2;
+	bvh_select(bvh, &bvh->order[node->first], node->count, half, axis);
+	
+	uint32_t left = bvh->num_node;
+	bvh->num_node += 2;
+	bvh->nodes[left] = (wf3d_bvh_node_t) {
+		.parent = idx,
+		.first  = node->first,
+		.count  = half,
+	};
+	bvh->nodes[left + 1] = (wf3d_bvh_node_t) {
+		.parent = idx,
+		.first  = node->first + half,
+		.count  = node->count - half,
+	};
+	node->left = left;
+	
+	bvh_build_node(bvh, left);
+	bvh_build_node(bvh, left + 1);
+}
+
+// BUILDs a BVH over a set of objects, replacing the existing contents, if any.
+bool wf3d_bvh_build(wf3d_bvh_t *bvh, size_t num_obj, const wf3d_aabb_t *obj_bounds) {
+	// A binary tree with leaves of at least one object has less than twice as many nodes.
+	size_t cap_node = num_obj ? 2 * num_obj : 1;
+	wf3d_aabb_t     *bounds = realloc(bvh->obj_bounds, sizeof(wf3d_aabb_t) * (num_obj ? num_obj : 1));
+	if (bounds) bvh->obj_bounds = bounds;
+	uint32_t        *order  = realloc(bvh->order,      sizeof(uint32_t)    * (num_obj ? num_obj : 1));
+	if (order) bvh->order = order;
+	uint32_t        *leaf   = realloc(bvh->obj_leaf,   sizeof(uint32_t)    * (num_obj ? num_obj : 1));
+	if (leaf) bvh->obj_leaf = leaf;
+	wf3d_bvh_node_t *nodes  = realloc(bvh->nodes,      sizeof(wf3d_bvh_node_t) * cap_node);
+	if (nodes) bvh->nodes = nodes;
+	if (!bounds || !order || !leaf || !nodes) {
+		wf3d_bvh_destroy(bvh);
+		return false;
+	}
+	
+	// Copy in the objects.
+	bvh->num_obj = num_obj;
+	memcpy(bvh->obj_bounds, obj_bounds, sizeof(wf3d_aabb_t) * num_obj);
+	for (size_t i = 0; i < num_obj; i++) {
+		bvh->order[i] = i;
+	}
+	
+	// Build the tree.
+	bvh->num_node = 1;
+	bvh->nodes[0] = (wf3d_bvh_node_t) {
+		.parent = WF3D_BVH_NONE,
+		.first  = 0,
+		.count  = num_obj,
+	};
+	bvh_build_node(bvh, 0);
+	return true;
+}
+
+// DESTROYs a BVH.
+void wf3d_bvh_destroy(wf3d_bvh_t *bvh) {
+	free(bvh->obj_bounds);
+	free(bvh->order);
+	free(bvh->obj_leaf);
+	free(bvh->nodes);
+	*bvh = (wf3d_bvh_t) {0};
+}
+
+// Changes the bounds of one object and refits the nodes above it.
+void wf3d_bvh_update(wf3d_bvh_t *bvh, size_t obj, wf3d_aabb_t bounds) {
+	bvh->obj_bounds[obj] = bounds;
+	
+	// Walk up until nothing changes anymore.
+	uint32_t idx = bvh->obj_leaf[obj];
+	while (idx != WF3D_BVH_NONE) {
+		wf3d_bvh_node_t *node = &bvh->nodes[idx];
+		wf3d_aabb_t box = bvh_node_bounds(bvh, node);
+		if (!memcmp(&box, &node->bounds, sizeof(box))) break;
+		node->bounds = box;
+		idx = node->parent;
+	}
+}
+
+// REFITs all nodes to the current object bounds, keeping the tree structure.
+void wf3d_bvh_refit(wf3d_bvh_t *bvh) {
+	// Children always come after their parents.
+	for (size_t i = bvh->num_node; i-- > 0;) {
+		bvh->nodes[i].bounds = bvh_node_bounds(bvh, &bvh->nodes[i]);
+	}
+}
+
+// Finds all objects which may be inside a frustum, culling whole nodes at once.
+size_t wf3d_bvh_cull(const wf3d_bvh_t *bvh, const wf3d_frustum_t *frustum, wf3d_bvh_cb_t callback, void *args) {
+	if (!bvh->num_obj) return 0;
+	
+	// The tree is split at the median, so it is never deeper than this.
+	uint32_t stack[64];
+	size_t   stack_len = 1;
+	size_t   found     = 0;
+	stack[0] = 0;
+	
+	while (stack_len) {
+		const wf3d_bvh_node_t *node = &bvh->nodes[stack[--stack_len]];
+		wf3d_cull_t res = wf3d_frustum_test(frustum, node->bounds);
+		if (res == WF3D_CULL_OUTSIDE) continue;
+		
+		if (res == WF3D_CULL_INTERSECT && node->left) {
+			// Partially visible: check the children.
+			stack[stack_len++] = node->left;
+			stack[stack_len++] = node->left + 1;
+			
+		} else {
+			// Entirely visible or a leaf: report the objects.
+			for (size_t i = node->first; i < node->first + node->count; i++) {
+				uint32_t obj = bvh->order[i];
+				if (res == WF3D_CULL_INTERSECT && wf3d_frustum_test(frustum, bvh->obj_bounds[obj]) == WF3D_CULL_OUTSIDE) continue;
+				if (wf3d_aabb_is_empty(bvh->obj_bounds[obj])) continue;
+				callback(args, obj);
+				found ++;
+			}
+		}
+	}
+	
+	return found;
+}
+
+
+// Finds the nearest object hit by a ray, visiting nearer nodes first and skipping nodes beyond the nearest hit.
+float wf3d_bvh_raycast(const wf3d_bvh_t *bvh, wf3d_ray_t ray, wf3d_bvh_ray_cb_t callback, void *args) {
+	if (!bvh->num_obj || wf3d_ray_aabb(ray, bvh->nodes[0].bounds) == INFINITY) return INFINITY;
+	
+	uint32_t stack[64];
+	size_t   stack_len = 1;
+	float    nearest   = INFINITY;
+	stack[0] = 0;
+	
+	while (stack_len) {
+		const wf3d_bvh_node_t *node = &bvh->nodes[stack[--stack_len]];
+		if (wf3d_ray_aabb(ray, node->bounds) == INFINITY) continue;
+		
+		if (node->left) {
+			// Visit the nearer child first by pushing it last.
+			float t_left  = wf3d_ray_aabb(ray, bvh->nodes[node->left].bounds);
+			float t_right = wf3d_ray_aabb(ray, bvh->nodes[node->left + 1].bounds);
+			if (t_left <= t_right) {
+				if (t_right != INFINITY) stack[stack_len++] = node->left + 1;
+				if (t_left  != INFINITY) stack[stack_len++] = node->left;
+			} else {
+				if (t_left  != INFINITY) stack[stack_len++] = node->left;
+				if (t_right != INFINITY) stack[stack_len++] = node->left + 1;
+			}
+			
+		} else {
+			// Test the objects in this leaf.
+			for (size_t i = node->first; i < node->first + node->count; i++) {
+				uint32_t obj = bvh->order[i];
+				if (wf3d_ray_aabb(ray, bvh->obj_bounds[obj]) == INFINITY) continue;
+				float dist = callback(args, obj, ray);
+				if (dist < nearest) {
+					// Nothing beyond this hit matters anymore.
+					nearest   = dist;
+					ray.t_max = dist;
+				}
+			}
+		}
+	}
+	
+	return nearest;
+}
+
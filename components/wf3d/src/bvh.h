@@ -0,0 +1,175 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef BVH_H
+#define BVH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+#include <math.h>
+
+
+
+// Maximum amount of objects in a BVH leaf.
+#define WF3D_BVH_LEAF_SIZE 4
+// Node index meaning "no node", used for the parent of the root node.
+#define WF3D_BVH_NONE      UINT32_MAX
+
+
+
+// An axis-aligned bounding box.
+// Boxes with min greater than max are empty.
+typedef struct {
+	vec3f_t min, max;
+} wf3d_aabb_t;
+
+// A plane: points where dot(normal, point) + dist > 0 are outside.
+typedef struct {
+	vec3f_t normal;
+	float   dist;
+} wf3d_plane_t;
+
+// The volume of space visible to the camera.
+typedef struct {
+	// Near, left, right, bottom and top planes.
+	wf3d_plane_t planes[5];
+} wf3d_frustum_t;
+
+// A ray: all points origin + t * dir for t in [t_min, t_max].
+typedef struct {
+	vec3f_t origin;
+	vec3f_t dir;
+	float   t_min;
+	float   t_max;
+} wf3d_ray_t;
+
+// Result of testing a box against a frustum.
+typedef enum {
+	// The box is entirely outside.
+	WF3D_CULL_OUTSIDE,
+	// The box is partially inside.
+	WF3D_CULL_INTERSECT,
+	// The box is entirely inside.
+	WF3D_CULL_INSIDE,
+} wf3d_cull_t;
+
+// A single node in a BVH.
+typedef struct {
+	// The bounds of all objects in this node.
+	wf3d_aabb_t bounds;
+	// Index of the parent node, or WF3D_BVH_NONE.
+	uint32_t    parent;
+	// Index of the left child node, the right is the one after it. Zero for leaves.
+	uint32_t    left;
+	// Index of the first object in the BVH's object order.
+	uint32_t    first;
+	// The amount of objects in this node.
+	uint32_t    count;
+} wf3d_bvh_node_t;
+
+// A bounding volume hierarchy over a set of objects.
+typedef struct {
+	// The amount of objects stored.
+	size_t           num_obj;
+	// The bounds of every object.
+	wf3d_aabb_t     *obj_bounds;
+	// Object indices, in such an order that every node covers a contiguous range.
+	uint32_t        *order;
+	// The leaf node containing every object.
+	uint32_t        *obj_leaf;
+	
+	// The amount of nodes stored.
+	size_t           num_node;
+	// A list of all nodes, the root being the first.
+	wf3d_bvh_node_t *nodes;
+} wf3d_bvh_t;
+
+// Called for every object found during a BVH traversal.
+typedef void (*wf3d_bvh_cb_t)(void *args, size_t obj);
+// Called for every object whose bounds a ray hits during a BVH traversal.
+// Returns the distance of the nearest hit with the object within the ray, or INFINITY if there is none.
+typedef float (*wf3d_bvh_ray_cb_t)(void *args, size_t obj, wf3d_ray_t ray);
+
+
+
+// Makes an empty bounding box.
+static inline wf3d_aabb_t wf3d_aabb_empty() {
+	return (wf3d_aabb_t) {
+		{  INFINITY,  INFINITY,  INFINITY },
+		{ -INFINITY, -INFINITY, -INFINITY },
+	};
+}
+// Determines whether a bounding box is empty.
+static inline bool wf3d_aabb_is_empty(wf3d_aabb_t box) {
+	return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+}
+// Makes a bounding box containing both boxes.
+wf3d_aabb_t wf3d_aabb_union (wf3d_aabb_t a, wf3d_aabb_t b);
+// Transforms a bounding box, returning a box around the result.
+wf3d_aabb_t wf3d_aabb_xform (matrix_3d_t mtx, wf3d_aabb_t box);
+// Computes the bounding box of a shape.
+wf3d_aabb_t wf3d_shape_bounds(const wf3d_shape_t *shape);
+// Intersects a ray with a bounding box.
+// Returns the distance at which the ray enters the box, or INFINITY if it misses.
+float       wf3d_ray_aabb    (wf3d_ray_t ray, wf3d_aabb_t box);
+// Transforms a ray. Distances along the ray stay the same.
+wf3d_ray_t  wf3d_ray_xform   (matrix_3d_t mtx, wf3d_ray_t ray);
+
+// Determines the frustum visible to the camera, in the space of the current MATRIX.
+wf3d_frustum_t wf3d_get_frustum (pax_buf_t *buf, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix);
+// Determines the frustum of a camera with the given focal depth and half screen size in projected units,
+// in the space that the given matrix transforms to camera space.
+wf3d_frustum_t wf3d_make_frustum(float focal, float half_width, float half_height, matrix_3d_t mtx);
+// Tests a bounding box against a frustum.
+wf3d_cull_t    wf3d_frustum_test(const wf3d_frustum_t *frustum, wf3d_aabb_t box);
+
+// BUILDs a BVH over a set of objects, replacing the existing contents, if any.
+// Returns whether enough memory was available.
+bool   wf3d_bvh_build  (wf3d_bvh_t *bvh, size_t num_obj, const wf3d_aabb_t *obj_bounds);
+// DESTROYs a BVH.
+void   wf3d_bvh_destroy(wf3d_bvh_t *bvh);
+// Changes the bounds of one object and refits the nodes above it.
+void   wf3d_bvh_update (wf3d_bvh_t *bvh, size_t obj, wf3d_aabb_t bounds);
+// Changes the bounds of one object without refitting, for use with wf3d_bvh_refit.
+static inline void wf3d_bvh_move(wf3d_bvh_t *bvh, size_t obj, wf3d_aabb_t bounds) {
+	bvh->obj_bounds[obj] = bounds;
+}
+// REFITs all nodes to the current object bounds, keeping the tree structure.
+void   wf3d_bvh_refit  (wf3d_bvh_t *bvh);
+// Finds all objects which may be inside a frustum, culling whole nodes at once.
+// Returns the amount of objects found.
+size_t wf3d_bvh_cull   (const wf3d_bvh_t *bvh, const wf3d_frustum_t *frustum, wf3d_bvh_cb_t callback, void *args);
+// Finds the nearest object hit by a ray, visiting nearer nodes first and skipping nodes beyond the nearest hit.
+// Returns the distance of the nearest hit, or INFINITY if there is none.
+float  wf3d_bvh_raycast(const wf3d_bvh_t *bvh, wf3d_ray_t ray, wf3d_bvh_ray_cb_t callback, void *args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BVH_H
@@ -0,0 +1,205 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "dlist.h"
+#include "mem.h"
+#include <string.h>
+
+
+
+// MAKEs a new, empty DISPLAY LIST, with the default MEMORY POLICY.
+void wf3d_dlist_init(wf3d_dlist_t *list) {
+	wf3d_dlist_init_mem(list, &wf3d_mem_default);
+}
+
+// MAKEs a new, empty DISPLAY LIST, with its buffers placed by `mem`.
+void wf3d_dlist_init_mem(wf3d_dlist_t *list, wf3d_mem_t *mem) {
+	wf3d_dlist_cmd_t *cmds   = wf3d_mem_alloc(mem, WF3D_MEM_QUEUE, sizeof(wf3d_dlist_cmd_t) * WF3D_DLIST_INITIAL_CAP);
+	wf3d_shape_t    **shapes = wf3d_mem_alloc(mem, WF3D_MEM_QUEUE, sizeof(wf3d_shape_t *) * WF3D_DLIST_INITIAL_CAP);
+	// Whatever did not fit starts out empty, and is made on the first append.
+	*list = (wf3d_dlist_t) {
+		.num_cmd   = 0,
+		.cap_cmd   = cmds ? WF3D_DLIST_INITIAL_CAP : 0,
+		.cmds      = cmds,
+		.num_shape = 0,
+		.cap_shape = shapes ? WF3D_DLIST_INITIAL_CAP : 0,
+		.shapes    = shapes,
+		.mem       = mem,
+	};
+}
+
+// DESTROYs a DISPLAY LIST.
+void wf3d_dlist_destroy(wf3d_dlist_t *list) {
+	if (!list->borrowed)        wf3d_mem_free(list->mem, WF3D_MEM_QUEUE, list->cmds);
+	if (!list->borrowed_shapes) wf3d_mem_free(list->mem, WF3D_MEM_QUEUE, list->shapes);
+	*list = (wf3d_dlist_t) {0};
+}
+
+// CLEARs all commands from a DISPLAY LIST.
+void wf3d_dlist_clear(wf3d_dlist_t *list) {
+	// A DESTROYed DISPLAY LIST no longer has a MEMORY POLICY.
+	wf3d_mem_t *mem = list->mem ? list->mem : &wf3d_mem_default;
+	wf3d_dlist_destroy(list);
+	wf3d_dlist_init_mem(list, mem);
+}
+
+
+
+// Starts RECORDING wf3d_mesh calls into a DISPLAY LIST instead of the DRAWING QUEUE.
+bool wf3d_dlist_begin(wf3d_ctx_t *ctx, wf3d_dlist_t *list) {
+	// Without the saved MATRIX, ending could not restore it.
+	if (!wf3d_push_3d(ctx)) return false;
+	ctx->stack.value = matrix_3d_identity();
+	ctx->record      = list;
+	return true;
+}
+
+// Stops RECORDING into a DISPLAY LIST; does nothing if not recording.
+void wf3d_dlist_end(wf3d_ctx_t *ctx) {
+	// Only a successful begin pushed a MATRIX to pop.
+	if (!ctx->record) return;
+	ctx->record = NULL;
+	wf3d_pop_3d(ctx);
+}
+
+// Adds a single mesh draw to a DISPLAY LIST; leaves it as it was if out of memory.
+void wf3d_dlist_append(wf3d_dlist_t *list, matrix_3d_t mtx, wf3d_shape_t *shape) {
+	// Borrowed data must be copied before it can grow.
+	if (list->borrowed || list->borrowed_shapes) {
+		wf3d_dlist_t copy;
+		wf3d_dlist_init_mem(&copy, list->mem);
+		for (size_t i = 0; i < list->num_cmd; i++) {
+			wf3d_dlist_append(&copy, list->cmds[i].mtx, list->shapes[list->cmds[i].shape]);
+		}
+		wf3d_dlist_destroy(list);
+		*list = copy;
+	}
+	
+	// Look up the shape in the shape table.
+	size_t shape_idx;
+	for (shape_idx = 0; shape_idx < list->num_shape; shape_idx++) {
+		if (list->shapes[shape_idx] == shape) break;
+	}
+	
+	// Ensure array space for SHAPE.
+	// Out of memory leaves the DISPLAY LIST as it was, without this draw.
+	if (list->cap_shape <= shape_idx) {
+		size_t         cap = list->cap_shape * 3 / 2 + 1;
+		wf3d_shape_t **mem = wf3d_mem_realloc(list->mem, WF3D_MEM_QUEUE, list->shapes, sizeof(wf3d_shape_t *) * cap);
+		if (!mem) return;
+		list->shapes    = mem;
+		list->cap_shape = cap;
+	}
+	
+	// Ensure array space for CMD.
+	if (list->cap_cmd <= list->num_cmd) {
+		size_t            cap = list->cap_cmd * 3 / 2 + 1;
+		wf3d_dlist_cmd_t *mem = wf3d_mem_realloc(list->mem, WF3D_MEM_QUEUE, list->cmds, sizeof(wf3d_dlist_cmd_t) * cap);
+		if (!mem) return;
+		list->cmds    = mem;
+		list->cap_cmd = cap;
+	}
+	
+	// Insert SHAPE, now that the CMD referencing it fits.
+	if (shape_idx == list->num_shape) {
+		list->shapes[list->num_shape++] = shape;
+	}
+	list->cmds[list->num_cmd++] = (wf3d_dlist_cmd_t) {
+		.mtx   = mtx,
+		.shape = shape_idx,
+	};
+}
+
+
+
+// REPLAYs a DISPLAY LIST into the DRAWING QUEUE, under the current MATRIX.
+void wf3d_dlist_draw(wf3d_ctx_t *ctx, const wf3d_dlist_t *list) {
+	for (size_t i = 0; i < list->num_cmd; i++) {
+		wf3d_mesh_mtx(ctx, list->cmds[i].mtx, list->shapes[list->cmds[i].shape]);
+	}
+}
+
+
+
+// SERIALIZEs a DISPLAY LIST. Shapes are stored by their index in the shape table.
+size_t wf3d_dlist_serialize(const wf3d_dlist_t *list, void *out, size_t out_cap) {
+	size_t size = sizeof(wf3d_dlist_hdr_t) + sizeof(wf3d_dlist_cmd_t) * list->num_cmd;
+	if (!out || out_cap < size) return size;
+	
+	wf3d_dlist_hdr_t hdr = {
+		.magic     = WF3D_DLIST_MAGIC,
+		.version   = WF3D_DLIST_VERSION,
+		.num_shape = list->num_shape,
+		.num_cmd   = list->num_cmd,
+	};
+	memcpy(out, &hdr, sizeof(hdr));
+	memcpy((uint8_t *) out + sizeof(hdr), list->cmds, sizeof(wf3d_dlist_cmd_t) * list->num_cmd);
+	return size;
+}
+
+// LOADs a serialized DISPLAY LIST, resolving shape indices with the given table.
+bool wf3d_dlist_load(wf3d_dlist_t *list, const void *data, size_t len, wf3d_shape_t **shapes, size_t num_shapes) {
+	// Check the header.
+	wf3d_dlist_hdr_t hdr;
+	if (len < sizeof(hdr)) return false;
+	memcpy(&hdr, data, sizeof(hdr));
+	if (hdr.magic != WF3D_DLIST_MAGIC || hdr.version != WF3D_DLIST_VERSION) return false;
+	if (hdr.num_shape > num_shapes) return false;
+	// Divide rather than multiply, which could overflow with a corrupt count.
+	if (hdr.num_cmd > (len - sizeof(hdr)) / sizeof(wf3d_dlist_cmd_t)) return false;
+	
+	// Reference the commands in place if possible.
+	const uint8_t *raw = (const uint8_t *) data + sizeof(hdr);
+	bool aligned = ((size_t) raw % _Alignof(wf3d_dlist_cmd_t)) == 0;
+	wf3d_dlist_cmd_t *cmds;
+	if (aligned) {
+		cmds = (wf3d_dlist_cmd_t *) raw;
+	} else {
+		cmds = wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_QUEUE, sizeof(wf3d_dlist_cmd_t) * hdr.num_cmd);
+		if (!cmds) return false;
+		memcpy(cmds, raw, sizeof(wf3d_dlist_cmd_t) * hdr.num_cmd);
+	}
+	
+	// Check the shape indices.
+	for (size_t i = 0; i < hdr.num_cmd; i++) {
+		if (cmds[i].shape >= hdr.num_shape) {
+			if (!aligned) wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_QUEUE, cmds);
+			return false;
+		}
+	}
+	
+	*list = (wf3d_dlist_t) {
+		.num_cmd         = hdr.num_cmd,
+		.cap_cmd         = hdr.num_cmd,
+		.cmds            = cmds,
+		.borrowed        = aligned,
+		.num_shape       = hdr.num_shape,
+		.cap_shape       = hdr.num_shape,
+		.shapes          = shapes,
+		.borrowed_shapes = true,
+		.mem             = &wf3d_mem_default,
+	};
+	return true;
+}
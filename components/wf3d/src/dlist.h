@@ -0,0 +1,126 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef DLIST_H
+#define DLIST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+
+
+
+// Magic number of a serialized display list ("W3DL").
+#define WF3D_DLIST_MAGIC       0x4c443357
+// Version of the serialized display list format.
+#define WF3D_DLIST_VERSION     1
+// Initial amount of commands that fit in a display list.
+#define WF3D_DLIST_INITIAL_CAP 16
+
+
+
+// A single recorded mesh draw.
+typedef struct {
+	// The pre-multiplied MATRIX to draw the mesh with.
+	matrix_3d_t mtx;
+	// Index of the mesh in the display list's shape table.
+	uint32_t    shape;
+} wf3d_dlist_cmd_t;
+
+// The header of a serialized display list, followed by the commands.
+typedef struct {
+	// Must be WF3D_DLIST_MAGIC.
+	uint32_t magic;
+	// Must be WF3D_DLIST_VERSION.
+	uint16_t version;
+	// The amount of shapes the shape table must have.
+	uint16_t num_shape;
+	// The amount of commands following the header.
+	uint32_t num_cmd;
+} wf3d_dlist_hdr_t;
+
+// A recorded sequence of mesh draws.
+struct wf3d_dlist {
+	// The amount of commands stored.
+	size_t            num_cmd;
+	// The amount of commands that will fit.
+	size_t            cap_cmd;
+	// A list of all commands.
+	wf3d_dlist_cmd_t *cmds;
+	// Whether the commands are borrowed from serialized data.
+	bool              borrowed;
+	
+	// The amount of shapes referenced.
+	size_t            num_shape;
+	// The amount of shapes that will fit.
+	size_t            cap_shape;
+	// The table of shapes referenced by commands.
+	wf3d_shape_t    **shapes;
+	// Whether the shape table is borrowed from the caller.
+	bool              borrowed_shapes;
+	
+	// The MEMORY POLICY the commands and shape table are allocated with.
+	wf3d_mem_t       *mem;
+};
+
+
+
+// MAKEs a new, empty DISPLAY LIST, with the default MEMORY POLICY.
+void   wf3d_dlist_init     (wf3d_dlist_t *list);
+// MAKEs a new, empty DISPLAY LIST, with its buffers placed by `mem`.
+void   wf3d_dlist_init_mem (wf3d_dlist_t *list, wf3d_mem_t *mem);
+// DESTROYs a DISPLAY LIST.
+void   wf3d_dlist_destroy  (wf3d_dlist_t *list);
+// CLEARs all commands from a DISPLAY LIST.
+void   wf3d_dlist_clear    (wf3d_dlist_t *list);
+
+// Starts RECORDING wf3d_mesh calls into a DISPLAY LIST instead of the DRAWING QUEUE.
+// Other additions still go to the DRAWING QUEUE.
+// Recording starts from an identity MATRIX, which is restored when recording ends.
+// Returns false without recording if out of memory for saving the MATRIX.
+bool   wf3d_dlist_begin    (wf3d_ctx_t *ctx, wf3d_dlist_t *list);
+// Stops RECORDING into a DISPLAY LIST; does nothing if not recording.
+void   wf3d_dlist_end      (wf3d_ctx_t *ctx);
+// Adds a single mesh draw to a DISPLAY LIST; leaves it as it was if out of memory.
+void   wf3d_dlist_append   (wf3d_dlist_t *list, matrix_3d_t mtx, wf3d_shape_t *shape);
+
+// REPLAYs a DISPLAY LIST into the DRAWING QUEUE, under the current MATRIX.
+void   wf3d_dlist_draw     (wf3d_ctx_t *ctx, const wf3d_dlist_t *list);
+
+// SERIALIZEs a DISPLAY LIST. Shapes are stored by their index in the shape table.
+// Returns the size required, and only writes if it fits in the given capacity.
+size_t wf3d_dlist_serialize(const wf3d_dlist_t *list, void *out, size_t out_cap);
+// LOADs a serialized DISPLAY LIST, resolving shape indices with the given table.
+// Aligned data (e.g. in flash) is referenced in place instead of copied, with the default MEMORY POLICY otherwise.
+// Returns whether the data was valid.
+bool   wf3d_dlist_load     (wf3d_dlist_t *list, const void *data, size_t len, wf3d_shape_t **shapes, size_t num_shapes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DLIST_H
@@ -0,0 +1,192 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "dynres.h"
+#include "mem.h"
+#include <string.h>
+
+
+
+// Gets the size of a resolution level, in quarters of the output size.
+static inline int wf3d_dynres_quarters(int level) {
+	return 4 - level;
+}
+
+// Recomputes the column map for the current level.
+static void wf3d_dynres_map(wf3d_dynres_t *dr) {
+	int src_w = dr->level ? dr->bufs[dr->level].width : dr->out->width;
+	for (int x = 0; x < dr->out->width; x++) {
+		dr->col_map[x] = x * src_w / dr->out->width;
+	}
+}
+
+// MAKEs dynamic resolution for an output buffer, with a frame time budget in microseconds.
+// Returns false if no reduced buffers could be made; it will then stay at full resolution.
+bool wf3d_dynres_init(wf3d_dynres_t *dr, pax_buf_t *out, int64_t budget) {
+	*dr = (wf3d_dynres_t) {
+		.out        = out,
+		.budget     = budget,
+		.high       = WF3D_DYNRES_HIGH,
+		.low        = WF3D_DYNRES_LOW,
+		.hysteresis = WF3D_DYNRES_HYSTERESIS,
+	};
+	
+	// Only whole-byte pixels can be upscaled by copying.
+	int bpp = PAX_GET_BPP(out->type);
+	// Read and written for every row flushed, so placed like scratch.
+	dr->col_map = wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_SCRATCH, sizeof(uint16_t) * out->width);
+	dr->band    = wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_SCRATCH, out->width * bpp / 8 * WF3D_DYNRES_BAND);
+	if (!dr->col_map || !dr->band || (bpp != 8 && bpp != 16 && bpp != 32)) return false;
+	
+	// Make the reduced buffers, stopping at the first that doesn't fit.
+	for (int i = 1; i < WF3D_DYNRES_LEVELS; i++) {
+		int w = out->width  * wf3d_dynres_quarters(i) / 4;
+		int h = out->height * wf3d_dynres_quarters(i) / 4;
+		pax_buf_init(&dr->bufs[i], NULL, w, h, out->type);
+		if (!dr->bufs[i].buf) break;
+		dr->bufs[i].reverse_endianness = out->reverse_endianness;
+		dr->max_level = i;
+	}
+	
+	wf3d_dynres_map(dr);
+	return dr->max_level > 0;
+}
+
+// DESTROYs dynamic resolution, freeing the reduced buffers.
+void wf3d_dynres_destroy(wf3d_dynres_t *dr) {
+	for (int i = 1; i <= dr->max_level; i++) {
+		pax_buf_destroy(&dr->bufs[i]);
+	}
+	wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_SCRATCH, dr->col_map);
+	wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_SCRATCH, dr->band);
+	*dr = (wf3d_dynres_t) {0};
+}
+
+// Gets the buffer to render the next frame into.
+pax_buf_t *wf3d_dynres_target(wf3d_dynres_t *dr) {
+	return dr->level ? &dr->bufs[dr->level] : dr->out;
+}
+
+// Upscales rows `y` to `y + rows` of the output from the reduced resolution buffer into `to`.
+static void wf3d_dynres_rows(wf3d_dynres_t *dr, uint8_t *to, int y0, int rows) {
+	pax_buf_t      *src    = &dr->bufs[dr->level];
+	pax_buf_t      *dst    = dr->out;
+	int             bpp    = PAX_GET_BPP(dst->type);
+	size_t          stride = dst->width * bpp / 8;
+	const uint16_t *map    = dr->col_map;
+	int             last_y = -1;
+	
+	for (int y = y0; y < y0 + rows; y++) {
+		int      src_y = y * src->height / dst->height;
+		uint8_t *row   = to + (y - y0) * stride;
+		
+		if (src_y == last_y) {
+			// Same source row: duplicate the previous output row.
+			memcpy(row, row - stride, stride);
+			continue;
+		}
+		last_y = src_y;
+		
+		// Nearest neighbour across the row.
+		if (bpp == 16) {
+			const uint16_t *in  = (const uint16_t *) src->buf + src_y * src->width;
+			uint16_t       *out = (uint16_t *) row;
+			for (int x = 0; x < dst->width; x++) out[x] = in[map[x]];
+		} else if (bpp == 32) {
+			const uint32_t *in  = (const uint32_t *) src->buf + src_y * src->width;
+			uint32_t       *out = (uint32_t *) row;
+			for (int x = 0; x < dst->width; x++) out[x] = in[map[x]];
+		} else {
+			const uint8_t  *in  = (const uint8_t *) src->buf + src_y * src->width;
+			for (int x = 0; x < dst->width; x++) row[x] = in[map[x]];
+		}
+	}
+}
+
+// Upscales the rendered frame into the output buffer, if it was rendered at reduced resolution.
+void wf3d_dynres_present(wf3d_dynres_t *dr) {
+	if (!dr->level) return;
+	wf3d_dynres_rows(dr, dr->out->buf, 0, dr->out->height);
+	pax_mark_dirty0(dr->out);
+}
+
+// Sends the rendered frame to the screen, upscaling a band of rows at a time on the way if it was rendered at reduced resolution.
+// Returns false if some rows could not be sent.
+bool wf3d_dynres_flush(wf3d_dynres_t *dr, wf3d_dynres_write_t write, void *args) {
+	if (!dr->level) {
+		// Already at full resolution.
+		return write(args, dr->out->buf, 0, dr->out->height);
+	}
+	
+	// Only a band of the output exists at a time, so the whole frame is never copied.
+	bool ok = true;
+	for (int y = 0; y < dr->out->height; y += WF3D_DYNRES_BAND) {
+		int rows = dr->out->height - y < WF3D_DYNRES_BAND ? dr->out->height - y : WF3D_DYNRES_BAND;
+		wf3d_dynres_rows(dr, dr->band, y, rows);
+		ok &= write(args, dr->band, y, rows);
+	}
+	return ok;
+}
+
+// Reports how long the last frame took in microseconds, possibly changing the resolution.
+// Returns whether the resolution changed.
+bool wf3d_dynres_frame(wf3d_dynres_t *dr, int64_t frame_us) {
+	if (!dr->budget) return false;
+	
+	// Smooth out single slow or fast frames.
+	dr->avg = dr->avg ? (dr->avg * 3 + frame_us) / 4 : frame_us;
+	
+	if (dr->avg * 100 > dr->budget * dr->high) {
+		dr->under = 0;
+		if (++dr->over >= dr->hysteresis && dr->level < dr->max_level) {
+			wf3d_dynres_set(dr, dr->level + 1);
+			return true;
+		}
+	} else if (dr->avg * 100 < dr->budget * dr->low) {
+		dr->over = 0;
+		if (++dr->under >= dr->hysteresis && dr->level > 0) {
+			wf3d_dynres_set(dr, dr->level - 1);
+			return true;
+		}
+	} else {
+		dr->over  = 0;
+		dr->under = 0;
+	}
+	
+	return false;
+}
+
+// Forces a resolution level.
+void wf3d_dynres_set(wf3d_dynres_t *dr, int level) {
+	if (level < 0) level = 0;
+	if (level > dr->max_level) level = dr->max_level;
+	
+	dr->level = level;
+	dr->over  = 0;
+	dr->under = 0;
+	// The old average was measured at another resolution.
+	dr->avg   = 0;
+	wf3d_dynres_map(dr);
+}
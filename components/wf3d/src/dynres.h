@@ -0,0 +1,119 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+
+
+
+// Amount of resolution levels, level 0 being full resolution.
+#define WF3D_DYNRES_LEVELS      3
+// Smoothed frame time above budget * HIGH / 100 lowers the resolution.
+#ifndef WF3D_DYNRES_HIGH
+#define WF3D_DYNRES_HIGH        100
+#endif
+// Smoothed frame time below budget * LOW / 100 raises the resolution.
+#ifndef WF3D_DYNRES_LOW
+#define WF3D_DYNRES_LOW         45
+#endif
+// Amount of consecutive frames past a threshold before the resolution changes.
+#ifndef WF3D_DYNRES_HYSTERESIS
+#define WF3D_DYNRES_HYSTERESIS  8
+#endif
+// Amount of output rows upscaled at a time while flushing.
+#ifndef WF3D_DYNRES_BAND
+#define WF3D_DYNRES_BAND        16
+#endif
+
+
+
+// Renders at reduced resolution when frames take too long, upscaling afterwards.
+typedef struct {
+	// The full resolution output buffer.
+	pax_buf_t *out;
+	// The reduced resolution buffers, index 0 is unused as it is the output buffer.
+	pax_buf_t  bufs[WF3D_DYNRES_LEVELS];
+	// Source column for every output column, at the current level.
+	uint16_t  *col_map;
+	// WF3D_DYNRES_BAND rows of output, upscaled while flushing.
+	void      *band;
+	
+	// Current resolution level.
+	int        level;
+	// Highest resolution level that may be used.
+	int        max_level;
+	// Frame time budget in microseconds, 0 to always render at full resolution.
+	int64_t    budget;
+	// Percentage of the budget above which to lower the resolution.
+	int        high;
+	// Percentage of the budget below which to raise the resolution.
+	int        low;
+	// Amount of consecutive frames past a threshold before the resolution changes.
+	int        hysteresis;
+	
+	// Smoothed frame time in microseconds.
+	int64_t    avg;
+	// Amount of consecutive frames over the high threshold.
+	int        over;
+	// Amount of consecutive frames under the low threshold.
+	int        under;
+} wf3d_dynres_t;
+
+// Sends `rows` rows of output pixels, starting at row `y`, to the screen.
+// Returns false if they could not be sent.
+typedef bool (*wf3d_dynres_write_t)(void *args, const void *pixels, int y, int rows);
+
+
+
+// MAKEs dynamic resolution for an output buffer, with a frame time budget in microseconds.
+// Returns false if no reduced buffers could be made; it will then stay at full resolution.
+bool       wf3d_dynres_init   (wf3d_dynres_t *dr, pax_buf_t *out, int64_t budget);
+// DESTROYs dynamic resolution, freeing the reduced buffers.
+void       wf3d_dynres_destroy(wf3d_dynres_t *dr);
+// Gets the buffer to render the next frame into.
+pax_buf_t *wf3d_dynres_target (wf3d_dynres_t *dr);
+// Upscales the rendered frame into the output buffer, if it was rendered at reduced resolution.
+void       wf3d_dynres_present(wf3d_dynres_t *dr);
+// Sends the rendered frame to the screen, upscaling a band of rows at a time on the way if it was rendered at reduced resolution.
+// Leaves the output buffer untouched; call before wf3d_dynres_frame, which may change the resolution.
+// Returns false if some rows could not be sent.
+bool       wf3d_dynres_flush  (wf3d_dynres_t *dr, wf3d_dynres_write_t write, void *args);
+// Reports how long the last frame took in microseconds, possibly changing the resolution.
+// Returns whether the resolution changed.
+bool       wf3d_dynres_frame  (wf3d_dynres_t *dr, int64_t frame_us);
+// Forces a resolution level.
+void       wf3d_dynres_set    (wf3d_dynres_t *dr, int level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DYNRES_H
@@ -103,9 +103,24 @@ matrix_3d_t matrix_3d_rotate_z(float angle) {
 // 3D matrix: matrix inversion, such that inverted multiplied by input (in any order) is identity.
 // Returns whether an inverse matrix was found.
 bool matrix_3d_invert(matrix_3d_t *out_ptr, matrix_3d_t a) {
-	matrix_3d_t out = matrix_3d_identity();
+	// Determinant of the linear part.
+	float det = a.xx * (a.yy * a.zz - a.zy * a.yz)
+	          - a.yx * (a.xy * a.zz - a.zy * a.xz)
+	          + a.zx * (a.xy * a.yz - a.yy * a.xz);
+	if (det == 0) return false;
+	float mul = 1.0 / det;
 	
-	//
+	// Invert the linear part using the adjugate.
+	matrix_3d_t out = { .arr = {
+		(a.yy * a.zz - a.zy * a.yz) * mul, (a.zx * a.yz - a.yx * a.zz) * mul, (a.yx * a.zy - a.zx * a.yy) * mul, 0,
+		(a.zy * a.xz - a.xy * a.zz) * mul, (a.xx * a.zz - a.zx * a.xz) * mul, (a.zx * a.xy - a.xx * a.zy) * mul, 0,
+		(a.xy * a.yz - a.yy * a.xz) * mul, (a.yx * a.xz - a.xx * a.yz) * mul, (a.xx * a.yy - a.yx * a.xy) * mul, 0,
+	}};
+	
+	// Then undo the translation.
+	out.dx = -(out.xx * a.dx + out.yx * a.dy + out.zx * a.dz);
+	out.dy = -(out.xy * a.dx + out.yy * a.dy + out.zy * a.dz);
+	out.dz = -(out.xz * a.dx + out.yz * a.dy + out.zz * a.dz);
 	
 	// Done!
 	*out_ptr = out;
@@ -0,0 +1,152 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "mem.h"
+#include <esp_log.h>
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+static const char *TAG = "wf-3d-mem";
+
+static const char *const class_names[WF3D_MEM_CLASSES] = {
+	"depth", "scratch", "queue", "mesh",
+};
+
+// The MEMORY POLICY of new DRAWING QUEUEs and the loaders.
+wf3d_mem_t wf3d_mem_default = {
+	.caps = {
+		[WF3D_MEM_DEPTH]   = { MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM   | MALLOC_CAP_8BIT },
+		[WF3D_MEM_SCRATCH] = { MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM   | MALLOC_CAP_8BIT },
+		[WF3D_MEM_QUEUE]   = { MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM   | MALLOC_CAP_8BIT },
+		// Shapes are only read in order, which PSRAM's cache handles well.
+		[WF3D_MEM_MESH]    = { MALLOC_CAP_SPIRAM   | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+	},
+};
+
+
+
+// Counts a buffer as in use.
+static void wf3d_mem_count(wf3d_mem_usage_t *usage, void *ptr) {
+	size_t size = heap_caps_get_allocated_size(ptr);
+	size_t total;
+	if (esp_ptr_external_ram(ptr)) {
+		atomic_fetch_add_explicit(&usage->num_external, 1, memory_order_relaxed);
+		total = atomic_fetch_add_explicit(&usage->external, size, memory_order_relaxed) + size
+			  + atomic_load_explicit(&usage->internal, memory_order_relaxed);
+	} else {
+		atomic_fetch_add_explicit(&usage->num_internal, 1, memory_order_relaxed);
+		total = atomic_fetch_add_explicit(&usage->internal, size, memory_order_relaxed) + size
+			  + atomic_load_explicit(&usage->external, memory_order_relaxed);
+	}
+	size_t peak = atomic_load_explicit(&usage->peak, memory_order_relaxed);
+	while (total > peak && !atomic_compare_exchange_weak_explicit(&usage->peak, &peak, total, memory_order_relaxed, memory_order_relaxed));
+}
+
+// Counts a buffer as no longer in use.
+static void wf3d_mem_uncount(wf3d_mem_usage_t *usage, void *ptr) {
+	size_t size = heap_caps_get_allocated_size(ptr);
+	if (esp_ptr_external_ram(ptr)) {
+		atomic_fetch_sub_explicit(&usage->num_external, 1, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&usage->external, size, memory_order_relaxed);
+	} else {
+		atomic_fetch_sub_explicit(&usage->num_internal, 1, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&usage->internal, size, memory_order_relaxed);
+	}
+}
+
+// Counts an allocation that fell back or failed.
+static void wf3d_mem_result(wf3d_mem_t *mem, wf3d_mem_class_t cls, size_t size, int tried, void *ptr) {
+	wf3d_mem_usage_t *usage = &mem->usage[cls];
+	if (!ptr) {
+		atomic_fetch_add_explicit(&usage->failures, 1, memory_order_relaxed);
+		ESP_LOGW(TAG, "Out of memory for %u bytes of %s", (unsigned) size, class_names[cls]);
+	} else if (tried) {
+		atomic_fetch_add_explicit(&usage->fallbacks, 1, memory_order_relaxed);
+		ESP_LOGD(TAG, "%u bytes of %s went to %s instead", (unsigned) size, class_names[cls],
+			esp_ptr_external_ram(ptr) ? "PSRAM" : "internal RAM");
+	}
+}
+
+
+
+// Allocates a buffer of a class; returns NULL if no capabilities of the class fit.
+void *wf3d_mem_alloc(wf3d_mem_t *mem, wf3d_mem_class_t cls, size_t size) {
+	void *ptr = NULL;
+	int   try = 0;
+	for (; try < WF3D_MEM_TRIES && mem->caps[cls][try]; try++) {
+		ptr = heap_caps_malloc(size, mem->caps[cls][try]);
+		if (ptr) break;
+	}
+	wf3d_mem_result(mem, cls, size, try, ptr);
+	if (ptr) wf3d_mem_count(&mem->usage[cls], ptr);
+	return ptr;
+}
+
+// Resizes a buffer of a class, which may move it; returns NULL and keeps it as it was if no capabilities fit.
+void *wf3d_mem_realloc(wf3d_mem_t *mem, wf3d_mem_class_t cls, void *ptr, size_t size) {
+	if (!ptr) return wf3d_mem_alloc(mem, cls, size);
+	
+	// Uncount first, as the old buffer is gone once a move succeeds.
+	wf3d_mem_uncount(&mem->usage[cls], ptr);
+	void *res = NULL;
+	int   try = 0;
+	for (; try < WF3D_MEM_TRIES && mem->caps[cls][try]; try++) {
+		res = heap_caps_realloc(ptr, size, mem->caps[cls][try]);
+		if (res) break;
+	}
+	wf3d_mem_result(mem, cls, size, try, res);
+	wf3d_mem_count(&mem->usage[cls], res ? res : ptr);
+	return res;
+}
+
+// Frees a buffer of a class, NULL is ignored.
+void wf3d_mem_free(wf3d_mem_t *mem, wf3d_mem_class_t cls, void *ptr) {
+	if (!ptr) return;
+	wf3d_mem_uncount(&mem->usage[cls], ptr);
+	heap_caps_free(ptr);
+}
+
+// Logs where the buffers of each class are and how much they use.
+void wf3d_mem_report(wf3d_mem_t *mem) {
+	for (int i = 0; i < WF3D_MEM_CLASSES; i++) {
+		wf3d_mem_usage_t *usage = &mem->usage[i];
+		ESP_LOGI(TAG, "%-7s %7u bytes in %2u internal, %7u bytes in %2u PSRAM, peak %7u, %u fallbacks, %u failed",
+			class_names[i],
+			(unsigned) atomic_load(&usage->internal), (unsigned) atomic_load(&usage->num_internal),
+			(unsigned) atomic_load(&usage->external), (unsigned) atomic_load(&usage->num_external),
+			(unsigned) atomic_load(&usage->peak),
+			(unsigned) atomic_load(&usage->fallbacks), (unsigned) atomic_load(&usage->failures)
+		);
+	}
+	ESP_LOGI(TAG, "free: %u bytes internal (largest %u), %u bytes PSRAM",
+		(unsigned) heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+		(unsigned) heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+		(unsigned) heap_caps_get_free_size(MALLOC_CAP_SPIRAM)
+	);
+}
@@ -0,0 +1,96 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef MEM_H
+#define MEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+#include <stdatomic.h>
+#include <esp_heap_caps.h>
+
+
+
+// Amount of capabilities tried per class of buffers.
+#define WF3D_MEM_TRIES          2
+
+// Classes of buffers, each placed in memory by its own capabilities.
+typedef enum {
+	// The DepthBuffer, read and written for every pixel drawn.
+	WF3D_MEM_DEPTH,
+	// Buffers that last for one render, such as projected vertices and sort keys.
+	WF3D_MEM_SCRATCH,
+	// The vertices, lines and triangles of DRAWING QUEUEs, filled every frame, and DISPLAY LISTs.
+	WF3D_MEM_QUEUE,
+	// Shapes made by the loaders, read every frame they are drawn in.
+	WF3D_MEM_MESH,
+	// Amount of classes.
+	WF3D_MEM_CLASSES,
+} wf3d_mem_class_t;
+
+// How much of one class of buffers is where.
+typedef struct {
+	// Bytes in use in internal RAM and in PSRAM.
+	_Atomic size_t   internal, external;
+	// Buffers in use in internal RAM and in PSRAM.
+	_Atomic uint32_t num_internal, num_external;
+	// Most bytes in use at once.
+	_Atomic size_t   peak;
+	// Allocations that did not get the first capabilities, or any.
+	_Atomic uint32_t fallbacks, failures;
+} wf3d_mem_usage_t;
+
+// A MEMORY POLICY: where each class of buffers goes, and how much of each is in use.
+// Safe to allocate from on several cores at once.
+struct wf3d_mem {
+	// heap_caps capabilities to try in order for each class; 0 ends the list early.
+	uint32_t         caps[WF3D_MEM_CLASSES][WF3D_MEM_TRIES];
+	// What has been allocated per class.
+	wf3d_mem_usage_t usage[WF3D_MEM_CLASSES];
+};
+
+// The MEMORY POLICY of new DRAWING QUEUEs and the loaders.
+// DepthBuffers, scratch and DRAWING QUEUEs go to internal RAM if they fit, shapes go to PSRAM if there is any.
+extern wf3d_mem_t wf3d_mem_default;
+
+
+
+// Allocates a buffer of a class; returns NULL if no capabilities of the class fit.
+void *wf3d_mem_alloc  (wf3d_mem_t *mem, wf3d_mem_class_t cls, size_t size);
+// Resizes a buffer of a class, which may move it; returns NULL and keeps it as it was if no capabilities fit.
+void *wf3d_mem_realloc(wf3d_mem_t *mem, wf3d_mem_class_t cls, void *ptr, size_t size);
+// Frees a buffer of a class, NULL is ignored.
+void  wf3d_mem_free   (wf3d_mem_t *mem, wf3d_mem_class_t cls, void *ptr);
+// Logs where the buffers of each class are and how much they use.
+void  wf3d_mem_report (wf3d_mem_t *mem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_H
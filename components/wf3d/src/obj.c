@@ -23,8 +23,10 @@
 */
 
 #include "obj.h"
+#include "mem.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 static bool obj_nextline(FILE *fd, char *out_buf, size_t out_cap) {
 	size_t out_written = 0;
@@ -65,13 +67,31 @@ static bool obj_expect(FILE *fd, const char *prefix, char *buf, size_t cap) {
 	return false;
 }
 
-static bool obj_lines_contains(size_t num_line, size_t *line_indices, size_t v0, size_t v1) {
+static size_t obj_lines_find(size_t num_line, size_t *line_indices, size_t v0, size_t v1) {
 	for (size_t i = 0; i < num_line; i++) {
 		if ((line_indices[i*2] == v0 && line_indices[i*2+1] == v1) || (line_indices[i*2] == v1 && line_indices[i*2+1] == v0)) {
-			return true;
+			return i;
 		}
 	}
-	return false;
+	return SIZE_MAX;
+}
+
+// Adds the line between two vertices of a face if it is new, and records the face as being next to it.
+static void obj_add_edge(size_t *num_line, size_t *line_indices, size_t *edge_faces, size_t v0, size_t v1, size_t face) {
+	size_t line = obj_lines_find(*num_line, line_indices, v0, v1);
+	if (line == SIZE_MAX) {
+		line = (*num_line) ++;
+		line_indices[line*2]   = v0;
+		line_indices[line*2+1] = v1;
+		edge_faces[line*2]     = SIZE_MAX;
+		edge_faces[line*2+1]   = SIZE_MAX;
+	}
+	// Edges shared by more than two faces keep the first two.
+	if (edge_faces[line*2] == SIZE_MAX) {
+		edge_faces[line*2]   = face;
+	} else if (edge_faces[line*2+1] == SIZE_MAX) {
+		edge_faces[line*2+1] = face;
+	}
 }
 
 // Decodes an .obj model file and makes a wireframe version of it.
@@ -84,11 +104,13 @@ wf3d_shape_t *s3d_decode_obj(FILE *fd) {
 	size_t vertices_size = num_vertex * sizeof(vec3f_t);
 	size_t lines_size    = num_line * sizeof(size_t) * 2;
 	size_t tris_size     = num_triangle * sizeof(size_t) * 3;
-	size_t memory        = (size_t) malloc(sizeof(wf3d_shape_t) + vertices_size + lines_size + num_triangle);
+	size_t memory        = (size_t) wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_MESH, sizeof(wf3d_shape_t) + vertices_size + tris_size + 2 * lines_size);
+	if (!memory) return NULL;
 	wf3d_shape_t *shape        = (void *)  memory;
 	vec3f_t      *vertices     = (void *) (memory + sizeof(wf3d_shape_t));
 	size_t       *tri_indices  = (void *) (memory + sizeof(wf3d_shape_t) + vertices_size);
 	size_t       *line_indices = (void *) (memory + sizeof(wf3d_shape_t) + vertices_size + tris_size);
+	size_t       *edge_faces   = (void *) (memory + sizeof(wf3d_shape_t) + vertices_size + tris_size + lines_size);
 	
 	char tmp[64];
 	
@@ -127,22 +149,10 @@ wf3d_shape_t *s3d_decode_obj(FILE *fd) {
 		tri_indices[i*3+1] = v1;
 		tri_indices[i*3+2] = v2;
 		
-		// Add lines to the list.
-		if (!obj_lines_contains(real_line, line_indices, v0, v1)) {
-			line_indices[real_line*2]   = v0;
-			line_indices[real_line*2+1] = v1;
-			real_line ++;
-		}
-		if (!obj_lines_contains(real_line, line_indices, v2, v1)) {
-			line_indices[real_line*2]   = v2;
-			line_indices[real_line*2+1] = v1;
-			real_line ++;
-		}
-		if (!obj_lines_contains(real_line, line_indices, v0, v2)) {
-			line_indices[real_line*2]   = v0;
-			line_indices[real_line*2+1] = v2;
-			real_line ++;
-		}
+		// Add lines to the list, with the faces on either side.
+		obj_add_edge(&real_line, line_indices, edge_faces, v0, v1, i);
+		obj_add_edge(&real_line, line_indices, edge_faces, v2, v1, i);
+		obj_add_edge(&real_line, line_indices, edge_faces, v0, v2, i);
 	}
 	
 	shape->num_vertex   = num_vertex;
@@ -151,9 +161,11 @@ wf3d_shape_t *s3d_decode_obj(FILE *fd) {
 	shape->line_indices = line_indices;
 	shape->num_tri      = num_triangle;
 	shape->tri_indices  = tri_indices;
+	shape->edge_faces   = edge_faces;
+	shape->serial       = s3d_serial();
 	return shape;
 	
 	error:
-	free((void *) memory);
+	wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_MESH, (void *) memory);
 	return NULL;
 }
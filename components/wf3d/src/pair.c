@@ -0,0 +1,116 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+#include "pair.h"
+#include "mem.h"
+
+
+
+// Exchanges the contents of two DRAWING QUEUEs, leaving their settings in place.
+// Both must have the same MEMORY POLICY, as the buffers are freed and grown by the one they end up in.
+static void wf3d_pair_exchange(wf3d_ctx_t *a, wf3d_ctx_t *b) {
+	wf3d_ctx_t tmp = *a;
+	
+	a->num_vertex = b->num_vertex;
+	a->cap_vertex = b->cap_vertex;
+	a->vertices   = b->vertices;
+	a->num_line   = b->num_line;
+	a->cap_line   = b->cap_line;
+	a->lines      = b->lines;
+	a->line_faces = b->line_faces;
+	a->num_tri    = b->num_tri;
+	a->cap_tri    = b->cap_tri;
+	a->tris       = b->tris;
+	a->sig        = b->sig;
+	a->kept       = b->kept;
+	a->stats      = b->stats;
+	
+	b->num_vertex = tmp.num_vertex;
+	b->cap_vertex = tmp.cap_vertex;
+	b->vertices   = tmp.vertices;
+	b->num_line   = tmp.num_line;
+	b->cap_line   = tmp.cap_line;
+	b->lines      = tmp.lines;
+	b->line_faces = tmp.line_faces;
+	b->num_tri    = tmp.num_tri;
+	b->cap_tri    = tmp.cap_tri;
+	b->tris       = tmp.tris;
+	b->sig        = tmp.sig;
+	b->kept       = tmp.kept;
+	b->stats      = tmp.stats;
+}
+
+
+
+// MAKEs a pair of DRAWING QUEUEs, with the default MEMORY POLICY; set up `front` like a single one.
+void wf3d_pair_init(wf3d_pair_t *pair) {
+	wf3d_pair_init_mem(pair, &wf3d_mem_default);
+}
+
+// MAKEs a pair of DRAWING QUEUEs, with the buffers of both placed by `mem`; set up `front` like a single one.
+// Buffers move between the two, so they cannot have MEMORY POLICIES of their own.
+void wf3d_pair_init_mem(wf3d_pair_t *pair, wf3d_mem_t *mem) {
+	wf3d_init_mem(&pair->front, mem);
+	wf3d_init_mem(&pair->back,  mem);
+	atomic_init(&pair->ready, false);
+	pair->swaps = 0;
+}
+
+// DESTROYs a pair of DRAWING QUEUEs.
+void wf3d_pair_destroy(wf3d_pair_t *pair) {
+	wf3d_destroy(&pair->front);
+	wf3d_destroy(&pair->back);
+}
+
+// Builder: gets the DRAWING QUEUE to fill, or NULL while the renderer has not taken the previous frame yet.
+wf3d_ctx_t *wf3d_pair_back(wf3d_pair_t *pair) {
+	if (atomic_load_explicit(&pair->ready, memory_order_acquire)) return NULL;
+	// Whether the PRIMITIVE SINK keeps shapes, and how shapes are drawn, is decided while filling.
+	pair->back.sink       = pair->front.sink;
+	pair->back.depth_mode = pair->front.depth_mode;
+	pair->back.draw_mode  = pair->front.draw_mode;
+	// Its buffers end up in `front`, so must come from the same place.
+	pair->back.mem        = pair->front.mem;
+	return &pair->back;
+}
+
+// Builder: hands the filled DRAWING QUEUE to the renderer; do not touch it until wf3d_pair_back returns it again.
+void wf3d_pair_submit(wf3d_pair_t *pair) {
+	atomic_store_explicit(&pair->ready, true, memory_order_release);
+}
+
+// Renderer: CLEARs `front` and swaps in the submitted frame, if there is one.
+// Returns whether `front` holds a new frame.
+bool wf3d_pair_swap(wf3d_pair_t *pair) {
+	if (!atomic_load_explicit(&pair->ready, memory_order_acquire)) return false;
+	
+	// CLEAR first, so the STATISTICS of the frame just presented are kept.
+	wf3d_clear(&pair->front);
+	wf3d_pair_exchange(&pair->front, &pair->back);
+	wf3d_reset_3d(&pair->back);
+	pair->swaps ++;
+	
+	atomic_store_explicit(&pair->ready, false, memory_order_release);
+	return true;
+}
@@ -0,0 +1,74 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef PAIR_H
+#define PAIR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+#include <stdatomic.h>
+
+
+
+// Two DRAWING QUEUEs, so one core can fill the next frame while another DRAWs this one.
+// The builder only touches `back` and the renderer only touches `front`; they swap at frame boundaries,
+// exchanging buffers rather than copying primitives.
+typedef struct {
+	// DRAWn from, holds the settings such as the DepthBuffer and PRIMITIVE SINK.
+	// Its MEMORY POLICY is that of the pair, and must not be changed.
+	wf3d_ctx_t   front;
+	// Filled with the next frame.
+	wf3d_ctx_t   back;
+	// Whether `back` holds a whole frame that the renderer has not taken yet.
+	_Atomic bool ready;
+	// Amount of frames taken by the renderer.
+	uint32_t     swaps;
+} wf3d_pair_t;
+
+
+
+// MAKEs a pair of DRAWING QUEUEs, with the default MEMORY POLICY; set up `front` like a single one.
+void        wf3d_pair_init    (wf3d_pair_t *pair);
+// MAKEs a pair of DRAWING QUEUEs, with the buffers of both placed by `mem`; set up `front` like a single one.
+// Buffers move between the two, so they cannot have MEMORY POLICIES of their own.
+void        wf3d_pair_init_mem(wf3d_pair_t *pair, wf3d_mem_t *mem);
+// DESTROYs a pair of DRAWING QUEUEs.
+void        wf3d_pair_destroy (wf3d_pair_t *pair);
+// Builder: gets the DRAWING QUEUE to fill, or NULL while the renderer has not taken the previous frame yet.
+wf3d_ctx_t *wf3d_pair_back    (wf3d_pair_t *pair);
+// Builder: hands the filled DRAWING QUEUE to the renderer; do not touch it until wf3d_pair_back returns it again.
+void        wf3d_pair_submit  (wf3d_pair_t *pair);
+// Renderer: CLEARs `front` and swaps in the submitted frame, if there is one.
+// Returns whether `front` holds a new frame.
+bool        wf3d_pair_swap    (wf3d_pair_t *pair);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PAIR_H
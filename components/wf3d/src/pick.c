@@ -0,0 +1,268 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "pick.h"
+#include "mem.h"
+#include <math.h>
+
+
+
+// Subtracts two vectors.
+static inline vec3f_t vec3f_sub(vec3f_t a, vec3f_t b) {
+	return (vec3f_t) { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+// Dot product of two vectors.
+static inline float vec3f_dot(vec3f_t a, vec3f_t b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Cross product of two vectors.
+static inline vec3f_t vec3f_cross(vec3f_t a, vec3f_t b) {
+	return (vec3f_t) {
+		a.y * b.z - a.z * b.y,
+		a.z * b.x - a.x * b.z,
+		a.x * b.y - a.y * b.x,
+	};
+}
+
+
+
+// Turns a screen coordinate into a ray, in the space of the current MATRIX.
+wf3d_ray_t wf3d_screen_ray(pax_buf_t *buf, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix, float x, float y) {
+	// Undo the screen transform used by wf3d_render.
+	float scale = fminf(buf->width, buf->height);
+	float px    =  (x - buf->width  / 2.0) / (scale / 2);
+	float py    = -(y - buf->height / 2.0) / (scale / 2);
+	
+	// Projection is x * focal / (focal + z), so the eye sits at z = -focal.
+	// At t = 1 the ray crosses z = 0, in front of which nothing is drawn.
+	float      focal = wf3d_get_foc(buf, ctx);
+	wf3d_ray_t ray   = {
+		.origin = { 0,  0,  -focal },
+		.dir    = { px, py,  focal },
+		.t_min  = 1,
+		.t_max  = INFINITY,
+	};
+	
+	// Bring it into the space of the current MATRIX.
+	matrix_3d_t inv;
+	if (!matrix_3d_invert(&inv, matrix_3d_multiply(cam_matrix, ctx->stack.value))) {
+		ray.t_max = 0;
+		return ray;
+	}
+	return wf3d_ray_xform(inv, ray);
+}
+
+// Intersects a ray with a triangle (Moller-Trumbore).
+float wf3d_ray_tri(wf3d_ray_t ray, vec3f_t a, vec3f_t b, vec3f_t c, float *bary_out) {
+	vec3f_t edge1 = vec3f_sub(b, a);
+	vec3f_t edge2 = vec3f_sub(c, a);
+	vec3f_t pvec  = vec3f_cross(ray.dir, edge2);
+	float   det   = vec3f_dot(edge1, pvec);
+	if (det == 0) return INFINITY;
+	float   mul   = 1.0 / det;
+	
+	vec3f_t tvec  = vec3f_sub(ray.origin, a);
+	float   u     = vec3f_dot(tvec, pvec) * mul;
+	if (u < 0 || u > 1) return INFINITY;
+	
+	vec3f_t qvec  = vec3f_cross(tvec, edge1);
+	float   v     = vec3f_dot(ray.dir, qvec) * mul;
+	if (v < 0 || u + v > 1) return INFINITY;
+	
+	float   t     = vec3f_dot(edge2, qvec) * mul;
+	if (t < ray.t_min || t > ray.t_max) return INFINITY;
+	
+	if (bary_out) {
+		bary_out[0] = 1 - u - v;
+		bary_out[1] = u;
+		bary_out[2] = v;
+	}
+	return t;
+}
+
+
+
+// BUILDs a BVH over the triangles of a shape, for picking.
+bool wf3d_shape_bvh(wf3d_bvh_t *bvh, const wf3d_shape_t *shape) {
+	wf3d_aabb_t *bounds = wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_SCRATCH, sizeof(wf3d_aabb_t) * (shape->num_tri ? shape->num_tri : 1));
+	if (!bounds) return false;
+	
+	for (size_t i = 0; i < shape->num_tri; i++) {
+		bounds[i] = wf3d_aabb_empty();
+		for (size_t x = 0; x < 3; x++) {
+			size_t idx = shape->tri_indices[i*3 + x];
+			if (idx >= shape->num_vertex) {
+				// Invalid triangles are never hit.
+				bounds[i] = wf3d_aabb_empty();
+				break;
+			}
+			vec3f_t vtx = shape->vertices[idx];
+			bounds[i] = wf3d_aabb_union(bounds[i], (wf3d_aabb_t) { vtx, vtx });
+		}
+	}
+	
+	bool res = wf3d_bvh_build(bvh, shape->num_tri, bounds);
+	wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_SCRATCH, bounds);
+	return res;
+}
+
+// Arguments for pick_tri_cb.
+typedef struct {
+	const wf3d_shape_t *shape;
+	wf3d_hit_t         *hit;
+} pick_tri_args_t;
+
+// Tests a single triangle found in a triangle BVH.
+static float pick_tri_cb(void *raw_args, size_t tri, wf3d_ray_t ray) {
+	pick_tri_args_t    *args  = raw_args;
+	const wf3d_shape_t *shape = args->shape;
+	float bary[3];
+	float dist = wf3d_ray_tri(
+		ray,
+		shape->vertices[shape->tri_indices[tri*3]],
+		shape->vertices[shape->tri_indices[tri*3+1]],
+		shape->vertices[shape->tri_indices[tri*3+2]],
+		bary
+	);
+	
+	// The BVH only passes rays up to the nearest hit, so any hit is the new nearest.
+	if (dist != INFINITY) {
+		args->hit->tri     = tri;
+		args->hit->dist    = dist;
+		args->hit->bary[0] = bary[0];
+		args->hit->bary[1] = bary[1];
+		args->hit->bary[2] = bary[2];
+	}
+	return dist;
+}
+
+// Finds the nearest triangle of a shape hit by a ray, in the space of the shape.
+bool wf3d_pick_shape(const wf3d_shape_t *shape, const wf3d_bvh_t *tri_bvh, wf3d_ray_t ray, wf3d_hit_t *hit) {
+	pick_tri_args_t args = { shape, hit };
+	
+	if (tri_bvh) {
+		return wf3d_bvh_raycast(tri_bvh, ray, pick_tri_cb, &args) != INFINITY;
+	}
+	
+	// No BVH: test every triangle.
+	bool found = false;
+	for (size_t i = 0; i < shape->num_tri; i++) {
+		size_t idx0 = shape->tri_indices[i*3];
+		size_t idx1 = shape->tri_indices[i*3+1];
+		size_t idx2 = shape->tri_indices[i*3+2];
+		if (idx0 >= shape->num_vertex || idx1 >= shape->num_vertex || idx2 >= shape->num_vertex) continue;
+		float dist = pick_tri_cb(&args, i, ray);
+		if (dist != INFINITY) {
+			ray.t_max = dist;
+			found     = true;
+		}
+	}
+	return found;
+}
+
+
+
+// Gets the cached triangle BVH of a shape, building it if needed.
+// The cache goes by pointer and SERIAL, so a shape freed and replaced at the same address gets a new BVH.
+static const wf3d_bvh_t *pick_shape_bvh(wf3d_scene_t *scene, const wf3d_shape_t *shape) {
+	for (size_t i = 0; i < scene->num_shape_bvh; i++) {
+		if (scene->shape_bvhs[i].shape != shape) continue;
+		if (scene->shape_bvhs[i].serial == shape->serial) return &scene->shape_bvhs[i].bvh;
+		// The old shape is gone, and so is its BVH.
+		wf3d_scene_forget_shape(scene, shape);
+		break;
+	}
+	
+	wf3d_shape_bvh_t *mem = realloc(scene->shape_bvhs, sizeof(wf3d_shape_bvh_t) * (scene->num_shape_bvh + 1));
+	if (!mem) return NULL;
+	scene->shape_bvhs = mem;
+	
+	wf3d_shape_bvh_t *entry = &scene->shape_bvhs[scene->num_shape_bvh];
+	*entry = (wf3d_shape_bvh_t) { .shape = shape, .serial = shape->serial };
+	if (!wf3d_shape_bvh(&entry->bvh, shape)) return NULL;
+	scene->num_shape_bvh ++;
+	return &entry->bvh;
+}
+
+// Arguments for pick_node_cb.
+typedef struct {
+	wf3d_scene_t *scene;
+	wf3d_hit_t   *hit;
+} pick_node_args_t;
+
+// Tests a single NODE whose bounds were hit.
+static float pick_node_cb(void *raw_args, size_t obj, wf3d_ray_t ray) {
+	pick_node_args_t *args = raw_args;
+	wf3d_node_t      *node = &args->scene->nodes[obj];
+	if (!node->shape) return INFINITY;
+	
+	// Bring the ray into the NODE's space; distances stay the same.
+	matrix_3d_t inv;
+	if (!matrix_3d_invert(&inv, node->world)) return INFINITY;
+	ray = wf3d_ray_xform(inv, ray);
+	
+	wf3d_hit_t hit;
+	if (!wf3d_pick_shape(node->shape, pick_shape_bvh(args->scene, node->shape), ray, &hit)) return INFINITY;
+	hit.node   = obj;
+	*args->hit = hit;
+	return hit.dist;
+}
+
+// Finds the nearest triangle in a SCENE hit by a ray, in the space of the SCENE.
+bool wf3d_pick_scene(wf3d_scene_t *scene, wf3d_ray_t ray, wf3d_hit_t *hit) {
+	pick_node_args_t args = { scene, hit };
+	float dist = INFINITY;
+	
+	if (wf3d_scene_build_bvh(scene)) {
+		dist = wf3d_bvh_raycast(&scene->bvh, ray, pick_node_cb, &args);
+		
+	} else {
+		// Out of memory: test the bounds of every NODE.
+		for (size_t i = 0; i < scene->num_node; i++) {
+			wf3d_node_t *node = &scene->nodes[i];
+			if (wf3d_ray_aabb(ray, wf3d_aabb_xform(node->world, node->bounds)) == INFINITY) continue;
+			float res = pick_node_cb(&args, i, ray);
+			if (res < dist) {
+				dist      = res;
+				ray.t_max = res;
+			}
+		}
+	}
+	
+	if (dist == INFINITY) return false;
+	hit->pos = (vec3f_t) {
+		ray.origin.x + ray.dir.x * dist,
+		ray.origin.y + ray.dir.y * dist,
+		ray.origin.z + ray.dir.z * dist,
+	};
+	return true;
+}
+
+// Finds the nearest triangle in a SCENE under a screen coordinate, with the SCENE drawn under the current MATRIX.
+bool wf3d_pick(pax_buf_t *buf, wf3d_ctx_t *ctx, wf3d_scene_t *scene, matrix_3d_t cam_matrix, float x, float y, wf3d_hit_t *hit) {
+	return wf3d_pick_scene(scene, wf3d_screen_ray(buf, ctx, cam_matrix, x, y), hit);
+}
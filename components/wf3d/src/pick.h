@@ -0,0 +1,82 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef PICK_H
+#define PICK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+#include "bvh.h"
+#include "scene.h"
+
+
+
+// A triangle found by picking.
+typedef struct {
+	// Index of the scene node hit.
+	size_t  node;
+	// Index of the triangle hit within the shape.
+	size_t  tri;
+	// Barycentric coordinates of the hit: the weights of the triangle's three vertices.
+	float   bary[3];
+	// Distance along the picking ray.
+	float   dist;
+	// Position of the hit, in the space of the ray.
+	vec3f_t pos;
+} wf3d_hit_t;
+
+
+
+// Turns a screen coordinate into a ray, in the space of the current MATRIX.
+// Uses the same projection as wf3d_render, and starts at the near cutoff.
+wf3d_ray_t wf3d_screen_ray(pax_buf_t *buf, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix, float x, float y);
+// Intersects a ray with a triangle.
+// Returns the distance along the ray, or INFINITY if it misses, and the barycentric coordinates of a hit.
+float      wf3d_ray_tri   (wf3d_ray_t ray, vec3f_t a, vec3f_t b, vec3f_t c, float *bary_out);
+
+// BUILDs a BVH over the triangles of a shape, for picking.
+// Returns whether enough memory was available.
+bool       wf3d_shape_bvh (wf3d_bvh_t *bvh, const wf3d_shape_t *shape);
+// Finds the nearest triangle of a shape hit by a ray, in the space of the shape.
+// Uses a triangle BVH if given, otherwise tests every triangle.
+// Returns whether any triangle was hit.
+bool       wf3d_pick_shape(const wf3d_shape_t *shape, const wf3d_bvh_t *tri_bvh, wf3d_ray_t ray, wf3d_hit_t *hit);
+// Finds the nearest triangle in a SCENE hit by a ray, in the space of the SCENE.
+// Tests the bounds of NODEs first, then their triangle BVHs, which are built on first use and kept per shape and SERIAL.
+// After editing a shape in place, use wf3d_scene_forget_shape.
+// Returns whether any triangle was hit.
+bool       wf3d_pick_scene(wf3d_scene_t *scene, wf3d_ray_t ray, wf3d_hit_t *hit);
+// Finds the nearest triangle in a SCENE under a screen coordinate, with the SCENE drawn under the current MATRIX.
+// Returns whether any triangle was hit.
+bool       wf3d_pick      (pax_buf_t *buf, wf3d_ctx_t *ctx, wf3d_scene_t *scene, matrix_3d_t cam_matrix, float x, float y, wf3d_hit_t *hit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PICK_H
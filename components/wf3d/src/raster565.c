@@ -0,0 +1,252 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "raster565.h"
+#include <math.h>
+
+// Byte swaps an RGB565 color.
+static inline uint16_t wf3d_565_swap(uint16_t col) {
+	return (col >> 8) | (col << 8);
+}
+
+
+
+// Gets the SHADE PALETTE for a color, building it if it isn't cached.
+const wf3d_palette565_t *wf3d_palette565(wf3d_ctx_t *ctx, pax_col_t base) {
+	for (size_t i = 0; i < WF3D_PALETTE_CACHE; i++) {
+		if (ctx->palettes[i].valid && ctx->palettes[i].base == base) {
+			return &ctx->palettes[i];
+		}
+	}
+	
+	// Replace the oldest one.
+	wf3d_palette565_t *pal = &ctx->palettes[ctx->next_palette];
+	ctx->next_palette = (ctx->next_palette + 1) % WF3D_PALETTE_CACHE;
+	pal->valid = true;
+	pal->base  = base;
+	for (int i = 0; i < 256; i++) {
+		pal->shade[i] = wf3d_col_to_565(pax_col_lerp(i, 0xff000000, base));
+	}
+	return pal;
+}
+
+
+
+// Starts a render pass straight into `to`, with the context's current COLOR MASK.
+// Returns false if `to` is not an RGB565 buffer, in which case pax must be used.
+bool wf3d_raster565_begin(wf3d_raster565_t *raster, pax_buf_t *to, wf3d_ctx_t *ctx) {
+	if (!WF3D_RASTER565 || to->type != PAX_BUF_16_565RGB) return false;
+	
+	// pax may still be drawing into the buffer on the other core.
+	pax_join();
+	
+	uint16_t mask = wf3d_col_to_565(ctx->mask);
+	*raster = (wf3d_raster565_t) {
+		.ctx                = ctx,
+		.pixels             = to->buf,
+		.width              = to->width,
+		.height             = to->height,
+		.reverse_endianness = to->reverse_endianness,
+		.mask               = to->reverse_endianness ? wf3d_565_swap(mask) : mask,
+		.reciprocal         = ctx->depth_mode == WF3D_DEPTH_RECIPROCAL,
+		.painter            = ctx->depth_mode == WF3D_DEPTH_NONE,
+		// Same transform as the pax path: origin centered, y up, shortest side spans -1 to 1.
+		.center_x           = to->width  / 2.0,
+		.center_y           = to->height / 2.0,
+		.scale              = fminf(to->width, to->height) / 2.0,
+	};
+	return true;
+}
+
+// Finishes a render pass.
+void wf3d_raster565_end(wf3d_raster565_t *raster, pax_buf_t *to) {
+	pax_mark_dirty0(to);
+}
+
+
+
+// Fills one span of a triangle; inlined once per depth comparison.
+static inline uint32_t wf3d_raster565_span(uint16_t *pixels, depth_t *depth, int count, float z, float dz, uint16_t color, uint16_t mask, bool reciprocal) {
+	uint32_t passed = 0;
+	for (int i = 0; i < count; i++) {
+		int32_t d = z + dz * i;
+		if (d < 0)          d = 0;
+		if (d > UINT16_MAX) d = UINT16_MAX;
+		
+		if (reciprocal ? d > depth[i] : d < depth[i]) {
+			depth[i]  = d;
+			pixels[i] = (color & mask) | (pixels[i] & ~mask);
+			passed ++;
+		}
+	}
+	return passed;
+}
+
+// Fills one span of a triangle without a DepthBuffer.
+static inline void wf3d_raster565_fill(uint16_t *pixels, int count, uint16_t color, uint16_t mask) {
+	if (mask == 0xffff) {
+		for (int i = 0; i < count; i++) pixels[i] = color;
+	} else {
+		for (int i = 0; i < count; i++) pixels[i] = (color & mask) | (pixels[i] & ~mask);
+	}
+}
+
+// Draws a depth tested triangle in a single color; without a DepthBuffer, it is drawn over everything.
+// Points are projected coordinates, depths are encoded for the DepthBuffer.
+void wf3d_raster565_tri(wf3d_raster565_t *raster, uint16_t color, vec3f_t p0, vec3f_t p1, vec3f_t p2, float d0, float d1, float d2) {
+	// Into screen space.
+	float x[3] = {
+		raster->center_x + p0.x * raster->scale,
+		raster->center_x + p1.x * raster->scale,
+		raster->center_x + p2.x * raster->scale,
+	};
+	float y[3] = {
+		raster->center_y - p0.y * raster->scale,
+		raster->center_y - p1.y * raster->scale,
+		raster->center_y - p2.y * raster->scale,
+	};
+	float d[3] = {d0, d1, d2};
+	
+	// Make the winding positive so the inside is where all edges are positive.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0 || !isfinite(area)) return;
+	if (area < 0) {
+		float tmp;
+		tmp = x[1]; x[1] = x[2]; x[2] = tmp;
+		tmp = y[1]; y[1] = y[2]; y[2] = tmp;
+		tmp = d[1]; d[1] = d[2]; d[2] = tmp;
+		area = -area;
+	}
+	
+	// Edge i is opposite vertex i: e(x, y) = a * x + b * y + c, which is `area` at vertex i.
+	float a[3], b[3], c[3];
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3, k = (i + 2) % 3;
+		a[i] = y[j] - y[k];
+		b[i] = x[k] - x[j];
+		c[i] = -(a[i] * x[j] + b[i] * y[j]);
+	}
+	
+	// Depth is the barycentric blend of the vertex depths, a plane in screen space.
+	float za = (a[0] * d[0] + a[1] * d[1] + a[2] * d[2]) / area;
+	float zb = (b[0] * d[0] + b[1] * d[1] + b[2] * d[2]) / area;
+	float zc = (c[0] * d[0] + c[1] * d[1] + c[2] * d[2]) / area;
+	
+	// Rows whose pixel centers the triangle may cover.
+	float min_y = fmaxf(fminf(y[0], fminf(y[1], y[2])), 0);
+	float max_y = fminf(fmaxf(y[0], fmaxf(y[1], y[2])), raster->height);
+	int   y0    = ceilf (min_y - 0.5f);
+	int   y1    = floorf(max_y - 0.5f);
+	
+	if (raster->reverse_endianness) color = wf3d_565_swap(color);
+	uint32_t passed = 0, tested = 0;
+	
+	for (int py = y0; py <= y1; py++) {
+		float cy = py + 0.5f;
+		
+		// Intersect the row with every edge's inside.
+		float lo = 0, hi = raster->width;
+		for (int i = 0; i < 3; i++) {
+			float rest = b[i] * cy + c[i];
+			if (a[i] > 0) {
+				lo = fmaxf(lo, -rest / a[i]);
+			} else if (a[i] < 0) {
+				hi = fminf(hi, rest / -a[i]);
+			} else if (rest < 0) {
+				hi = -1;
+			}
+		}
+		int x0 = ceilf (lo - 0.5f);
+		int x1 = floorf(hi - 0.5f);
+		if (x1 >= raster->width) x1 = raster->width - 1;
+		if (x0 > x1) continue;
+		
+		size_t idx = x0 + py * raster->width;
+		float  z   = za * (x0 + 0.5f) + zb * cy + zc;
+		tested += x1 - x0 + 1;
+		if (raster->painter) {
+			wf3d_raster565_fill(raster->pixels + idx, x1 - x0 + 1, color, raster->mask);
+			passed += x1 - x0 + 1;
+		} else if (raster->reciprocal) {
+			passed += wf3d_raster565_span(raster->pixels + idx, raster->ctx->depth + idx, x1 - x0 + 1, z, za, color, raster->mask, true);
+		} else {
+			passed += wf3d_raster565_span(raster->pixels + idx, raster->ctx->depth + idx, x1 - x0 + 1, z, za, color, raster->mask, false);
+		}
+	}
+	
+	WF3D_STAT(wf3d_stats_pixels(raster->ctx, tested, passed));
+	(void) tested;
+	(void) passed;
+}
+
+// Draws a line, BLENDing with the per-channel MAXIMUM or saturating ADDITION.
+// Points are projected coordinates.
+void wf3d_raster565_line(wf3d_raster565_t *raster, wf3d_blend_t blend, uint16_t color, vec3f_t p0, vec3f_t p1) {
+	float x0 = raster->center_x + p0.x * raster->scale;
+	float y0 = raster->center_y - p0.y * raster->scale;
+	float dx = raster->center_x + p1.x * raster->scale - x0;
+	float dy = raster->center_y - p1.y * raster->scale - y0;
+	
+	// Clip to the buffer (Liang-Barsky).
+	float t0 = 0, t1 = 1;
+	float p[4] = { -dx, dx, -dy, dy };
+	float q[4] = { x0, raster->width - 0.001f - x0, y0, raster->height - 0.001f - y0 };
+	for (int i = 0; i < 4; i++) {
+		if (p[i] == 0) {
+			if (q[i] < 0) return;
+		} else {
+			float t = q[i] / p[i];
+			if (p[i] < 0) {
+				if (t > t1) return;
+				if (t > t0) t0 = t;
+			} else {
+				if (t < t0) return;
+				if (t < t1) t1 = t;
+			}
+		}
+	}
+	if (!isfinite(t0) || !isfinite(t1)) return;
+	
+	// Step one pixel at a time along the major axis.
+	float sx    = x0 + dx * t0;
+	float sy    = y0 + dy * t0;
+	float len   = fmaxf(fabsf(dx), fabsf(dy)) * (t1 - t0);
+	int   steps = len;
+	float step_x = steps ? dx * (t1 - t0) / steps : 0;
+	float step_y = steps ? dy * (t1 - t0) / steps : 0;
+	
+	for (int i = 0; i <= steps; i++) {
+		int px = sx + step_x * i;
+		int py = sy + step_y * i;
+		if (px < 0 || px >= raster->width || py < 0 || py >= raster->height) continue;
+		
+		uint16_t *pixel = &raster->pixels[px + py * raster->width];
+		if (raster->reverse_endianness) {
+			*pixel = wf3d_565_swap(wf3d_565_blend(blend, wf3d_565_swap(*pixel), color));
+		} else {
+			*pixel = wf3d_565_blend(blend, *pixel, color);
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef RASTER565_H
+#define RASTER565_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+
+
+
+// Whether wf3d draws straight into RGB565 buffers instead of through pax shaders.
+#ifndef WF3D_RASTER565
+#define WF3D_RASTER565          1
+#endif
+
+
+
+// One render pass straight into an RGB565 buffer.
+typedef struct {
+	// The context being rendered, for the DepthBuffer and STATISTICS.
+	wf3d_ctx_t *ctx;
+	// The pixels of the buffer.
+	uint16_t   *pixels;
+	// Size of the buffer.
+	int         width, height;
+	// Whether pixels are stored byte swapped.
+	bool        reverse_endianness;
+	// Channels written by triangles, as stored in the buffer.
+	uint16_t    mask;
+	// Whether the DepthBuffer holds reciprocal depth, where larger is closer.
+	bool        reciprocal;
+	// Whether there is no DepthBuffer, so triangles cover whatever was drawn before them.
+	bool        painter;
+	// Screen position of the projected origin.
+	float       center_x, center_y;
+	// Pixels per projected unit.
+	float       scale;
+} wf3d_raster565_t;
+
+
+
+// Converts an ARGB8888 color to RGB565.
+static inline uint16_t wf3d_col_to_565(pax_col_t col) {
+	return ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f);
+}
+
+// Per-channel MAXIMUM of two RGB565 colors.
+static inline uint16_t wf3d_565_max(uint16_t a, uint16_t b) {
+	// Masked fields compare like the channels themselves, no shifting needed.
+	uint16_t r = (a & 0xf800) > (b & 0xf800) ? (a & 0xf800) : (b & 0xf800);
+	uint16_t g = (a & 0x07e0) > (b & 0x07e0) ? (a & 0x07e0) : (b & 0x07e0);
+	uint16_t bl = (a & 0x001f) > (b & 0x001f) ? (a & 0x001f) : (b & 0x001f);
+	return r | g | bl;
+}
+
+// Per-channel saturating ADDITION of two RGB565 colors.
+static inline uint16_t wf3d_565_add(uint16_t a, uint16_t b) {
+	// Spread the channels out so every one has room for its carry: 00000GGGGGG00000RRRRR000000BBBBB.
+	uint32_t x   = (a | ((uint32_t) a << 16)) & 0x07e0f81f;
+	uint32_t y   = (b | ((uint32_t) b << 16)) & 0x07e0f81f;
+	uint32_t sum = x + y;
+	// Turn every carry into a full channel.
+	uint32_t ovf = sum & 0x08010020;
+	sum |= ovf - ((ovf & 0x00010020) >> 5) - ((ovf & 0x08000000) >> 6);
+	sum &= 0x07e0f81f;
+	return sum | (sum >> 16);
+}
+
+// BLENDs an RGB565 color onto another.
+static inline uint16_t wf3d_565_blend(wf3d_blend_t blend, uint16_t below, uint16_t color) {
+	return blend == WF3D_BLEND_ADD ? wf3d_565_add(below, color) : wf3d_565_max(below, color);
+}
+
+// Gets the SHADE PALETTE for a color, building it if it isn't cached.
+const wf3d_palette565_t *wf3d_palette565(wf3d_ctx_t *ctx, pax_col_t base);
+
+// Starts a render pass straight into `to`, with the context's current COLOR MASK.
+// Returns false if `to` is not an RGB565 buffer, in which case pax must be used.
+bool wf3d_raster565_begin(wf3d_raster565_t *raster, pax_buf_t *to, wf3d_ctx_t *ctx);
+// Finishes a render pass.
+void wf3d_raster565_end  (wf3d_raster565_t *raster, pax_buf_t *to);
+// Draws a depth tested triangle in a single color; without a DepthBuffer, it is drawn over everything.
+// Points are projected coordinates, depths are encoded for the DepthBuffer.
+void wf3d_raster565_tri  (wf3d_raster565_t *raster, uint16_t color, vec3f_t p0, vec3f_t p1, vec3f_t p2, float d0, float d1, float d2);
+// Draws a line, BLENDing with the per-channel MAXIMUM or saturating ADDITION.
+// Points are projected coordinates.
+void wf3d_raster565_line (wf3d_raster565_t *raster, wf3d_blend_t blend, uint16_t color, vec3f_t p0, vec3f_t p1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RASTER565_H
@@ -0,0 +1,223 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#include "scene.h"
+#include "mem.h"
+#include <string.h>
+
+
+
+// MAKEs a new, empty SCENE.
+void wf3d_scene_init(wf3d_scene_t *scene) {
+	*scene = (wf3d_scene_t) {
+		.num_node = 0,
+		.cap_node = WF3D_SCENE_INITIAL_CAP,
+		.nodes    = malloc(sizeof(wf3d_node_t) * WF3D_SCENE_INITIAL_CAP),
+		.dirty    = false,
+		.pass     = 0,
+	};
+}
+
+// DESTROYs a SCENE.
+void wf3d_scene_destroy(wf3d_scene_t *scene) {
+	for (size_t i = 0; i < scene->num_shape_bvh; i++) {
+		wf3d_bvh_destroy(&scene->shape_bvhs[i].bvh);
+	}
+	free(scene->shape_bvhs);
+	wf3d_bvh_destroy(&scene->bvh);
+	free(scene->nodes);
+	*scene = (wf3d_scene_t) {0};
+}
+
+
+
+// Adds a NODE to the SCENE, returning its index.
+size_t wf3d_scene_add(wf3d_scene_t *scene, size_t parent, matrix_3d_t local, wf3d_shape_t *shape) {
+	if (parent != WF3D_SCENE_NONE && parent >= scene->num_node) return WF3D_SCENE_NONE;
+	
+	// Ensure array space for NODE.
+	if (scene->cap_node <= scene->num_node) {
+		size_t       cap = scene->cap_node * 3 / 2 + 1;
+		wf3d_node_t *mem = realloc(scene->nodes, sizeof(wf3d_node_t) * cap);
+		if (!mem) return WF3D_SCENE_NONE;
+		scene->nodes    = mem;
+		scene->cap_node = cap;
+	}
+	
+	// Insert NODE.
+	size_t idx = scene->num_node++;
+	scene->nodes[idx] = (wf3d_node_t) {
+		.parent       = parent,
+		.first_child  = WF3D_SCENE_NONE,
+		.next_sibling = WF3D_SCENE_NONE,
+		.local        = local,
+		.world        = local,
+		.shape        = shape,
+		.bounds       = shape ? wf3d_shape_bounds(shape) : wf3d_aabb_empty(),
+		.dirty        = true,
+		.stamp        = 0,
+	};
+	scene->dirty     = true;
+	scene->bvh_valid = false;
+	
+	// Link it to the parent.
+	if (parent != WF3D_SCENE_NONE) {
+		scene->nodes[idx].next_sibling   = scene->nodes[parent].first_child;
+		scene->nodes[parent].first_child = idx;
+	}
+	
+	return idx;
+}
+
+// Changes the local transformation of a NODE, marking it and its children dirty.
+void wf3d_scene_set_local(wf3d_scene_t *scene, size_t node, matrix_3d_t local) {
+	if (node >= scene->num_node) return;
+	scene->nodes[node].local = local;
+	scene->nodes[node].dirty = true;
+	scene->dirty             = true;
+}
+
+// Changes the shape of a NODE, marking it dirty.
+// Forgets the old shape's triangle BVH if no other NODE uses it.
+void wf3d_scene_set_shape(wf3d_scene_t *scene, size_t node, wf3d_shape_t *shape) {
+	if (node >= scene->num_node) return;
+	wf3d_shape_t *old = scene->nodes[node].shape;
+	scene->nodes[node].shape  = shape;
+	scene->nodes[node].bounds = shape ? wf3d_shape_bounds(shape) : wf3d_aabb_empty();
+	scene->nodes[node].dirty  = true;
+	scene->dirty              = true;
+	
+	// Only look for other users if there is something to forget.
+	if (!old || old == shape || !scene->num_shape_bvh) return;
+	for (size_t i = 0; i < scene->num_node; i++) {
+		if (scene->nodes[i].shape == old) return;
+	}
+	wf3d_scene_forget_shape(scene, old);
+}
+
+// Drops the triangle BVH cached for picking a shape, if any.
+void wf3d_scene_forget_shape(wf3d_scene_t *scene, const wf3d_shape_t *shape) {
+	for (size_t i = 0; i < scene->num_shape_bvh; i++) {
+		if (scene->shape_bvhs[i].shape != shape) continue;
+		wf3d_bvh_destroy(&scene->shape_bvhs[i].bvh);
+		// The order does not matter, so move the last one into its place.
+		scene->shape_bvhs[i] = scene->shape_bvhs[--scene->num_shape_bvh];
+		return;
+	}
+}
+
+
+
+// Recomputes world transformations of dirty NODEs and their children, refitting the BVH if present.
+size_t wf3d_scene_update(wf3d_scene_t *scene) {
+	if (!scene->dirty) return 0;
+	
+	// Parents precede their children, so a single pass propagates changes.
+	// A NODE is recomputed if it is dirty or its parent was recomputed this pass.
+	uint32_t pass  = ++scene->pass;
+	size_t   count = 0;
+	for (size_t i = 0; i < scene->num_node; i++) {
+		wf3d_node_t *node   = &scene->nodes[i];
+		wf3d_node_t *parent = node->parent == WF3D_SCENE_NONE ? NULL : &scene->nodes[node->parent];
+		if (!node->dirty && !(parent && parent->stamp == pass)) continue;
+		
+		node->world = parent ? matrix_3d_multiply(parent->world, node->local) : node->local;
+		node->dirty = false;
+		node->stamp = pass;
+		count ++;
+		
+		if (scene->bvh_valid) {
+			wf3d_bvh_move(&scene->bvh, i, wf3d_aabb_xform(node->world, node->bounds));
+		}
+	}
+	
+	// Refit the BVH: walk up from each moved NODE if there are few, otherwise refit everything.
+	if (scene->bvh_valid && count * 8 <= scene->num_node) {
+		for (size_t i = 0; i < scene->num_node; i++) {
+			if (scene->nodes[i].stamp == pass) {
+				wf3d_bvh_update(&scene->bvh, i, scene->bvh.obj_bounds[i]);
+			}
+		}
+	} else if (scene->bvh_valid) {
+		wf3d_bvh_refit(&scene->bvh);
+	}
+	
+	scene->dirty = false;
+	return count;
+}
+
+// Adds all shapes in the SCENE to the DRAWING QUEUE, under the current MATRIX.
+void wf3d_scene_draw(wf3d_ctx_t *ctx, wf3d_scene_t *scene) {
+	wf3d_scene_update(scene);
+	for (size_t i = 0; i < scene->num_node; i++) {
+		if (scene->nodes[i].shape) {
+			wf3d_mesh_mtx(ctx, scene->nodes[i].world, scene->nodes[i].shape);
+		}
+	}
+}
+
+// Arguments for scene_cull_cb.
+typedef struct {
+	wf3d_ctx_t   *ctx;
+	wf3d_scene_t *scene;
+} scene_cull_args_t;
+
+// Adds a found NODE to the DRAWING QUEUE.
+static void scene_cull_cb(void *raw_args, size_t obj) {
+	scene_cull_args_t *args = raw_args;
+	wf3d_node_t       *node = &args->scene->nodes[obj];
+	wf3d_mesh_mtx(args->ctx, node->world, node->shape);
+}
+
+// Makes sure the SCENE's BVH matches the current set of NODEs, updating the SCENE first if needed.
+bool wf3d_scene_build_bvh(wf3d_scene_t *scene) {
+	wf3d_scene_update(scene);
+	if (scene->bvh_valid) return true;
+	
+	wf3d_aabb_t *bounds = wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_SCRATCH, sizeof(wf3d_aabb_t) * (scene->num_node ? scene->num_node : 1));
+	if (!bounds) return false;
+	for (size_t i = 0; i < scene->num_node; i++) {
+		// NODEs without a shape get empty bounds and are never found.
+		wf3d_node_t *node = &scene->nodes[i];
+		bounds[i] = node->shape ? wf3d_aabb_xform(node->world, node->bounds) : wf3d_aabb_empty();
+	}
+	scene->bvh_valid = wf3d_bvh_build(&scene->bvh, scene->num_node, bounds);
+	wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_SCRATCH, bounds);
+	return scene->bvh_valid;
+}
+
+// Adds the shapes in the SCENE that may be visible to the DRAWING QUEUE, under the current MATRIX.
+size_t wf3d_scene_draw_culled(wf3d_ctx_t *ctx, wf3d_scene_t *scene, pax_buf_t *to, matrix_3d_t cam_matrix) {
+	if (!wf3d_scene_build_bvh(scene)) {
+		// Out of memory: draw everything instead.
+		wf3d_scene_draw(ctx, scene);
+		return scene->num_node;
+	}
+	
+	// Draw everything that may be visible.
+	wf3d_frustum_t    frustum = wf3d_get_frustum(to, ctx, cam_matrix);
+	scene_cull_args_t args    = { ctx, scene };
+	return wf3d_bvh_cull(&scene->bvh, &frustum, scene_cull_cb, &args);
+}
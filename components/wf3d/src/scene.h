@@ -0,0 +1,146 @@
+/*
+	MIT License
+
+	Copyright (c) 2022 Julian Scheffers
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "wf3d.h"
+#include "bvh.h"
+
+
+
+// Initial amount of nodes that fit in a scene.
+#define WF3D_SCENE_INITIAL_CAP 16
+// Node index meaning "no node", used for the parent of top-level nodes.
+#define WF3D_SCENE_NONE        SIZE_MAX
+
+
+
+// A single node in a scene graph.
+typedef struct {
+	// Index of the parent node, or WF3D_SCENE_NONE.
+	size_t        parent;
+	// Index of the first child node, or WF3D_SCENE_NONE.
+	size_t        first_child;
+	// Index of the next node with the same parent, or WF3D_SCENE_NONE.
+	size_t        next_sibling;
+	
+	// Transformation relative to the parent.
+	matrix_3d_t   local;
+	// Cached transformation relative to the scene.
+	matrix_3d_t   world;
+	// The shape drawn at this node, if any.
+	wf3d_shape_t *shape;
+	// The bounds of the shape, in local space.
+	wf3d_aabb_t   bounds;
+	
+	// Whether the local transformation changed since the last update.
+	bool          dirty;
+	// The update pass in which the world transformation last changed.
+	uint32_t      stamp;
+} wf3d_node_t;
+
+// A triangle BVH of a shape, cached for picking.
+typedef struct {
+	// The shape the BVH was built for.
+	const wf3d_shape_t *shape;
+	// SERIAL of the shape when the BVH was built; another means it was freed and a new one made at its address.
+	uint32_t            serial;
+	// BVH over the triangles of the shape.
+	wf3d_bvh_t          bvh;
+} wf3d_shape_bvh_t;
+
+// A hierarchy of shapes, stored as a flat array in which parents precede their children.
+typedef struct {
+	// The amount of nodes stored.
+	size_t       num_node;
+	// The amount of nodes that will fit.
+	size_t       cap_node;
+	// A list of all nodes.
+	wf3d_node_t *nodes;
+	
+	// Whether any node is dirty.
+	bool         dirty;
+	// The current update pass.
+	uint32_t     pass;
+	
+	// BVH over the world bounds of all nodes, for culling.
+	wf3d_bvh_t   bvh;
+	// Whether the BVH matches the current set of nodes.
+	bool         bvh_valid;
+	
+	// The amount of triangle BVHs cached for picking.
+	size_t            num_shape_bvh;
+	// Triangle BVHs cached for picking, one per shape.
+	wf3d_shape_bvh_t *shape_bvhs;
+} wf3d_scene_t;
+
+
+
+// MAKEs a new, empty SCENE.
+void   wf3d_scene_init     (wf3d_scene_t *scene);
+// DESTROYs a SCENE.
+void   wf3d_scene_destroy  (wf3d_scene_t *scene);
+
+// Adds a NODE to the SCENE, returning its index.
+// The parent must already exist, or be WF3D_SCENE_NONE; returns WF3D_SCENE_NONE if it doesn't or if out of memory.
+size_t wf3d_scene_add      (wf3d_scene_t *scene, size_t parent, matrix_3d_t local, wf3d_shape_t *shape);
+// Changes the local transformation of a NODE, marking it and its children dirty.
+void   wf3d_scene_set_local(wf3d_scene_t *scene, size_t node, matrix_3d_t local);
+// Changes the shape of a NODE, marking it dirty.
+// Forgets the old shape's triangle BVH if no other NODE uses it.
+void   wf3d_scene_set_shape(wf3d_scene_t *scene, size_t node, wf3d_shape_t *shape);
+// Drops the triangle BVH cached for picking a shape, if any; use it after editing the shape in place.
+void   wf3d_scene_forget_shape(wf3d_scene_t *scene, const wf3d_shape_t *shape);
+
+// Recomputes world transformations of dirty NODEs and their children, refitting the BVH if present.
+// Returns the amount of NODEs recomputed.
+size_t wf3d_scene_update   (wf3d_scene_t *scene);
+// Gets the world transformation of a NODE, as of the last update.
+static inline matrix_3d_t wf3d_scene_world(const wf3d_scene_t *scene, size_t node) {
+	return scene->nodes[node].world;
+}
+
+// Makes sure the SCENE's BVH matches the current set of NODEs, updating the SCENE first if needed.
+// Returns whether enough memory was available.
+bool   wf3d_scene_build_bvh(wf3d_scene_t *scene);
+
+// Adds all shapes in the SCENE to the DRAWING QUEUE, under the current MATRIX.
+// Updates the SCENE first if needed.
+void   wf3d_scene_draw     (wf3d_ctx_t *ctx, wf3d_scene_t *scene);
+// Adds the shapes in the SCENE that may be visible to the DRAWING QUEUE, under the current MATRIX.
+// Updates the SCENE and (re)builds its BVH first if needed.
+// Returns the amount of shapes added.
+size_t wf3d_scene_draw_culled(wf3d_ctx_t *ctx, wf3d_scene_t *scene, pax_buf_t *to, matrix_3d_t cam_matrix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCENE_H
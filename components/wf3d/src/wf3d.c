@@ -23,9 +23,15 @@
 */
 
 #include "wf3d.h"
+#include "dlist.h"
+#include "mem.h"
+#include "raster565.h"
 #include <math.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
 
 
 
@@ -45,49 +51,200 @@ static void dump_ctx(wf3d_ctx_t *ctx) {
 
 
 
-// MAKEs a new DRAWING QUEUE.
+// MAKEs a new DRAWING QUEUE, with the default MEMORY POLICY.
 void wf3d_init(wf3d_ctx_t *ctx) {
+	wf3d_init_mem(ctx, &wf3d_mem_default);
+}
+
+// MAKEs a new DRAWING QUEUE, with its buffers placed by `mem`.
+void wf3d_init_mem(wf3d_ctx_t *ctx, wf3d_mem_t *mem) {
 	*ctx = (wf3d_ctx_t) {
 		.num_line     = 0,
 		.cap_line     = WF3D_INITIAL_LINE_CAP,
-		.lines        = malloc(2 * sizeof(size_t) * WF3D_INITIAL_LINE_CAP),
+		.lines        = wf3d_mem_alloc(mem, WF3D_MEM_QUEUE, 2 * sizeof(size_t) * WF3D_INITIAL_LINE_CAP),
+		.line_faces   = wf3d_mem_alloc(mem, WF3D_MEM_QUEUE, 2 * sizeof(size_t) * WF3D_INITIAL_LINE_CAP),
 		.num_tri      = 0,
 		.cap_tri      = WF3D_INITIAL_TRI_CAP,
-		.tris         = malloc(3 * sizeof(size_t) * WF3D_INITIAL_TRI_CAP),
+		.tris         = wf3d_mem_alloc(mem, WF3D_MEM_QUEUE, 3 * sizeof(size_t) * WF3D_INITIAL_TRI_CAP),
 		.num_vertex   = 0,
 		.cap_vertex   = WF3D_INITIAL_VERTEX_CAP,
-		.vertices     = malloc(sizeof(vec3f_t) * WF3D_INITIAL_VERTEX_CAP),
+		.vertices     = wf3d_mem_alloc(mem, WF3D_MEM_QUEUE, sizeof(vec3f_t) * WF3D_INITIAL_VERTEX_CAP),
 		.cam_mode     = CAMERA_VERTICAL_FOV,
 		.cam_var      = 60,
+		.depth_mode   = WF3D_DEPTH_LINEAR,
+		.depth_near   = WF3D_DEFAULT_NEAR,
+		.depth_far    = WF3D_DEFAULT_FAR,
+		.crease_angle = WF3D_DEFAULT_CREASE,
 		.stack        = {
 			.parent = NULL,
 			.value  = matrix_3d_identity(),
-		}
+		},
+		.mem          = mem,
+		.sig          = WF3D_SIG_INIT,
+		.force_redraw = true,
 	};
 }
 
 // DESTROYs a DRAWING QUEUE.
 void wf3d_destroy(wf3d_ctx_t *ctx) {
-	free(ctx->lines);
-	free(ctx->tris);
-	free(ctx->vertices);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_QUEUE, ctx->lines);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_QUEUE, ctx->line_faces);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_QUEUE, ctx->tris);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_QUEUE, ctx->vertices);
+	if (ctx->kept) {
+		wf3d_dlist_destroy(ctx->kept);
+		wf3d_mem_free(ctx->mem, WF3D_MEM_QUEUE, ctx->kept);
+	}
 	wf3d_reset_3d(ctx);
 }
 
 // CLEARs the DRAWING QUEUE.
 void wf3d_clear(wf3d_ctx_t *ctx) {
+#if WF3D_PROFILE
+	// Collect the pixels counted by each core.
+	for (size_t i = 0; i < WF3D_STAT_CORES; i++) {
+		ctx->stats.pixels_tested += ctx->pixels[i].tested;
+		ctx->stats.pixels_passed += ctx->pixels[i].passed;
+		ctx->pixels[i] = (wf3d_pixel_stats_t) {0};
+	}
+	// Keep the STATISTICS of presented frames around.
+	if (ctx->sig_checked && ctx->sig_changed) {
+		int64_t now = esp_timer_get_time();
+		ctx->stats.frame_us = now - ctx->frame_start;
+		ctx->frame_start    = now;
+		ctx->last_stats     = ctx->stats;
+	}
+	ctx->stats = (wf3d_stats_t) {0};
+#endif
 	ctx->num_line     = 0;
 	ctx->num_tri      = 0;
 	ctx->num_vertex   = 0;
+	if (ctx->kept) {
+		// Keep the DISPLAY LIST's memory for the next frame.
+		ctx->kept->num_cmd   = 0;
+		ctx->kept->num_shape = 0;
+	}
+	ctx->sig          = WF3D_SIG_INIT;
+	ctx->sig_checked  = false;
 	wf3d_reset_3d(ctx);
 }
 
 
 
+// MIXes some raw bytes into a SIGNATURE (FNV-1a).
+static inline uint32_t wf3d_sig_bytes(uint32_t sig, const void *data, size_t len) {
+	const uint8_t *arr = data;
+	for (size_t i = 0; i < len; i++) {
+		sig = (sig ^ arr[i]) * 16777619u;
+	}
+	return sig;
+}
+
+// MIXes extra frame state (render mode, colors, etc.) into the DRAWING QUEUE's SIGNATURE.
+void wf3d_sig_mix(wf3d_ctx_t *ctx, const void *data, size_t len) {
+	ctx->sig = wf3d_sig_bytes(ctx->sig, data, len);
+}
+
+// Determines whether this frame differs from the last presented frame.
+bool wf3d_changed(wf3d_ctx_t *ctx, pax_buf_t *to, matrix_3d_t cam_matrix) {
+	// Only compare once per frame, so multi-pass renders agree.
+	if (ctx->sig_checked) return ctx->sig_changed;
+	
+	// Mix in the camera and target.
+	uint32_t sig = ctx->sig;
+	sig = wf3d_sig_bytes(sig, &cam_matrix,   sizeof(cam_matrix));
+	sig = wf3d_sig_bytes(sig, &ctx->cam_mode, sizeof(ctx->cam_mode));
+	sig = wf3d_sig_bytes(sig, &ctx->cam_var,  sizeof(ctx->cam_var));
+	// Mix in the settings that change what the same DRAWING QUEUE looks like.
+	sig = wf3d_sig_bytes(sig, &ctx->draw_mode,  sizeof(ctx->draw_mode));
+	sig = wf3d_sig_bytes(sig, &ctx->depth_mode, sizeof(ctx->depth_mode));
+	sig = wf3d_sig_bytes(sig, &ctx->depth_near, sizeof(ctx->depth_near));
+	sig = wf3d_sig_bytes(sig, &ctx->depth_far,  sizeof(ctx->depth_far));
+	sig = wf3d_sig_bytes(sig, &ctx->depth,      sizeof(ctx->depth));
+	sig = wf3d_sig_bytes(sig, &ctx->tri_order,  sizeof(ctx->tri_order));
+	sig = wf3d_sig_bytes(sig, &ctx->line_blend, sizeof(ctx->line_blend));
+	sig = wf3d_sig_bytes(sig, &ctx->sink,       sizeof(ctx->sink));
+	if (ctx->draw_mode == WF3D_DRAW_OUTLINE) {
+		sig = wf3d_sig_bytes(sig, &ctx->crease_angle, sizeof(ctx->crease_angle));
+	}
+	sig = wf3d_sig_bytes(sig, &to->buf,       sizeof(to->buf));
+	sig = wf3d_sig_bytes(sig, &to->width,     sizeof(to->width));
+	sig = wf3d_sig_bytes(sig, &to->height,    sizeof(to->height));
+	
+	ctx->sig_checked  = true;
+	ctx->sig_changed  = ctx->force_redraw || sig != ctx->last_sig;
+	ctx->last_sig     = sig;
+	ctx->force_redraw = false;
+	return ctx->sig_changed;
+}
+
+// FORCEs the next frame to be redrawn.
+void wf3d_force_redraw(wf3d_ctx_t *ctx) {
+	ctx->force_redraw = true;
+}
+
+
+
+// Records the time it took to send the frame to the screen, in microseconds.
+void wf3d_stats_flush(wf3d_ctx_t *ctx, int64_t flush_us) {
+	WF3D_STAT(ctx->stats.flush_us += flush_us);
+}
+
+// Counts pixels DRAWn by the core this runs on.
+void wf3d_stats_pixels(wf3d_ctx_t *ctx, uint32_t tested, uint32_t passed) {
+	wf3d_pixel_stats_t *pixels = &ctx->pixels[xPortGetCoreID() % WF3D_STAT_CORES];
+	pixels->tested += tested;
+	pixels->passed += passed;
+}
+
+// DRAWs an overlay with FPS and STATISTICS of the last presented frame.
+void wf3d_draw_stats(pax_buf_t *to, wf3d_ctx_t *ctx) {
+#if WF3D_PROFILE
+	const wf3d_stats_t *stats = &ctx->last_stats;
+	char tmp[64];
+	float line = 10;
+	
+	pax_draw_rect(to, 0xbf000000, 0, 0, 132, line * 8 + 2);
+	
+	int64_t fps10 = stats->frame_us ? 10000000 / stats->frame_us : 0;
+	snprintf(tmp, sizeof(tmp), "%3lld.%lld FPS %6lldus", fps10 / 10, fps10 % 10, stats->frame_us);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 0, tmp);
+	snprintf(tmp, sizeof(tmp), "add %5lld xfm %5lld", stats->add_us, stats->xform_us);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 1, tmp);
+	snprintf(tmp, sizeof(tmp), "tri %5lld lin %5lld", stats->tri_us, stats->line_us);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 2, tmp);
+	snprintf(tmp, sizeof(tmp), "srt %5lld fl %5lld", stats->sort_us, stats->flush_us);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 3, tmp);
+	snprintf(tmp, sizeof(tmp), "vtx %u ln %u/%u", (unsigned) stats->vertices, (unsigned) stats->lines_drawn, (unsigned) stats->lines_culled);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 4, tmp);
+	snprintf(tmp, sizeof(tmp), "tris %u/%u culled", (unsigned) stats->tris_drawn, (unsigned) stats->tris_culled);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 5, tmp);
+	snprintf(tmp, sizeof(tmp), "px %u/%u passed", (unsigned) stats->pixels_passed, (unsigned) stats->pixels_tested);
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 6, tmp);
+	// How many times each covered pixel was drawn, in hundredths.
+	uint32_t overdraw = stats->pixels_covered ? (uint64_t) stats->pixels_passed * 100 / stats->pixels_covered : 0;
+	snprintf(tmp, sizeof(tmp), "cov %u ovr %u.%02ux", (unsigned) stats->pixels_covered, (unsigned) (overdraw / 100), (unsigned) (overdraw % 100));
+	pax_draw_text(to, 0xffffffff, pax_font_sky_mono, 9, 1, 1 + line * 7, tmp);
+#endif
+}
+
+
+
 static inline depth_t float_to_depth(float in, float max) {
 	return UINT16_MAX * (in / max);
 }
 
+// Encodes the depth of a point at distance `w` from the eye as reversed 1/w.
+// The NEAR PLANE maps to UINT16_MAX, the FAR PLANE to 1 so it still passes against a cleared buffer.
+static inline depth_t float_to_rdepth(wf3d_ctx_t *ctx, float w) {
+	float inv_near = 1 / ctx->depth_near;
+	float inv_far  = 1 / ctx->depth_far;
+	float part     = (1 / w - inv_far) / (inv_near - inv_far);
+	if (part >= 1) return UINT16_MAX;
+	if (part <= 0) return 1;
+	return 1 + (UINT16_MAX - 1) * part;
+}
+
 // A DEPTH BUFFER shading device.
 pax_col_t wf3d_shader_cb_depth(pax_col_t tint, pax_col_t existing, int x, int y, float u, float v, void *args) {
 	wf3d_ctx_t *ctx = args;
@@ -100,13 +257,43 @@ pax_col_t wf3d_shader_cb_depth(pax_col_t tint, pax_col_t existing, int x, int y,
 	depth_t existing_depth = ctx->depth[x + y*ctx->width];
 	
 	if (depth < existing_depth) {
+		WF3D_STAT(wf3d_stats_pixels(ctx, 1, 1));
 		ctx->depth[x + y*ctx->width] = depth;
 		return 0xff000000 | (tint & ctx->mask) | (existing & ~ctx->mask);
 	} else {
+		WF3D_STAT(wf3d_stats_pixels(ctx, 1, 0));
 		return existing;
 	}
 }
 
+// A reciprocal DEPTH BUFFER shading device, where larger is closer.
+pax_col_t wf3d_shader_cb_rdepth(pax_col_t tint, pax_col_t existing, int x, int y, float u, float v, void *args) {
+	wf3d_ctx_t *ctx = args;
+	
+	if (x < 0 || x >= ctx->width || y < 0 || y >= ctx->height) {
+		return existing;
+	}
+	
+	depth_t depth = u;
+	depth_t existing_depth = ctx->depth[x + y*ctx->width];
+	
+	if (depth > existing_depth) {
+		WF3D_STAT(wf3d_stats_pixels(ctx, 1, 1));
+		ctx->depth[x + y*ctx->width] = depth;
+		return 0xff000000 | (tint & ctx->mask) | (existing & ~ctx->mask);
+	} else {
+		WF3D_STAT(wf3d_stats_pixels(ctx, 1, 0));
+		return existing;
+	}
+}
+
+// A shading device without DEPTH BUFFER, which only applies the COLOR MASK.
+pax_col_t wf3d_shader_cb_mask(pax_col_t tint, pax_col_t existing, int x, int y, float u, float v, void *args) {
+	wf3d_ctx_t *ctx = args;
+	WF3D_STAT(wf3d_stats_pixels(ctx, 1, 1));
+	return 0xff000000 | (tint & ctx->mask) | (existing & ~ctx->mask);
+}
+
 // An ADDITIVE shading device.
 pax_col_t wf3d_shader_cb_additive(pax_col_t tint, pax_col_t existing, int x, int y, float u, float v, void *args) {
 	uint16_t r = (existing >> 16) & 255;
@@ -182,32 +369,68 @@ void wf3d_tris(wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t n
 	wf3d_add(ctx, num_vertices, vertices, 0, NULL, num_tris, tri_indices);
 }
 
-// Adds multiple LINEs and TRIANGLEs to the DRAWING QUEUE.
-void wf3d_add(wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t num_lines, size_t *line_indices, size_t num_tris, size_t *tri_indices) {
+// Adds multiple LINEs and TRIANGLEs to the DRAWING QUEUE, with the triangles on either side of each line if `edge_faces` isn't NULL.
+static void wf3d_add_edges(wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t num_lines, size_t *line_indices, size_t num_tris, size_t *tri_indices, size_t *edge_faces) {
+	WF3D_STAT(int64_t stat_start = esp_timer_get_time());
+	
 	// Ensure array space for VTX.
+	// Out of memory leaves the DRAWING QUEUE as it was, without this addition.
 	if (ctx->cap_vertex <= ctx->num_vertex + num_vertices) {
-		while (ctx->cap_vertex <= ctx->num_vertex + num_vertices) {
-			ctx->cap_vertex = ctx->cap_vertex * 3 / 2;
+		size_t cap = ctx->cap_vertex;
+		while (cap <= ctx->num_vertex + num_vertices) {
+			cap = cap * 3 / 2;
 		}
-		ctx->vertices = realloc(ctx->vertices, sizeof(vec3f_t) * ctx->cap_vertex);
+		vec3f_t *vertices_mem = wf3d_mem_realloc(ctx->mem, WF3D_MEM_QUEUE, ctx->vertices, sizeof(vec3f_t) * cap);
+		if (!vertices_mem) return;
+		ctx->vertices   = vertices_mem;
+		ctx->cap_vertex = cap;
 	}
 	
 	// Ensure array space for LN.
 	if (ctx->cap_line <= ctx->num_line + num_lines) {
-		while (ctx->cap_line <= ctx->num_line + num_lines) {
-			ctx->cap_line = ctx->cap_line * 3 / 2;
+		size_t cap = ctx->cap_line;
+		while (cap <= ctx->num_line + num_lines) {
+			cap = cap * 3 / 2;
 		}
-		ctx->lines = realloc(ctx->lines, 2 * sizeof(size_t) * ctx->cap_line);
+		// Either may move while the other fails; the capacity only grows once both have.
+		size_t *lines_mem = wf3d_mem_realloc(ctx->mem, WF3D_MEM_QUEUE, ctx->lines, 2 * sizeof(size_t) * cap);
+		if (!lines_mem) return;
+		ctx->lines = lines_mem;
+		size_t *faces_mem = wf3d_mem_realloc(ctx->mem, WF3D_MEM_QUEUE, ctx->line_faces, 2 * sizeof(size_t) * cap);
+		if (!faces_mem) return;
+		ctx->line_faces = faces_mem;
+		ctx->cap_line   = cap;
 	}
 	
 	// Ensure array space for TRI.
 	if (ctx->cap_tri <= ctx->num_tri + num_tris) {
-		while (ctx->cap_tri <= ctx->num_tri + num_tris) {
-			ctx->cap_tri = ctx->cap_tri * 3 / 2;
+		size_t cap = ctx->cap_tri;
+		while (cap <= ctx->num_tri + num_tris) {
+			cap = cap * 3 / 2;
 		}
-		ctx->tris = realloc(ctx->tris, 3 * sizeof(size_t) * ctx->cap_tri);
+		size_t *tris_mem = wf3d_mem_realloc(ctx->mem, WF3D_MEM_QUEUE, ctx->tris, 3 * sizeof(size_t) * cap);
+		if (!tris_mem) return;
+		ctx->tris    = tris_mem;
+		ctx->cap_tri = cap;
 	}
 	
+	// Update the SIGNATURE.
+	ctx->sig = wf3d_sig_bytes(ctx->sig, &ctx->stack.value, sizeof(matrix_3d_t));
+	if (num_vertices <= WF3D_SIG_INLINE_VERTEX) {
+		// Small additions tend to live on the stack, so sign their contents.
+		ctx->sig = wf3d_sig_bytes(ctx->sig, vertices,     sizeof(vec3f_t) * num_vertices);
+		ctx->sig = wf3d_sig_bytes(ctx->sig, line_indices, 2 * sizeof(size_t) * num_lines);
+		ctx->sig = wf3d_sig_bytes(ctx->sig, tri_indices,  3 * sizeof(size_t) * num_tris);
+	} else {
+		// Larger additions are signed by pointer.
+		ctx->sig = wf3d_sig_bytes(ctx->sig, &vertices,     sizeof(vertices));
+		ctx->sig = wf3d_sig_bytes(ctx->sig, &line_indices, sizeof(line_indices));
+		ctx->sig = wf3d_sig_bytes(ctx->sig, &tri_indices,  sizeof(tri_indices));
+	}
+	ctx->sig = wf3d_sig_bytes(ctx->sig, &num_vertices, sizeof(num_vertices));
+	ctx->sig = wf3d_sig_bytes(ctx->sig, &num_lines,    sizeof(num_lines));
+	ctx->sig = wf3d_sig_bytes(ctx->sig, &num_tris,     sizeof(num_tris));
+	
 	// Insert VTX.
 	for (size_t i = 0; i < num_vertices; i++) {
 		vec3f_t *ptr = &ctx->vertices[ctx->num_vertex + i];
@@ -219,6 +442,10 @@ void wf3d_add(wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t nu
 	for (size_t i = 0; i < num_lines; i++) {
 		ctx->lines[2*(i+ctx->num_line)]   = line_indices[i*2]   + ctx->num_vertex;
 		ctx->lines[2*(i+ctx->num_line)+1] = line_indices[i*2+1] + ctx->num_vertex;
+		for (size_t x = 0; x < 2; x++) {
+			size_t face = edge_faces ? edge_faces[i*2+x] : SIZE_MAX;
+			ctx->line_faces[2*(i+ctx->num_line)+x] = face < num_tris ? face + ctx->num_tri : SIZE_MAX;
+		}
 	}
 	
 	// Insert TRI.
@@ -231,18 +458,155 @@ void wf3d_add(wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t nu
 	ctx->num_vertex += num_vertices;
 	ctx->num_line   += num_lines;
 	ctx->num_tri    += num_tris;
+	
+	WF3D_STAT(ctx->stats.add_us += esp_timer_get_time() - stat_start);
+}
+
+// Adds multiple LINEs and TRIANGLEs to the DRAWING QUEUE; leaves it as it was if out of memory.
+void wf3d_add(wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t num_lines, size_t *line_indices, size_t num_tris, size_t *tri_indices) {
+	wf3d_add_edges(ctx, num_vertices, vertices, num_lines, line_indices, num_tris, tri_indices, NULL);
 }
 
 // Adds a SHAPE to the DRAWING QUEUE.
 void wf3d_mesh(wf3d_ctx_t *ctx, wf3d_shape_t *shape) {
-	if (shape->num_tri)
+	if (ctx->record) {
+		// Recording into a DISPLAY LIST instead.
+		wf3d_dlist_append(ctx->record, ctx->stack.value, shape);
+		return;
+	}
+	
+	const wf3d_sink_t *sink = ctx->sink;
+	bool fill = ctx->draw_mode == WF3D_DRAW_FILL;
+	if (fill && sink && sink->keeps && ctx->depth_mode == WF3D_DEPTH_RECIPROCAL && sink->keeps(sink->args, shape)) {
+		if (!ctx->kept) {
+			ctx->kept = wf3d_mem_alloc(ctx->mem, WF3D_MEM_QUEUE, sizeof(wf3d_dlist_t));
+			if (ctx->kept) wf3d_dlist_init_mem(ctx->kept, ctx->mem);
+		}
+		if (ctx->kept) {
+			// The sink draws it from its own copy, so sign it by pointer and SERIAL.
+			ctx->sig = wf3d_sig_bytes(ctx->sig, &ctx->stack.value, sizeof(matrix_3d_t));
+			ctx->sig = wf3d_sig_bytes(ctx->sig, &shape, sizeof(shape));
+			ctx->sig = wf3d_sig_bytes(ctx->sig, &shape->serial, sizeof(shape->serial));
+			wf3d_dlist_append(ctx->kept, ctx->stack.value, shape);
+			return;
+		}
+	}
+	
+	wf3d_mesh_direct(ctx, shape);
+}
+
+// Adds a SHAPE to the DRAWING QUEUE itself, never recorded or kept by the PRIMITIVE SINK.
+// Returns the index of its first vertex in the DRAWING QUEUE, or SIZE_MAX if out of memory, which leaves it out.
+size_t wf3d_mesh_direct(wf3d_ctx_t *ctx, wf3d_shape_t *shape) {
+	size_t first = ctx->num_vertex;
+	if (ctx->draw_mode == WF3D_DRAW_OUTLINE && shape->num_tri && shape->edge_faces)
+		// The triangles tell which lines are on the OUTLINE, but are not drawn.
+		wf3d_add_edges(ctx, shape->num_vertex, shape->vertices, shape->num_lines, shape->line_indices, shape->num_tri, shape->tri_indices, shape->edge_faces);
+	else if (ctx->draw_mode == WF3D_DRAW_FILL && shape->num_tri)
 		wf3d_tris(ctx, shape->num_vertex, shape->vertices, shape->num_tri, shape->tri_indices);
 	else
 		wf3d_lines(ctx, shape->num_vertex, shape->vertices, shape->num_lines, shape->line_indices);
+	// Out of memory leaves the DRAWING QUEUE as it was.
+	return ctx->num_vertex == first + shape->num_vertex ? first : SIZE_MAX;
 }
 
-// DRAWs everything in the DRAWING QUEUE.
-void wf3d_render(pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix) {
+// Adds a SHAPE to the DRAWING QUEUE under an extra MATRIX, without touching the MATRIX STACK.
+void wf3d_mesh_mtx(wf3d_ctx_t *ctx, matrix_3d_t mtx, wf3d_shape_t *shape) {
+	matrix_3d_t saved = ctx->stack.value;
+	ctx->stack.value  = matrix_3d_multiply(saved, mtx);
+	wf3d_mesh(ctx, shape);
+	ctx->stack.value  = saved;
+}
+
+// Whether a triangle faces the eye and lies entirely in front of it.
+static inline bool wf3d_tri_visible(vec3f_t normals, const vec3f_t *proj_vtx, size_t idx0, size_t idx1, size_t idx2) {
+	return normals.z <= 0 && proj_vtx[idx0].z >= 0 && proj_vtx[idx1].z >= 0 && proj_vtx[idx2].z >= 0;
+}
+
+// One pass of a RADIX SORT: stably moves `num` keys and their triangles into `to_keys` and `to_idx` by 8 bits of key.
+static void wf3d_radix_pass(size_t num, int shift, const uint16_t *keys, const size_t *idx, uint16_t *to_keys, size_t *to_idx) {
+	size_t count[256] = {0};
+	for (size_t i = 0; i < num; i++) {
+		count[(keys[i] >> shift) & 255] ++;
+	}
+	size_t pos = 0;
+	for (int i = 0; i < 256; i++) {
+		size_t tmp = count[i];
+		count[i]   = pos;
+		pos       += tmp;
+	}
+	for (size_t i = 0; i < num; i++) {
+		size_t to   = count[(keys[i] >> shift) & 255] ++;
+		to_keys[to] = keys[i];
+		to_idx[to]  = idx[i];
+	}
+}
+
+// Finds the visible triangles and sorts them by their average depth, quantised to 16 bits, nearest first unless `far_first`.
+// Returns the indices of the triangles to draw in order, or NULL if out of memory; free it after drawing.
+static size_t *wf3d_sort_tris(wf3d_ctx_t *ctx, const vec3f_t *xform_vtx, const vec3f_t *proj_vtx, float focal, float max_depth, bool far_first, size_t *num_visible) {
+	size_t    num  = ctx->num_tri;
+	size_t   *idx  = wf3d_mem_alloc(ctx->mem, WF3D_MEM_SCRATCH, (2 * sizeof(size_t) + 2 * sizeof(uint16_t)) * num);
+	if (!idx) return NULL;
+	size_t   *tmp_idx  = idx + num;
+	uint16_t *keys     = (uint16_t *) (tmp_idx + num);
+	uint16_t *tmp_keys = keys + num;
+	bool reciprocal    = ctx->depth_mode == WF3D_DEPTH_RECIPROCAL;
+	
+	// Make a key for every visible triangle, smallest is drawn first.
+	size_t visible = 0;
+	for (size_t i = 0; i < num; i++) {
+		size_t idx0 = ctx->tris[3*i];
+		size_t idx1 = ctx->tris[3*i+1];
+		size_t idx2 = ctx->tris[3*i+2];
+		if (idx0 >= ctx->num_vertex || idx1 >= ctx->num_vertex || idx2 >= ctx->num_vertex) continue;
+		
+		vec3f_t normals = wf3d_calc_tri_normals(xform_vtx[idx0], xform_vtx[idx1], xform_vtx[idx2]);
+		if (!wf3d_tri_visible(normals, proj_vtx, idx0, idx1, idx2)) {
+			WF3D_STAT(ctx->stats.tris_culled ++);
+			continue;
+		}
+		
+		float    avg_depth = (proj_vtx[idx0].z + proj_vtx[idx1].z + proj_vtx[idx2].z) / 3;
+		uint16_t near_key  = reciprocal
+			? UINT16_MAX - float_to_rdepth(ctx, focal + avg_depth)
+			: float_to_depth(avg_depth, max_depth);
+		keys[visible] = far_first ? UINT16_MAX - near_key : near_key;
+		idx[visible]  = i;
+		visible ++;
+	}
+	
+	// Sort by the low byte, then stably by the high byte.
+	wf3d_radix_pass(visible, 0, keys,     idx,     tmp_keys, tmp_idx);
+	wf3d_radix_pass(visible, 8, tmp_keys, tmp_idx, keys,     idx);
+	
+	*num_visible = visible;
+	return idx;
+}
+
+// Whether a line is on the OUTLINE, given the normals of all triangles in the eye's space.
+static inline bool wf3d_line_outline(const wf3d_ctx_t *ctx, const vec3f_t *face_normals, size_t line, float crease_cos) {
+	size_t face0  = ctx->line_faces[2*line];
+	size_t face1  = ctx->line_faces[2*line+1];
+	bool   valid0 = face0 < ctx->num_tri;
+	bool   valid1 = face1 < ctx->num_tri;
+	// Lines not next to any face are always drawn.
+	if (!valid0 && !valid1) return true;
+	
+	// Faces are towards the eye exactly when they would not be culled.
+	bool front0 = valid0 && face_normals[face0].z <= 0;
+	bool front1 = valid1 && face_normals[face1].z <= 0;
+	// On the edge of a single face, or on the SILHOUETTE.
+	if (!valid0 || !valid1 || front0 != front1) return front0 || front1;
+	
+	// On a CREASE that can be seen.
+	vec3f_t a = face_normals[face0];
+	vec3f_t b = face_normals[face1];
+	return front0 && a.x * b.x + a.y * b.y + a.z * b.z < crease_cos;
+}
+
+// DRAWs everything in the DRAWING QUEUE, regardless of SIGNATURE.
+static void wf3d_render_raw(pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix) {
 	// Get camera information.
 	float focal = wf3d_get_foc(to, ctx);
 	ctx->width  = to->width;
@@ -251,20 +615,33 @@ void wf3d_render(pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t ca
 				| ((color & 0x00ff00) ? 0x00ff00 : 0)
 				| ((color & 0x0000ff) ? 0x0000ff : 0);
 	
-	// Clear depth buffer.
-	memset(ctx->depth, 255, sizeof(depth_t) * ctx->width * ctx->height);
+	// Clear depth buffer; a sink keeps its own.
+	bool reciprocal = ctx->depth_mode == WF3D_DEPTH_RECIPROCAL;
+	bool painter    = ctx->depth_mode == WF3D_DEPTH_NONE;
+	const wf3d_sink_t *sink = ctx->sink;
+	if (painter) {
+		// Sorting takes the place of the depth buffer.
+	} else if (!sink) {
+		memset(ctx->depth, reciprocal ? 0 : 255, sizeof(depth_t) * ctx->width * ctx->height);
+	} else if (sink->clear) {
+		sink->clear(sink->args);
+	}
 	
 	// Transform 3D points into 2D.
-	vec3f_t *xform_vtx = malloc(sizeof(vec3f_t) * ctx->num_vertex);
-	vec3f_t *proj_vtx  = malloc(sizeof(vec3f_t) * ctx->num_vertex);
+	WF3D_STAT(int64_t stat_start = esp_timer_get_time());
+	vec3f_t *xform_vtx = wf3d_mem_alloc(ctx->mem, WF3D_MEM_SCRATCH, sizeof(vec3f_t) * ctx->num_vertex);
+	vec3f_t *proj_vtx  = wf3d_mem_alloc(ctx->mem, WF3D_MEM_SCRATCH, sizeof(vec3f_t) * ctx->num_vertex);
 	float max_depth = 0;
 	for (size_t i = 0; i < ctx->num_vertex; i++) {
 		vec3f_t raw_vtx = ctx->vertices[i];
 		matrix_3d_transform(cam_matrix, &raw_vtx.x, &raw_vtx.y, &raw_vtx.z);
 		xform_vtx[i] = raw_vtx;
 		proj_vtx[i] = wf3d_xform(ctx, focal, raw_vtx);
-		if (proj_vtx[i].z > max_depth) max_depth = proj_vtx[i].z;
+		// Only linear depth depends on the whole frame.
+		if (!reciprocal && proj_vtx[i].z > max_depth) max_depth = proj_vtx[i].z;
 	}
+	WF3D_STAT(ctx->stats.vertices += ctx->num_vertex);
+	WF3D_STAT(ctx->stats.xform_us += esp_timer_get_time() - stat_start);
 	
 	// Set up PAX transform thingy.
 	pax_push_2d(to);
@@ -277,15 +654,58 @@ void wf3d_render(pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t ca
 		.schema_complement = ~1,
 		.renderer_id       = PAX_RENDERER_ID_SWR,
 		.promise_callback  = NULL,
-		.callback          = wf3d_shader_cb_depth,
+		.callback          = painter ? wf3d_shader_cb_mask : reciprocal ? wf3d_shader_cb_rdepth : wf3d_shader_cb_depth,
 		.callback_args     = ctx,
 		.alpha_promise_0   = true,
 		.alpha_promise_255 = true,
 	};
 	
+	// Draw straight into RGB565 buffers when possible.
+	wf3d_raster565_t raster;
+	bool native = !sink && wf3d_raster565_begin(&raster, to, ctx);
+	const wf3d_palette565_t *palette = native || sink ? wf3d_palette565(ctx, color) : NULL;
+	// Sinks take positions in pixels.
+	float sink_cx    = to->width  / 2.0;
+	float sink_cy    = to->height / 2.0;
+	float sink_scale = scale / 2;
+	
+	// In OUTLINE mode, tris only decide which lines are drawn; without memory, all lines are.
+	bool     outline      = ctx->draw_mode == WF3D_DRAW_OUTLINE;
+	vec3f_t *face_normals = NULL;
+	if (outline && ctx->num_tri) {
+		face_normals = wf3d_mem_alloc(ctx->mem, WF3D_MEM_SCRATCH, sizeof(vec3f_t) * ctx->num_tri);
+	}
+	if (face_normals) {
+		for (size_t i = 0; i < ctx->num_tri; i++) {
+			size_t idx0 = ctx->tris[3*i];
+			size_t idx1 = ctx->tris[3*i+1];
+			size_t idx2 = ctx->tris[3*i+2];
+			if (idx0 >= ctx->num_vertex || idx1 >= ctx->num_vertex || idx2 >= ctx->num_vertex) {
+				// Counts as facing away.
+				face_normals[i] = (vec3f_t) {0, 0, 1};
+			} else {
+				face_normals[i] = wf3d_calc_tri_normals(xform_vtx[idx0], xform_vtx[idx1], xform_vtx[idx2]);
+			}
+		}
+	}
+	float crease_cos = cosf(ctx->crease_angle * (M_PI / 180));
+	
+	// Sort tris; without memory they are drawn as added.
+	size_t *order     = NULL;
+	size_t  num_order = outline ? 0 : ctx->num_tri;
+	if ((painter || ctx->tri_order != WF3D_ORDER_SUBMIT) && num_order) {
+		WF3D_STAT(stat_start = esp_timer_get_time());
+		bool far_first = painter || ctx->tri_order == WF3D_ORDER_BACK_TO_FRONT;
+		order = wf3d_sort_tris(ctx, xform_vtx, proj_vtx, focal, max_depth, far_first, &num_order);
+		if (!order) num_order = ctx->num_tri;
+		WF3D_STAT(ctx->stats.sort_us += esp_timer_get_time() - stat_start);
+	}
+	
 	// Draw tris.
+	WF3D_STAT(stat_start = esp_timer_get_time());
 	matrix_3d_t ligt_mtx = matrix_3d_multiply(matrix_3d_rotate_x(-M_PI / 4), matrix_3d_rotate_y(-M_PI / 2));
-	for (size_t i = 0; i < ctx->num_tri; i++) {
+	for (size_t n = 0; n < num_order; n++) {
+		size_t i    = order ? order[n] : n;
 		size_t idx0 = ctx->tris[3*i];
 		size_t idx1 = ctx->tris[3*i+1];
 		size_t idx2 = ctx->tris[3*i+2];
@@ -294,56 +714,177 @@ void wf3d_render(pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t ca
 		// Compute normals.
 		vec3f_t normals = wf3d_calc_tri_normals(xform_vtx[idx0], xform_vtx[idx1], xform_vtx[idx2]);
 		
-		if (normals.z <= 0 && proj_vtx[idx0].z >= 0 && proj_vtx[idx1].z >= 0 && proj_vtx[idx2].z >= 0) {
+		if (wf3d_tri_visible(normals, proj_vtx, idx0, idx1, idx2)) {
 			// float avg_depth = (proj_vtx[idx0].z + proj_vtx[idx1].z + proj_vtx[idx2].z) / 3;
 			// uint8_t part = 255 - 200 * (avg_depth / max_depth);
 			uint8_t part = 255 - (matrix_3d_transform_inline(ligt_mtx, normals).z + 1) / 2 * 200;
-			pax_tri_t depths = {
-				.x0 = float_to_depth(proj_vtx[idx0].z, max_depth), .y0 = 0,
-				.x1 = float_to_depth(proj_vtx[idx1].z, max_depth), .y1 = 0,
-				.x2 = float_to_depth(proj_vtx[idx2].z, max_depth), .y2 = 0,
-			};
-			pax_shade_tri(
-				to,
-				// pax_col_rgb(127+normals.x*127, 16, 16),
-				// pax_col_rgb(127+normals.x*32, 127+normals.y*127, 127+normals.z*127),
-				pax_col_lerp(part, 0xff000000, color),
-				&wf3d_shader_depth, &depths,
-				proj_vtx[idx0].x, proj_vtx[idx0].y,
-				proj_vtx[idx1].x, proj_vtx[idx1].y,
-				proj_vtx[idx2].x, proj_vtx[idx2].y
-			);
+			pax_tri_t depths;
+			if (reciprocal) {
+				depths = (pax_tri_t) {
+					.x0 = float_to_rdepth(ctx, focal + proj_vtx[idx0].z), .y0 = 0,
+					.x1 = float_to_rdepth(ctx, focal + proj_vtx[idx1].z), .y1 = 0,
+					.x2 = float_to_rdepth(ctx, focal + proj_vtx[idx2].z), .y2 = 0,
+				};
+			} else {
+				depths = (pax_tri_t) {
+					.x0 = float_to_depth(proj_vtx[idx0].z, max_depth), .y0 = 0,
+					.x1 = float_to_depth(proj_vtx[idx1].z, max_depth), .y1 = 0,
+					.x2 = float_to_depth(proj_vtx[idx2].z, max_depth), .y2 = 0,
+				};
+			}
+			if (sink) {
+				vec3f_t screen[3];
+				size_t  idx[3]   = { idx0, idx1, idx2 };
+				float   depth[3] = { depths.x0, depths.x1, depths.x2 };
+				for (int j = 0; j < 3; j++) {
+					screen[j] = (vec3f_t) {
+						sink_cx + proj_vtx[idx[j]].x * sink_scale,
+						sink_cy - proj_vtx[idx[j]].y * sink_scale,
+						// Linear depth is smaller when closer.
+						reciprocal ? depth[j] : UINT16_MAX - depth[j],
+					};
+				}
+				sink->tri(sink->args, screen, palette->shade[part], wf3d_col_to_565(ctx->mask));
+			} else if (native) {
+				wf3d_raster565_tri(
+					&raster, palette->shade[part],
+					proj_vtx[idx0], proj_vtx[idx1], proj_vtx[idx2],
+					depths.x0, depths.x1, depths.x2
+				);
+			} else {
+				pax_shade_tri(
+					to,
+					// pax_col_rgb(127+normals.x*127, 16, 16),
+					// pax_col_rgb(127+normals.x*32, 127+normals.y*127, 127+normals.z*127),
+					pax_col_lerp(part, 0xff000000, color),
+					&wf3d_shader_depth, &depths,
+					proj_vtx[idx0].x, proj_vtx[idx0].y,
+					proj_vtx[idx1].x, proj_vtx[idx1].y,
+					proj_vtx[idx2].x, proj_vtx[idx2].y
+				);
+			}
+			WF3D_STAT(ctx->stats.tris_drawn ++);
+		} else {
+			WF3D_STAT(ctx->stats.tris_culled ++);
+		}
+	}
+	WF3D_STAT(ctx->stats.tri_us += esp_timer_get_time() - stat_start);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_SCRATCH, order);
+	
+#if WF3D_PROFILE
+	// Count the pixels that triangles ended up covering, to tell how many were drawn over.
+	if (!sink && !painter && !outline && ctx->num_tri) {
+		depth_t  cleared = reciprocal ? 0 : UINT16_MAX;
+		size_t   area    = ctx->width * ctx->height;
+		uint32_t covered = 0;
+		for (size_t i = 0; i < area; i++) {
+			covered += ctx->depth[i] != cleared;
 		}
+		ctx->stats.pixels_covered += covered;
 	}
+#endif
 	
 	// Draw lines.
+	WF3D_STAT(stat_start = esp_timer_get_time());
 	for (size_t i = 0; i < ctx->num_line; i++) {
 		size_t start_idx = ctx->lines[2*i];
 		size_t end_idx   = ctx->lines[2*i + 1];
 		if (start_idx >= ctx->num_vertex || end_idx >= ctx->num_vertex) continue;
+		if (face_normals && !wf3d_line_outline(ctx, face_normals, i, crease_cos)) {
+			WF3D_STAT(ctx->stats.lines_culled ++);
+			continue;
+		}
 		
 		if (proj_vtx[start_idx].z >= 0 && proj_vtx[end_idx].z >= 0) {
 			float avg_depth = (proj_vtx[start_idx].z + proj_vtx[end_idx].z) / 2;
-			uint8_t part = 255 - 100 * (avg_depth / max_depth);
-			pax_shade_line(
-				to, pax_col_lerp(part, 0xff000000, color),
-				&wf3d_shader_maximum,
-				proj_vtx[start_idx].x, proj_vtx[start_idx].y,
-				proj_vtx[end_idx].x, proj_vtx[end_idx].y
+			uint8_t part;
+			if (reciprocal) {
+				// Fade towards the FAR PLANE instead of the farthest vertex.
+				part = 155 + 100 * (float_to_rdepth(ctx, focal + avg_depth) / (float) UINT16_MAX);
+			} else {
+				part = 255 - 100 * (avg_depth / max_depth);
+			}
+			if (sink) {
+				vec3f_t screen[2] = {
+					{ sink_cx + proj_vtx[start_idx].x * sink_scale, sink_cy - proj_vtx[start_idx].y * sink_scale, 0 },
+					{ sink_cx + proj_vtx[end_idx].x   * sink_scale, sink_cy - proj_vtx[end_idx].y   * sink_scale, 0 },
+				};
+				sink->line(sink->args, screen, palette->shade[part]);
+			} else if (native) {
+				wf3d_raster565_line(&raster, ctx->line_blend, palette->shade[part], proj_vtx[start_idx], proj_vtx[end_idx]);
+			} else {
+				pax_shade_line(
+					to, pax_col_lerp(part, 0xff000000, color),
+					ctx->line_blend == WF3D_BLEND_ADD ? &wf3d_shader_additive : &wf3d_shader_maximum,
+					proj_vtx[start_idx].x, proj_vtx[start_idx].y,
+					proj_vtx[end_idx].x, proj_vtx[end_idx].y
+				);
+			}
+			WF3D_STAT(ctx->stats.lines_drawn ++);
+		}
+	}
+	WF3D_STAT(ctx->stats.line_us += esp_timer_get_time() - stat_start);
+	
+	// Let the sink draw the shapes it keeps.
+	if (sink && ctx->kept && ctx->kept->num_cmd) {
+		WF3D_STAT(stat_start = esp_timer_get_time());
+		wf3d_proj_t proj = {
+			.focal      = focal,
+			.cx         = sink_cx,
+			.cy         = sink_cy,
+			.scale      = sink_scale,
+			.depth_near = ctx->depth_near,
+			.depth_far  = ctx->depth_far,
+			// The Z row of the light MATRIX above.
+			.light      = { ligt_mtx.xz, ligt_mtx.yz, ligt_mtx.zz },
+		};
+		for (size_t i = 0; i < ctx->kept->num_cmd; i++) {
+			const wf3d_dlist_cmd_t *cmd = &ctx->kept->cmds[i];
+			sink->mesh(
+				sink->args, ctx->kept->shapes[cmd->shape],
+				matrix_3d_multiply(cam_matrix, cmd->mtx), &proj,
+				palette->shade[255], wf3d_col_to_565(ctx->mask)
 			);
 		}
+		WF3D_STAT(ctx->stats.tri_us += esp_timer_get_time() - stat_start);
 	}
 	
 	// Clean up.
+	if (native) wf3d_raster565_end(&raster, to);
 	pax_pop_2d(to);
-	free(xform_vtx);
-	free(proj_vtx);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_SCRATCH, xform_vtx);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_SCRATCH, proj_vtx);
+	wf3d_mem_free(ctx->mem, WF3D_MEM_SCRATCH, face_normals);
+}
+
+// Determines whether to draw this frame, signing the colors and eye distance first.
+static bool wf3d_render_check(wf3d_ctx_t *ctx, pax_buf_t *to, matrix_3d_t cam_matrix, const pax_col_t *colors, size_t num_colors, float eye_dist) {
+	// Once checked, the SIGNATURE is final for this frame.
+	if (!ctx->sig_checked) {
+		wf3d_sig_mix(ctx, colors,    sizeof(pax_col_t) * num_colors);
+		wf3d_sig_mix(ctx, &eye_dist, sizeof(eye_dist));
+	}
+	if (wf3d_changed(ctx, to, cam_matrix)) return true;
+	if (ctx->skip_unchanged) return false;
+	// Drawn all the same, so it counts as presented.
+	ctx->sig_changed = true;
+	return true;
+}
+
+// DRAWs everything in the DRAWING QUEUE.
+bool wf3d_render(pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix) {
+	if (!wf3d_render_check(ctx, to, cam_matrix, &color, 1, 0)) return false;
+	wf3d_render_raw(to, color, ctx, cam_matrix);
+	return true;
 }
 
 // DRAWs everything in one color per eye.
-void wf3d_render2(pax_buf_t *to, pax_col_t left_eye, pax_col_t right_eye, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix, float eye_dist) {
-	wf3d_render(to, left_eye, ctx, matrix_3d_multiply(matrix_3d_translate(-eye_dist/2, 0, 0), cam_matrix));
-	wf3d_render(to, right_eye, ctx, matrix_3d_multiply(matrix_3d_translate(eye_dist/2, 0, 0), cam_matrix));
+bool wf3d_render2(pax_buf_t *to, pax_col_t left_eye, pax_col_t right_eye, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix, float eye_dist) {
+	pax_col_t colors[2] = { left_eye, right_eye };
+	if (!wf3d_render_check(ctx, to, cam_matrix, colors, 2, eye_dist)) return false;
+	wf3d_render_raw(to, left_eye, ctx, matrix_3d_multiply(matrix_3d_translate(-eye_dist/2, 0, 0), cam_matrix));
+	wf3d_render_raw(to, right_eye, ctx, matrix_3d_multiply(matrix_3d_translate(eye_dist/2, 0, 0), cam_matrix));
+	return true;
 }
 
 
@@ -401,11 +942,12 @@ void wf3d_apply_3d(wf3d_ctx_t *ctx, matrix_3d_t mtx) {
 }
 
 // PUSH to the MATRIX STACK to SAVE FOR LATER.
-void wf3d_push_3d(wf3d_ctx_t *ctx) {
+bool wf3d_push_3d(wf3d_ctx_t *ctx) {
 	matrix_stack_3d_t *parent = malloc(sizeof(matrix_stack_3d_t));
-	if (!parent) return;
+	if (!parent) return false;
 	*parent = ctx->stack;
 	ctx->stack.parent = parent;
+	return true;
 }
 
 // POP from the MATRIX STACK to RESTORE.
@@ -445,7 +987,8 @@ wf3d_shape_t *s3d_uv_sphere(vec3f_t position, float radius, int latitude_cuts, i
 	size_t vertices_size = num_vertex * sizeof(vec3f_t);
 	size_t tris_size     = num_tri * sizeof(size_t) * 3;
 	size_t lines_size    = num_line * sizeof(size_t) * 2;
-	size_t memory        = (size_t) malloc(sizeof(wf3d_shape_t) + vertices_size + tris_size + lines_size);
+	size_t memory        = (size_t) wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_MESH, sizeof(wf3d_shape_t) + vertices_size + tris_size + lines_size);
+	if (!memory) return NULL;
 	wf3d_shape_t *shape        = (void *)  memory;
 	vec3f_t      *vertices     = (void *) (memory + sizeof(wf3d_shape_t));
 	size_t       *tri_indices  = (void *) (memory + sizeof(wf3d_shape_t) + vertices_size);
@@ -529,5 +1072,23 @@ wf3d_shape_t *s3d_uv_sphere(vec3f_t position, float radius, int latitude_cuts, i
 	shape->line_indices = line_indices;
 	shape->num_tri      = num_tri;
 	shape->tri_indices  = tri_indices;
+	shape->edge_faces   = NULL;
+	shape->serial       = s3d_serial();
 	return shape;
 }
+
+// Frees a shape made by s3d_uv_sphere or s3d_decode_obj.
+void s3d_free(wf3d_shape_t *shape) {
+	// The arrays are in the same allocation as the shape.
+	wf3d_mem_free(&wf3d_mem_default, WF3D_MEM_MESH, shape);
+}
+
+// Gets a SERIAL for a new shape: never 0, and different from every one before it.
+uint32_t s3d_serial() {
+	static _Atomic uint32_t next = 1;
+	uint32_t serial;
+	do {
+		serial = atomic_fetch_add_explicit(&next, 1, memory_order_relaxed);
+	} while (!serial);
+	return serial;
+}
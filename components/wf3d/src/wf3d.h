@@ -51,6 +51,12 @@ typedef struct {
 	size_t   num_tri;
 	// The line_indices of triangle vertices, three per triangle.
 	size_t  *tri_indices;
+	// The triangles on either side of every line, two per line, SIZE_MAX where there is none.
+	// May be NULL, in which case outlines show every line.
+	size_t  *edge_faces;
+	// SERIAL of the shape, from s3d_serial, or 0 for shapes that are never freed.
+	// Tells the shape apart from an earlier one that was freed at the same address.
+	uint32_t serial;
 } wf3d_shape_t;
 
 #include "matrix3.h"
@@ -62,6 +68,34 @@ typedef struct {
 #define WF3D_INITIAL_LINE_CAP   64
 #define WF3D_INITIAL_TRI_CAP    64
 
+// Additions with at most this many vertices are signed by content instead of by pointer.
+#define WF3D_SIG_INLINE_VERTEX  4
+// Initial value of the DRAWING QUEUE's signature (FNV-1a offset basis).
+#define WF3D_SIG_INIT           2166136261u
+
+// Whether to collect per-stage render statistics.
+#ifndef WF3D_PROFILE
+#define WF3D_PROFILE            0
+#endif
+
+// Amount of cores that may DRAW at once, each counting pixels on its own.
+#define WF3D_STAT_CORES         2
+
+#if WF3D_PROFILE
+// Evaluates the argument only if render statistics are collected.
+#define WF3D_STAT(...) __VA_ARGS__
+#else
+// Evaluates the argument only if render statistics are collected.
+#define WF3D_STAT(...)
+#endif
+
+// Default distance from the eye to the NEAR PLANE of reciprocal depth.
+#define WF3D_DEFAULT_NEAR       0.1
+// Default distance from the eye to the FAR PLANE of reciprocal depth.
+#define WF3D_DEFAULT_FAR        100
+// Default angle in degrees between the faces on either side of a line for it to be a CREASE.
+#define WF3D_DEFAULT_CREASE     40
+
 
 
 typedef enum {
@@ -73,6 +107,137 @@ typedef enum {
 	CAMERA_VERTICAL_FOV,
 } cam_mode_t;
 
+typedef enum {
+	// Depth relative to the farthest vertex of the frame, smaller is closer.
+	WF3D_DEPTH_LINEAR,
+	// Reversed 1/distance between the NEAR and FAR PLANEs, larger is closer.
+	// Linear in screen space, so it interpolates correctly, and stable across frames.
+	WF3D_DEPTH_RECIPROCAL,
+	// No DepthBuffer: triangles are sorted farthest first and drawn over each other (PAINTER'S ALGORITHM).
+	// Wrong where triangles overlap in depth, but needs no memory or clearing per pixel.
+	WF3D_DEPTH_NONE,
+} wf3d_depth_mode_t;
+
+typedef enum {
+	// Triangles are drawn in the order they were added.
+	WF3D_ORDER_SUBMIT,
+	// Visible triangles are sorted nearest first, so the depth test rejects hidden pixels before they are drawn.
+	WF3D_ORDER_FRONT_TO_BACK,
+	// Visible triangles are sorted farthest first; always used without a DepthBuffer.
+	WF3D_ORDER_BACK_TO_FRONT,
+} wf3d_tri_order_t;
+
+typedef enum {
+	// Shapes with triangles are filled, other shapes are drawn as lines.
+	WF3D_DRAW_FILL,
+	// Every line of every shape is drawn.
+	WF3D_DRAW_WIREFRAME,
+	// Only the OUTLINE of shapes is drawn: lines between faces towards and away from the eye,
+	// lines on a CREASE next to a face towards the eye, and lines on the edge of a face towards the eye.
+	WF3D_DRAW_OUTLINE,
+} wf3d_draw_mode_t;
+
+typedef enum {
+	// Lines keep the per-channel MAXIMUM of their color and what is below them.
+	WF3D_BLEND_MAX,
+	// Lines are ADDED to what is below them, saturating per channel.
+	WF3D_BLEND_ADD,
+} wf3d_blend_t;
+
+typedef struct wf3d_dlist wf3d_dlist_t;
+typedef struct wf3d_mem   wf3d_mem_t;
+
+// Amount of SHADE PALETTEs cached per context.
+#define WF3D_PALETTE_CACHE      2
+
+// A ramp of 256 shades from black to a base color, in RGB565.
+typedef struct {
+	// Whether this palette has been built.
+	bool      valid;
+	// The color of the brightest shade.
+	pax_col_t base;
+	// The shades, where shade[part] is pax_col_lerp(part, black, base).
+	uint16_t  shade[256];
+} wf3d_palette565_t;
+
+// The projection a PRIMITIVE SINK draws the shapes it keeps with.
+// A point in the eye's space with z >= 0 goes to pixel (cx + x * scale * focal / (focal + z), cy - y * scale * focal / (focal + z)).
+typedef struct {
+	// Focal depth.
+	float   focal;
+	// Pixel position of the center of the view.
+	float   cx, cy;
+	// Pixels per unit at the focal depth.
+	float   scale;
+	// Distance from the eye to the NEAR and FAR PLANE of reciprocal depth.
+	float   depth_near, depth_far;
+	// Triangles with normal n are shaded to 255 - (dot(light, n) + 1) * 100 of 255.
+	vec3f_t light;
+} wf3d_proj_t;
+
+// Receives the primitives of a frame instead of the buffer, e.g. to draw them on a GPU.
+// Positions are in pixels of the buffer rendered to, z is depth where larger is closer.
+typedef struct {
+	// Draws a depth tested triangle, writing only the channels in `mask565`.
+	void (*tri) (void *args, const vec3f_t screen[3], uint16_t color565, uint16_t mask565);
+	// Draws a line, blending with the per-channel maximum.
+	void (*line)(void *args, const vec3f_t screen[2], uint16_t color565);
+	// Clears the depth buffer before each pass, may be NULL.
+	void (*clear)(void *args);
+	// Whether the sink keeps a copy of `shape` to draw it with `mesh`, instead of it going through the DRAWING QUEUE.
+	// Only asked with reciprocal depth, may be NULL.
+	bool (*keeps)(void *args, wf3d_shape_t *shape);
+	// Draws a shape the sink keeps, placed in the eye's space by `mtx`.
+	void (*mesh) (void *args, wf3d_shape_t *shape, matrix_3d_t mtx, const wf3d_proj_t *proj, uint16_t color565, uint16_t mask565);
+	// Passed to the callbacks.
+	void  *args;
+} wf3d_sink_t;
+
+// Per-stage render statistics for one frame.
+// Times are in microseconds.
+typedef struct {
+	// Time spent adding to the DRAWING QUEUE.
+	int64_t  add_us;
+	// Time spent transforming and projecting vertices.
+	int64_t  xform_us;
+	// Time spent sorting triangles.
+	int64_t  sort_us;
+	// Time spent submitting triangles.
+	int64_t  tri_us;
+	// Time spent submitting lines.
+	int64_t  line_us;
+	// Time spent sending the frame to the screen.
+	int64_t  flush_us;
+	// Time between this frame and the previous one.
+	int64_t  frame_us;
+	
+	// The amount of vertices transformed.
+	uint32_t vertices;
+	// The amount of triangles culled.
+	uint32_t tris_culled;
+	// The amount of triangles drawn.
+	uint32_t tris_drawn;
+	// The amount of lines drawn.
+	uint32_t lines_drawn;
+	// The amount of lines not on the OUTLINE.
+	uint32_t lines_culled;
+	// The amount of pixels depth tested.
+	uint32_t pixels_tested;
+	// The amount of pixels that passed the depth test.
+	uint32_t pixels_passed;
+	// The amount of pixels covered by triangles; passed pixels beyond this were drawn over again.
+	// Only counted when drawing to the buffer with a DepthBuffer.
+	uint32_t pixels_covered;
+} wf3d_stats_t;
+
+// Pixel counts of one core; pax shaders run on both cores at once, so each has its own.
+typedef struct {
+	// The amount of pixels depth tested.
+	uint32_t tested;
+	// The amount of pixels that passed the depth test.
+	uint32_t passed;
+} wf3d_pixel_stats_t;
+
 typedef struct matrix_stack_3d matrix_stack_3d_t;
 // A simple linked list data structure used to store matrices in a stack.
 struct matrix_stack_3d {
@@ -94,6 +259,8 @@ typedef struct {
 	size_t      cap_line;
 	// A list of all lines.
 	size_t     *lines;
+	// The triangles on either side of every line, two per line, SIZE_MAX where there is none.
+	size_t     *line_faces;
 	
 	// The amount of lines stored.
 	size_t      num_tri;
@@ -110,7 +277,22 @@ typedef struct {
 	// MATRIX STACK used to SAVE MATRIX for later.
 	matrix_stack_3d_t stack;
 	// A DepthBuffer ;)
+	// Not used, and may be NULL, with WF3D_DEPTH_NONE.
 	depth_t    *depth;
+	// How depth is stored in the DepthBuffer.
+	wf3d_depth_mode_t depth_mode;
+	// Distance from the eye to the NEAR PLANE, for reciprocal depth.
+	float       depth_near;
+	// Distance from the eye to the FAR PLANE, for reciprocal depth.
+	float       depth_far;
+	// Order in which to draw triangles.
+	wf3d_tri_order_t tri_order;
+	// How shapes are drawn; used while adding them.
+	wf3d_draw_mode_t draw_mode;
+	// Angle in degrees between the faces on either side of a line for it to be a CREASE.
+	float       crease_angle;
+	// How lines BLEND with what is already drawn; a PRIMITIVE SINK always uses the maximum.
+	wf3d_blend_t line_blend;
 	
 	// Current WIDTH being rendered.
 	int width;
@@ -118,14 +300,54 @@ typedef struct {
 	int height;
 	// Current COLOR MASK being rendered.
 	pax_col_t mask;
+	// SHADE PALETTEs of recently rendered colors.
+	wf3d_palette565_t palettes[WF3D_PALETTE_CACHE];
+	// Index of the SHADE PALETTE to replace next.
+	size_t            next_palette;
+	// PRIMITIVE SINK to draw to instead of the buffer, if any.
+	const wf3d_sink_t *sink;
+	
+	// MEMORY POLICY for the DRAWING QUEUE's buffers and render scratch.
+	wf3d_mem_t *mem;
+	
+	// SIGNATURE of everything added to the DRAWING QUEUE.
+	uint32_t sig;
+	// SIGNATURE of the last presented frame.
+	uint32_t last_sig;
+	// Whether this frame has been compared to the last presented frame.
+	bool     sig_checked;
+	// Whether this frame differs from the last presented frame.
+	bool     sig_changed;
+	// Whether to redraw the next frame regardless of SIGNATURE.
+	bool     force_redraw;
+	// Whether wf3d_render and wf3d_render2 skip frames whose SIGNATURE matches the last presented frame.
+	// Off by default, because SHAPEs edited in place then need wf3d_force_redraw to show.
+	bool     skip_unchanged;
+	
+	// DISPLAY LIST being RECORDED into, if any.
+	wf3d_dlist_t *record;
+	// Shapes that the PRIMITIVE SINK keeps and draws itself, if any.
+	wf3d_dlist_t *kept;
+	
+	// STATISTICS of the frame being built.
+	// Present regardless of WF3D_PROFILE, so every file agrees on the layout.
+	wf3d_stats_t       stats;
+	// STATISTICS of the last presented frame.
+	wf3d_stats_t       last_stats;
+	// Pixels counted per core while DRAWing, added to `stats` when the frame is presented.
+	wf3d_pixel_stats_t pixels[WF3D_STAT_CORES];
+	// Time at which the last presented frame was cleared.
+	int64_t            frame_start;
 } wf3d_ctx_t;
 
 typedef pax_vec1_t vec2f_t;
 
 
 
-// MAKEs a new DRAWING QUEUE.
+// MAKEs a new DRAWING QUEUE, with the default MEMORY POLICY.
 void wf3d_init    (wf3d_ctx_t *ctx);
+// MAKEs a new DRAWING QUEUE, with its buffers placed by `mem`.
+void wf3d_init_mem(wf3d_ctx_t *ctx, wf3d_mem_t *mem);
 // DESTROYs a DRAWING QUEUE.
 void wf3d_destroy (wf3d_ctx_t *ctx);
 // CLEARs the DRAWING QUEUE.
@@ -139,14 +361,43 @@ void wf3d_lines   (wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size
 void wf3d_tri     (wf3d_ctx_t *ctx, vec3f_t a, vec3f_t b, vec3f_t c);
 // Adds multiple TRIANGLES to the DRAWING QUEUE.
 void wf3d_tris    (wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t num_tris, size_t *tri_indices);
-// Adds multiple LINES and TRIANGLES to the DRAWING QUEUE.
+// Adds multiple LINES and TRIANGLES to the DRAWING QUEUE; leaves it as it was if out of memory.
 void wf3d_add     (wf3d_ctx_t *ctx, size_t num_vertices, vec3f_t *vertices, size_t num_lines, size_t *line_indices, size_t num_tris, size_t *tri_indices);
 // Adds a SHAPE to the DRAWING QUEUE.
 void wf3d_mesh    (wf3d_ctx_t *ctx, wf3d_shape_t *shape);
+// Adds a SHAPE to the DRAWING QUEUE under an extra MATRIX, without touching the MATRIX STACK.
+void wf3d_mesh_mtx(wf3d_ctx_t *ctx, matrix_3d_t mtx, wf3d_shape_t *shape);
+// Adds a SHAPE to the DRAWING QUEUE itself, never recorded or kept by the PRIMITIVE SINK.
+// Returns the index of its first vertex in the DRAWING QUEUE, or SIZE_MAX if out of memory, which leaves it out.
+size_t wf3d_mesh_direct(wf3d_ctx_t *ctx, wf3d_shape_t *shape);
 // DRAWs everything in the DRAWING QUEUE.
-void wf3d_render  (pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix);
+// With skip_unchanged set, returns false without drawing if nothing changed since the last presented frame,
+// including the color; otherwise always draws and returns true.
+bool wf3d_render  (pax_buf_t *to, pax_col_t color, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix);
 // DRAWs everything in one color per eye.
-void wf3d_render2 (pax_buf_t *to, pax_col_t left_eye, pax_col_t right_eye, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix, float eye_dist);
+// With skip_unchanged set, returns false without drawing if nothing changed since the last presented frame,
+// including the colors and eye distance; otherwise always draws and returns true.
+bool wf3d_render2 (pax_buf_t *to, pax_col_t left_eye, pax_col_t right_eye, wf3d_ctx_t *ctx, matrix_3d_t cam_matrix, float eye_dist);
+
+// MIXes extra frame state (render mode, colors, etc.) into the DRAWING QUEUE's SIGNATURE.
+// Must be called before the frame is checked or rendered.
+void wf3d_sig_mix     (wf3d_ctx_t *ctx, const void *data, size_t len);
+// Determines whether this frame differs from the last presented frame.
+// Shapes are identified by pointer, so use wf3d_force_redraw after editing one in place.
+// Only wf3d_render and wf3d_render2 sign their colors and eye distance, so when checking ahead of them,
+// MIX in whatever chooses those first.
+bool wf3d_changed     (wf3d_ctx_t *ctx, pax_buf_t *to, matrix_3d_t cam_matrix);
+// FORCEs the next frame to be redrawn.
+void wf3d_force_redraw(wf3d_ctx_t *ctx);
+
+// Records the time it took to send the frame to the screen, in microseconds.
+// Does nothing unless WF3D_PROFILE is enabled.
+void wf3d_stats_flush(wf3d_ctx_t *ctx, int64_t flush_us);
+// Counts pixels DRAWn by the core this runs on.
+void wf3d_stats_pixels(wf3d_ctx_t *ctx, uint32_t tested, uint32_t passed);
+// DRAWs an overlay with FPS and STATISTICS of the last presented frame.
+// Does nothing unless WF3D_PROFILE is enabled.
+void wf3d_draw_stats (pax_buf_t *to, wf3d_ctx_t *ctx);
 
 // Calculates the normals for a 3D triangle.
 vec3f_t wf3d_calc_tri_normals(vec3f_t a, vec3f_t b, vec3f_t c);
@@ -158,15 +409,19 @@ vec3f_t wf3d_xform(wf3d_ctx_t *ctx, float focal_depth, vec3f_t point);
 // APPLY some MATRIX.
 void wf3d_apply_3d(wf3d_ctx_t *ctx, matrix_3d_t mtx);
 // PUSH to the MATRIX STACK to SAVE FOR LATER.
-void wf3d_push_3d (wf3d_ctx_t *ctx);
+// Returns false if out of memory, which leaves the MATRIX STACK as it was.
+bool wf3d_push_3d (wf3d_ctx_t *ctx);
 // POP from the MATRIX STACK to RESTORE.
 void wf3d_pop_3d  (wf3d_ctx_t *ctx);
 // RESET the MATRIX STACK.
 void wf3d_reset_3d(wf3d_ctx_t *ctx);
 
-// Creates a UV sphere mesh.
+// Creates a UV sphere mesh; see wf3d_prims.h for shapes made when building instead.
 wf3d_shape_t *s3d_uv_sphere(vec3f_t position, float radius, int latitude_cuts, int longitude_cuts);
-
+// Frees a shape made by s3d_uv_sphere or s3d_decode_obj.
+void          s3d_free     (wf3d_shape_t *shape);
+// Gets a SERIAL for a new shape: never 0, and different from every one before it.
+uint32_t      s3d_serial   ();
 
 #ifdef __cplusplus
 }
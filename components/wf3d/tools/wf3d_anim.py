@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+# Encodes keyframes of a deformed mesh into a wf3d vertex animation, to be built into flash.
+# Usage: wf3d_anim.py [output .c] [output .h] [name] [keyframes per second] [loop|once] [base .obj] [keyframe .obj]...
+# Every keyframe must have the vertices of the base in the same order, such as when exported with "keep vertex order".
+
+import os
+import sys
+
+def load_obj(path):
+	"""Return the vertices of an .obj file, ignoring everything else."""
+	vertices = []
+	with open(path) as fd:
+		for line in fd:
+			words = line.split()
+			if words and words[0] == "v":
+				vertices.append(tuple(float(w) for w in words[1:4]))
+	return vertices
+
+def quantise(base, frame):
+	"""Return (scale, steps): offsets from the base in steps of one scale, fitting a signed byte."""
+	offsets = [f[k] - b[k] for b, f in zip(base, frame) for k in range(3)]
+	scale   = max((abs(o) for o in offsets), default=0) / 127
+	if scale == 0:
+		return 0, [0] * len(offsets)
+	return scale, [max(-127, min(127, round(o / scale))) for o in offsets]
+
+def rows(values, per_row):
+	return "".join("\t" + " ".join(values[i:i + per_row]) + "\n" for i in range(0, len(values), per_row))
+
+def main():
+	if len(sys.argv) < 8 or sys.argv[5] not in ("loop", "once"):
+		print(f"Usage: {sys.argv[0]} [output .c] [output .h] [name] [keyframes per second] [loop|once] [base .obj] [keyframe .obj]...", file=sys.stderr)
+		return 1
+	out_c, out_h, name, rate, mode, base_path, frame_paths = *sys.argv[1:7], sys.argv[7:]
+	if not name.isidentifier():
+		raise ValueError(f"{name}: bad name")
+	rate = float(rate)
+
+	base = load_obj(base_path)
+	scales, deltas, error = [], [], 0
+	for path in frame_paths:
+		frame = load_obj(path)
+		if len(frame) != len(base):
+			raise ValueError(f"{path}: {len(frame)} vertices where the base has {len(base)}")
+		scale, steps = quantise(base, frame)
+		scales.append(scale)
+		deltas += steps
+		for i, step in enumerate(steps):
+			error = max(error, abs(base[i // 3][i % 3] + step * scale - frame[i // 3][i % 3]))
+
+	prefix = f"wf3d_anim_{name}"
+	guard  = f"WF3D_ANIM_{name.upper()}_H"
+	source  = f"// Generated by wf3d_anim.py, do not edit.\n\n#include \"{os.path.basename(out_h)}\"\n\n"
+	source += f"// {len(frame_paths)} keyframes of {os.path.basename(base_path)} at {rate:g} per second.\n"
+	source += f"static const float {prefix}_scales[] = {{\n"
+	source += rows([f"{s:.7g}," for s in scales], 8)
+	source += "};\n"
+	source += f"static const int8_t {prefix}_deltas[] = {{\n"
+	source += rows([f"{d}," for d in deltas], 24)
+	source += "};\n"
+	source += f"const wf3d_anim_t {prefix} = {{\n"
+	source += f"\t.num_vertex = {len(base)},\n"
+	source += f"\t.num_frame  = {len(frame_paths)},\n"
+	source += f"\t.rate       = {rate:g},\n"
+	source += f"\t.loop       = {'true' if mode == 'loop' else 'false'},\n"
+	source += f"\t.scales     = {prefix}_scales,\n"
+	source += f"\t.deltas     = {prefix}_deltas,\n"
+	source += "};\n"
+
+	header  = f"// Generated by wf3d_anim.py, do not edit.\n\n#ifndef {guard}\n#define {guard}\n\n#include \"anim.h\"\n\n"
+	header += "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n"
+	header += f"// {len(frame_paths)} keyframes of {os.path.basename(base_path)}; play it with wf3d_anim_mesh on a SHAPE with the same vertices.\n"
+	header += f"extern const wf3d_anim_t {prefix};\n"
+	header += f"\n#ifdef __cplusplus\n}}\n#endif\n\n#endif // {guard}\n"
+
+	for path, text in ((out_c, source), (out_h, header)):
+		with open(path, "w") as fd:
+			fd.write(text)
+	print(f"{prefix}: {len(base)} vertices, {len(frame_paths)} keyframes, {len(deltas) + 4 * len(scales)} bytes, "
+		f"largest error {error:.3g}", file=sys.stderr)
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())
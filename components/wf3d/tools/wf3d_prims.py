@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+# Generates wf3d shapes for parametric primitives, to be built into flash instead of made at runtime.
+# Usage: wf3d_prims.py [output .c] [output .h] [name:kind[:parameter...]]...
+# For example, sphere:uv_sphere:8:16 makes wf3d_prim_sphere, see KINDS for the parameters of each kind.
+
+import math
+import os
+import sys
+
+# Index of a missing face next to a line; SIZE_MAX in C.
+NO_FACE = None
+
+class Mesh:
+	"""Vertices and polygons, wound so that wf3d_calc_tri_normals points outwards."""
+	def __init__(self, closed=True):
+		self.vertices = []
+		self.polys    = []
+		self.closed   = closed
+
+	def vertex(self, x, y, z):
+		self.vertices.append((x, y, z))
+		return len(self.vertices) - 1
+
+	def poly(self, *indices):
+		self.polys.append(indices)
+
+	def build(self):
+		"""Return (lines, tris, edge_faces): every polygon edge once, polygons as triangle fans and the two triangles next to each line."""
+		tris  = []
+		lines = []
+		seen  = set()
+		owner = {}
+		for poly in self.polys:
+			for i in range(1, len(poly) - 1):
+				tri = (poly[0], poly[i], poly[i + 1])
+				for j in range(3):
+					owner.setdefault(frozenset((tri[j], tri[(j + 1) % 3])), []).append(len(tris))
+				tris.append(tri)
+			for i in range(len(poly)):
+				edge = (poly[i], poly[(i + 1) % len(poly)])
+				if frozenset(edge) not in seen:
+					seen.add(frozenset(edge))
+					lines.append(edge)
+		# Edges of more than two faces keep the first two, like s3d_decode_obj.
+		edge_faces = [(owner[frozenset(l)] + [NO_FACE, NO_FACE])[:2] for l in lines]
+		return lines, tris, edge_faces
+
+	def volume(self, tris):
+		"""Signed volume, positive if the faces point outwards."""
+		vol = 0
+		for a, b, c in tris:
+			p, q, r = self.vertices[a], self.vertices[b], self.vertices[c]
+			vol += p[0] * (q[1] * r[2] - q[2] * r[1]) + p[1] * (q[2] * r[0] - q[0] * r[2]) + p[2] * (q[0] * r[1] - q[1] * r[0])
+		return vol / 6
+
+
+
+def cube():
+	"""Cube from -1 to 1."""
+	m = Mesh()
+	for z in (-1, 1):
+		for y in (-1, 1):
+			for x in (-1, 1):
+				m.vertex(x, y, z)
+	m.poly(0, 2, 3, 1)
+	m.poly(4, 5, 7, 6)
+	m.poly(0, 1, 5, 4)
+	m.poly(2, 6, 7, 3)
+	m.poly(0, 4, 6, 2)
+	m.poly(1, 3, 7, 5)
+	return m
+
+def grid(cells_x, cells_z):
+	"""Square from -1 to 1 on the XZ plane, facing up, cut into cells."""
+	cells_x, cells_z = int(cells_x), int(cells_z)
+	m = Mesh(closed=False)
+	for j in range(cells_z + 1):
+		for i in range(cells_x + 1):
+			m.vertex(-1 + 2 * i / cells_x, 0, -1 + 2 * j / cells_z)
+	row = cells_x + 1
+	for j in range(cells_z):
+		for i in range(cells_x):
+			a = i + j * row
+			m.poly(a, a + row, a + row + 1, a + 1)
+	return m
+
+def cylinder(segments):
+	"""Cylinder of radius 1 around the Y axis, from -1 to 1, with capped ends."""
+	segments = int(segments)
+	m = Mesh()
+	for i in range(segments):
+		a = 2 * math.pi * i / segments
+		m.vertex(math.cos(a), -1, math.sin(a))
+		m.vertex(math.cos(a),  1, math.sin(a))
+	for i in range(segments):
+		j = (i + 1) % segments
+		m.poly(2 * i, 2 * i + 1, 2 * j + 1, 2 * j)
+	m.poly(*[2 * i for i in range(segments)])
+	m.poly(*[2 * i + 1 for i in reversed(range(segments))])
+	return m
+
+def uv_sphere(rings, segments):
+	"""Sphere of radius 1 with poles on the Y axis and `rings` rings of vertices between them, like s3d_uv_sphere."""
+	rings, segments = int(rings), int(segments)
+	m = Mesh()
+	top    = m.vertex(0,  1, 0)
+	bottom = m.vertex(0, -1, 0)
+	for r in range(rings):
+		lat = math.pi * (r + 1) / (rings + 1)
+		for s in range(segments):
+			lon = 2 * math.pi * s / segments
+			m.vertex(math.sin(lat) * math.cos(lon), math.cos(lat), math.sin(lat) * math.sin(lon))
+	def at(r, s):
+		return 2 + r * segments + s % segments
+	for s in range(segments):
+		m.poly(top, at(0, s + 1), at(0, s))
+		m.poly(bottom, at(rings - 1, s), at(rings - 1, s + 1))
+		for r in range(rings - 1):
+			m.poly(at(r, s), at(r, s + 1), at(r + 1, s + 1), at(r + 1, s))
+	return m
+
+def icosphere(subdivisions):
+	"""Sphere of radius 1 made by splitting every triangle of an icosahedron into four, `subdivisions` times."""
+	t = (1 + math.sqrt(5)) / 2
+	points = [
+		(-1,  t,  0), ( 1,  t,  0), (-1, -t,  0), ( 1, -t,  0),
+		( 0, -1,  t), ( 0,  1,  t), ( 0, -1, -t), ( 0,  1, -t),
+		( t,  0, -1), ( t,  0,  1), (-t,  0, -1), (-t,  0,  1),
+	]
+	faces = [
+		(0, 11, 5), (0, 5, 1), (0, 1, 7), (0, 7, 10), (0, 10, 11),
+		(1, 5, 9), (5, 11, 4), (11, 10, 2), (10, 7, 6), (7, 1, 8),
+		(3, 9, 4), (3, 4, 2), (3, 2, 6), (3, 6, 8), (3, 8, 9),
+		(4, 9, 5), (2, 4, 11), (6, 2, 10), (8, 6, 7), (9, 8, 1),
+	]
+	m = Mesh()
+	for p in points:
+		n = math.sqrt(sum(c * c for c in p))
+		m.vertex(*(c / n for c in p))
+	for _ in range(int(subdivisions)):
+		middle = {}
+		def mid(a, b):
+			key = (min(a, b), max(a, b))
+			if key not in middle:
+				p = [(m.vertices[a][k] + m.vertices[b][k]) / 2 for k in range(3)]
+				n = math.sqrt(sum(c * c for c in p))
+				middle[key] = m.vertex(*(c / n for c in p))
+			return middle[key]
+		split = []
+		for a, b, c in faces:
+			ab, bc, ca = mid(a, b), mid(b, c), mid(c, a)
+			split += [(a, ab, ca), (b, bc, ab), (c, ca, bc), (ab, bc, ca)]
+		faces = split
+	for face in faces:
+		m.poly(*face)
+	return m
+
+def torus(segments, sides, thickness):
+	"""Torus around the Y axis, with a ring of radius 1 and a tube of radius `thickness`."""
+	segments, sides, thickness = int(segments), int(sides), float(thickness)
+	m = Mesh()
+	for i in range(segments):
+		a = 2 * math.pi * i / segments
+		for j in range(sides):
+			b = 2 * math.pi * j / sides
+			r = 1 + thickness * math.cos(b)
+			m.vertex(r * math.cos(a), thickness * math.sin(b), r * math.sin(a))
+	def at(i, j):
+		return (i % segments) * sides + j % sides
+	for i in range(segments):
+		for j in range(sides):
+			m.poly(at(i, j), at(i, j + 1), at(i + 1, j + 1), at(i + 1, j))
+	return m
+
+KINDS = {
+	"cube":      cube,
+	"grid":      grid,
+	"cylinder":  cylinder,
+	"uv_sphere": uv_sphere,
+	"icosphere": icosphere,
+	"torus":     torus,
+}
+
+
+
+def num(value):
+	text = f"{value:.7g}"
+	return "0" if text == "-0" else text
+
+def index(value):
+	return "SIZE_MAX" if value is NO_FACE else str(value)
+
+def rows(values, per_row):
+	return "".join("\t" + " ".join(values[i:i + per_row]) + "\n" for i in range(0, len(values), per_row))
+
+def emit(name, spec, kind, mesh):
+	lines, tris, edge_faces = mesh.build()
+	if mesh.closed and mesh.volume(tris) <= 0:
+		raise ValueError(f"{spec}: faces point inwards")
+	prefix = f"wf3d_prim_{name}"
+	out  = f"// {spec}: {kind.__doc__}\n"
+	out += f"static const vec3f_t {prefix}_vertices[] = {{\n"
+	out += "".join(f"\t{{ {num(x)}, {num(y)}, {num(z)} }},\n" for x, y, z in mesh.vertices)
+	out += "};\n"
+	out += f"static const size_t {prefix}_lines[] = {{\n"
+	out += rows([f"{a}, {b}," for a, b in lines], 8)
+	out += "};\n"
+	out += f"static const size_t {prefix}_tris[] = {{\n"
+	out += rows([f"{a}, {b}, {c}," for a, b, c in tris], 6)
+	out += "};\n"
+	out += f"static const size_t {prefix}_edge_faces[] = {{\n"
+	out += rows([f"{index(a)}, {index(b)}," for a, b in edge_faces], 8)
+	out += "};\n"
+	out += f"wf3d_shape_t {prefix} = {{\n"
+	out += f"\t.num_vertex   = {len(mesh.vertices)},\n"
+	out += f"\t.vertices     = (vec3f_t *) {prefix}_vertices,\n"
+	out += f"\t.num_lines    = {len(lines)},\n"
+	out += f"\t.line_indices = (size_t *) {prefix}_lines,\n"
+	out += f"\t.num_tri      = {len(tris)},\n"
+	out += f"\t.tri_indices  = (size_t *) {prefix}_tris,\n"
+	out += f"\t.edge_faces   = (size_t *) {prefix}_edge_faces,\n"
+	out += "};\n\n"
+	return out
+
+def main():
+	if len(sys.argv) < 3:
+		print(f"Usage: {sys.argv[0]} [output .c] [output .h] [name:kind[:parameter...]]...", file=sys.stderr)
+		return 1
+	out_c, out_h, specs = sys.argv[1], sys.argv[2], sys.argv[3:]
+
+	source = f"// Generated by wf3d_prims.py, do not edit.\n\n#include \"{os.path.basename(out_h)}\"\n#include <stdint.h>\n\n"
+	header = "// Generated by wf3d_prims.py, do not edit.\n\n#ifndef WF3D_PRIMS_H\n#define WF3D_PRIMS_H\n\n#include \"wf3d.h\"\n\n"
+	header += "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n"
+	header += "// The vertices and indices are const and live in flash; do not edit these shapes.\n"
+	names = set()
+	for spec in specs:
+		name, kind, *params = spec.split(":")
+		if not name.isidentifier() or name in names:
+			raise ValueError(f"{spec}: bad or repeated name")
+		if kind not in KINDS:
+			raise ValueError(f"{spec}: unknown kind, expected one of {', '.join(KINDS)}")
+		names.add(name)
+		source += emit(name, spec, KINDS[kind], KINDS[kind](*params))
+		header += f"// {spec}: {KINDS[kind].__doc__}\nextern wf3d_shape_t wf3d_prim_{name};\n"
+	header += "\n#ifdef __cplusplus\n}\n#endif\n\n#endif // WF3D_PRIMS_H\n"
+
+	for path, text in ((out_c, source), (out_h, header)):
+		with open(path, "w") as fd:
+			fd.write(text)
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -0,0 +1,74 @@
+/*
+    MIT License
+
+    Copyright (c) 2022 Julian Scheffers
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// How a finished frame is handed to the screen.
+typedef enum {
+    // Present as soon as the frame pacer allows it.
+    PRESENT_IMMEDIATE,
+    // Additionally wait for the start of the panel's tearing effect pulse.
+    // Requires the FPGA to be initialised; it forwards the LCD's FMARK line.
+    PRESENT_TEARING_EFFECT,
+} present_mode_t;
+
+// Frame pacer: keeps frames at a fixed rate and records missed deadlines.
+typedef struct {
+    // How frames are presented.
+    present_mode_t     mode;
+    // Target frame period in microseconds, 0 to not pace.
+    int64_t            period;
+    // When the next frame is due, 0 if not yet known.
+    int64_t            deadline;
+    
+    // Amount of frames presented.
+    uint32_t           frames;
+    // Amount of frames that finished after their deadline.
+    uint32_t           missed;
+    // Amount of times the tearing effect signal could not be waited for.
+    uint32_t           fmark_errors;
+    // Time by which the latest frame missed its deadline, 0 if it didn't.
+    int64_t            late;
+    // Worst time by which a deadline was missed.
+    int64_t            max_late;
+    
+    // One-shot timer used to sleep until the deadline.
+    esp_timer_handle_t timer;
+    // Task to wake when the timer expires.
+    TaskHandle_t       task;
+} pacer_t;
+
+// Initialises a frame pacer for a target rate in Hz, 0 to not pace.
+void pacer_init(pacer_t *pacer, present_mode_t mode, int rate);
+// Frees resources held by a frame pacer.
+void pacer_destroy(pacer_t *pacer);
+// Sleeps until the next frame may be presented.
+// Returns false if the frame missed its deadline.
+bool pacer_wait(pacer_t *pacer);
@@ -0,0 +1,111 @@
+/*
+    MIT License
+
+    Copyright (c) 2022 Julian Scheffers
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "wf3d.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Capacity of a scene queue in updates, a power of two.
+#ifndef SCENE_QUEUE_LEN
+#define SCENE_QUEUE_LEN 32
+#endif
+
+// What a scene update does.
+typedef enum {
+    // Sets the render mode and camera of the frame.
+    SCENE_VIEW,
+    // Ends the frame; added by scene_queue_commit.
+    SCENE_END,
+} scene_op_t;
+
+// One update of the scene, from the logic task to the render task.
+typedef struct {
+    scene_op_t op;
+    union {
+        struct {
+            // Render mode, see app_main.
+            int         mode;
+            // Distance between the eyes for the stereo modes.
+            float       eye_dist;
+            matrix_3d_t camera;
+        } view;
+        // When the frame was committed, in microseconds.
+        int64_t time;
+    };
+} scene_update_t;
+
+// Lock-free queue of scene updates from one producer task to one consumer task.
+// Updates are handed over a frame at a time, so the consumer never sees half a frame.
+typedef struct {
+    scene_update_t    slots[SCENE_QUEUE_LEN];
+    // Where the producer publishes frames up to; written by the producer only.
+    _Atomic uint32_t  head;
+    // Where the consumer reads from; written by the consumer only.
+    _Atomic uint32_t  tail;
+    // Amount of frames published and taken.
+    _Atomic uint32_t  frames_in;
+    uint32_t          frames_out;
+    
+    // Where the producer writes the frame being built.
+    uint32_t          write;
+    // Whether the frame being built did not fit.
+    bool              overflow;
+    
+    // Set while the consumer sleeps; the producer then rings the doorbell.
+    _Atomic bool      waiting;
+    SemaphoreHandle_t doorbell;
+    StaticSemaphore_t doorbell_buf;
+    
+    // Amount of frames dropped by the producer because the queue was full.
+    _Atomic uint32_t  dropped;
+    // Amount of frames the consumer skipped because a newer one was waiting.
+    uint32_t          skipped;
+    // Most updates waiting at once.
+    uint32_t          high_water;
+    // Time from committing the latest frame to the consumer finishing taking it, and the longest one, in microseconds.
+    int64_t           latency;
+    int64_t           max_latency;
+} scene_queue_t;
+
+// Initialises an empty scene queue.
+void scene_queue_init(scene_queue_t *queue);
+
+// Producer: adds an update to the frame being built.
+// Returns false if it does not fit, in which case the whole frame is dropped at commit.
+bool scene_queue_push(scene_queue_t *queue, const scene_update_t *update);
+// Producer: ends the frame being built and hands it to the consumer.
+// Returns false if it was dropped because the queue was full.
+bool scene_queue_commit(scene_queue_t *queue);
+
+// Consumer: waits up to `timeout` for a whole frame, skipping to the newest if several are waiting.
+// Returns whether a frame is ready to be taken with scene_queue_pop.
+bool scene_queue_wait(scene_queue_t *queue, TickType_t timeout);
+// Consumer: takes the next update of the frame; the SCENE_END update is the last one.
+// Returns false if there is nothing to take.
+bool scene_queue_pop(scene_queue_t *queue, scene_update_t *update);
@@ -25,7 +25,54 @@
 
 #include "main.h"
 #include "wf3d.h"
+#include "dynres.h"
+#include "pair.h"
+#include "mem.h"
 #include "quartz.h"
+#include "pacer.h"
+#include "scene_queue.h"
+#include "wf3d_prims.h"
+#include <string.h>
+
+// Target frame rate in Hz, 0 to draw as fast as possible.
+#define FRAME_RATE   30
+// How frames are presented, see present_mode_t.
+#define PRESENT_MODE PRESENT_IMMEDIATE
+// Render time budget in microseconds, 0 to always render at full resolution.
+#define RENDER_BUDGET 20000
+// Whether to send triangles and lines to the FPGA instead of drawing them on the CPU.
+// Needs a bitstream built from components/quartz-gpu/fpga whose simulation passed, see the check below.
+#define RENDER_ON_GPU 0
+// Whether to draw with a depth buffer; without one, triangles are sorted back to front and drawn over each other.
+// Saves the depth buffer's RAM and clearing, but overlapping triangles may be drawn in the wrong order.
+// Ignored with RENDER_ON_GPU, as the FPGA has its own depth buffer.
+#define DEPTH_BUFFER  1
+// How shapes are drawn, see wf3d_draw_mode_t; WF3D_DRAW_OUTLINE draws only silhouettes and creases.
+#define DRAW_MODE     WF3D_DRAW_FILL
+// Whether the FPGA keeps the framebuffer and drives the LCD, so only changed tiles are sent.
+// The FPGA waits for the tearing effect itself, so use PRESENT_IMMEDIATE with this.
+// Needs a bitstream built from components/quartz-gpu/fpga whose simulation passed, see the check below.
+#define FB_ON_GPU     0
+// Rate at which the logic task reads input and updates the scene, in Hz.
+#define LOGIC_RATE    50
+// Cores and priorities of the render and logic tasks; PAX's multicore worker shares core 1 with the logic task.
+#define RENDER_CORE   0
+#define RENDER_PRIO   5
+#define LOGIC_CORE    1
+#define LOGIC_PRIO    4
+// Stack sizes of the render and logic tasks, in bytes; FreeRTOS takes them from internal RAM.
+#define RENDER_STACK  8192
+#define LOGIC_STACK   4096
+// Internal RAM for the tasks besides their stacks, such as their control blocks.
+#define TASK_OVERHEAD 1024
+
+// The GPU features need the real bitstream, and RTL that has passed its simulation.
+#if FB_ON_GPU && !(QUARTZ_BITSTREAM_BUILT && QUARTZ_SIM_DELTA)
+#error "FB_ON_GPU needs fpga/build-tmp/quartz.bin built and the delta scene of fpga/sim passing"
+#endif
+#if RENDER_ON_GPU && !(QUARTZ_BITSTREAM_BUILT && QUARTZ_SIM_RASTER && QUARTZ_SIM_MESHES)
+#error "RENDER_ON_GPU needs fpga/build-tmp/quartz.bin built, and raster_tb and the meshes scene of fpga/sim passing"
+#endif
 
 static pax_buf_t buf;
 xQueueHandle buttonQueue;
@@ -36,9 +83,119 @@ static const char *TAG = "main";
 extern const char suzanne_obj_start[] asm("_binary_suzanne_obj_start");
 extern const char suzanne_obj_end[]   asm("_binary_suzanne_obj_end");
 
+// Scene updates from the logic task to the render task.
+static scene_queue_t scene;
+// Geometry, filled by the logic task while the render task draws the previous frame.
+static wf3d_pair_t   pair;
+// Loaded before the tasks start, then only read.
+static wf3d_shape_t *suzanne;
+
+// Draw commands for the FPGA.
+static quartz_batch_t gpu_batch;
+// What the FPGA's framebuffer holds.
+static quartz_delta_t gpu_delta;
+// Meshes kept in the FPGA's RAM, after the framebuffer.
+static quartz_meshes_t gpu_meshes;
+// Projection last sent to the FPGA.
+static quartz_view_t gpu_view;
+
+// Renders at reduced resolution when frames get too heavy.
+static wf3d_dynres_t dynres;
+
+// Converts a position in pixels to the FPGA's 12.4 fixed-point.
+static int16_t gpu_fixed(float value) {
+    float fixed = value * 16;
+    if (fixed < INT16_MIN) return INT16_MIN;
+    if (fixed > INT16_MAX) return INT16_MAX;
+    return lrintf(fixed);
+}
+
+// Sends a triangle from wf3d to the FPGA.
+static void gpu_tri(void *args, const vec3f_t screen[3], uint16_t color565, uint16_t mask565) {
+    quartz_tri_t tri = { .color = color565 };
+    for (int i = 0; i < 3; i++) {
+        tri.v[i] = (quartz_vtx_t) { gpu_fixed(screen[i].x), gpu_fixed(screen[i].y), screen[i].z };
+    }
+    quartz_batch_tri(args, &tri, mask565);
+}
+
+// Sends a line from wf3d to the FPGA.
+static void gpu_line(void *args, const vec3f_t screen[2], uint16_t color565) {
+    quartz_line_t line = {
+        gpu_fixed(screen[0].x), gpu_fixed(screen[0].y),
+        gpu_fixed(screen[1].x), gpu_fixed(screen[1].y),
+        color565,
+    };
+    quartz_batch_line(args, &line);
+}
+
+// Clears the FPGA's depth buffer before a pass.
+static void gpu_clear(void *args) {
+    // The clear must not overtake draw commands still in the batch.
+    quartz_batch_flush(args);
+    quartz_cmd_clear(0, 0, QUARTZ_CLEAR_DEPTH);
+}
+
+// Keeps triangle meshes on the FPGA, so they are sent once instead of every frame.
+static bool gpu_keeps(void *args, wf3d_shape_t *shape) {
+    return shape->num_tri && shape->num_tri <= UINT16_MAX && shape->num_vertex <= UINT16_MAX;
+}
+
+// Draws a mesh kept on the FPGA, uploading it first if it is not there.
+static void gpu_mesh(void *args, wf3d_shape_t *shape, matrix_3d_t mtx, const wf3d_proj_t *proj, uint16_t color565, uint16_t mask565) {
+    quartz_mesh_src_t src = {
+        shape->num_vertex, (const float *) shape->vertices,
+        shape->num_tri,    shape->tri_indices,
+        // A shape made where a freed one was must not be drawn as the old one.
+        shape->serial,
+    };
+    int handle = quartz_meshes_acquire(&gpu_meshes, args, shape, &src);
+    if (handle < 0) {
+        ESP_LOGW(TAG, "Mesh of %zu triangles does not fit on the FPGA", shape->num_tri);
+        return;
+    }
+    
+    quartz_view_t view = quartz_make_view(proj->focal, proj->scale, proj->cx, proj->cy, proj->depth_near, proj->depth_far);
+    if (memcmp(&view, &gpu_view, sizeof(view))) {
+        // Draws already in the batch use the old projection.
+        quartz_batch_flush(args);
+        quartz_cmd_view(&view);
+        gpu_view = view;
+    }
+    
+    float light[3] = { proj->light.x, proj->light.y, proj->light.z };
+    quartz_xform_t xform = quartz_meshes_xform(&gpu_meshes, handle, mtx.arr, light);
+    quartz_batch_draw(args, handle, color565, mask565, &xform);
+}
+
+static const wf3d_sink_t gpu_sink = {
+    .tri   = gpu_tri,
+    .line  = gpu_line,
+    .clear = gpu_clear,
+    .keeps = gpu_keeps,
+    .mesh  = gpu_mesh,
+    .args  = &gpu_batch,
+};
+
+// Sends rows of the frame to the LCD.
+static bool disp_write(void *args, const void *pixels, int y, int rows) {
+    return ili9341_write_partial_direct(get_ili9341(), pixels, 0, y, buf.width, rows) == ESP_OK;
+}
+
 // Updates the screen with the latest buffer.
 void disp_flush() {
-    ili9341_write(get_ili9341(), buf.buf);
+    if (RENDER_ON_GPU) {
+        // The frame was drawn straight into the FPGA's framebuffer.
+        quartz_cmd_present();
+    } else if (FB_ON_GPU) {
+        if (!quartz_delta_upload(&gpu_delta, &gpu_batch, buf.buf, buf.reverse_endianness)) {
+            ESP_LOGW(TAG, "Some of the frame did not reach the FPGA");
+        }
+        quartz_cmd_present();
+    } else {
+        // Upscales on the way if the frame was rendered at reduced resolution.
+        wf3d_dynres_flush(&dynres, disp_write, NULL);
+    }
 }
 
 // Exits the app, returning to the launcher.
@@ -47,143 +204,121 @@ void exit_to_launcher() {
     esp_restart();
 }
 
-void app_main() {
-  
-    vTaskDelay(pdMS_TO_TICKS(500));
-    ESP_LOGI(TAG, "Starting...");
-
-    // Initialize the screen, the I2C and the SPI busses.
-    bsp_init();
-
-    // Initialize the RP2040 (responsible for buttons, etc).
-    bsp_rp2040_init();
-    
-    // This queue is used to receive button presses.
-    buttonQueue = get_rp2040()->queue;
-    
-    // Initialize graphics for the screen.
-    pax_buf_init(&buf, NULL, 320, 240, PAX_BUF_16_565RGB);
-    pax_background(&buf, 0xff000000);
-    pax_enable_multicore(1);
-    // quartz_init();
-    // quartz_debug();
-    // exit_to_launcher();
+// Draws the newest frame of scene updates from the logic task.
+static void render_task(void *args) {
+    wf3d_ctx_t *c3d = &pair.front;
     
-    // Initialize NVS.
-    nvs_flash_init();
-    
-    // Initialize WiFi. This doesn't connect to Wifi yet.
-    wifi_init();
-        
-    wf3d_ctx_t c3d;
-    wf3d_init(&c3d);
-    c3d.depth = malloc(sizeof(depth_t) * buf.width * buf.height);
+    // The FPGA always draws at full resolution.
+    wf3d_dynres_init(&dynres, &buf, RENDER_ON_GPU ? 0 : RENDER_BUDGET);
     
-    bool up = 0, down = 0, left = 0, right = 0;
+    pacer_t pacer;
+    pacer_init(&pacer, PRESENT_MODE, FRAME_RATE);
+    uint32_t last_missed  = 0;
+    uint32_t last_dropped = 0;
+    uint32_t last_skipped = 0;
     
-    FILE *fd = fmemopen((void *) suzanne_obj_start, suzanne_obj_end - suzanne_obj_start, "r");
-    wf3d_shape_t *suzanne = s3d_decode_obj(fd);
-    wf3d_shape_t *sphere  = s3d_uv_sphere((vec3f_t){0, 0, 0}, 1.5, 5, 10);
+    // Set by the logic task.
+    int         mode     = 0;
+    float       eye_dist = 0;
+    matrix_3d_t cam_mtx  = matrix_3d_identity();
     
-    int mode = 0;
-    int scene = 1;
-    float eye_dist = 0.18;
     while (1) {
-        pax_background(&buf, 0);
-        
-        // 3D unit CUBE test.
-        vec3f_t cube_vtx[] = {
-            // Front face
-            { -1, -1, -1 },
-            {  1, -1, -1 },
-            {  1,  1, -1 },
-            { -1,  1, -1 },
-            
-            // Back face
-            { -1, -1,  1 },
-            {  1, -1,  1 },
-            {  1,  1,  1 },
-            { -1,  1,  1 },
-        };
-        
-        size_t cube_lines[] = {
-            // Front face
-            0, 1,
-            1, 2,
-            2, 3,
-            3, 0,
-            
-            // Back face
-            4, 5,
-            5, 6,
-            6, 7,
-            7, 4,
-            
-            // Edge faces
-            0, 4,
-            1, 5,
-            2, 6,
-            3, 7,
-        };
-        
-        // Move around a bit.
-        wf3d_apply_3d(&c3d, matrix_3d_translate(0, 0, 2));
-        wf3d_apply_3d(&c3d, matrix_3d_scale(1.2, 1.2, 1.2));
-        float a = esp_timer_get_time() % 30000000 / 10000000.0 * 2 * M_PI;
-        wf3d_apply_3d(&c3d, matrix_3d_rotate_y(a));
-        
-        // // Sphere.
-        // wf3d_push_3d (&c3d);
-        // wf3d_apply_3d(&c3d, matrix_3d_translate(1, 1, 1));
-        // wf3d_apply_3d(&c3d, matrix_3d_scale(0.25, 0.25, 0.25));
-        // wf3d_apply_3d(&c3d, matrix_3d_rotate_z(a/3));
-        // wf3d_mesh    (&c3d, sphere);
-        // wf3d_pop_3d  (&c3d);
-        
-        // // Sphere 2!
-        // wf3d_push_3d (&c3d);
-        // wf3d_apply_3d(&c3d, matrix_3d_translate(-1, -1, -1));
-        // wf3d_apply_3d(&c3d, matrix_3d_scale(0.25, 0.25, 0.25));
-        // wf3d_apply_3d(&c3d, matrix_3d_rotate_z(a/3));
-        // wf3d_mesh    (&c3d, sphere);
-        // wf3d_pop_3d  (&c3d);
-        
-        // Add the shapes.
-        if (suzanne && scene == 1) {
-            wf3d_mesh(&c3d, suzanne);
-        } else {
-            wf3d_line(&c3d, (vec3f_t) {-1, -1, 0}, (vec3f_t) {1, 1, 0});
-            wf3d_lines(&c3d, 8, cube_vtx, 12, cube_lines);
+        // Wait for the logic task, which submits the geometry before it commits the view.
+        if (scene_queue_wait(&scene, pdMS_TO_TICKS(100))) {
+            scene_update_t update;
+            while (scene_queue_pop(&scene, &update) && update.op != SCENE_END) {
+                if (update.op == SCENE_VIEW) {
+                    mode     = update.view.mode;
+                    eye_dist = update.view.eye_dist;
+                    cam_mtx  = update.view.camera;
+                }
+            }
         }
         
-        if (left && !right) {
-            eye_dist /= 1.05;
-        } else if (right && !left) {
-            eye_dist *= 1.05;
+        // Take the geometry of the next frame, which frees the last one for the logic task to refill.
+        if (!wf3d_pair_swap(&pair)) {
+            // Nothing to draw, so there is headroom to return to full resolution.
+            if (dynres.level) wf3d_dynres_frame(&dynres, 0);
+            continue;
         }
         
-        // Make a camera matrix.
-        matrix_3d_t cam_mtx = 
-            matrix_3d_identity();
-            // matrix_3d_multiply(matrix_3d_rotate_y(a), matrix_3d_translate(0, 0, 2));
-            // matrix_3d_multiply(matrix_3d_translate(0, 0, 2), matrix_3d_rotate_y(a));
-            // matrix_3d_rotate_y(a);
-            // matrix_3d_translate(0, 0, 2);
-        
-        // Render 3D stuff.
-        if (mode == 0) wf3d_render (&buf, 0xffafafaf, &c3d, cam_mtx); // Regular projected 3D.
-        if (mode == 1) wf3d_render2(&buf, 0xffff0000, 0xff00ffff, &c3d, cam_mtx, eye_dist); // Red, Cyan
-        if (mode == 2) wf3d_render2(&buf, 0xffffff00, 0xff0000ff, &c3d, cam_mtx, eye_dist); // Yellow, Blue
-        wf3d_clear(&c3d);
-        
-        // Draws the entire graphics buffer to the screen.
-        disp_flush();
+        // Only redraw when something changed since the last frame.
+        wf3d_sig_mix(c3d, &mode, sizeof(mode));
+        if (mode) wf3d_sig_mix(c3d, &eye_dist, sizeof(eye_dist));
+        pax_buf_t *target = wf3d_dynres_target(&dynres);
+        bool changed = wf3d_changed(c3d, target, cam_mtx);
         
+        if (changed) {
+            int64_t render_start = esp_timer_get_time();
+            pax_background(target, 0);
+            if (RENDER_ON_GPU) quartz_cmd_clear(0, 0, QUARTZ_CLEAR_COLOR);
+            
+            // Render 3D stuff.
+            if (mode == 0) wf3d_render (target, 0xffafafaf, c3d, cam_mtx); // Regular projected 3D.
+            if (mode == 1) wf3d_render2(target, 0xffff0000, 0xff00ffff, c3d, cam_mtx, eye_dist); // Red, Cyan
+            if (mode == 2) wf3d_render2(target, 0xffffff00, 0xff0000ff, c3d, cam_mtx, eye_dist); // Yellow, Blue
+            if (RENDER_ON_GPU && !quartz_batch_flush(&gpu_batch)) {
+                ESP_LOGW(TAG, "Some draw commands did not reach the FPGA");
+            }
+            
+            // The FPGA's framebuffer is updated by comparing against a full frame, so upscale it first.
+            // The LCD is sent the frame while upscaling instead.
+            if (FB_ON_GPU) wf3d_dynres_present(&dynres);
+            int64_t render_us = esp_timer_get_time() - render_start;
+            
+            // Draw render statistics, if enabled.
+            wf3d_draw_stats(FB_ON_GPU ? &buf : target, c3d);
+            
+            // Wait for the frame's time slot and the panel to start blanking.
+            pacer_wait(&pacer);
+            if (pacer.frames == 256) {
+                // By now the drawing queues have grown to fit the scene.
+                wf3d_mem_report(&wf3d_mem_default);
+            }
+            if (pacer.frames % 256 == 0 && pacer.missed != last_missed) {
+                ESP_LOGW(TAG, "Missed %u of the last 256 frame deadlines (worst %lld us late)",
+                    (unsigned) (pacer.missed - last_missed), (long long) pacer.max_late);
+                last_missed    = pacer.missed;
+                pacer.max_late = 0;
+            }
+            uint32_t dropped = atomic_load_explicit(&scene.dropped, memory_order_relaxed);
+            if (pacer.frames % 256 == 0 && (dropped != last_dropped || scene.skipped != last_skipped)) {
+                ESP_LOGW(TAG, "Scene queue dropped %u and skipped %u frames (worst handoff %lld us, %u of %u updates used)",
+                    (unsigned) (dropped - last_dropped), (unsigned) (scene.skipped - last_skipped),
+                    (long long) scene.max_latency, (unsigned) scene.high_water, SCENE_QUEUE_LEN);
+                last_dropped      = dropped;
+                last_skipped      = scene.skipped;
+                scene.max_latency = 0;
+            }
+            
+            // Draws the entire graphics buffer to the screen.
+            int64_t flush_start = esp_timer_get_time();
+            disp_flush();
+            wf3d_stats_flush(c3d, esp_timer_get_time() - flush_start);
+            
+            // Pick the resolution for the next frame, now that this one is out.
+            wf3d_dynres_frame(&dynres, render_us);
+        } else if (dynres.level) {
+            // Nothing to draw, so there is headroom to return to full resolution.
+            wf3d_dynres_frame(&dynres, 0);
+        }
+    }
+}
+
+// Reads input and animates the scene, handing a frame of updates to the render task LOGIC_RATE times a second.
+static void logic_task(void *args) {
+    bool up = 0, down = 0, left = 0, right = 0;
+    
+    int mode = 0;
+    int scene_index = 1;
+    float eye_dist = 0.18;
+    TickType_t wake = xTaskGetTickCount();
+    while (1) {
         // Structure used to receive data.
         rp2040_input_message_t message;
         
-        // Wait for button presses and do another cycle.
-        if (xQueueReceive(buttonQueue, &message, 0)) {
+        // Handle the button presses since the last update.
+        while (xQueueReceive(buttonQueue, &message, 0)) {
             // Which button is currently pressed?
             if (message.input == RP2040_INPUT_BUTTON_HOME && message.state) {
                 // If home is pressed, exit to launcher.
@@ -194,8 +329,8 @@ void app_main() {
                 mode %= 3;
             } else if (message.input == RP2040_INPUT_BUTTON_BACK && message.state) {
                 // Cycle render mode.
-                scene ++;
-                scene %= 2;
+                scene_index ++;
+                scene_index %= 2;
             } else if (message.input == RP2040_INPUT_JOYSTICK_UP) {
                 up    = message.state;
             } else if (message.input == RP2040_INPUT_JOYSTICK_DOWN) {
@@ -206,5 +341,113 @@ void app_main() {
                 right = message.state;
             }
         }
+        
+        if (left && !right) {
+            eye_dist /= 1.05;
+        } else if (right && !left) {
+            eye_dist *= 1.05;
+        }
+        
+        // Build the next frame, unless the render task has not taken the last one yet.
+        wf3d_ctx_t *c3d = wf3d_pair_back(&pair);
+        if (c3d) {
+            // Move around a bit.
+            float a = esp_timer_get_time() % 30000000 / 10000000.0 * 2 * M_PI;
+            matrix_3d_t mtx = matrix_3d_multiply(matrix_3d_translate(0, 0, 2), matrix_3d_scale(1.2, 1.2, 1.2));
+            mtx = matrix_3d_multiply(mtx, matrix_3d_rotate_y(a));
+            
+            // Add the shapes.
+            wf3d_mesh_mtx(c3d, mtx, suzanne && scene_index == 1 ? suzanne : &wf3d_prim_cube);
+            wf3d_pair_submit(&pair);
+            
+            // Make a camera matrix.
+            scene_update_t view = {
+                .op   = SCENE_VIEW,
+                .view = { mode, eye_dist, matrix_3d_identity() },
+            };
+            scene_queue_push(&scene, &view);
+            // Dropped frames are counted by the queue and reported by the render task.
+            scene_queue_commit(&scene);
+        }
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / LOGIC_RATE));
+    }
+}
+
+void app_main() {
+  
+    vTaskDelay(pdMS_TO_TICKS(500));
+    ESP_LOGI(TAG, "Starting...");
+
+    // Initialize the screen, the I2C and the SPI busses.
+    bsp_init();
+
+    // Initialize the RP2040 (responsible for buttons, etc).
+    bsp_rp2040_init();
+    
+    // This queue is used to receive button presses.
+    buttonQueue = get_rp2040()->queue;
+    
+    // Initialize graphics for the screen.
+    pax_buf_init(&buf, NULL, 320, 240, PAX_BUF_16_565RGB);
+    pax_background(&buf, 0xff000000);
+    pax_enable_multicore(1);
+    if (PRESENT_MODE == PRESENT_TEARING_EFFECT || RENDER_ON_GPU || FB_ON_GPU) {
+        // The FPGA forwards the LCD's tearing effect signal.
+        quartz_init();
+    }
+    if (RENDER_ON_GPU || FB_ON_GPU) {
+        // The FPGA drives the LCD from its own framebuffer.
+        quartz_select(true);
+        quartz_batch_init(&gpu_batch);
+        quartz_delta_init(&gpu_delta);
+        quartz_meshes_init(&gpu_meshes, QUARTZ_RAM_FREE, QUARTZ_RAM_SIZE - QUARTZ_RAM_FREE);
+    }
+    // quartz_init();
+    // quartz_debug();
+    // exit_to_launcher();
+    
+    // Initialize NVS.
+    nvs_flash_init();
+    
+    // Initialize WiFi. This doesn't connect to Wifi yet.
+    wifi_init();
+    
+    FILE *fd = fmemopen((void *) suzanne_obj_start, suzanne_obj_end - suzanne_obj_start, "r");
+    suzanne = s3d_decode_obj(fd);
+    
+    wf3d_pair_init(&pair);
+    if (DEPTH_BUFFER || RENDER_ON_GPU) {
+        // The depth buffer prefers internal RAM, but the task stacks must fit there too.
+        // Hold their RAM while placing it, so it goes to PSRAM unless both fit.
+        void *stacks = heap_caps_malloc(RENDER_STACK + LOGIC_STACK + 2 * TASK_OVERHEAD, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        pair.front.depth = wf3d_mem_alloc(&wf3d_mem_default, WF3D_MEM_DEPTH, sizeof(depth_t) * buf.width * buf.height);
+        heap_caps_free(stacks);
+    }
+    if (pair.front.depth) {
+        // Fixed planes around the scene; the eye is about 0.87 units behind the screen.
+        pair.front.depth_mode = WF3D_DEPTH_RECIPROCAL;
+        pair.front.depth_near = 0.5;
+        pair.front.depth_far  = 20;
+        // Draw the nearest triangles first, so hidden pixels fail the depth test instead of being drawn over.
+        pair.front.tri_order  = WF3D_ORDER_FRONT_TO_BACK;
+    } else {
+        if (DEPTH_BUFFER || RENDER_ON_GPU) ESP_LOGW(TAG, "No RAM for the depth buffer, sorting triangles instead");
+        pair.front.depth_mode = WF3D_DEPTH_NONE;
+    }
+    pair.front.draw_mode = DRAW_MODE;
+    if (RENDER_ON_GPU) {
+        // The FPGA keeps its own depth buffer.
+        pair.front.sink = &gpu_sink;
+    }
+    
+    // Where the depth buffer and Suzanne ended up.
+    wf3d_mem_report(&wf3d_mem_default);
+    
+    // Rendering and input each get a core, so a slow input poll or scene update does not hold up a frame.
+    scene_queue_init(&scene);
+    if (xTaskCreatePinnedToCore(render_task, "render", RENDER_STACK, NULL, RENDER_PRIO, NULL, RENDER_CORE) != pdPASS
+     || xTaskCreatePinnedToCore(logic_task,  "logic",  LOGIC_STACK,  NULL, LOGIC_PRIO,  NULL, LOGIC_CORE)  != pdPASS) {
+        ESP_LOGE(TAG, "No internal RAM for the task stacks, %u bytes free", (unsigned) heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+        exit_to_launcher();
     }
 }
@@ -0,0 +1,106 @@
+/*
+    MIT License
+
+    Copyright (c) 2022 Julian Scheffers
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "pacer.h"
+#include "quartz.h"
+
+#include <esp_log.h>
+static const char *TAG = "pacer";
+
+// Wakes the waiting task once the deadline is reached.
+static void pacer_timer_cb(void *arg) {
+    pacer_t *pacer = arg;
+    xTaskNotifyGive(pacer->task);
+}
+
+// Initialises a frame pacer for a target rate in Hz, 0 to not pace.
+void pacer_init(pacer_t *pacer, present_mode_t mode, int rate) {
+    *pacer = (pacer_t) {
+        .mode   = mode,
+        .period = rate > 0 ? 1000000 / rate : 0,
+    };
+    esp_timer_create_args_t args = {
+        .callback = pacer_timer_cb,
+        .arg      = pacer,
+        .name     = "pacer",
+    };
+    esp_err_t res = esp_timer_create(&args, &pacer->timer);
+    if (res) {
+        ESP_LOGE(TAG, "Cannot create timer: %s", esp_err_to_name(res));
+        pacer->timer = NULL;
+    }
+}
+
+// Frees resources held by a frame pacer.
+void pacer_destroy(pacer_t *pacer) {
+    if (pacer->timer) {
+        esp_timer_stop(pacer->timer);
+        esp_timer_delete(pacer->timer);
+        pacer->timer = NULL;
+    }
+}
+
+// Sleeps until the next frame may be presented.
+// Returns false if the frame missed its deadline.
+bool pacer_wait(pacer_t *pacer) {
+    bool on_time = true;
+    pacer->late = 0;
+    
+    if (pacer->period) {
+        int64_t now = esp_timer_get_time();
+        if (!pacer->deadline) {
+            // First frame: nothing to be late for.
+            pacer->deadline = now;
+        }
+        
+        if (now > pacer->deadline) {
+            // Missed it; present right away and restart the schedule from here.
+            on_time         = false;
+            pacer->late     = now - pacer->deadline;
+            if (pacer->late > pacer->max_late) pacer->max_late = pacer->late;
+            pacer->missed  ++;
+            pacer->deadline = now;
+            
+        } else if (pacer->deadline > now && pacer->timer) {
+            // Sleep until the deadline.
+            pacer->task = xTaskGetCurrentTaskHandle();
+            ulTaskNotifyTake(pdTRUE, 0);
+            esp_timer_start_once(pacer->timer, pacer->deadline - now);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        
+        pacer->deadline += pacer->period;
+    }
+    
+    if (pacer->mode == PRESENT_TEARING_EFFECT) {
+        // The FPGA answers at the start of the next tearing effect pulse.
+        quartz_status_t status = quartz_cmd_fmark();
+        if (!status.rx_valid) {
+            pacer->fmark_errors ++;
+        }
+    }
+    
+    pacer->frames ++;
+    return on_time;
+}
@@ -0,0 +1,133 @@
+/*
+    MIT License
+
+    Copyright (c) 2022 Julian Scheffers
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "scene_queue.h"
+#include "esp_timer.h"
+
+_Static_assert((SCENE_QUEUE_LEN & (SCENE_QUEUE_LEN - 1)) == 0, "SCENE_QUEUE_LEN must be a power of two");
+
+// Initialises an empty scene queue.
+void scene_queue_init(scene_queue_t *queue) {
+    *queue = (scene_queue_t) {0};
+    atomic_init(&queue->head,      0);
+    atomic_init(&queue->tail,      0);
+    atomic_init(&queue->frames_in, 0);
+    atomic_init(&queue->waiting,   false);
+    atomic_init(&queue->dropped,   0);
+    queue->doorbell = xSemaphoreCreateBinaryStatic(&queue->doorbell_buf);
+}
+
+// Producer: adds an update to the frame being built.
+// Returns false if it does not fit, in which case the whole frame is dropped at commit.
+bool scene_queue_push(scene_queue_t *queue, const scene_update_t *update) {
+    // The consumer hands slots back by moving the tail.
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (queue->overflow || queue->write - tail >= SCENE_QUEUE_LEN) {
+        queue->overflow = true;
+        return false;
+    }
+    queue->slots[queue->write % SCENE_QUEUE_LEN] = *update;
+    queue->write ++;
+    return true;
+}
+
+// Producer: ends the frame being built and hands it to the consumer.
+// Returns false if it was dropped because the queue was full.
+bool scene_queue_commit(scene_queue_t *queue) {
+    scene_update_t end = {
+        .op   = SCENE_END,
+        .time = esp_timer_get_time(),
+    };
+    scene_queue_push(queue, &end);
+    
+    if (queue->overflow) {
+        // Forget the frame, the consumer only ever sees whole ones.
+        queue->write    = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        queue->overflow = false;
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    
+    // Publish the updates, then the frame.
+    atomic_store_explicit(&queue->head, queue->write, memory_order_release);
+    atomic_fetch_add(&queue->frames_in, 1);
+    
+    // Only wake the consumer if it announced that it sleeps; this pairs with scene_queue_wait.
+    if (atomic_exchange(&queue->waiting, false)) {
+        xSemaphoreGive(queue->doorbell);
+    }
+    return true;
+}
+
+// Takes the next published update.
+static bool scene_queue_take(scene_queue_t *queue, scene_update_t *update) {
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail == head) return false;
+    
+    if (head - tail > queue->high_water) queue->high_water = head - tail;
+    *update = queue->slots[tail % SCENE_QUEUE_LEN];
+    // Hand the slot back to the producer.
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    
+    if (update->op == SCENE_END) queue->frames_out ++;
+    return true;
+}
+
+// Consumer: waits up to `timeout` for a whole frame, skipping to the newest if several are waiting.
+// Returns whether a frame is ready to be taken with scene_queue_pop.
+bool scene_queue_wait(scene_queue_t *queue, TickType_t timeout) {
+    uint32_t frames = atomic_load_explicit(&queue->frames_in, memory_order_acquire);
+    if (frames == queue->frames_out && timeout) {
+        // Announce the wait before checking again, so a frame committed in between rings the doorbell.
+        atomic_store(&queue->waiting, true);
+        frames = atomic_load(&queue->frames_in);
+        if (frames == queue->frames_out) {
+            xSemaphoreTake(queue->doorbell, timeout);
+            frames = atomic_load_explicit(&queue->frames_in, memory_order_acquire);
+        }
+        atomic_store_explicit(&queue->waiting, false, memory_order_relaxed);
+    }
+    if (frames == queue->frames_out) return false;
+    
+    // Older frames are out of date, only the newest is drawn.
+    scene_update_t update;
+    while (frames - queue->frames_out > 1) {
+        while (scene_queue_take(queue, &update) && update.op != SCENE_END);
+        queue->skipped ++;
+    }
+    return true;
+}
+
+// Consumer: takes the next update of the frame; the SCENE_END update is the last one.
+// Returns false if there is nothing to take.
+bool scene_queue_pop(scene_queue_t *queue, scene_update_t *update) {
+    if (!scene_queue_take(queue, update)) return false;
+    
+    if (update->op == SCENE_END) {
+        queue->latency = esp_timer_get_time() - update->time;
+        if (queue->latency > queue->max_latency) queue->max_latency = queue->latency;
+    }
+    return true;
+}